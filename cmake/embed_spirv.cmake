@@ -0,0 +1,41 @@
+# Writes the SPIR-V files in INPUTS into the header OUTPUT, one constexpr
+# byte array per file named gfx_spirv_<file name with dots as underscores>,
+# e.g. basic.vert.spv becomes gfx_spirv_basic_vert.
+#
+#     cmake -DINPUTS="a.vert.spv;b.frag.spv" -DOUTPUT=gfx_shader_spirv.h -P embed_spirv.cmake
+
+if(NOT DEFINED INPUTS OR NOT DEFINED OUTPUT)
+    message(FATAL_ERROR "embed_spirv.cmake needs INPUTS and OUTPUT")
+endif()
+
+set(content "// Generated by cmake/embed_spirv.cmake, do not edit.\n\n#pragma once\n\n#include \"defines.h\"\n")
+
+foreach(input IN LISTS INPUTS)
+    get_filename_component(file_name "${input}" NAME)
+    string(REGEX REPLACE "\\.spv$" "" name "${file_name}")
+    string(MAKE_C_IDENTIFIER "${name}" name)
+
+    file(READ "${input}" hex HEX)
+    string(LENGTH "${hex}" hex_length)
+    if(hex_length EQUAL 0)
+        message(FATAL_ERROR "${input} is empty")
+    endif()
+
+    # 16 bytes per line, CMake regexes have no repeat counts.
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(REPEAT "0x..," 16 line)
+    string(REGEX REPLACE "(${line})" "\\1\n    " bytes "${bytes}")
+    string(REGEX REPLACE "\n    $" "" bytes "${bytes}")
+
+    string(APPEND content "\nalignas(4) constexpr u8 gfx_spirv_${name}[] = {\n    ${bytes}\n};\n")
+endforeach()
+
+# Only touch the header when it changes, so the sources using it are not
+# rebuilt for nothing.
+if(EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" previous)
+    if(previous STREQUAL content)
+        return()
+    endif()
+endif()
+file(WRITE "${OUTPUT}" "${content}")
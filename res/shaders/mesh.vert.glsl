@@ -0,0 +1,26 @@
+#version 460
+
+// Vertex layout: GFX_VERTEX_LAYOUT_FLOAT.
+
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_normal;
+layout(location = 2) in vec2 in_texcoord;
+layout(location = 4) in mat4 in_transform; // Per instance, locations 4-7
+
+layout(location = 0) out vec4 out_color;
+layout(location = 1) out vec2 out_texcoord;
+
+layout(set=1, binding=0) uniform Uniform_Block {
+    mat4 view_proj;      // View-projection matrix
+    vec4 dequant_scale;  // Unused by this layout
+    vec4 dequant_offset; // Unused by this layout
+};
+
+void main() {
+    vec3 normal = normalize(mat3(in_transform) * in_normal);
+    float light = 0.5 + 0.5 * max(dot(normal, normalize(vec3(0.3, 0.8, 0.5))), 0.0);
+
+    gl_Position = view_proj * in_transform * vec4(in_position, 1.0);
+    out_color = vec4(vec3(light), 1.0);
+    out_texcoord = in_texcoord;
+}
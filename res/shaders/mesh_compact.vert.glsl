@@ -0,0 +1,35 @@
+#version 460
+
+// Vertex layout: GFX_VERTEX_LAYOUT_COMPACT.
+
+layout(location = 0) in vec4 in_position; // snorm16, w = tangent handedness
+layout(location = 1) in vec2 in_normal;   // Octahedral snorm16
+layout(location = 2) in vec2 in_texcoord; // Half float
+layout(location = 4) in mat4 in_transform; // Per instance, locations 4-7
+
+layout(location = 0) out vec4 out_color;
+layout(location = 1) out vec2 out_texcoord;
+
+layout(set=1, binding=0) uniform Uniform_Block {
+    mat4 view_proj;      // View-projection matrix
+    vec4 dequant_scale;  // position = in_position * scale + offset
+    vec4 dequant_offset;
+};
+
+vec3 oct_decode(vec2 e) {
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
+void main() {
+    vec3 position = in_position.xyz * dequant_scale.xyz + dequant_offset.xyz;
+    vec3 normal = normalize(mat3(in_transform) * oct_decode(in_normal));
+    float light = 0.5 + 0.5 * max(dot(normal, normalize(vec3(0.3, 0.8, 0.5))), 0.0);
+
+    gl_Position = view_proj * in_transform * vec4(position, 1.0);
+    out_color = vec4(vec3(light), 1.0);
+    out_texcoord = in_texcoord;
+}
@@ -6,10 +6,17 @@
 #include <glm/glm.hpp>
 
 #include "gfx.h"
+#include "gfx_stream.h"
+#include "gfx_texture_cache.h"
+#include "job.h"
+#include "profile.h"
 
 struct App_State {
     SDL_Window *window;
     Gfx_Context gfx;
+    Job_System jobs;
+    Gfx_Stream stream;
+    Gfx_Texture_Cache textures;
 
     // Time in milliseconds.
     u64 last_time = 0;
@@ -19,5 +26,7 @@ struct App_State {
     glm::mat4 proj  = glm::mat4(1.0f);
     glm::mat4 model = glm::mat4(1.0f);
 
-    Gfx_Model sample_model;
+    // Owned by the stream, drawn as its meshes arrive.
+    Gfx_Asset *sample_model = NULL;
+    Gfx_Texture_Handle *sample_texture = NULL;
 };
@@ -0,0 +1,870 @@
+#include "defines.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+
+#include "gfx.h"
+#include "job.h"
+#include "profile.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+//
+// Headless frame benchmark. Runs the CPU side of the app's frame on
+// synthetic scenes: glTF load, transform updates, culling, sorting, vertex
+// packing and upload planning, with the SDL GPU calls going to the
+// recording device (see gfx_gpu_record.h). No window or GPU is needed.
+//
+// Usage: app_bench [static|animated|streaming|outdoor|interior] [--frames <n>] [--warmup <n>] [--seed <n>] [--threads <n>]
+//                  [--output <file>]
+//
+// Without a scene name all of them run. Each scene is generated from the
+// seed as a .gltf and .bin pair, loaded with gfx_model_load_ex(), uploaded,
+// then drawn for --warmup frames and measured for --frames more, at a fixed
+// 60 Hz time step. The warmup also lets the background pipelines finish.
+// The same seed, frame count and thread count replay the same frames: the
+// per-frame counters and their checksum are identical between runs.
+//
+// static:    a few dozen meshes instanced thousands of times on a grid, all
+//            submitted every frame, with an orbiting camera. Culling,
+//            sorting and instance upload.
+//
+// animated:  one large node hierarchy with a quarter of its nodes spinning,
+//            whole subtrees under the moving group nodes. Transform updates.
+//
+// streaming: hundreds of unique meshes spread over a world four times
+//            larger than the GPU budget. The camera flies around it and only
+//            submits the meshes near it, so meshes are evicted and packed
+//            again as they come back. Meshlet culling is on.
+//
+// outdoor:   finer spheres repeated over a wide field, seen from a camera
+//            flying low over it, so most instances are far away. The meshes
+//            get LOD chains after loading and gfx_draw() picks a level per
+//            instance. Reports the triangles of every level and the indices
+//            drawn against drawing every instance in full.
+//
+// interior:  every group is a room closed by four walls, with doorways at
+//            the corners, and the camera walks through the rooms at eye
+//            height. The walls near the camera are submitted as occluders
+//            too, so gfx_draw() drops the instances in the rooms behind
+//            them. Reports the occluders and the instances they hide.
+//
+// The results go to --output (app_bench.json by default) as JSON: per scene
+// the load times, the p50, p99, max and mean of every frame phase (the
+// PROFILE_ZONE names of the main thread, see profile.h), the mean per-frame
+// counters, the triangles per LOD level and the checksum. The phase table is
+// also logged.
+//
+
+#if !PROFILE_ENABLED || !GFX_GPU_RECORD
+    #error "app_bench needs PROFILE_ENABLED and GFX_GPU_RECORD, see CMakeLists.txt"
+#endif
+
+#define DEFAULT_OUTPUT "app_bench.json"
+#define FRAME_STEP     (1.0f / 60.0f)
+#define ROOM_WALLS     4
+
+struct Bench_Scene {
+    const char *name;
+
+    // The model: groups of spheres under one root, the groups on a grid.
+    int groups;
+    int meshes_per_group;
+    int min_segments; // Sphere resolution, picked per mesh.
+    int max_segments;
+    f32 group_spacing;
+
+    int copies;           // Instances of the whole model, on a grid.
+    int animated_percent; // Of the nodes below the root, spun every frame.
+
+    f32 submit_radius;    // Meshes farther from the camera are not submitted, 0 submits all.
+    f32 budget_fraction;  // GPU budget of the meshes as a fraction of their size, 0 for none.
+    bool look_ahead;      // The camera looks along its path instead of at the center.
+    f32 camera_height;    // 0 for a quarter of the orbit radius.
+    bool meshlets;
+    bool lods;
+    bool walls;           // Every group gets ROOM_WALLS walls around it, each its own mesh.
+    f32 occluder_radius;  // Walls nearer the camera are also submitted as occluders.
+
+    Gfx_Vertex_Layout layout;
+};
+
+static const Bench_Scene bench_scenes[] = {
+    {"static",     4,  8,  8, 24,  6.0f, 256,  0,   0.0f, 0.0f,  false, 0.0f, false, false, false,  0.0f, GFX_VERTEX_LAYOUT_COMPACT},
+    {"animated", 256, 16,  8, 16,  8.0f,   1, 25,   0.0f, 0.0f,  false, 0.0f, false, false, false,  0.0f, GFX_VERTEX_LAYOUT_COMPACT},
+    {"streaming", 64,  8, 24, 64, 40.0f,   1,  0,  60.0f, 0.25f, true,  0.0f, true,  false, false,  0.0f, GFX_VERTEX_LAYOUT_COMPACT},
+    {"outdoor",   16,  8, 48, 96,  8.0f, 256,  0,   0.0f, 0.0f,  true,  3.0f, false, true,  false,  0.0f, GFX_VERTEX_LAYOUT_COMPACT},
+    {"interior",  16, 12, 16, 32,  8.0f,  16,  0,   0.0f, 0.0f,  true,  1.6f, false, false, true,  16.0f, GFX_VERTEX_LAYOUT_COMPACT},
+};
+
+static f64 elapsed_ms(u64 start) {
+    return cast(f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / cast(f64)SDL_GetPerformanceFrequency();
+}
+
+// xorshift64*, good enough for benchmark data.
+static u64 next_random(u64 *state) {
+    u64 x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545f4914f6cdd1dull;
+}
+
+static f32 random_range(u64 *state, f32 min, f32 max) {
+    return min + (max - min) * cast(f32)(next_random(state) >> 40) / cast(f32)(1 << 24);
+}
+
+static u64 random_seed(u64 seed) {
+    u64 state = seed ^ 0x9e3779b97f4a7c15ull;
+    return state ? state : 1;
+}
+
+// Position of item index of count on a centered square grid.
+static glm::vec3 grid_position(int index, int count, f32 spacing) {
+    int side = cast(int)SDL_ceil(SDL_sqrt(cast(f64)count));
+    f32 half = cast(f32)(side - 1) * 0.5f;
+    return glm::vec3((cast(f32)(index % side) - half) * spacing, 0.0f, (cast(f32)(index / side) - half) * spacing);
+}
+
+//
+// Text building, for the glTF and the results.
+//
+
+struct Text {
+    char *data = NULL;
+    usize size = 0;
+    usize capacity = 0;
+    bool failed = false;
+};
+
+static void text_append(Text *text, const char *format, ...) {
+    if (text->failed) return;
+
+    va_list args;
+    va_start(args, format);
+    defer { va_end(args); };
+
+    va_list measure;
+    va_copy(measure, args);
+    int length = SDL_vsnprintf(NULL, 0, format, measure);
+    va_end(measure);
+    if (length < 0) {
+        text->failed = true;
+        return;
+    }
+
+    usize needed = text->size + cast(usize)length + 1;
+    if (needed > text->capacity) {
+        usize capacity = SDL_max(SDL_max(text->capacity * 2, needed), cast(usize)4096);
+        auto data = cast(char *)SDL_realloc(text->data, capacity);
+        if (!data) {
+            text->failed = true;
+            return;
+        }
+        text->data = data;
+        text->capacity = capacity;
+    }
+
+    SDL_vsnprintf(text->data + text->size, text->capacity - text->size, format, args);
+    text->size += cast(usize)length;
+}
+
+static void text_free(Text *text) {
+    SDL_free(text->data);
+    *text = {};
+}
+
+// Writes through a temporary file so a failed write never leaves a
+// truncated file behind.
+static bool save_file(const char *file, const void *data, usize size) {
+    char temp_file[1024];
+    SDL_snprintf(temp_file, sizeof(temp_file), "%s.tmp", file);
+    if (!SDL_SaveFile(temp_file, data, size)) return false;
+
+    SDL_RemovePath(file);
+    if (!SDL_RenamePath(temp_file, file)) {
+        SDL_RemovePath(temp_file);
+        return false;
+    }
+    return true;
+}
+
+//
+// Scene generation.
+//
+
+// UV spheres of unit radius, with rings = segments / 2. Stored in the .bin
+// as positions, normals, texcoords and u16 indices, padded to 4 bytes.
+static int sphere_rings(int segments) {
+    return SDL_max(segments / 2, 2);
+}
+
+static int sphere_vertex_count(int segments) {
+    return (sphere_rings(segments) + 1) * (segments + 1);
+}
+
+static int sphere_index_count(int segments) {
+    return sphere_rings(segments) * segments * 6;
+}
+
+static usize sphere_bytes(int segments) {
+    usize vertex_count = cast(usize)sphere_vertex_count(segments);
+    usize index_bytes  = cast(usize)sphere_index_count(segments) * sizeof(u16);
+    return vertex_count * 8 * sizeof(f32) + ((index_bytes + 3) & ~cast(usize)3);
+}
+
+static void write_sphere(u8 *bin, int segments) {
+    int rings = sphere_rings(segments);
+    int vertex_count = sphere_vertex_count(segments);
+
+    auto positions = cast(f32 *)bin;
+    auto normals   = positions + vertex_count * 3;
+    auto texcoords = normals + vertex_count * 3;
+    auto indices   = cast(u16 *)(texcoords + vertex_count * 2);
+
+    int v = 0;
+    for (int r = 0; r <= rings; r++) {
+        f32 theta = SDL_PI_F * cast(f32)r / cast(f32)rings;
+        for (int s = 0; s <= segments; s++, v++) {
+            f32 phi = 2.0f * SDL_PI_F * cast(f32)s / cast(f32)segments;
+            glm::vec3 n(SDL_sinf(theta) * SDL_cosf(phi), SDL_cosf(theta), SDL_sinf(theta) * SDL_sinf(phi));
+            positions[v * 3 + 0] = n.x;
+            positions[v * 3 + 1] = n.y;
+            positions[v * 3 + 2] = n.z;
+            normals[v * 3 + 0] = n.x;
+            normals[v * 3 + 1] = n.y;
+            normals[v * 3 + 2] = n.z;
+            texcoords[v * 2 + 0] = cast(f32)s / cast(f32)segments;
+            texcoords[v * 2 + 1] = cast(f32)r / cast(f32)rings;
+        }
+    }
+
+    int i = 0;
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            u16 a = cast(u16)(r * (segments + 1) + s);
+            u16 b = cast(u16)(a + segments + 1);
+            indices[i++] = a;
+            indices[i++] = b;
+            indices[i++] = cast(u16)(a + 1);
+            indices[i++] = cast(u16)(a + 1);
+            indices[i++] = b;
+            indices[i++] = cast(u16)(b + 1);
+        }
+    }
+}
+
+// A box from -1 to 1, four vertices per face for flat normals, stored like
+// the spheres. Its nodes scale it into walls.
+#define BOX_VERTEX_COUNT 24
+#define BOX_INDEX_COUNT  36
+
+static usize box_bytes() {
+    return BOX_VERTEX_COUNT * 8 * sizeof(f32) + BOX_INDEX_COUNT * sizeof(u16);
+}
+
+static void write_box(u8 *bin) {
+    auto positions = cast(f32 *)bin;
+    auto normals   = positions + BOX_VERTEX_COUNT * 3;
+    auto texcoords = normals + BOX_VERTEX_COUNT * 3;
+    auto indices   = cast(u16 *)(texcoords + BOX_VERTEX_COUNT * 2);
+
+    static const f32 corners[4][2] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+    for (int face = 0; face < 6; face++) {
+        int axis = face / 2;
+        int u    = (axis + 1) % 3;
+        int v    = (axis + 2) % 3;
+        f32 sign = face % 2 ? -1.0f : 1.0f;
+
+        for (int k = 0; k < 4; k++) {
+            int vertex = face * 4 + k;
+            for (int c = 0; c < 3; c++) {
+                positions[vertex * 3 + c] = 0.0f;
+                normals[vertex * 3 + c]   = 0.0f;
+            }
+            positions[vertex * 3 + axis] = sign;
+            positions[vertex * 3 + u]    = corners[k][0];
+            positions[vertex * 3 + v]    = corners[k][1];
+            normals[vertex * 3 + axis]   = sign;
+            texcoords[vertex * 2 + 0]    = corners[k][0] * 0.5f + 0.5f;
+            texcoords[vertex * 2 + 1]    = corners[k][1] * 0.5f + 0.5f;
+        }
+
+        // u x v points along +axis, so the negative faces turn around to
+        // stay counter-clockwise from outside.
+        u16 base = cast(u16)(face * 4);
+        u16 quad[6] = {0, 1, 2, 0, 2, 3};
+        if (sign < 0.0f) {
+            quad[1] = 2; quad[2] = 1;
+            quad[4] = 3; quad[5] = 2;
+        }
+        for (int k = 0; k < 6; k++) indices[face * 6 + k] = cast(u16)(base + quad[k]);
+    }
+}
+
+// The glTF lists the spheres first, then the walls of every group when the
+// scene has them. The loaded model has them in node order instead: per
+// group its spheres, then its walls.
+static int scene_sphere_count(const Bench_Scene *scene) {
+    return scene->groups * scene->meshes_per_group;
+}
+
+static int scene_mesh_count(const Bench_Scene *scene) {
+    return scene_sphere_count(scene) + (scene->walls ? scene->groups * ROOM_WALLS : 0);
+}
+
+// Writes the model of scene to gltf_file and bin_file, both in the working
+// directory. Returns false on failure.
+static bool write_scene_files(const Bench_Scene *scene, u64 seed, const char *gltf_file, const char *bin_file) {
+    int mesh_count = scene_sphere_count(scene);
+    int wall_count = scene_mesh_count(scene) - mesh_count;
+    u64 random = random_seed(seed);
+
+    auto segments = cast(int *)SDL_malloc(cast(usize)mesh_count * sizeof(int));
+    auto offsets  = cast(usize *)SDL_malloc(cast(usize)mesh_count * sizeof(usize));
+    defer { SDL_free(segments); SDL_free(offsets); };
+    if (!segments || !offsets) return false;
+
+    usize bin_size = 0;
+    for (int m = 0; m < mesh_count; m++) {
+        segments[m] = scene->min_segments + cast(int)(next_random(&random) % cast(u64)(scene->max_segments - scene->min_segments + 1));
+        offsets[m]  = bin_size;
+        bin_size   += sphere_bytes(segments[m]);
+    }
+
+    // All the walls share one box.
+    usize box_offset = bin_size;
+    if (wall_count > 0) bin_size += box_bytes();
+
+    auto bin = cast(u8 *)SDL_calloc(1, SDL_max(bin_size, cast(usize)1));
+    if (!bin) return false;
+    defer { SDL_free(bin); };
+    for (int m = 0; m < mesh_count; m++) write_sphere(bin + offsets[m], segments[m]);
+    if (wall_count > 0) write_box(bin + box_offset);
+
+    Text text;
+    defer { text_free(&text); };
+    text_append(&text, "{\n\"asset\":{\"version\":\"2.0\",\"generator\":\"app_bench\"},\n\"scene\":0,\n\"scenes\":[{\"nodes\":[0]}],\n");
+
+    // The root, then every group followed by its spheres and walls:
+    // depth-first order.
+    int group_walls  = wall_count / scene->groups;
+    int group_stride = scene->meshes_per_group + group_walls + 1;
+    text_append(&text, "\"nodes\":[\n{\"name\":\"root\",\"children\":[");
+    for (int g = 0; g < scene->groups; g++) text_append(&text, "%s%d", g ? "," : "", 1 + g * group_stride);
+    text_append(&text, "]}");
+
+    for (int g = 0; g < scene->groups; g++) {
+        glm::vec3 position = grid_position(g, scene->groups, scene->group_spacing);
+        text_append(&text, ",\n{\"translation\":[%g,%g,%g],\"children\":[", position.x, position.y, position.z);
+        for (int k = 0; k < scene->meshes_per_group + group_walls; k++) text_append(&text, "%s%d", k ? "," : "", 2 + g * group_stride + k);
+        text_append(&text, "]}");
+
+        for (int k = 0; k < scene->meshes_per_group; k++) {
+            f32 angle  = 2.0f * SDL_PI_F * cast(f32)k / cast(f32)scene->meshes_per_group;
+            f32 radius = scene->group_spacing * 0.3f;
+            f32 height = random_range(&random, 0.5f, 2.0f);
+            f32 size   = random_range(&random, 0.4f, 1.2f);
+            glm::quat rotation = glm::angleAxis(random_range(&random, 0.0f, 2.0f * SDL_PI_F), glm::vec3(0.0f, 1.0f, 0.0f));
+            text_append(&text, ",\n{\"mesh\":%d,\"translation\":[%g,%g,%g],\"rotation\":[%g,%g,%g,%g],\"scale\":[%g,%g,%g]}",
+                        g * scene->meshes_per_group + k, radius * SDL_cosf(angle), height, radius * SDL_sinf(angle),
+                        rotation.x, rotation.y, rotation.z, rotation.w, size, size, size);
+        }
+
+        // Walls 3 high and 0.2 thick just inside the group cell, leaving
+        // corridors between the rooms and doorways at their corners.
+        for (int w = 0; w < group_walls; w++) {
+            f32 offset = (w % 2 ? -0.45f : 0.45f) * scene->group_spacing;
+            f32 length = 0.35f * scene->group_spacing;
+            bool along_z = w < 2;
+            text_append(&text, ",\n{\"mesh\":%d,\"translation\":[%g,1.5,%g],\"scale\":[%g,1.5,%g]}",
+                        mesh_count + g * group_walls + w, along_z ? offset : 0.0f, along_z ? 0.0f : offset,
+                        along_z ? 0.1f : length, along_z ? length : 0.1f);
+        }
+    }
+    text_append(&text, "\n],\n");
+
+    text_append(&text, "\"meshes\":[\n");
+    for (int m = 0; m < mesh_count; m++) {
+        text_append(&text, "%s{\"primitives\":[{\"attributes\":{\"POSITION\":%d,\"NORMAL\":%d,\"TEXCOORD_0\":%d},\"indices\":%d}]}",
+                    m ? ",\n" : "", m * 4 + 0, m * 4 + 1, m * 4 + 2, m * 4 + 3);
+    }
+    for (int w = 0; w < wall_count; w++) {
+        int box = mesh_count * 4;
+        text_append(&text, "%s{\"primitives\":[{\"attributes\":{\"POSITION\":%d,\"NORMAL\":%d,\"TEXCOORD_0\":%d},\"indices\":%d}]}",
+                    (mesh_count + w) ? ",\n" : "", box + 0, box + 1, box + 2, box + 3);
+    }
+    text_append(&text, "\n],\n");
+
+    // One buffer view per accessor.
+    text_append(&text, "\"accessors\":[\n");
+    for (int m = 0; m < mesh_count; m++) {
+        int vertex_count = sphere_vertex_count(segments[m]);
+        int index_count  = sphere_index_count(segments[m]);
+        text_append(&text, "%s{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\",\"min\":[-1,-1,-1],\"max\":[1,1,1]},\n",
+                    m ? ",\n" : "", m * 4 + 0, vertex_count);
+        text_append(&text, "{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\"},\n", m * 4 + 1, vertex_count);
+        text_append(&text, "{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC2\"},\n", m * 4 + 2, vertex_count);
+        text_append(&text, "{\"bufferView\":%d,\"componentType\":5123,\"count\":%d,\"type\":\"SCALAR\"}", m * 4 + 3, index_count);
+    }
+    if (wall_count > 0) {
+        int box = mesh_count * 4;
+        text_append(&text, "%s{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\",\"min\":[-1,-1,-1],\"max\":[1,1,1]},\n",
+                    mesh_count ? ",\n" : "", box + 0, BOX_VERTEX_COUNT);
+        text_append(&text, "{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\"},\n", box + 1, BOX_VERTEX_COUNT);
+        text_append(&text, "{\"bufferView\":%d,\"componentType\":5126,\"count\":%d,\"type\":\"VEC2\"},\n", box + 2, BOX_VERTEX_COUNT);
+        text_append(&text, "{\"bufferView\":%d,\"componentType\":5123,\"count\":%d,\"type\":\"SCALAR\"}", box + 3, BOX_INDEX_COUNT);
+    }
+    text_append(&text, "\n],\n");
+
+    text_append(&text, "\"bufferViews\":[\n");
+    for (int m = 0; m < mesh_count; m++) {
+        usize vertex_count = cast(usize)sphere_vertex_count(segments[m]);
+        usize sizes[4] = {vertex_count * 12, vertex_count * 12, vertex_count * 8, cast(usize)sphere_index_count(segments[m]) * 2};
+        usize offset = offsets[m];
+        for (int v = 0; v < 4; v++) {
+            text_append(&text, "%s{\"buffer\":0,\"byteOffset\":%llu,\"byteLength\":%llu}", (m || v) ? ",\n" : "",
+                        cast(unsigned long long)offset, cast(unsigned long long)sizes[v]);
+            offset += sizes[v];
+        }
+    }
+    if (wall_count > 0) {
+        usize sizes[4] = {BOX_VERTEX_COUNT * 12, BOX_VERTEX_COUNT * 12, BOX_VERTEX_COUNT * 8, BOX_INDEX_COUNT * 2};
+        usize offset = box_offset;
+        for (int v = 0; v < 4; v++) {
+            text_append(&text, "%s{\"buffer\":0,\"byteOffset\":%llu,\"byteLength\":%llu}", (mesh_count || v) ? ",\n" : "",
+                        cast(unsigned long long)offset, cast(unsigned long long)sizes[v]);
+            offset += sizes[v];
+        }
+    }
+    text_append(&text, "\n],\n");
+
+    text_append(&text, "\"buffers\":[{\"uri\":\"%s\",\"byteLength\":%llu}]\n}\n", bin_file, cast(unsigned long long)bin_size);
+    if (text.failed) return false;
+
+    return save_file(bin_file, bin, bin_size) && save_file(gltf_file, text.data, text.size);
+}
+
+//
+// Frames.
+//
+
+struct Bench_Animation {
+    int node;
+    glm::vec3 axis;
+    f32 speed; // Radians per second.
+    glm::quat rest;
+};
+
+// Per frame, summed over the measured frames. Only counts, so they are the
+// same on every run and go into the checksum.
+struct Bench_Counters {
+    u64 submitted       = 0;
+    u64 frustum_culled  = 0;
+    u64 meshlets_culled = 0;
+    u64 nodes_updated   = 0;
+    u64 packets         = 0;
+    u64 draws           = 0;
+    u64 binds           = 0;
+    u64 indices         = 0;
+    u64 full_indices    = 0; // Had every instance drawn its full mesh.
+    u64 upload_bytes    = 0;
+    u64 evictions       = 0;
+    u64 restores        = 0;
+    u64 restored_bytes  = 0;
+    u64 lod_instances[GFX_LOD_MAX_LEVELS + 1] = {};
+    u64 occluders        = 0;
+    u64 occlusion_tested = 0; // Instances left after frustum culling, when there were occluders.
+    u64 occlusion_culled = 0;
+};
+
+static void add_counters(Bench_Counters *total, const Bench_Counters *frame) {
+    total->submitted       += frame->submitted;
+    total->frustum_culled  += frame->frustum_culled;
+    total->meshlets_culled += frame->meshlets_culled;
+    total->nodes_updated   += frame->nodes_updated;
+    total->packets         += frame->packets;
+    total->draws           += frame->draws;
+    total->binds           += frame->binds;
+    total->indices         += frame->indices;
+    total->full_indices    += frame->full_indices;
+    total->upload_bytes    += frame->upload_bytes;
+    total->evictions       += frame->evictions;
+    total->restores        += frame->restores;
+    total->restored_bytes  += frame->restored_bytes;
+    for (int l = 0; l <= GFX_LOD_MAX_LEVELS; l++) total->lod_instances[l] += frame->lod_instances[l];
+    total->occluders        += frame->occluders;
+    total->occlusion_tested += frame->occlusion_tested;
+    total->occlusion_culled += frame->occlusion_culled;
+}
+
+static glm::mat4 camera_view(const Bench_Scene *scene, f32 extent, int frame) {
+    f32 time   = cast(f32)frame * FRAME_STEP;
+    f32 radius = SDL_max(extent * 0.6f, 4.0f);
+    f32 angle  = time * (scene->look_ahead ? 0.5f : 0.2f);
+    f32 height = scene->camera_height > 0.0f ? scene->camera_height : 2.0f + radius * 0.25f;
+    glm::vec3 eye(radius * SDL_cosf(angle), height, radius * SDL_sinf(angle));
+
+    glm::vec3 target(0.0f);
+    if (scene->look_ahead) {
+        target   = eye + glm::vec3(-SDL_sinf(angle), 0.0f, SDL_cosf(angle)) * radius * 0.5f;
+        target.y = 0.0f;
+    }
+    return glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+static void write_phases(Text *json) {
+    Profile_Phase_Stats stats[PROFILE_MAX_PHASES];
+    int count = profile_phase_stats(stats, PROFILE_MAX_PHASES);
+
+    text_append(json, "      \"phases\": {\n");
+    for (int i = 0; i < count; i++) {
+        const Profile_Phase_Stats *phase = &stats[i];
+        text_append(json, "        \"%s\": {\"frames\": %d, \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, \"mean_ms\": %.4f}%s\n",
+                    phase->name, phase->frames, phase->p50_ms, phase->p99_ms, phase->max_ms, phase->mean_ms,
+                    i + 1 < count ? "," : "");
+    }
+    text_append(json, "      },\n");
+}
+
+static bool run_scene(Job_System *jobs, const Bench_Scene *scene, u64 seed, int frames, int warmup, Text *json, bool first) {
+    char gltf_file[256];
+    char bin_file[256];
+    SDL_snprintf(gltf_file, sizeof(gltf_file), "app_bench_%s.gltf", scene->name);
+    SDL_snprintf(bin_file, sizeof(bin_file), "app_bench_%s.bin", scene->name);
+
+    u64 start = SDL_GetPerformanceCounter();
+    bool written = write_scene_files(scene, seed, gltf_file, bin_file);
+    f64 generate_ms = elapsed_ms(start);
+    if (!written) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s: failed to write %s: %s", scene->name, gltf_file, SDL_GetError());
+        return false;
+    }
+
+    Gfx_Model model;
+    start = SDL_GetPerformanceCounter();
+    gfx_model_load_ex(&model, gltf_file, jobs);
+    f64 load_ms = elapsed_ms(start);
+    defer { gfx_model_cleanup(&model); };
+
+    SDL_RemovePath(gltf_file);
+    SDL_RemovePath(bin_file);
+
+    int mesh_count  = scene_mesh_count(scene);
+    int group_size  = mesh_count / scene->groups;
+    if (model.mesh_count != mesh_count) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s: loaded %d of %d meshes", scene->name, model.mesh_count, mesh_count);
+        return false;
+    }
+
+    Gfx_Context gfx{};
+    gfx_init(&gfx, NULL);
+    gfx.jobs = jobs;
+    defer { gfx_cleanup(&gfx); };
+
+    auto gpu_meshes = cast(Gfx_GPU_Mesh *)SDL_calloc(cast(usize)mesh_count, sizeof(Gfx_GPU_Mesh));
+    defer {
+        for (int i = 0; gpu_meshes && i < mesh_count; i++) gfx_mesh_release(&gfx, &gpu_meshes[i]);
+        SDL_free(gpu_meshes);
+    };
+    if (!gpu_meshes) return false;
+
+    u64 vertex_total   = 0;
+    u64 triangle_total = 0;
+    u64 bytes_before   = gfx_residency_bytes(&gfx.residency.stats);
+
+    f64 meshlets_ms = 0.0;
+    if (scene->meshlets) {
+        start = SDL_GetPerformanceCounter();
+        bool built = gfx_model_build_meshlets(&model, jobs);
+        meshlets_ms = elapsed_ms(start);
+        if (!built) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s: failed to build the meshlets", scene->name);
+            return false;
+        }
+    }
+
+    // Meshes with fewer levels count with their coarsest one.
+    f64 lods_ms = 0.0;
+    u64 lod_triangles[GFX_LOD_MAX_LEVELS + 1] = {};
+    if (scene->lods) {
+        start = SDL_GetPerformanceCounter();
+        bool built = gfx_model_build_lods(&model, NULL, jobs, false);
+        lods_ms = elapsed_ms(start);
+        if (!built) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s: failed to build the LODs", scene->name);
+            return false;
+        }
+    }
+    for (int i = 0; i < mesh_count; i++) {
+        const Gfx_Mesh *mesh = &model.meshes[i];
+        for (int l = 0; l <= GFX_LOD_MAX_LEVELS; l++) {
+            int level = SDL_min(l, mesh->lod_count);
+            lod_triangles[l] += level == 0 ? cast(u64)mesh->triangle_count : mesh->lods[level - 1].index_count / 3;
+        }
+    }
+
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < mesh_count; i++) {
+        const Gfx_Mesh *mesh = &model.meshes[i];
+        gfx_mesh_upload(&gfx, &gpu_meshes[i], mesh, scene->layout);
+        if (mesh->meshlets.count > 0) gpu_meshes[i].meshlets = &mesh->meshlets;
+
+        vertex_total   += cast(u64)mesh->vertex_count;
+        triangle_total += cast(u64)mesh->triangle_count;
+    }
+    f64 upload_ms = elapsed_ms(start);
+    u64 mesh_bytes = gfx_residency_bytes(&gfx.residency.stats) - bytes_before;
+
+    if (scene->budget_fraction > 0.0f) {
+        gfx.residency.budget_bytes = bytes_before + cast(u64)(cast(f64)mesh_bytes * scene->budget_fraction);
+    }
+
+    // Copies of the model, and the half width of the world for the camera.
+    auto copies = cast(glm::mat4 *)SDL_malloc(cast(usize)scene->copies * sizeof(glm::mat4));
+    defer { SDL_free(copies); };
+    if (!copies) return false;
+
+    int group_side = cast(int)SDL_ceil(SDL_sqrt(cast(f64)scene->groups));
+    f32 model_size = cast(f32)group_side * scene->group_spacing;
+    for (int c = 0; c < scene->copies; c++) {
+        copies[c] = glm::translate(glm::mat4(1.0f), grid_position(c, scene->copies, model_size));
+    }
+    int copy_side = cast(int)SDL_ceil(SDL_sqrt(cast(f64)scene->copies));
+    f32 extent = cast(f32)copy_side * model_size * 0.5f;
+
+    // Spinning nodes, picked from their own random stream so the model does
+    // not depend on them.
+    Gfx_Scene *nodes = &model.scene;
+    auto animations = cast(Bench_Animation *)SDL_malloc(cast(usize)nodes->node_count * sizeof(Bench_Animation));
+    defer { SDL_free(animations); };
+    if (!animations) return false;
+
+    int animation_count = 0;
+    u64 random = random_seed(seed + 1);
+    for (int node = 1; node < nodes->node_count; node++) {
+        if (cast(int)(next_random(&random) % 100) >= scene->animated_percent) continue;
+
+        Bench_Animation *animation = &animations[animation_count++];
+        animation->node  = node;
+        animation->axis  = glm::normalize(glm::vec3(random_range(&random, -1.0f, 1.0f), 1.0f, random_range(&random, -1.0f, 1.0f)));
+        animation->speed = random_range(&random, 0.5f, 2.0f);
+        animation->rest  = nodes->rotation[node];
+    }
+
+    Bench_Counters total;
+    u64 checksum = hash_fnv1a64(NULL, 0);
+    SDL_FColor clear_color = {0.0f, 0.0f, 0.0f, 1.0f};
+
+    // Leaves the load out of the first frame.
+    profile_reset_stats();
+    gfx_gpu_record_reset();
+
+    for (int frame = 0; frame < warmup + frames; frame++) {
+        bool measured = frame >= warmup;
+        Bench_Counters counters;
+        Gfx_GPU_Record_Stats gpu_before = gfx_gpu_record_stats();
+        f32 time = cast(f32)frame * FRAME_STEP;
+
+        {
+            PROFILE_ZONE("animate");
+            for (int i = 0; i < animation_count; i++) {
+                const Bench_Animation *animation = &animations[i];
+                glm::quat rotation = glm::angleAxis(animation->speed * time, animation->axis) * animation->rest;
+                gfx_scene_set_local(nodes, animation->node, nodes->translation[animation->node], rotation, nodes->scale[animation->node]);
+            }
+        }
+
+        {
+            PROFILE_ZONE("transform");
+            counters.nodes_updated = cast(u64)gfx_scene_update(nodes, jobs);
+        }
+
+        // The meshes were all uploaded before the first frame. Once the
+        // ones out of view may go, trim them down to the budget, restores
+        // and evictions keep it from there.
+        if (frame == gfx.residency.keep_frames) gfx_residency_reserve(&gfx.residency, 0);
+
+        gfx.view = camera_view(scene, extent, frame);
+        glm::vec3 eye = glm::vec3(glm::inverse(gfx.view)[3]);
+
+        {
+            PROFILE_ZONE("submit");
+            f32 radius_squared   = scene->submit_radius * scene->submit_radius;
+            f32 occluder_squared = scene->occluder_radius * scene->occluder_radius;
+            for (int c = 0; c < scene->copies; c++) {
+                for (int i = 0; i < mesh_count; i++) {
+                    glm::mat4 transform = copies[c] * gfx_model_mesh_transform(&model, i);
+                    glm::vec3 offset = glm::vec3(transform[3]) - eye;
+                    f32 distance_squared = glm::dot(offset, offset);
+                    if (scene->submit_radius > 0.0f && distance_squared > radius_squared) continue;
+                    gfx_submit(&gfx, &gpu_meshes[i], transform);
+                    counters.submitted++;
+
+                    bool wall = i % group_size >= scene->meshes_per_group;
+                    if (wall && distance_squared <= occluder_squared) {
+                        Gfx_Occluder occluder = gfx_occluder_from_mesh(&model.meshes[i], 0);
+                        gfx_submit_occluder(&gfx, &occluder, transform);
+                        counters.occluders++;
+                    }
+                }
+            }
+        }
+
+        gfx.cull_stats = {};
+        gfx_draw(&gfx, time, clear_color);
+
+        Gfx_GPU_Record_Stats gpu = gfx_gpu_record_stats();
+        counters.frustum_culled  = cast(u64)gfx.frustum_culled;
+        counters.meshlets_culled = cast(u64)(gfx.cull_stats.frustum_culled + gfx.cull_stats.backface_culled);
+        counters.packets         = gfx.queue_stats.packets;
+        counters.draws           = gpu.draws - gpu_before.draws;
+        counters.binds           = (gpu.pipeline_binds + gpu.vertex_buffer_binds + gpu.index_buffer_binds) -
+                                   (gpu_before.pipeline_binds + gpu_before.vertex_buffer_binds + gpu_before.index_buffer_binds);
+        counters.indices         = gpu.indices - gpu_before.indices;
+        counters.full_indices    = gfx.lod_stats.full_triangles * 3;
+        for (int l = 0; l <= GFX_LOD_MAX_LEVELS; l++) counters.lod_instances[l] = gfx.lod_stats.instances[l];
+        counters.upload_bytes    = gfx.upload_stats.bytes;
+        counters.evictions       = cast(u64)gfx.residency.last_frame.evictions;
+        counters.restores        = cast(u64)gfx.residency.last_frame.restores;
+        counters.restored_bytes  = gfx.residency.last_frame.restored_bytes;
+        counters.occlusion_tested = cast(u64)gfx.occlusion.stats.tested;
+        counters.occlusion_culled = cast(u64)gfx.occlusion.stats.culled;
+
+        profile_frame_end();
+
+        if (measured) {
+            add_counters(&total, &counters);
+            checksum = hash_fnv1a64(&counters, sizeof(counters), checksum);
+        }
+
+        // The measured frames start clean.
+        if (frame + 1 == warmup) {
+            profile_reset_stats();
+            gfx_gpu_record_reset();
+        }
+    }
+
+    Gfx_GPU_Record_Stats gpu = gfx_gpu_record_stats();
+    f64 per_frame = 1.0 / cast(f64)frames;
+
+    SDL_Log("%s: %d mesh(es), %d node(s), %d instance(s), %llu vertices, %llu triangles, %d animated, checksum %016llx",
+            scene->name, mesh_count, nodes->node_count, mesh_count * scene->copies, cast(unsigned long long)vertex_total,
+            cast(unsigned long long)triangle_total, animation_count, cast(unsigned long long)checksum);
+    if (scene->lods) {
+        SDL_Log("%s: LOD triangles %llu / %llu / %llu / %llu / %llu in %.1f ms, %.1f%% of the full indices drawn", scene->name,
+                cast(unsigned long long)lod_triangles[0], cast(unsigned long long)lod_triangles[1],
+                cast(unsigned long long)lod_triangles[2], cast(unsigned long long)lod_triangles[3],
+                cast(unsigned long long)lod_triangles[4], lods_ms,
+                total.full_indices > 0 ? 100.0 * cast(f64)total.indices / cast(f64)total.full_indices : 100.0);
+    }
+    if (scene->walls) {
+        SDL_Log("%s: %.1f occluder(s) per frame hide %.1f of %.1f instances in the frustum (%.1f%%)", scene->name,
+                total.occluders * per_frame, total.occlusion_culled * per_frame, total.occlusion_tested * per_frame,
+                total.occlusion_tested > 0 ? 100.0 * cast(f64)total.occlusion_culled / cast(f64)total.occlusion_tested : 0.0);
+    }
+    profile_log_stats();
+    if (gpu.errors > 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s: %llu invalid GPU call(s)", scene->name, cast(unsigned long long)gpu.errors);
+    }
+
+    text_append(json, "%s    {\n", first ? "" : ",\n");
+    text_append(json, "      \"name\": \"%s\",\n", scene->name);
+    text_append(json, "      \"meshes\": %d, \"nodes\": %d, \"instances\": %d, \"animated_nodes\": %d, \"vertices\": %llu, \"triangles\": %llu,\n",
+                mesh_count, nodes->node_count, mesh_count * scene->copies, animation_count,
+                cast(unsigned long long)vertex_total, cast(unsigned long long)triangle_total);
+    text_append(json, "      \"mesh_bytes\": %llu, \"budget_bytes\": %llu,\n",
+                cast(unsigned long long)mesh_bytes, cast(unsigned long long)gfx.residency.budget_bytes);
+    text_append(json, "      \"load_ms\": {\"generate\": %.4f, \"gltf\": %.4f, \"meshlets\": %.4f, \"lods\": %.4f, \"upload\": %.4f},\n",
+                generate_ms, load_ms, meshlets_ms, lods_ms, upload_ms);
+    text_append(json, "      \"lod_triangles\": [%llu, %llu, %llu, %llu, %llu],\n", cast(unsigned long long)lod_triangles[0],
+                cast(unsigned long long)lod_triangles[1], cast(unsigned long long)lod_triangles[2],
+                cast(unsigned long long)lod_triangles[3], cast(unsigned long long)lod_triangles[4]);
+    write_phases(json);
+    text_append(json, "      \"per_frame\": {\"submitted\": %.2f, \"frustum_culled\": %.2f, \"meshlets_culled\": %.2f, "
+                      "\"nodes_updated\": %.2f, \"packets\": %.2f, \"draws\": %.2f, \"binds\": %.2f, \"indices\": %.2f, "
+                      "\"full_indices\": %.2f, \"upload_bytes\": %.2f, \"evictions\": %.2f, \"restores\": %.2f, \"restored_bytes\": %.2f, "
+                      "\"lod_instances\": [%.2f, %.2f, %.2f, %.2f, %.2f], "
+                      "\"occluders\": %.2f, \"occlusion_tested\": %.2f, \"occlusion_culled\": %.2f},\n",
+                total.submitted * per_frame, total.frustum_culled * per_frame, total.meshlets_culled * per_frame,
+                total.nodes_updated * per_frame, total.packets * per_frame, total.draws * per_frame, total.binds * per_frame,
+                total.indices * per_frame, total.full_indices * per_frame, total.upload_bytes * per_frame,
+                total.evictions * per_frame, total.restores * per_frame, total.restored_bytes * per_frame,
+                total.lod_instances[0] * per_frame, total.lod_instances[1] * per_frame, total.lod_instances[2] * per_frame,
+                total.lod_instances[3] * per_frame, total.lod_instances[4] * per_frame,
+                total.occluders * per_frame, total.occlusion_tested * per_frame, total.occlusion_culled * per_frame);
+    text_append(json, "      \"gpu_errors\": %llu,\n", cast(unsigned long long)gpu.errors);
+    text_append(json, "      \"checksum\": \"%016llx\"\n", cast(unsigned long long)checksum);
+    text_append(json, "    }");
+
+    return gpu.errors == 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *name   = NULL;
+    const char *output = DEFAULT_OUTPUT;
+    int frames  = 600;
+    int warmup  = 60;
+    int threads = 0;
+    u64 seed    = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (SDL_strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = SDL_atoi(argv[++i]);
+            frames = SDL_clamp(frames, 1, PROFILE_WINDOW);
+        } else if (SDL_strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = SDL_atoi(argv[++i]);
+            warmup = SDL_max(warmup, 0);
+        } else if (SDL_strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = SDL_strtoull(argv[++i], NULL, 0);
+        } else if (SDL_strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = SDL_atoi(argv[++i]);
+            threads = SDL_clamp(threads, 1, JOB_MAX_WORKERS);
+        } else if (SDL_strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (name == NULL) {
+            name = argv[i];
+        }
+    }
+
+    if (threads == 0) threads = SDL_min(SDL_GetNumLogicalCPUCores(), JOB_MAX_WORKERS);
+    profile_set_thread_name("main");
+
+    Text json;
+    defer { text_free(&json); };
+    text_append(&json, "{\n  \"seed\": %llu, \"frames\": %d, \"warmup\": %d, \"threads\": %d,\n  \"scenes\": [\n",
+                cast(unsigned long long)seed, frames, warmup, threads);
+
+    bool ok = true;
+    int run = 0;
+    {
+        Job_System jobs;
+        job_system_init(&jobs, threads);
+        defer { job_system_shutdown(&jobs); };
+
+        for (int i = 0; i < cast(int)ARRAY_COUNT(bench_scenes); i++) {
+            const Bench_Scene *scene = &bench_scenes[i];
+            if (name != NULL && SDL_strcmp(name, scene->name) != 0) continue;
+
+            ok = run_scene(&jobs, scene, seed + cast(u64)i, frames, warmup, &json, run == 0) && ok;
+            run++;
+        }
+    }
+    profile_shutdown();
+
+    if (run == 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unknown scene %s", name);
+        return 1;
+    }
+
+    text_append(&json, "\n  ]\n}\n");
+    if (json.failed || !save_file(output, json.data, json.size)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to write %s: %s", output, SDL_GetError());
+        return 1;
+    }
+    SDL_Log("Results written to %s", output);
+
+    return ok ? 0 : 1;
+}
@@ -13,14 +13,28 @@
 
 #define CLEAR_COLOR {1.0f, 1.0f, 1.0f, 1.0f}
 
+// GPU data uploaded per frame from streamed assets.
+#define UPLOAD_BUDGET_BYTES (4 * 1024 * 1024)
+
+// GPU memory for meshes and textures, least recently used ones are evicted
+// beyond it.
+#define GPU_BUDGET_BYTES (1024ull * 1024 * 1024)
+
+// Written by the P key when built with the profiler.
+#define PROFILE_TRACE_FILE "profile.json"
+
 
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     static App_State state{};
 
     SDL_SetLogPriorities(SDL_LOG_PRIORITY_VERBOSE);
+    profile_set_thread_name("main");
 
     ASSERT(SDL_Init(SDL_INIT_VIDEO));
 
+    // Runs serially if it fails.
+    job_system_init(&state.jobs, 0);
+
     state.current_time = SDL_GetTicks();
     state.last_time    = state.current_time;
 
@@ -28,7 +42,16 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     ASSERT(state.window != NULL);
 
     gfx_init(&state.gfx, state.window);
-    gfx_model_load(&state.sample_model, "res/models/sample/scene.gltf");
+    state.gfx.jobs = &state.jobs;
+    state.gfx.residency.budget_bytes = GPU_BUDGET_BYTES;
+
+    // Assets load in the background, the first frames draw without them.
+    if (!gfx_stream_init(&state.stream, 0) || !gfx_texture_cache_init(&state.textures, &state.stream, &state.gfx)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to start the asset streaming: %s", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+    state.sample_model   = gfx_stream_model(&state.stream, "res/models/sample/scene.gltf", "res/models/sample/scene.mesh", GFX_VERTEX_LAYOUT_COMPACT);
+    state.sample_texture = gfx_texture_cache_acquire(&state.textures, "res/images/Sample.png");
 
     *appstate = &state;
     return SDL_APP_CONTINUE;
@@ -37,9 +60,23 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
 void SDL_AppQuit(void *appstate, SDL_AppResult result) {
     auto state = static_cast<App_State *>(appstate);
 
-    gfx_model_cleanup(&state->sample_model);
+    const Gfx_Texture_Cache_Stats *stats = &state->textures.stats;
+    SDL_Log("Textures: %llu hit(s), %llu miss(es), %llu shared, %llu decode(s), %d resident in %llu bytes",
+            cast(unsigned long long)stats->hits, cast(unsigned long long)stats->misses, cast(unsigned long long)stats->shared,
+            cast(unsigned long long)stats->decodes, stats->resident_textures, cast(unsigned long long)stats->resident_bytes);
+
+    Gfx_Pipeline_Stats pipeline_stats = gfx_pipeline_stats(&state->gfx.pipelines);
+    SDL_Log("Pipelines: %d created (%d in the background) in %.1f ms, %d stall(s), %d missing",
+            pipeline_stats.created, pipeline_stats.background, pipeline_stats.create_ms, pipeline_stats.stalls, pipeline_stats.missing);
+
+    profile_log_stats();
 
+    // The stream first, its loader threads claim through the cache.
+    gfx_stream_shutdown(&state->stream, &state->gfx);
+    gfx_texture_cache_free(&state->textures);
     gfx_cleanup(&state->gfx);
+    job_system_shutdown(&state->jobs);
+    profile_shutdown();
 
     SDL_DestroyWindow(state->window);
 
@@ -48,8 +85,34 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result) {
 }
 
 SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
+    auto state = static_cast<App_State *>(appstate);
+
     switch (event->type) {
         case SDL_EVENT_KEY_DOWN: {
+            // F cycles the texture filter.
+            if (event->key.key == SDLK_F && !event->key.repeat) {
+                Gfx_Context *gfx = &state->gfx;
+                gfx->sampler_filter = cast(Gfx_Sampler_Filter)((gfx->sampler_filter + 1) % GFX_SAMPLER_FILTER_COUNT);
+                SDL_Log("Texture filter: %s", gfx_sampler_filter_name(gfx->sampler_filter));
+            }
+            // R logs the GPU memory of the last frame.
+            if (event->key.key == SDLK_R && !event->key.repeat) {
+                const Gfx_Residency *residency = &state->gfx.residency;
+                const Gfx_Residency_Stats *stats = &residency->last_frame;
+                const f64 MIB = 1024.0 * 1024.0;
+                SDL_Log("GPU memory: %.1f of %.1f MiB, %.1f MiB peak", cast(f64)gfx_residency_bytes(stats) / MIB,
+                        cast(f64)residency->budget_bytes / MIB, cast(f64)stats->peak_bytes / MIB);
+                for (int i = 0; i < GFX_RESIDENT_KIND_COUNT; i++) {
+                    SDL_Log("  %-8s %6d  %8.1f MiB", gfx_resident_kind_name(cast(Gfx_Resident_Kind)i), stats->count[i], cast(f64)stats->bytes[i] / MIB);
+                }
+                SDL_Log("  last frame: %d eviction(s) %.1f MiB, %d restore(s) %.1f MiB, %d over budget", stats->evictions,
+                        cast(f64)stats->evicted_bytes / MIB, stats->restores, cast(f64)stats->restored_bytes / MIB, stats->over_budget);
+            }
+            // P logs the frame phases and writes the trace of the last frames.
+            if (event->key.key == SDLK_P && !event->key.repeat) {
+                profile_log_stats();
+                if (profile_write_trace(PROFILE_TRACE_FILE)) SDL_Log("Wrote %s", PROFILE_TRACE_FILE);
+            }
             break;
         }
         case SDL_EVENT_KEY_UP: {
@@ -66,6 +129,7 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
 
 SDL_AppResult SDL_AppIterate(void *appstate) {
     auto state = static_cast<App_State *>(appstate);
+    defer { profile_frame_end(); };
 
     state->current_time = SDL_GetTicks();
     auto delta_time     = static_cast<f32>(state->current_time - state->last_time) / 1000.f;
@@ -73,6 +137,26 @@ SDL_AppResult SDL_AppIterate(void *appstate) {
 
     state->rotate += glm::radians(90.0f * delta_time);
 
+    gfx_stream_update(&state->stream, &state->gfx, UPLOAD_BUDGET_BYTES);
+    gfx_texture_cache_update(&state->textures);
+
+    // White until it arrives.
+    gfx_set_texture(&state->gfx, gfx_texture_cache_use(&state->textures, state->sample_texture));
+
+    auto model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, 0.0f, -5.0f));
+    model = glm::rotate(model, state->rotate, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // Meshes not uploaded yet have no buffers and are skipped by gfx_submit().
+    Gfx_Asset *sample = state->sample_model;
+    if (sample && (sample->state == GFX_ASSET_UPLOADING || sample->state == GFX_ASSET_READY)) {
+        PROFILE_ZONE("submit");
+        gfx_scene_update(&sample->model.scene, &state->jobs);
+        for (int i = 0; i < sample->model.mesh_count; i++) {
+            gfx_submit(&state->gfx, &sample->gpu_meshes[i], model * gfx_model_mesh_transform(&sample->model, i));
+        }
+    }
+
     gfx_draw(&state->gfx, state->rotate, CLEAR_COLOR);
 
     return SDL_APP_CONTINUE;
@@ -0,0 +1,61 @@
+#include "arena.h"
+
+#include <SDL3/SDL.h>
+
+static SDL_SpinLock stats_lock;
+static Arena_Stats stats;
+
+bool arena_init(Arena *arena, usize size) {
+    *arena = {};
+    if (size == 0) return true;
+
+    size = (size + ARENA_BLOCK_ALIGNMENT - 1) & ~cast(usize)(ARENA_BLOCK_ALIGNMENT - 1);
+    arena->base = cast(u8 *)SDL_aligned_alloc(ARENA_BLOCK_ALIGNMENT, size);
+    if (!arena->base) return false;
+    arena->size = size;
+
+    SDL_LockSpinlock(&stats_lock);
+    stats.alloc_count++;
+    stats.live_bytes += size;
+    if (stats.live_bytes > stats.peak_bytes) stats.peak_bytes = stats.live_bytes;
+    SDL_UnlockSpinlock(&stats_lock);
+
+    return true;
+}
+
+void arena_release(Arena *arena) {
+    if (arena->base != NULL) {
+        SDL_aligned_free(arena->base);
+
+        SDL_LockSpinlock(&stats_lock);
+        stats.release_count++;
+        stats.live_bytes -= arena->size;
+        SDL_UnlockSpinlock(&stats_lock);
+    }
+    *arena = {};
+}
+
+void *arena_push(Arena *arena, usize size, usize alignment) {
+    ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    usize offset = (arena->used + alignment - 1) & ~(alignment - 1);
+    arena->used = offset + size;
+
+    if (arena->base == NULL) return NULL;
+
+    ASSERT(arena->used <= arena->size);
+    return arena->base + offset;
+}
+
+Arena_Stats arena_get_stats() {
+    SDL_LockSpinlock(&stats_lock);
+    Arena_Stats result = stats;
+    SDL_UnlockSpinlock(&stats_lock);
+    return result;
+}
+
+void arena_reset_peak() {
+    SDL_LockSpinlock(&stats_lock);
+    stats.peak_bytes = stats.live_bytes;
+    SDL_UnlockSpinlock(&stats_lock);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "defines.h"
+
+//
+// Linear allocator over a single aligned heap block.
+//
+// Everything pushed into an arena is freed at once by arena_release(). An
+// arena without a block only measures: arena_push() returns NULL but still
+// advances `used`, so the same layout code can size a block in one pass and
+// fill it in the next.
+//
+
+#define ARENA_BLOCK_ALIGNMENT 64
+#define ARENA_DEFAULT_ALIGNMENT 16
+
+struct Arena {
+    u8 *base   = NULL;
+    usize size = 0;
+    usize used = 0;
+};
+
+// Global heap counters for arena blocks.
+struct Arena_Stats {
+    u64 alloc_count   = 0;
+    u64 release_count = 0;
+    u64 live_bytes    = 0;
+    u64 peak_bytes    = 0;
+};
+
+// Allocates a block of size bytes. Returns false on allocation failure.
+bool arena_init(Arena *arena, usize size);
+void arena_release(Arena *arena);
+
+void *arena_push(Arena *arena, usize size, usize alignment = ARENA_DEFAULT_ALIGNMENT);
+
+Arena_Stats arena_get_stats();
+void arena_reset_peak();
@@ -0,0 +1,406 @@
+#include "defines.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+
+#include "gfx.h"
+#include "gfx_cache.h"
+#include "gfx_optimize.h"
+#include "gfx_texture.h"
+
+#include <stb_image.h>
+
+//
+// Offline baker for the binary mesh cache and for block-compressed textures.
+//
+// Usage: bake <scene.gltf> [scene.mesh] [--compare <runs>] [--pack] [--no-split] [--meshlets <views>]
+//        bake <image.png> [image.tex] [--format bc1|bc3|bc7]
+//
+// Without an output path the cache is written next to the source with the
+// extension replaced by ".mesh". With --compare, the serial and parallel cgltf
+// paths and the cache path are timed and their output is checked to be
+// identical; the glTF models are split, optimized and given LODs like the baked
+// ones first, the LODs serially, so the check also covers the parallel build
+// of the bake. The heap blocks used by the model storage are reported too.
+// With --pack, every vertex layout is packed and its size and worst
+// round-trip error are reported; the bake fails when a mesh is off by more
+// than the bounds of the encodings (see gfx_vertex_pack_bound()). With
+// --no-split, meshes too large for 16-bit indices keep 32-bit indices instead
+// of being split. With --meshlets, the baked meshlets of every mesh are
+// checked, then culled from a fixed orbit of camera positions and the cull
+// rate is reported.
+//
+// Sources other than .gltf and .glb are baked as textures (see gfx_texture.h),
+// BC7 by default, written next to the source with the extension ".tex". The
+// size against RGBA8 and the PSNR of every level against the uncompressed
+// mip chain are reported.
+//
+
+static f64 elapsed_ms(u64 start) {
+    return cast(f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / cast(f64)SDL_GetPerformanceFrequency();
+}
+
+// Number of heap blocks the model would need with one allocation per stream.
+static int count_streams(const Gfx_Model *model) {
+    int count = 1; // Mesh array.
+    for (int i = 0; i < model->mesh_count; i++) {
+        const Gfx_Mesh *mesh = &model->meshes[i];
+        count += (mesh->vertices != NULL) + (mesh->texcoords != NULL) + (mesh->texcoords2 != NULL) +
+                 (mesh->normals != NULL) + (mesh->tangents != NULL) + (mesh->colors != NULL) + (mesh->indices != NULL) +
+                 (mesh->joints != NULL) + (mesh->weights != NULL);
+    }
+    return count;
+}
+
+static void report_storage(const char *source_file) {
+    arena_reset_peak();
+    Arena_Stats before = arena_get_stats();
+
+    Gfx_Model model;
+    gfx_model_load(&model, source_file);
+    Arena_Stats loaded = arena_get_stats();
+    int streams = count_streams(&model);
+    gfx_model_cleanup(&model);
+
+    SDL_Log("storage: %llu block(s), %llu peak bytes (per-stream allocation would need %d blocks)",
+            cast(unsigned long long)(loaded.alloc_count - before.alloc_count),
+            cast(unsigned long long)(loaded.peak_bytes - before.live_bytes), streams);
+}
+
+// Times the loads and checks that they give the same model. Returns false
+// when they differ.
+static bool compare_load_times(const char *source_file, const char *cache_file, int runs, bool split_meshes, Job_System *jobs) {
+    f64 gltf_ms     = 0.0;
+    f64 parallel_ms = 0.0;
+    f64 cache_ms    = 0.0;
+
+    for (int i = 0; i < runs; i++) {
+        Gfx_Model gltf_model;
+        u64 start = SDL_GetPerformanceCounter();
+        gfx_model_load(&gltf_model, source_file);
+        gltf_ms += elapsed_ms(start);
+        defer { gfx_model_cleanup(&gltf_model); };
+
+        Gfx_Model parallel_model;
+        start = SDL_GetPerformanceCounter();
+        gfx_model_load_ex(&parallel_model, source_file, jobs);
+        parallel_ms += elapsed_ms(start);
+        defer { gfx_model_cleanup(&parallel_model); };
+
+        if (!gfx_model_equal(&gltf_model, &parallel_model)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Parallel load does not match serial load of %s", source_file);
+            return false;
+        }
+
+        // Same steps as the bake.
+        bool processed = (!split_meshes || gfx_model_split(&gltf_model, GFX_MESH_MAX_VERTICES_16)) &&
+                         gfx_model_build_meshlets(&gltf_model, NULL);
+        if (processed) gfx_model_optimize(&gltf_model, false);
+        if (!processed || !gfx_model_build_lods(&gltf_model, NULL, NULL, false)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Out of memory processing %s", source_file);
+            return false;
+        }
+
+        Gfx_Model cache_model;
+        start = SDL_GetPerformanceCounter();
+        bool loaded = gfx_cache_load(&cache_model, cache_file);
+        cache_ms += elapsed_ms(start);
+        defer { gfx_model_cleanup(&cache_model); };
+
+        if (!loaded || !gfx_model_equal(&gltf_model, &cache_model)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Cache content does not match %s", source_file);
+            return false;
+        }
+    }
+
+    gltf_ms     /= runs;
+    parallel_ms /= runs;
+    cache_ms    /= runs;
+    SDL_Log("cgltf load:          %9.3f ms", gltf_ms);
+    SDL_Log("cgltf load (%2d thr): %9.3f ms", job_worker_count(jobs), parallel_ms);
+    SDL_Log("cache load:          %9.3f ms", cache_ms);
+    SDL_Log("speedup:             %9.1fx (%d runs)", cache_ms > 0.0 ? gltf_ms / cache_ms : 0.0, runs);
+    return true;
+}
+
+// Packs every mesh in every layout and checks the round trip against the
+// bounds of the encodings. Returns false when a mesh is off by more.
+static bool report_vertex_layouts(const char *cache_file) {
+    Gfx_Model model;
+    if (!gfx_cache_load(&model, cache_file)) return false;
+    defer { gfx_model_cleanup(&model); };
+
+#if SIMD_F16C
+    SDL_Log("half floats: F16C");
+#else
+    SDL_Log("half floats: scalar");
+#endif
+
+    bool ok = true;
+    for (int layout = 0; layout < GFX_VERTEX_LAYOUT_COUNT; layout++) {
+        u64 bytes = 0;
+        int failed = 0;
+        Gfx_Vertex_Pack_Error worst{};
+
+        for (int i = 0; i < model.mesh_count; i++) {
+            Gfx_Packed_Vertices packed;
+            if (!gfx_vertex_pack(&model.meshes[i], cast(Gfx_Vertex_Layout)layout, &packed)) return false;
+            defer { gfx_vertex_free(&packed); };
+
+            bytes += cast(u64)packed.vertex_count * packed.stride;
+
+            Gfx_Vertex_Pack_Error error = gfx_vertex_pack_error(&model.meshes[i], &packed);
+            Gfx_Vertex_Pack_Error bound = gfx_vertex_pack_bound(&packed);
+            worst.position        = SDL_max(worst.position, error.position);
+            worst.normal_degrees  = SDL_max(worst.normal_degrees, error.normal_degrees);
+            worst.tangent_degrees = SDL_max(worst.tangent_degrees, error.tangent_degrees);
+            worst.texcoord        = SDL_max(worst.texcoord, error.texcoord);
+
+            if (error.position > bound.position || error.normal_degrees > bound.normal_degrees ||
+                error.tangent_degrees > bound.tangent_degrees || error.texcoord > bound.texcoord) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                             "%s: mesh %d is off by position %.3g (%.3g), normal %.3g deg (%.3g), tangent %.3g deg (%.3g), texcoord %.3g (%.3g)",
+                             gfx_vertex_layout_name(cast(Gfx_Vertex_Layout)layout), i, error.position, bound.position,
+                             error.normal_degrees, bound.normal_degrees, error.tangent_degrees, bound.tangent_degrees,
+                             error.texcoord, bound.texcoord);
+                failed++;
+            }
+        }
+
+        SDL_Log("%-16s %2u B/vertex %10llu B  max error: position %.6f, normal %.4f deg, tangent %.4f deg, texcoord %.2e relative%s",
+                gfx_vertex_layout_name(cast(Gfx_Vertex_Layout)layout), gfx_vertex_stride(cast(Gfx_Vertex_Layout)layout),
+                cast(unsigned long long)bytes, worst.position, worst.normal_degrees, worst.tangent_degrees, worst.texcoord,
+                failed > 0 ? ", FAILED" : "");
+        ok = ok && failed == 0;
+    }
+    return ok;
+}
+
+// Checks the meshlets of a mesh: limits, contiguous ranges covering the index
+// buffer, and bounding spheres around their vertices.
+static bool check_meshlets(const Gfx_Mesh *mesh, const Gfx_Meshlets *meshlets) {
+    u32 next_index = 0;
+    for (int i = 0; i < meshlets->count; i++) {
+        const Gfx_Meshlet *meshlet = &meshlets->meshlets[i];
+        if (meshlet->first_index != next_index) return false;
+        if (meshlet->index_count == 0 || meshlet->index_count > GFX_MESHLET_MAX_TRIANGLES * 3) return false;
+        if (meshlet->vertex_count > GFX_MESHLET_MAX_VERTICES) return false;
+        next_index += meshlet->index_count;
+
+        for (u32 j = 0; j < meshlet->index_count; j++) {
+            u32 v = gfx_mesh_get_index(mesh, cast(int)(meshlet->first_index + j));
+            glm::vec3 p(mesh->vertices[v * 3 + 0], mesh->vertices[v * 3 + 1], mesh->vertices[v * 3 + 2]);
+            if (glm::length(p - meshlet->center) > meshlet->radius * 1.0001f + 1e-6f) return false;
+        }
+    }
+    return next_index == cast(u32)mesh->triangle_count * 3;
+}
+
+// A backface-culled meshlet must not have a front-facing triangle.
+static bool check_backface_cull(const Gfx_Mesh *mesh, const Gfx_Meshlet *meshlet, glm::vec3 eye) {
+    glm::vec3 to_apex = meshlet->cone_apex - eye;
+    if (glm::dot(to_apex, meshlet->cone_axis) < meshlet->cone_cutoff * glm::length(to_apex)) return true;
+
+    for (u32 t = 0; t < meshlet->index_count / 3; t++) {
+        glm::vec3 p[3];
+        for (int k = 0; k < 3; k++) {
+            u32 v = gfx_mesh_get_index(mesh, cast(int)(meshlet->first_index + t * 3 + k));
+            p[k] = glm::vec3(mesh->vertices[v * 3 + 0], mesh->vertices[v * 3 + 1], mesh->vertices[v * 3 + 2]);
+        }
+        glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+        if (glm::dot(n, eye - p[0]) > 1e-4f * glm::length(n) * glm::length(eye - p[0])) return false;
+    }
+    return true;
+}
+
+static bool report_meshlets(const char *cache_file, int views) {
+    Gfx_Model model;
+    if (!gfx_cache_load(&model, cache_file)) return false;
+    defer { gfx_model_cleanup(&model); };
+
+    // The meshlets were baked with the mesh, after optimizing they still
+    // have to cover the indices.
+    int meshlet_count = 0;
+    int max_ranges    = 0;
+    glm::vec3 lo(0.0f), hi(0.0f);
+    for (int i = 0; i < model.mesh_count; i++) {
+        const Gfx_Mesh *mesh = &model.meshes[i];
+        if (!check_meshlets(mesh, &mesh->meshlets)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Meshlet check failed for mesh %d", i);
+            return false;
+        }
+
+        meshlet_count += mesh->meshlets.count;
+        max_ranges = SDL_max(max_ranges, mesh->meshlets.count);
+        for (int v = 0; v < mesh->vertex_count; v++) {
+            glm::vec3 p(mesh->vertices[v * 3 + 0], mesh->vertices[v * 3 + 1], mesh->vertices[v * 3 + 2]);
+            lo = (i == 0 && v == 0) ? p : glm::min(lo, p);
+            hi = (i == 0 && v == 0) ? p : glm::max(hi, p);
+        }
+    }
+
+    auto ranges = cast(Gfx_Draw_Range *)SDL_malloc(cast(usize)SDL_max(max_ranges, 1) * sizeof(Gfx_Draw_Range));
+    if (!ranges) return false;
+    defer { SDL_free(ranges); };
+
+    // Orbit around the model, close enough that parts leave the frustum.
+    glm::vec3 center = (lo + hi) * 0.5f;
+    f32 radius = SDL_max(glm::length(hi - lo) * 0.5f, 1e-3f);
+    glm::mat4 proj = glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.01f, radius * 10.0f);
+
+    Gfx_Meshlet_Cull_Stats stats{};
+    int range_count = 0;
+    f64 cull_ms = 0.0;
+    for (int view = 0; view < views; view++) {
+        f32 angle = cast(f32)view * 2.0f * SDL_PI_F / cast(f32)views;
+        glm::vec3 eye = center + radius * glm::vec3(SDL_cosf(angle) * 1.2f, 0.4f, SDL_sinf(angle) * 1.2f);
+        glm::mat4 mvp = proj * glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+        u64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < model.mesh_count; i++) {
+            range_count += gfx_meshlets_cull(&model.meshes[i].meshlets, mvp, eye, ranges, &stats);
+        }
+        cull_ms += elapsed_ms(start);
+
+        for (int i = 0; i < model.mesh_count; i++) {
+            const Gfx_Mesh *mesh = &model.meshes[i];
+            for (int mi = 0; mi < mesh->meshlets.count; mi++) {
+                if (!check_backface_cull(mesh, &mesh->meshlets.meshlets[mi], eye)) {
+                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Meshlet %d of mesh %d culled with a front-facing triangle", mi, i);
+                    return false;
+                }
+            }
+        }
+    }
+
+    int culled = stats.frustum_culled + stats.backface_culled;
+    SDL_Log("meshlets: %d in %d mesh(es)", meshlet_count, model.mesh_count);
+    SDL_Log("culling:  %d views, %.1f%% frustum, %.1f%% backface, %.1f draws/view",
+            views, 100.0 * stats.frustum_culled / SDL_max(stats.total, 1), 100.0 * stats.backface_culled / SDL_max(stats.total, 1),
+            cast(f64)range_count / views);
+    SDL_Log("          %.0f meshlets/ms, %.0f culled/ms", cull_ms > 0.0 ? stats.total / cull_ms : 0.0, cull_ms > 0.0 ? culled / cull_ms : 0.0);
+    return true;
+}
+
+static bool is_model_file(const char *file) {
+    const char *dot = SDL_strrchr(file, '.');
+    return dot && (SDL_strcasecmp(dot, ".gltf") == 0 || SDL_strcasecmp(dot, ".glb") == 0);
+}
+
+static bool bake_texture(const char *source_file, const char *texture_file, Gfx_BC_Format format, Job_System *jobs) {
+    u64 start = SDL_GetPerformanceCounter();
+    if (!gfx_texture_bake(source_file, texture_file, format, jobs)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to bake %s", source_file);
+        return false;
+    }
+    f64 bake_ms = elapsed_ms(start);
+
+    Gfx_Baked_Texture texture;
+    if (!gfx_texture_load(&texture, texture_file)) return false;
+    defer { gfx_texture_free(&texture); };
+
+    // The baker compresses this same chain.
+    int width  = 0;
+    int height = 0;
+    u8 *pixels = stbi_load(source_file, &width, &height, NULL, 4);
+    if (!pixels) return false;
+    defer { stbi_image_free(pixels); };
+
+    Gfx_Mip_Chain chain;
+    defer { gfx_mip_chain_free(&chain); };
+    if (!gfx_mip_chain_build(&chain, pixels, width, height, GFX_MIP_FILTER_KAISER, true, jobs)) return false;
+
+    const f64 MIB = 1024.0 * 1024.0;
+    SDL_Log("Baked %s -> %s in %.3f ms", source_file, texture_file, bake_ms);
+    SDL_Log("%s, %dx%d, %d levels: %.2f MiB, %.2f MiB as RGBA8 (%.1fx smaller), %.1f MB/s",
+            gfx_bc_format_name(format), width, height, texture.level_count, cast(f64)texture.size / MIB, cast(f64)chain.size / MIB,
+            cast(f64)chain.size / cast(f64)texture.size, bake_ms > 0.0 ? cast(f64)chain.size / 1e3 / bake_ms : 0.0);
+
+    for (int i = 0; i < texture.level_count; i++) {
+        const Gfx_Mip_Level *level = &chain.levels[i];
+        f64 psnr = gfx_bc_psnr(format, chain.data + level->offset, texture.data + texture.levels[i].offset, level->width, level->height);
+        SDL_Log("  level %2d %5dx%-5d PSNR %6.2f dB", i, level->width, level->height, psnr);
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    const char *source_file = NULL;
+    const char *cache_file  = NULL;
+    int compare_runs = 0;
+    bool report_pack = false;
+    bool split_meshes = true;
+    int meshlet_views = 0;
+    Gfx_BC_Format format = GFX_BC7;
+    bool valid_args = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (SDL_strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            compare_runs = SDL_atoi(argv[++i]);
+            compare_runs = SDL_max(compare_runs, 1);
+        } else if (SDL_strcmp(argv[i], "--pack") == 0) {
+            report_pack = true;
+        } else if (SDL_strcmp(argv[i], "--meshlets") == 0 && i + 1 < argc) {
+            meshlet_views = SDL_atoi(argv[++i]);
+            meshlet_views = SDL_max(meshlet_views, 1);
+        } else if (SDL_strcmp(argv[i], "--no-split") == 0) {
+            split_meshes = false;
+        } else if (SDL_strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            bool found = false;
+            for (int f = 0; f < GFX_BC_FORMAT_COUNT; f++) {
+                if (SDL_strcasecmp(name, gfx_bc_format_name(cast(Gfx_BC_Format)f)) == 0) {
+                    format = cast(Gfx_BC_Format)f;
+                    found = true;
+                }
+            }
+            if (!found) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unknown texture format %s", name);
+                valid_args = false;
+            }
+        } else if (source_file == NULL) {
+            source_file = argv[i];
+        } else if (cache_file == NULL) {
+            cache_file = argv[i];
+        }
+    }
+
+    if (source_file == NULL || !valid_args) {
+        SDL_Log("Usage: bake <scene.gltf> [scene.mesh] [--compare <runs>] [--pack] [--no-split] [--meshlets <views>]");
+        SDL_Log("       bake <image.png> [image.tex] [--format bc1|bc3|bc7]");
+        return 1;
+    }
+
+    bool model = is_model_file(source_file);
+    char default_cache_file[1024];
+    if (cache_file == NULL) {
+        SDL_strlcpy(default_cache_file, source_file, sizeof(default_cache_file));
+        char *dot = SDL_strrchr(default_cache_file, '.');
+        if (dot) *dot = '\0';
+        SDL_strlcat(default_cache_file, model ? ".mesh" : ".tex", sizeof(default_cache_file));
+        cache_file = default_cache_file;
+    }
+
+    Job_System jobs;
+    job_system_init(&jobs, 0);
+    defer { job_system_shutdown(&jobs); };
+
+    if (!model) return bake_texture(source_file, cache_file, format, &jobs) ? 0 : 1;
+
+    u64 start = SDL_GetPerformanceCounter();
+    if (!gfx_cache_bake(source_file, cache_file, split_meshes, &jobs)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to bake %s", source_file);
+        return 1;
+    }
+    SDL_Log("Baked %s -> %s in %.3f ms", source_file, cache_file, elapsed_ms(start));
+
+    if (compare_runs > 0) {
+        if (!compare_load_times(source_file, cache_file, compare_runs, split_meshes, &jobs)) return 1;
+        report_storage(source_file);
+    }
+
+    if (report_pack && !report_vertex_layouts(cache_file)) return 1;
+    if (meshlet_views > 0 && !report_meshlets(cache_file, meshlet_views)) return 1;
+
+    return 0;
+}
@@ -0,0 +1,1868 @@
+#include "defines.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+
+#include "gfx_anim.h"
+#include "gfx.h"
+#include "gfx_anim_compress.h"
+#include "gfx_bc.h"
+#include "gfx_cull.h"
+#include "gfx_lod.h"
+#include "gfx_mip.h"
+#include "gfx_occlusion.h"
+#include "gfx_queue.h"
+#include "gfx_residency.h"
+#include "gfx_scene.h"
+#include "gfx_staging.h"
+#include "job.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+//
+// Headless micro benchmarks for the CPU side of the renderer. Inputs are
+// generated from fixed seeds, so every run sees the same data.
+//
+// Usage: bench [queue|cull|scene|jobs|staging|mips|bc|residency|anim|clip|lod|occlusion] [--runs <n>] [--packets <n>]
+//              [--instances <n>]
+//              [--nodes <n>] [--threads <n>] [--image <n>] [--characters <n>] [--vertices <n>]
+//
+// Without a benchmark name all of them run. Parallel code runs on a job
+// system with --threads workers, one per logical core by default.
+//
+// queue: sorts a render queue of random packets with the radix sort and with
+//        SDL_qsort, checks that both agree and that the radix sort is stable,
+//        and reports the binds removed by sorting.
+//
+// cull:  frustum culls random bounding spheres with the scalar reference, the
+//        SIMD kernel and the parallel version, and checks that all three keep
+//        the same instances.
+//
+// scene: updates a random node hierarchy after moving a few percent of the
+//        nodes, fully, incrementally and incrementally in parallel, and
+//        checks that the world matrices agree.
+//
+// jobs:  measures the scheduling overhead of the job system for empty jobs,
+//        parallel-for ranges and nested jobs, then times culling and a full
+//        scene update with 1 to --threads workers.
+//
+// staging: drives the staging ring bookkeeping with the uploads of simulated
+//        frames, some of them streaming large assets, while the simulated GPU
+//        finishes each batch a few frames later. Checks that no range is
+//        handed out while in use, and reports the bytes per frame, stalls
+//        and the cost of an allocation.
+//
+// mips:  builds the mip chain of a random --image sized square image with
+//        every filter, in sRGB and linear, serially and on the job system,
+//        and reports the throughput in MB/s of input. Checks that a flat
+//        image stays flat and that a checkerboard averages in linear space.
+//
+// bc:    block-compresses a smoother image in every format, serially and on
+//        the job system, and reports the throughput in MB/s of input and
+//        the PSNR of the decoded image.
+//
+// residency: walks a camera through a world of meshes and textures eight
+//        times larger than the GPU budget, restoring what comes back into
+//        view within the restore budget. Checks that nothing is evicted in
+//        the frame using it and that the budget holds unless a frame needs
+//        more, and reports evictions and restores per frame and the cost of
+//        a touch.
+//
+// anim:  plays a clip on --characters characters of 64 joints, each with its
+//        own time and speed, and skins a mesh of --vertices vertices per
+//        character. Reports the cost per character of sampling, of the
+//        palette and of skinning, scalar and SIMD, and of whole frames
+//        serially and on the job system. Checks that the SIMD kernels match
+//        the scalar ones and the parallel frame the serial one, and reports
+//        how often the keyframe cursors missed.
+//
+// clip:  compresses a minute long clip of the same rig, with the constant
+//        scale channels exporters write, and reports the compression ratio,
+//        the kept keys and the largest error per path. Then plays it on
+//        --characters characters from the raw floats and from the compressed
+//        block, and reports the cost of sampling both and the largest pose
+//        difference between them.
+//
+// lod:   builds the LOD chains of bumpy heightfields with open borders,
+//        bumpy spheres with a texture seam and faceted boxes with their own
+//        vertices per face, serially and on the job system, and checks that
+//        both agree and that every level is valid and smaller than the one
+//        before. Reports the time, the triangles and the largest error per
+//        level, and the triangles drawn for a row of instances walking away
+//        from the camera. Checks that the boxes simplify below what their
+//        edges would keep if seams did not move.
+//
+// occlusion: rasterizes a field of wall occluders around a turning camera
+//        with the scalar reference, the SIMD kernel and in parallel, and
+//        checks that all three write the same depths. Then tests a tenth of
+//        --instances random boxes against them with both test kernels,
+//        checks that they agree and that no wall hides its own bounds, and
+//        reports the boxes hidden among the ones in the frustum.
+//
+
+static f64 elapsed_ms(u64 start) {
+    return cast(f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / cast(f64)SDL_GetPerformanceFrequency();
+}
+
+// xorshift64*, good enough for benchmark data.
+static u64 next_random(u64 *state) {
+    u64 x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545f4914f6cdd1dull;
+}
+
+static int compare_packets(const void *a, const void *b) {
+    auto pa = cast(const Gfx_Draw_Packet *)a;
+    auto pb = cast(const Gfx_Draw_Packet *)b;
+    if (pa->key != pb->key) return pa->key < pb->key ? -1 : 1;
+    return pa->index < pb->index ? -1 : (pa->index > pb->index);
+}
+
+// A scene-like mix: few pipelines, some materials, many meshes.
+static void fill_queue(Gfx_Render_Queue *queue, int packet_count, u64 seed) {
+    gfx_queue_clear(queue);
+    for (int i = 0; i < packet_count; i++) {
+        u32 pipeline = cast(u32)(next_random(&seed) % 4);
+        u32 material = cast(u32)(next_random(&seed) % 64);
+        u32 mesh     = cast(u32)(next_random(&seed) % 2000);
+        f32 depth    = cast(f32)(next_random(&seed) % 1000000) / 1000000.0f;
+        gfx_queue_push(queue, gfx_draw_key(pipeline, material, mesh, depth), cast(u32)i);
+    }
+}
+
+static bool bench_queue(int runs, int packet_count) {
+    Gfx_Render_Queue queue;
+    defer { gfx_queue_free(&queue); };
+
+    auto reference = cast(Gfx_Draw_Packet *)SDL_malloc(cast(usize)packet_count * sizeof(Gfx_Draw_Packet));
+    if (!reference) return false;
+    defer { SDL_free(reference); };
+
+    f64 radix_ms = 0.0;
+    f64 qsort_ms = 0.0;
+    Gfx_Queue_Stats unsorted{};
+    Gfx_Queue_Stats sorted{};
+
+    for (int run = 0; run < runs; run++) {
+        u64 seed = 0x9e3779b97f4a7c15ull + cast(u64)run;
+
+        fill_queue(&queue, packet_count, seed);
+        if (queue.count != packet_count) return false;
+        unsorted = gfx_queue_stats(&queue);
+
+        // Sorting by (key, index) with qsort gives what a stable sort by key
+        // must produce.
+        SDL_memcpy(reference, queue.packets, cast(usize)packet_count * sizeof(Gfx_Draw_Packet));
+        u64 start = SDL_GetPerformanceCounter();
+        SDL_qsort(reference, cast(usize)packet_count, sizeof(Gfx_Draw_Packet), compare_packets);
+        qsort_ms += elapsed_ms(start);
+
+        start = SDL_GetPerformanceCounter();
+        gfx_queue_sort(&queue);
+        radix_ms += elapsed_ms(start);
+
+        if (SDL_memcmp(reference, queue.packets, cast(usize)packet_count * sizeof(Gfx_Draw_Packet)) != 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "queue: radix sort does not match the reference order");
+            return false;
+        }
+        sorted = gfx_queue_stats(&queue);
+    }
+
+    radix_ms /= runs;
+    qsort_ms /= runs;
+
+    u32 naive = unsorted.packets * 3;
+    SDL_Log("queue: %d packets, %d runs", packet_count, runs);
+    SDL_Log("  radix sort: %8.3f ms  %6.1f Mpackets/s", radix_ms, radix_ms > 0.0 ? packet_count / radix_ms / 1000.0 : 0.0);
+    SDL_Log("  SDL_qsort:  %8.3f ms  %6.1f Mpackets/s", qsort_ms, qsort_ms > 0.0 ? packet_count / qsort_ms / 1000.0 : 0.0);
+    SDL_Log("  binds unsorted: %u pipeline, %u material, %u mesh", unsorted.pipeline_binds, unsorted.material_binds, unsorted.mesh_binds);
+    SDL_Log("  binds sorted:   %u pipeline, %u material, %u mesh", sorted.pipeline_binds, sorted.material_binds, sorted.mesh_binds);
+    SDL_Log("  redundant binds removed: %u of %u (%.1f%%)", sorted.redundant_binds, naive, 100.0 * sorted.redundant_binds / SDL_max(naive, 1u));
+    return true;
+}
+
+// Spheres scattered through a 2000 unit cube around the camera, about a
+// tenth of them end up in view.
+static bool fill_spheres(Gfx_Sphere_Set *set, int instance_count) {
+    u64 seed = 0x2545f4914f6cdd1dull;
+    auto next_f32 = [&](f32 min, f32 max) {
+        return min + (max - min) * cast(f32)(next_random(&seed) >> 40) / cast(f32)(1 << 24);
+    };
+    for (int i = 0; i < instance_count; i++) {
+        glm::vec3 center(next_f32(-1000.0f, 1000.0f), next_f32(-1000.0f, 1000.0f), next_f32(-1000.0f, 1000.0f));
+        if (!gfx_sphere_set_push(set, center, next_f32(0.5f, 5.0f))) return false;
+    }
+    return true;
+}
+
+// The camera turns a bit every run.
+static Gfx_Frustum bench_frustum(int run) {
+    f32 angle = cast(f32)run * 0.3f;
+    glm::mat4 proj = glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(SDL_sinf(angle), 0.0f, -SDL_cosf(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+    return gfx_frustum_from_matrix(proj * view);
+}
+
+static bool bench_cull(Job_System *jobs, int runs, int instance_count) {
+    Gfx_Sphere_Set set;
+    defer { gfx_sphere_set_free(&set); };
+    if (!fill_spheres(&set, instance_count)) return false;
+
+    auto reference = cast(u32 *)SDL_malloc(cast(usize)instance_count * sizeof(u32));
+    auto visible   = cast(u32 *)SDL_malloc(cast(usize)instance_count * sizeof(u32));
+    defer {
+        SDL_free(reference);
+        SDL_free(visible);
+    };
+    if (!reference || !visible) return false;
+
+    f64 scalar_ms   = 0.0;
+    f64 simd_ms     = 0.0;
+    f64 parallel_ms = 0.0;
+    int visible_count = 0;
+
+    for (int run = 0; run < runs; run++) {
+        Gfx_Frustum frustum = bench_frustum(run);
+
+        u64 start = SDL_GetPerformanceCounter();
+        int reference_count = gfx_cull_spheres_scalar(&frustum, &set, 0, set.count, reference);
+        scalar_ms += elapsed_ms(start);
+
+        auto matches = [&](const char *kernel, int count) {
+            if (count == reference_count && SDL_memcmp(reference, visible, cast(usize)count * sizeof(u32)) == 0) return true;
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "cull: %s kept %d spheres, the reference kept %d", kernel, count, reference_count);
+            return false;
+        };
+
+        start = SDL_GetPerformanceCounter();
+        int count = gfx_cull_spheres(&frustum, &set, 0, set.count, visible);
+        simd_ms += elapsed_ms(start);
+        if (!matches("SIMD kernel", count)) return false;
+
+        start = SDL_GetPerformanceCounter();
+        count = gfx_cull_spheres_parallel(&frustum, &set, visible, jobs);
+        parallel_ms += elapsed_ms(start);
+        if (!matches("parallel", count)) return false;
+
+        visible_count = reference_count;
+    }
+
+    scalar_ms   /= runs;
+    simd_ms     /= runs;
+    parallel_ms /= runs;
+
+#if SIMD_AVX2
+    const char *kernel = "AVX2";
+#elif SIMD_SSE2
+    const char *kernel = "SSE2";
+#else
+    const char *kernel = "scalar";
+#endif
+
+    SDL_Log("cull: %d spheres, %d runs, %d visible in the last run", instance_count, runs, visible_count);
+    SDL_Log("  scalar:           %8.3f ms  %6.1f Mspheres/s", scalar_ms, scalar_ms > 0.0 ? instance_count / scalar_ms / 1000.0 : 0.0);
+    SDL_Log("  %-6s:           %8.3f ms  %6.1f Mspheres/s", kernel, simd_ms, simd_ms > 0.0 ? instance_count / simd_ms / 1000.0 : 0.0);
+    SDL_Log("  parallel (%2d thr): %8.3f ms  %6.1f Mspheres/s", job_worker_count(jobs), parallel_ms,
+            parallel_ms > 0.0 ? instance_count / parallel_ms / 1000.0 : 0.0);
+    return true;
+}
+
+// Random forest with a handful of roots, nodes appended in depth-first order
+// by attaching each one to a random node on the current root-to-leaf path.
+static bool fill_scene(Gfx_Scene *scene, int node_count, u64 seed) {
+    if (!gfx_scene_init(scene, node_count)) return false;
+
+    auto path = cast(s32 *)SDL_malloc(cast(usize)node_count * sizeof(s32));
+    if (!path) return false;
+    defer { SDL_free(path); };
+
+    int depth = 0;
+    for (int i = 0; i < node_count; i++) {
+        // Start a new root now and then, otherwise climb up a few levels,
+        // which keeps the tree around ten levels deep.
+        if (next_random(&seed) % 10000 == 0) depth = 0;
+        else if (depth > 0) depth -= cast(int)(next_random(&seed) % cast(u64)(SDL_min(depth, 4) + 1));
+
+        scene->parent[i] = depth > 0 ? path[depth - 1] : GFX_SCENE_NO_PARENT;
+        path[depth++] = i;
+
+        f32 angle = cast(f32)(next_random(&seed) % 628) / 100.0f;
+        scene->translation[i] = glm::vec3(cast(f32)(next_random(&seed) % 100) / 50.0f - 1.0f, 0.5f, 0.0f);
+        scene->rotation[i]    = glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    return gfx_scene_link(scene);
+}
+
+static bool bench_scene(Job_System *jobs, int runs, int node_count) {
+    Gfx_Scene scene;
+    defer { gfx_scene_free(&scene); };
+    if (!fill_scene(&scene, node_count, 0x9e3779b97f4a7c15ull)) return false;
+    gfx_scene_update(&scene, NULL);
+
+    auto reference = cast(glm::mat4 *)SDL_malloc(cast(usize)node_count * sizeof(glm::mat4));
+    if (!reference) return false;
+    defer { SDL_free(reference); };
+
+    // Animate 2% of the nodes, as a scene with a few animated characters
+    // would.
+    int moved_count = SDL_max(node_count / 50, 1);
+    u64 seed = 0x2545f4914f6cdd1dull;
+
+    f64 full_ms        = 0.0;
+    f64 incremental_ms = 0.0;
+    f64 parallel_ms    = 0.0;
+    int updated = 0;
+
+    for (int run = 0; run < runs; run++) {
+        for (int pass = 0; pass < 2; pass++) {
+            // Move the same nodes the same way on both passes.
+            u64 pass_seed = seed;
+            for (int i = 0; i < moved_count; i++) {
+                int node = cast(int)(next_random(&pass_seed) % cast(u64)node_count);
+                f32 angle = cast(f32)(run + 1) * 0.1f;
+                gfx_scene_set_local(&scene, node, scene.translation[node], glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)), scene.scale[node]);
+            }
+
+            u64 start = SDL_GetPerformanceCounter();
+            int count = gfx_scene_update(&scene, pass == 0 ? NULL : jobs);
+            f64 ms = elapsed_ms(start);
+
+            if (pass == 0) {
+                incremental_ms += ms;
+                updated = count;
+                SDL_memcpy(reference, scene.world, cast(usize)node_count * sizeof(glm::mat4));
+            } else {
+                parallel_ms += ms;
+            }
+        }
+        seed = next_random(&seed);
+
+        if (SDL_memcmp(reference, scene.world, cast(usize)node_count * sizeof(glm::mat4)) != 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "scene: parallel update does not match the serial one");
+            return false;
+        }
+
+        // Every node dirty is what updating without dirty tracking costs.
+        for (int i = 0; i < node_count; i++) gfx_scene_mark_dirty(&scene, i);
+        u64 start = SDL_GetPerformanceCounter();
+        gfx_scene_update(&scene, NULL);
+        full_ms += elapsed_ms(start);
+
+        if (SDL_memcmp(reference, scene.world, cast(usize)node_count * sizeof(glm::mat4)) != 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "scene: incremental update does not match a full update");
+            return false;
+        }
+    }
+
+    full_ms        /= runs;
+    incremental_ms /= runs;
+    parallel_ms    /= runs;
+
+    SDL_Log("scene: %d nodes, %d moved per run, %d runs, %d nodes recomputed in the last run", node_count, moved_count, runs, updated);
+    SDL_Log("  full update:          %8.3f ms", full_ms);
+    SDL_Log("  incremental:          %8.3f ms", incremental_ms);
+    SDL_Log("  incremental (%2d thr): %8.3f ms", job_worker_count(jobs), parallel_ms);
+    return true;
+}
+
+static void empty_job(void *data) {
+}
+
+static void empty_range(void *data, int begin, int end) {
+}
+
+struct Nested_Jobs {
+    Job_System *jobs;
+    int children;
+};
+
+static void spawn_children(void *data) {
+    auto nested = cast(Nested_Jobs *)data;
+    Job_Counter counter{};
+    for (int i = 0; i < nested->children; i++) job_run(nested->jobs, empty_job, NULL, &counter);
+    job_wait(nested->jobs, &counter);
+}
+
+static bool bench_jobs(int runs, int instance_count, int node_count, int max_workers) {
+    const int JOB_COUNT = 100000;
+
+    Gfx_Sphere_Set set;
+    defer { gfx_sphere_set_free(&set); };
+    if (!fill_spheres(&set, instance_count)) return false;
+
+    auto visible = cast(u32 *)SDL_malloc(cast(usize)instance_count * sizeof(u32));
+    if (!visible) return false;
+    defer { SDL_free(visible); };
+
+    Gfx_Scene scene;
+    defer { gfx_scene_free(&scene); };
+    if (!fill_scene(&scene, node_count, 0x9e3779b97f4a7c15ull)) return false;
+
+    SDL_Log("jobs: %d runs, %d jobs per overhead test, %d spheres, %d nodes", runs, JOB_COUNT, instance_count, node_count);
+    SDL_Log("  workers  run+wait  parallel-for  nested   |  cull ms  speedup  |  scene ms  speedup");
+
+    f64 base_cull_ms  = 0.0;
+    f64 base_scene_ms = 0.0;
+    for (int workers = 1; workers <= max_workers; workers++) {
+        Job_System jobs;
+        if (!job_system_init(&jobs, workers)) return false;
+        defer { job_system_shutdown(&jobs); };
+
+        f64 run_ns    = 0.0;
+        f64 range_ns  = 0.0;
+        f64 nested_ns = 0.0;
+        f64 cull_ms   = 0.0;
+        f64 scene_ms  = 0.0;
+
+        for (int run = 0; run < runs; run++) {
+            // Independent jobs from one thread.
+            Job_Counter counter{};
+            u64 start = SDL_GetPerformanceCounter();
+            for (int i = 0; i < JOB_COUNT; i++) job_run(&jobs, empty_job, NULL, &counter);
+            job_wait(&jobs, &counter);
+            run_ns += elapsed_ms(start) * 1e6 / JOB_COUNT;
+
+            // One range per item.
+            start = SDL_GetPerformanceCounter();
+            job_parallel_for(&jobs, JOB_COUNT, 1, empty_range, NULL);
+            range_ns += elapsed_ms(start) * 1e6 / JOB_COUNT;
+
+            // Jobs that spawn and wait for jobs, which spreads through stealing.
+            Nested_Jobs nested = { &jobs, 100 };
+            start = SDL_GetPerformanceCounter();
+            for (int i = 0; i < JOB_COUNT / 100; i++) job_run(&jobs, spawn_children, &nested, &counter);
+            job_wait(&jobs, &counter);
+            nested_ns += elapsed_ms(start) * 1e6 / JOB_COUNT;
+
+            Gfx_Frustum frustum = bench_frustum(run);
+            start = SDL_GetPerformanceCounter();
+            gfx_cull_spheres_parallel(&frustum, &set, visible, &jobs);
+            cull_ms += elapsed_ms(start);
+
+            for (int i = 0; i < node_count; i++) gfx_scene_mark_dirty(&scene, i);
+            start = SDL_GetPerformanceCounter();
+            gfx_scene_update(&scene, &jobs);
+            scene_ms += elapsed_ms(start);
+        }
+
+        run_ns    /= runs;
+        range_ns  /= runs;
+        nested_ns /= runs;
+        cull_ms   /= runs;
+        scene_ms  /= runs;
+        if (workers == 1) {
+            base_cull_ms  = cull_ms;
+            base_scene_ms = scene_ms;
+        }
+
+        SDL_Log("  %7d  %6.0f ns  %9.0f ns  %6.0f ns  |  %7.3f  %6.2fx  |  %8.3f  %6.2fx", workers, run_ns, range_ns, nested_ns,
+                cull_ms, cull_ms > 0.0 ? base_cull_ms / cull_ms : 0.0, scene_ms, scene_ms > 0.0 ? base_scene_ms / scene_ms : 0.0);
+    }
+
+    return true;
+}
+
+struct Staged_Range {
+    u32 offset;
+    u32 size;
+    int batch;
+};
+
+static bool bench_staging(int runs) {
+    const int FRAME_COUNT     = 600;
+    const int FRAMES_IN_FLIGHT = 3;
+    const u32 ALIGNMENT       = 16;
+
+    // Ranges in use, oldest first. A frame allocates a few dozen.
+    const int MAX_RANGES = 64 * 1024;
+    auto ranges = cast(Staged_Range *)SDL_malloc(MAX_RANGES * sizeof(Staged_Range));
+    if (!ranges) return false;
+    defer { SDL_free(ranges); };
+
+    Gfx_Staging_Ring ring;
+    gfx_staging_ring_init(&ring, GFX_STAGING_CAPACITY);
+
+    int range_first = 0;
+    int range_count = 0;
+    int batch_frames[GFX_STAGING_MAX_BATCHES];
+    int next_batch = 0;
+    int oldest_batch = 0;
+
+    u64 total_bytes = 0;
+    u64 peak_bytes  = 0;
+    int stalls      = 0;
+    int dedicated   = 0;
+    int overlaps    = 0;
+    u64 seed = 0x853c49e6748fea9bull;
+
+    auto retire = [&]() {
+        gfx_staging_ring_retire(&ring);
+        while (range_count > 0 && ranges[range_first].batch == oldest_batch) {
+            range_first = (range_first + 1) % MAX_RANGES;
+            range_count--;
+        }
+        oldest_batch++;
+    };
+
+    for (int frame = 0; frame < FRAME_COUNT; frame++) {
+        // The GPU finishes a frame FRAMES_IN_FLIGHT frames after its submit.
+        while (ring.batch_count > 0 && frame - batch_frames[ring.batch_first] >= FRAMES_IN_FLIGHT) retire();
+
+        // Instances and small buffers every frame, a streamed asset now and
+        // then.
+        int upload_count = 8 + cast(int)(next_random(&seed) % 32);
+        u64 frame_bytes = 0;
+        for (int i = 0; i < upload_count; i++) {
+            u32 size = 64 + cast(u32)(next_random(&seed) % (64 * 1024));
+            if (next_random(&seed) % 64 == 0) size = 1024 * 1024 + cast(u32)(next_random(&seed) % (12 * 1024 * 1024));
+            if (next_random(&seed) % 2048 == 0) size = GFX_STAGING_CAPACITY + 1;
+
+            if (size > ring.capacity) {
+                dedicated++;
+                continue;
+            }
+
+            u32 offset = 0;
+            while (!gfx_staging_ring_alloc(&ring, size, ALIGNMENT, &offset)) {
+                // The real allocator submits the open batch early and waits.
+                if (ring.batch_count == 0 || (range_count > 0 && ranges[range_first].batch == next_batch)) {
+                    gfx_staging_ring_close(&ring);
+                    batch_frames[(ring.batch_first + ring.batch_count - 1) % GFX_STAGING_MAX_BATCHES] = frame;
+                    next_batch++;
+                }
+                retire();
+                stalls++;
+            }
+
+            for (int r = 0; r < range_count; r++) {
+                const Staged_Range *live = &ranges[(range_first + r) % MAX_RANGES];
+                if (offset < live->offset + live->size && live->offset < offset + size) overlaps++;
+            }
+            if (range_count == MAX_RANGES) return false;
+            ranges[(range_first + range_count) % MAX_RANGES] = {offset, size, next_batch};
+            range_count++;
+            frame_bytes += size;
+        }
+
+        if (ring.batch_count == GFX_STAGING_MAX_BATCHES) {
+            retire();
+            stalls++;
+        }
+        gfx_staging_ring_close(&ring);
+        batch_frames[(ring.batch_first + ring.batch_count - 1) % GFX_STAGING_MAX_BATCHES] = frame;
+        next_batch++;
+
+        total_bytes += frame_bytes;
+        peak_bytes = SDL_max(peak_bytes, frame_bytes);
+    }
+
+    // Allocation cost alone, 64 small ranges per batch and two batches in
+    // flight.
+    f64 alloc_ns = 0.0;
+    const int ALLOC_COUNT = 1000000;
+    for (int run = 0; run < runs; run++) {
+        gfx_staging_ring_init(&ring, GFX_STAGING_CAPACITY);
+        u32 offset = 0;
+        u64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < ALLOC_COUNT; i++) {
+            if (!gfx_staging_ring_alloc(&ring, 256 + cast(u32)(i & 1023), ALIGNMENT, &offset)) return false;
+            if ((i & 63) == 63) {
+                if (ring.batch_count == 2) gfx_staging_ring_retire(&ring);
+                gfx_staging_ring_close(&ring);
+            }
+        }
+        alloc_ns += elapsed_ms(start) * 1e6 / ALLOC_COUNT;
+    }
+    alloc_ns /= runs;
+
+    const f64 MIB = 1024.0 * 1024.0;
+    SDL_Log("staging: %d MiB ring, %d frames, %d frames in flight", GFX_STAGING_CAPACITY / (1024 * 1024), FRAME_COUNT, FRAMES_IN_FLIGHT);
+    SDL_Log("  bytes per frame:  %8.2f MiB mean  %8.2f MiB peak", cast(f64)total_bytes / FRAME_COUNT / MIB, cast(f64)peak_bytes / MIB);
+    SDL_Log("  stalls:           %8d", stalls);
+    SDL_Log("  dedicated:        %8d", dedicated);
+    SDL_Log("  alloc:            %8.1f ns", alloc_ns);
+
+    if (overlaps > 0) {
+        SDL_Log("  FAILED: %d ranges handed out while in use", overlaps);
+        return false;
+    }
+    return true;
+}
+
+// Level 1 of a 2x2 image, with the box filter.
+static bool box_average(const u8 *pixels, bool srgb, u8 *out) {
+    Gfx_Mip_Chain chain;
+    defer { gfx_mip_chain_free(&chain); };
+    if (!gfx_mip_chain_build(&chain, pixels, 2, 2, GFX_MIP_FILTER_BOX, srgb)) return false;
+    SDL_memcpy(out, chain.data + chain.levels[1].offset, 4);
+    return true;
+}
+
+static bool check_mips() {
+    // A flat image must stay flat at every level, with every filter, odd
+    // sizes included.
+    const int W = 37;
+    const int H = 20;
+    const u8 color[4] = {200, 30, 90, 128};
+    u8 flat[W * H * 4];
+    for (int i = 0; i < W * H; i++) SDL_memcpy(flat + i * 4, color, 4);
+
+    for (int filter = 0; filter < GFX_MIP_FILTER_COUNT; filter++) {
+        Gfx_Mip_Chain chain;
+        defer { gfx_mip_chain_free(&chain); };
+        if (!gfx_mip_chain_build(&chain, flat, W, H, cast(Gfx_Mip_Filter)filter, true)) return false;
+        if (chain.level_count != gfx_mip_level_count(W, H)) return false;
+
+        const Gfx_Mip_Level *last = &chain.levels[chain.level_count - 1];
+        if (last->width != 1 || last->height != 1) return false;
+        for (int i = 0; i < chain.level_count; i++) {
+            const Gfx_Mip_Level *level = &chain.levels[i];
+            for (usize j = 0; j < level->size; j++) {
+                if (chain.data[level->offset + j] != color[j % 4]) {
+                    SDL_Log("  FAILED: %s level %d is not flat", gfx_mip_filter_name(cast(Gfx_Mip_Filter)filter), i);
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Black and white average to half the light, which is 188 in sRGB and
+    // 128 when the bytes are linear. Alpha is always linear.
+    const u8 checker[16] = {0, 0, 0, 0,  255, 255, 255, 255,  255, 255, 255, 255,  0, 0, 0, 0};
+    u8 srgb[4];
+    u8 linear[4];
+    if (!box_average(checker, true, srgb) || !box_average(checker, false, linear)) return false;
+    if (srgb[0] != 188 || srgb[3] != 128 || linear[0] != 128 || linear[3] != 128) {
+        SDL_Log("  FAILED: checkerboard averages to %d/%d in sRGB and %d/%d linear", srgb[0], srgb[3], linear[0], linear[3]);
+        return false;
+    }
+    return true;
+}
+
+// Square RGBA8 image of noise over a gradient, so every texel differs. With
+// smooth set the noise is faint and blue and alpha are gradients too, closer
+// to a real texture.
+static u8 *generate_image(int image_size, bool smooth) {
+    auto pixels = cast(u8 *)SDL_malloc(cast(usize)image_size * cast(usize)image_size * 4);
+    if (!pixels) return NULL;
+
+    u64 random = 0x2545f4914f6cdd1dull;
+    for (int y = 0; y < image_size; y++) {
+        for (int x = 0; x < image_size; x++) {
+            u8 *texel = pixels + (cast(usize)y * cast(usize)image_size + cast(usize)x) * 4;
+            u64 noise = next_random(&random);
+            if (smooth) {
+                texel[0] = cast(u8)(x * 247 / image_size + (noise & 7));
+                texel[1] = cast(u8)(y * 247 / image_size + ((noise >> 8) & 7));
+                texel[2] = cast(u8)((x + y) * 123 / image_size + ((noise >> 16) & 7));
+                texel[3] = cast(u8)(255 - x * 255 / image_size);
+            } else {
+                texel[0] = cast(u8)(x * 255 / image_size + (noise & 31));
+                texel[1] = cast(u8)(y * 255 / image_size + ((noise >> 8) & 31));
+                texel[2] = cast(u8)(noise >> 16);
+                texel[3] = cast(u8)(noise >> 24);
+            }
+        }
+    }
+    return pixels;
+}
+
+static bool bench_mips(Job_System *jobs, int runs, int image_size) {
+    usize size = cast(usize)image_size * cast(usize)image_size * 4;
+    u8 *pixels = generate_image(image_size, false);
+    if (!pixels) return false;
+    defer { SDL_free(pixels); };
+
+    SDL_Log("mips: %dx%d, %d levels, %d runs, %d workers", image_size, image_size, gfx_mip_level_count(image_size, image_size), runs,
+            job_worker_count(jobs));
+    SDL_Log("  filter  space   |  serial ms     MB/s  |  parallel ms     MB/s  speedup");
+
+    for (int filter = 0; filter < GFX_MIP_FILTER_COUNT; filter++) {
+        for (int space = 0; space < 2; space++) {
+            bool srgb = space == 0;
+
+            f64 ms[2] = {};
+            for (int parallel = 0; parallel < 2; parallel++) {
+                for (int run = 0; run < runs; run++) {
+                    Gfx_Mip_Chain chain;
+                    u64 start = SDL_GetPerformanceCounter();
+                    bool built = gfx_mip_chain_build(&chain, pixels, image_size, image_size, cast(Gfx_Mip_Filter)filter, srgb,
+                                                     parallel ? jobs : NULL);
+                    ms[parallel] += elapsed_ms(start);
+                    gfx_mip_chain_free(&chain);
+                    if (!built) return false;
+                }
+                ms[parallel] /= runs;
+            }
+
+            f64 mb = cast(f64)size / 1e6;
+            SDL_Log("  %-6s  %-6s  |  %9.2f  %7.0f  |  %11.2f  %7.0f  %6.2fx", gfx_mip_filter_name(cast(Gfx_Mip_Filter)filter),
+                    srgb ? "srgb" : "linear", ms[0], mb * 1000.0 / ms[0], ms[1], mb * 1000.0 / ms[1], ms[0] / ms[1]);
+        }
+    }
+
+    return check_mips();
+}
+
+static bool bench_bc(Job_System *jobs, int runs, int image_size) {
+    usize size = cast(usize)image_size * cast(usize)image_size * 4;
+    u8 *pixels = generate_image(image_size, true);
+    if (!pixels) return false;
+    defer { SDL_free(pixels); };
+
+    auto blocks = cast(u8 *)SDL_malloc(gfx_bc_size(GFX_BC7, image_size, image_size));
+    if (!blocks) return false;
+    defer { SDL_free(blocks); };
+
+    SDL_Log("bc: %dx%d, %d runs, %d workers", image_size, image_size, runs, job_worker_count(jobs));
+    SDL_Log("  format  bpp  |  serial ms     MB/s  |  parallel ms     MB/s  speedup  |  PSNR dB");
+
+    for (int format = 0; format < GFX_BC_FORMAT_COUNT; format++) {
+        auto bc = cast(Gfx_BC_Format)format;
+
+        f64 ms[2] = {};
+        for (int parallel = 0; parallel < 2; parallel++) {
+            for (int run = 0; run < runs; run++) {
+                u64 start = SDL_GetPerformanceCounter();
+                gfx_bc_encode(bc, pixels, image_size, image_size, blocks, parallel ? jobs : NULL);
+                ms[parallel] += elapsed_ms(start);
+            }
+            ms[parallel] /= runs;
+        }
+
+        f64 psnr = gfx_bc_psnr(bc, pixels, blocks, image_size, image_size);
+        f64 mb = cast(f64)size / 1e6;
+        SDL_Log("  %-6s  %3u  |  %9.2f  %7.1f  |  %11.2f  %7.1f  %6.2fx  |  %7.2f", gfx_bc_format_name(bc), gfx_bc_block_size(bc) / 2,
+                ms[0], mb * 1000.0 / ms[0], ms[1], mb * 1000.0 / ms[1], ms[0] / ms[1], psnr);
+        if (psnr <= 0.0) {
+            SDL_Log("  FAILED: %s blocks do not decode", gfx_bc_format_name(bc));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// A mesh or texture of the simulated world.
+struct Sim_Resource {
+    Gfx_Resident resident;
+    u64 size;
+    u64 used_frame; // Frame the camera last saw it in.
+    bool present;
+};
+
+struct Residency_Sim {
+    Gfx_Residency *residency;
+    int evicted_in_use = 0;
+};
+
+static void evict_sim(void *userdata, void *owner) {
+    auto sim      = cast(Residency_Sim *)userdata;
+    auto resource = cast(Sim_Resource *)owner;
+    if (resource->used_frame == sim->residency->frame) sim->evicted_in_use++;
+    resource->present = false;
+}
+
+static bool bench_residency(int runs) {
+    const int RESOURCE_COUNT = 4096;
+    const int FRAME_COUNT    = 2000;
+    const int WINDOW         = 192; // Resources seen from the camera.
+
+    auto resources = cast(Sim_Resource *)SDL_calloc(RESOURCE_COUNT, sizeof(Sim_Resource));
+    if (!resources) return false;
+    defer { SDL_free(resources); };
+
+    u64 seed = 0x2545f4914f6cdd1dull;
+    u64 world_bytes = 0;
+    for (int i = 0; i < RESOURCE_COUNT; i++) {
+        resources[i].size = 64 * 1024 + next_random(&seed) % (4 * 1024 * 1024);
+        world_bytes += resources[i].size;
+    }
+
+    Gfx_Residency residency;
+    residency.budget_bytes = world_bytes / 8;
+    residency.restore_budget_bytes = 32 * 1024 * 1024;
+    Residency_Sim sim;
+    sim.residency = &residency;
+    residency.userdata = &sim;
+
+    for (int i = 0; i < RESOURCE_COUNT; i++) {
+        resources[i].resident.evict = evict_sim;
+        resources[i].resident.owner = &resources[i];
+    }
+
+    int loads = 0;
+    int deferred = 0;
+    int over_frames = 0;
+    int unexplained = 0;
+    bool last_reserve_failed = false;
+    int peak_evictions = 0;
+    u64 total_evictions = 0;
+    u64 total_restores  = 0;
+    u64 total_resident  = 0;
+    int camera = 0;
+
+    u64 start = SDL_GetPerformanceCounter();
+    for (int frame = 0; frame < FRAME_COUNT; frame++) {
+        // Mostly forward, now and then back over what was evicted.
+        u64 step = next_random(&seed) % 64;
+        if (step == 0)     camera -= 256 + cast(int)(next_random(&seed) % 512);
+        else if (step < 8) camera -= 16;
+        else               camera += cast(int)(next_random(&seed) % 4);
+        camera = (camera % RESOURCE_COUNT + RESOURCE_COUNT) % RESOURCE_COUNT;
+
+        for (int w = 0; w < WINDOW; w++) {
+            Sim_Resource *resource = &resources[(camera + w) % RESOURCE_COUNT];
+            if (!resource->present) {
+                bool restore = resource->resident.evicted;
+                if (restore && !gfx_residency_can_restore(&residency, resource->size)) {
+                    deferred++;
+                    continue;
+                }
+                last_reserve_failed = !gfx_residency_reserve(&residency, resource->size);
+                gfx_residency_add(&residency, &resource->resident, w % 2 ? GFX_RESIDENT_TEXTURE : GFX_RESIDENT_BUFFER, resource->size);
+                resource->present = true;
+                if (!restore) loads++;
+            }
+            resource->used_frame = residency.frame;
+            gfx_residency_touch(&residency, &resource->resident);
+        }
+
+        // Over the budget only until a reservation fits again.
+        const Gfx_Residency_Stats *stats = &residency.stats;
+        if (gfx_residency_bytes(stats) > residency.budget_bytes) {
+            over_frames++;
+            if (!last_reserve_failed) unexplained++;
+        }
+
+        peak_evictions = SDL_max(peak_evictions, stats->evictions);
+        total_evictions += cast(u64)stats->evictions;
+        total_restores  += cast(u64)stats->restores;
+        total_resident  += gfx_residency_bytes(stats);
+        gfx_residency_next_frame(&residency);
+    }
+    f64 frame_us = elapsed_ms(start) * 1000.0 / FRAME_COUNT;
+
+    // Touch cost alone, in random order over a list of every resource.
+    f64 touch_ns = 0.0;
+    const int TOUCH_COUNT = 1000000;
+    for (int run = 0; run < runs; run++) {
+        u64 touch_seed = 0x9e3779b97f4a7c15ull;
+        u64 touch_start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < TOUCH_COUNT; i++) {
+            if ((i & 255) == 0) gfx_residency_next_frame(&residency);
+            Sim_Resource *resource = &resources[next_random(&touch_seed) % RESOURCE_COUNT];
+            gfx_residency_touch(&residency, &resource->resident);
+        }
+        touch_ns += elapsed_ms(touch_start) * 1e6 / TOUCH_COUNT;
+    }
+    touch_ns /= runs;
+
+    const f64 MIB = 1024.0 * 1024.0;
+    SDL_Log("residency: %d resources, %.0f MiB, %.0f MiB budget, %d frames, %d in view", RESOURCE_COUNT, cast(f64)world_bytes / MIB,
+            cast(f64)residency.budget_bytes / MIB, FRAME_COUNT, WINDOW);
+    SDL_Log("  resident:     %8.1f MiB mean  %8.1f MiB peak", cast(f64)total_resident / FRAME_COUNT / MIB, cast(f64)residency.stats.peak_bytes / MIB);
+    SDL_Log("  loads:        %8d", loads);
+    SDL_Log("  evictions:    %8.2f per frame  %d peak", cast(f64)total_evictions / FRAME_COUNT, peak_evictions);
+    SDL_Log("  restores:     %8.2f per frame  %d deferred", cast(f64)total_restores / FRAME_COUNT, deferred);
+    SDL_Log("  over budget:  %8d frames", over_frames);
+    SDL_Log("  frame:        %8.1f us", frame_us);
+    SDL_Log("  touch:        %8.1f ns", touch_ns);
+
+    if (sim.evicted_in_use > 0) {
+        SDL_Log("  FAILED: %d resources evicted in the frame using them", sim.evicted_in_use);
+        return false;
+    }
+    if (unexplained > 0) {
+        SDL_Log("  FAILED: %d frames over the budget after a reservation fit", unexplained);
+        return false;
+    }
+    return true;
+}
+
+//
+// Animation.
+//
+
+// A character rig: an armature node above 64 joints, a spine of 8 with a
+// chain of 7 hanging off every spine joint. The skin lists the joints in
+// reverse, so the palette order differs from the scene order.
+#define ANIM_SPINE_JOINTS 8
+#define ANIM_CHAIN_JOINTS 7
+#define ANIM_JOINT_COUNT  (ANIM_SPINE_JOINTS * (1 + ANIM_CHAIN_JOINTS))
+#define ANIM_CLIP_SECONDS 2.0f
+#define ANIM_KEYS_PER_SECOND 30
+#define CLIP_SECONDS 60.0f
+
+struct Anim_Rig {
+    Gfx_Scene scene;
+    Gfx_Skin skin;
+    Gfx_Clip clip;
+    Gfx_Skin_Source mesh;
+    void *memory = NULL;
+};
+
+static void free_rig(Anim_Rig *rig) {
+    gfx_scene_free(&rig->scene);
+    SDL_free(rig->memory);
+    *rig = {};
+}
+
+// The clip rotates every joint and moves the root, and with scale_channels
+// also has a constant scale channel per joint.
+static bool build_rig(Anim_Rig *rig, int vertex_count, f32 clip_seconds, bool scale_channels, u64 seed) {
+    *rig = {};
+    int node_count = 1 + ANIM_JOINT_COUNT;
+    if (!gfx_scene_init(&rig->scene, node_count)) return false;
+
+    // Depth-first: every spine joint is followed by its chain.
+    Gfx_Scene *scene = &rig->scene;
+    scene->translation[0] = glm::vec3(0.0f, 0.0f, 1.0f);
+    scene->scale[0]       = glm::vec3(0.5f);
+    int node = 1;
+    s32 spine_parent = 0;
+    for (int s = 0; s < ANIM_SPINE_JOINTS; s++) {
+        int spine = node++;
+        scene->parent[spine] = spine_parent;
+        scene->translation[spine] = glm::vec3(0.0f, s == 0 ? 0.0f : 0.3f, 0.0f);
+        spine_parent = spine;
+
+        s32 chain_parent = spine;
+        for (int c = 0; c < ANIM_CHAIN_JOINTS; c++) {
+            scene->parent[node] = chain_parent;
+            scene->translation[node] = glm::vec3(s % 2 ? 0.2f : -0.2f, 0.0f, 0.05f);
+            chain_parent = node++;
+        }
+    }
+    if (!gfx_scene_link(scene)) return false;
+    gfx_scene_update(scene, NULL);
+
+    int key_count = cast(int)(clip_seconds * ANIM_KEYS_PER_SECOND) + 1;
+    int channel_count = ANIM_JOINT_COUNT + 1; // Rotations and the root translation.
+    if (scale_channels) channel_count += ANIM_JOINT_COUNT;
+
+    usize joint_bytes   = ANIM_JOINT_COUNT * (sizeof(s32) + sizeof(glm::mat4));
+    usize channel_bytes = cast(usize)channel_count * (sizeof(Gfx_Anim_Channel) + cast(usize)key_count * 5 * sizeof(f32));
+    usize vertex_bytes  = cast(usize)vertex_count * (6 * sizeof(f32) + 4 * sizeof(u16) + 4 * sizeof(f32));
+    rig->memory = SDL_malloc(joint_bytes + channel_bytes + vertex_bytes);
+    if (!rig->memory) return false;
+
+    auto bytes = cast(u8 *)rig->memory;
+    auto take = [&](usize size) {
+        void *result = bytes;
+        bytes += size;
+        return result;
+    };
+
+    rig->skin.joint_count  = ANIM_JOINT_COUNT;
+    rig->skin.inverse_bind = cast(glm::mat4 *)take(ANIM_JOINT_COUNT * sizeof(glm::mat4));
+    rig->skin.joints       = cast(s32 *)take(ANIM_JOINT_COUNT * sizeof(s32));
+    for (int j = 0; j < ANIM_JOINT_COUNT; j++) {
+        rig->skin.joints[j]       = ANIM_JOINT_COUNT - j;
+        rig->skin.inverse_bind[j] = glm::inverse(scene->world[rig->skin.joints[j]]);
+    }
+
+    SDL_strlcpy(rig->clip.name, "sway", sizeof(rig->clip.name));
+    rig->clip.duration      = clip_seconds;
+    rig->clip.channel_count = channel_count;
+    rig->clip.channels      = cast(Gfx_Anim_Channel *)take(cast(usize)channel_count * sizeof(Gfx_Anim_Channel));
+    for (int ci = 0; ci < channel_count; ci++) {
+        Gfx_Anim_Channel *channel = &rig->clip.channels[ci];
+        *channel = {};
+        channel->node      = ci < ANIM_JOINT_COUNT ? 1 + ci : ci == ANIM_JOINT_COUNT ? 1 : ci - ANIM_JOINT_COUNT;
+        channel->path      = ci < ANIM_JOINT_COUNT ? GFX_ANIM_ROTATION : ci == ANIM_JOINT_COUNT ? GFX_ANIM_TRANSLATION : GFX_ANIM_SCALE;
+        channel->key_count = key_count;
+        channel->times     = cast(f32 *)take(cast(usize)key_count * sizeof(f32));
+        channel->values    = cast(f32 *)take(cast(usize)key_count * 4 * sizeof(f32));
+
+        f32 phase = cast(f32)(next_random(&seed) % 628) / 100.0f;
+        for (int k = 0; k < key_count; k++) {
+            f32 time = cast(f32)k / ANIM_KEYS_PER_SECOND;
+            f32 angle = 0.6f * SDL_sinf(time * 3.14159265f + phase);
+            channel->times[k] = time;
+            f32 *value = channel->values + k * gfx_anim_path_components(channel->path);
+            if (channel->path == GFX_ANIM_ROTATION) {
+                glm::quat q = glm::angleAxis(angle, glm::normalize(glm::vec3(1.0f, 0.5f, cast(f32)(ci % 3))));
+                value[0] = q.x;
+                value[1] = q.y;
+                value[2] = q.z;
+                value[3] = q.w;
+            } else if (channel->path == GFX_ANIM_TRANSLATION) {
+                value[0] = 0.0f;
+                value[1] = 0.1f * angle;
+                value[2] = 0.0f;
+            } else {
+                value[0] = value[1] = value[2] = 1.0f;
+            }
+        }
+    }
+
+    // Vertices around the rig, each on the four joints nearest in index.
+    auto positions = cast(f32 *)take(cast(usize)vertex_count * 3 * sizeof(f32));
+    auto normals   = cast(f32 *)take(cast(usize)vertex_count * 3 * sizeof(f32));
+    auto weights   = cast(f32 *)take(cast(usize)vertex_count * 4 * sizeof(f32));
+    auto joints    = cast(u16 *)take(cast(usize)vertex_count * 4 * sizeof(u16));
+    for (int v = 0; v < vertex_count; v++) {
+        int first = cast(int)(next_random(&seed) % (ANIM_JOINT_COUNT - 3));
+        glm::vec3 center = glm::vec3(scene->world[rig->skin.joints[first]][3]);
+        glm::vec3 normal(cast(f32)(next_random(&seed) % 200) / 100.0f - 1.0f, 1.0f, cast(f32)(next_random(&seed) % 200) / 100.0f - 1.0f);
+        normal = glm::normalize(normal);
+
+        f32 sum = 0.0f;
+        for (int k = 0; k < 4; k++) {
+            joints[v * 4 + k]  = cast(u16)(first + k);
+            weights[v * 4 + k] = 1.0f + cast(f32)(next_random(&seed) % 100);
+            sum += weights[v * 4 + k];
+        }
+        for (int k = 0; k < 4; k++) weights[v * 4 + k] /= sum;
+
+        for (int c = 0; c < 3; c++) {
+            positions[v * 3 + c] = center[c] + 0.1f * normal[c];
+            normals[v * 3 + c]   = normal[c];
+        }
+    }
+
+    rig->mesh.vertex_count = vertex_count;
+    rig->mesh.positions    = positions;
+    rig->mesh.normals      = normals;
+    rig->mesh.joints       = joints;
+    rig->mesh.weights      = weights;
+    return true;
+}
+
+struct Anim_Skin_Work {
+    const Anim_Rig *rig;
+    const Gfx_Anim_Character *characters;
+    f32 *positions;
+    f32 *normals;
+};
+
+// One character per item, into its own slice of the outputs.
+static void skin_characters(void *data, int begin, int end) {
+    auto work = cast(Anim_Skin_Work *)data;
+    usize floats = cast(usize)work->rig->mesh.vertex_count * 3;
+    for (int i = begin; i < end; i++) {
+        gfx_skin_vertices(&work->rig->mesh, work->characters[i].palette, 0, work->rig->mesh.vertex_count,
+                          work->positions + cast(usize)i * floats, work->normals + cast(usize)i * floats);
+    }
+}
+
+static f32 max_difference(const f32 *a, const f32 *b, usize count) {
+    f32 result = 0.0f;
+    for (usize i = 0; i < count; i++) result = SDL_max(result, SDL_fabsf(a[i] - b[i]));
+    return result;
+}
+
+static bool bench_anim(Job_System *jobs, int runs, int character_count, int vertex_count) {
+    Anim_Rig rig;
+    defer { free_rig(&rig); };
+    if (!build_rig(&rig, vertex_count, ANIM_CLIP_SECONDS, false, 0x9e3779b97f4a7c15ull)) return false;
+
+    Gfx_Skeleton skeleton;
+    defer { gfx_skeleton_free(&skeleton); };
+    if (!gfx_skeleton_build(&skeleton, &rig.scene, &rig.skin, &rig.clip, 1)) return false;
+
+    auto characters = cast(Gfx_Anim_Character *)SDL_calloc(cast(usize)character_count, sizeof(Gfx_Anim_Character));
+    if (!characters) return false;
+    defer {
+        for (int i = 0; i < character_count; i++) gfx_anim_character_free(&characters[i]);
+        SDL_free(characters);
+    };
+
+    // Spread over the clip, at slightly different speeds.
+    u64 seed = 0x2545f4914f6cdd1dull;
+    for (int i = 0; i < character_count; i++) {
+        if (!gfx_anim_character_init(&characters[i], &skeleton, 0)) return false;
+        characters[i].speed = 0.8f + cast(f32)(next_random(&seed) % 400) / 1000.0f;
+        gfx_anim_advance(&characters[i], cast(f32)(next_random(&seed) % 2000) / 1000.0f);
+
+        // The jump searches once, playback from there should not.
+        gfx_anim_sample(&characters[i]);
+        characters[i].searches = 0;
+    }
+
+    usize palette_floats = cast(usize)character_count * ANIM_JOINT_COUNT * 16;
+    usize vertex_floats  = cast(usize)character_count * cast(usize)vertex_count * 3;
+    auto reference_palettes  = cast(f32 *)SDL_malloc(palette_floats * sizeof(f32));
+    auto reference_positions = cast(f32 *)SDL_malloc(vertex_floats * sizeof(f32));
+    auto reference_normals   = cast(f32 *)SDL_malloc(vertex_floats * sizeof(f32));
+    auto positions = cast(f32 *)SDL_malloc(vertex_floats * sizeof(f32));
+    auto normals   = cast(f32 *)SDL_malloc(vertex_floats * sizeof(f32));
+    auto times     = cast(f32 *)SDL_malloc(cast(usize)character_count * sizeof(f32));
+    defer {
+        SDL_free(times);
+        SDL_free(reference_palettes);
+        SDL_free(reference_positions);
+        SDL_free(reference_normals);
+        SDL_free(positions);
+        SDL_free(normals);
+    };
+    if (!reference_palettes || !reference_positions || !reference_normals || !positions || !normals || !times) return false;
+
+    auto save_palettes = [&](f32 *out) {
+        for (int i = 0; i < character_count; i++) {
+            SDL_memcpy(out + cast(usize)i * ANIM_JOINT_COUNT * 16, characters[i].palette, ANIM_JOINT_COUNT * sizeof(glm::mat4));
+        }
+    };
+
+    const f32 step = 1.0f / 60.0f;
+    usize vertex_stride = cast(usize)vertex_count * 3;
+    f64 sample_ms = 0.0, palette_scalar_ms = 0.0, palette_simd_ms = 0.0;
+    f64 skin_scalar_ms = 0.0, skin_simd_ms = 0.0, serial_ms = 0.0, parallel_ms = 0.0;
+    f32 palette_error = 0.0f, position_error = 0.0f, normal_error = 0.0f;
+    u32 searches = 0;
+    u64 channel_samples = 0;
+
+    Anim_Skin_Work work;
+    work.rig        = &rig;
+    work.characters = characters;
+
+    for (int run = 0; run < runs; run++) {
+        // The parts one by one, serially.
+        u64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < character_count; i++) {
+            gfx_anim_advance(&characters[i], step);
+            gfx_anim_sample(&characters[i]);
+        }
+        sample_ms += elapsed_ms(start);
+        channel_samples += cast(u64)character_count * cast(u64)rig.clip.channel_count;
+
+        start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < character_count; i++) gfx_anim_compute_palette_scalar(&characters[i]);
+        palette_scalar_ms += elapsed_ms(start);
+        save_palettes(reference_palettes);
+
+        start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < character_count; i++) gfx_anim_compute_palette(&characters[i]);
+        palette_simd_ms += elapsed_ms(start);
+        save_palettes(positions);
+        palette_error = SDL_max(palette_error, max_difference(reference_palettes, positions, palette_floats));
+
+        start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < character_count; i++) {
+            gfx_skin_vertices_scalar(&rig.mesh, characters[i].palette, 0, vertex_count,
+                                     reference_positions + cast(usize)i * vertex_stride, reference_normals + cast(usize)i * vertex_stride);
+        }
+        skin_scalar_ms += elapsed_ms(start);
+
+        start = SDL_GetPerformanceCounter();
+        work.positions = positions;
+        work.normals   = normals;
+        skin_characters(&work, 0, character_count);
+        skin_simd_ms += elapsed_ms(start);
+        position_error = SDL_max(position_error, max_difference(reference_positions, positions, vertex_floats));
+        normal_error   = SDL_max(normal_error, max_difference(reference_normals, normals, vertex_floats));
+
+        // A whole frame, serially and then again on the job system.
+        for (int i = 0; i < character_count; i++) times[i] = characters[i].time;
+        start = SDL_GetPerformanceCounter();
+        gfx_anim_update(characters, character_count, step, NULL);
+        job_parallel_for(NULL, character_count, 1, skin_characters, &work);
+        serial_ms += elapsed_ms(start);
+        SDL_memcpy(reference_positions, positions, vertex_floats * sizeof(f32));
+        save_palettes(reference_palettes);
+
+        for (int i = 0; i < character_count; i++) characters[i].time = times[i];
+        start = SDL_GetPerformanceCounter();
+        gfx_anim_update(characters, character_count, step, jobs);
+        job_parallel_for(jobs, character_count, 1, skin_characters, &work);
+        parallel_ms += elapsed_ms(start);
+
+        save_palettes(reference_normals);
+        if (SDL_memcmp(reference_palettes, reference_normals, palette_floats * sizeof(f32)) != 0 ||
+            SDL_memcmp(reference_positions, positions, vertex_floats * sizeof(f32)) != 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "anim: parallel update does not match the serial one");
+            return false;
+        }
+        channel_samples += 2 * cast(u64)character_count * cast(u64)rig.clip.channel_count;
+    }
+
+    for (int i = 0; i < character_count; i++) searches += characters[i].searches;
+
+    sample_ms         /= runs;
+    palette_scalar_ms /= runs;
+    palette_simd_ms   /= runs;
+    skin_scalar_ms    /= runs;
+    skin_simd_ms      /= runs;
+    serial_ms         /= runs;
+    parallel_ms       /= runs;
+
+#if SIMD_SSE2
+    const char *kernel = "SSE2";
+#else
+    const char *kernel = "scalar";
+#endif
+
+    auto per_character = [&](f64 ms) { return ms * 1000.0 / character_count; };
+
+    SDL_Log("anim: %d characters, %d joints, %d channels, %d vertices, %d runs", character_count, ANIM_JOINT_COUNT,
+            rig.clip.channel_count, vertex_count, runs);
+    SDL_Log("  sample:                %8.3f ms  %8.2f us/character  %.2f searches per 1000 channel samples", sample_ms,
+            per_character(sample_ms), channel_samples > 0 ? 1000.0 * searches / cast(f64)channel_samples : 0.0);
+    SDL_Log("  palette scalar:        %8.3f ms  %8.2f us/character", palette_scalar_ms, per_character(palette_scalar_ms));
+    SDL_Log("  palette %-6s:        %8.3f ms  %8.2f us/character", kernel, palette_simd_ms, per_character(palette_simd_ms));
+    SDL_Log("  skin scalar:           %8.3f ms  %8.2f us/character", skin_scalar_ms, per_character(skin_scalar_ms));
+    SDL_Log("  skin %-6s:           %8.3f ms  %8.2f us/character", kernel, skin_simd_ms, per_character(skin_simd_ms));
+    SDL_Log("  frame serial:          %8.3f ms  %8.2f us/character", serial_ms, per_character(serial_ms));
+    SDL_Log("  frame parallel (%2d thr): %6.3f ms  %8.2f us/character", job_worker_count(jobs), parallel_ms, per_character(parallel_ms));
+    SDL_Log("  max difference to scalar: palette %.2e, positions %.2e, normals %.2e", palette_error, position_error, normal_error);
+
+    if (palette_error > 1e-4f || position_error > 1e-4f || normal_error > 1e-4f) {
+        SDL_Log("  FAILED: the %s kernels do not match the scalar reference", kernel);
+        return false;
+    }
+    return true;
+}
+
+// Largest difference per path between the joints of two poses.
+static void pose_difference(const Gfx_Skeleton *skeleton, const f32 *pose, const f32 *reference, f32 *max_error) {
+    int stride = skeleton->stride;
+    for (int j = 0; j < skeleton->joint_count; j++) {
+        const int first[GFX_ANIM_PATH_COUNT] = {GFX_POSE_TX, GFX_POSE_QX, GFX_POSE_SX};
+        for (int path = 0; path < GFX_ANIM_PATH_COUNT; path++) {
+            f32 value[4], expected[4];
+            for (int c = 0; c < gfx_anim_path_components(cast(Gfx_Anim_Path)path); c++) {
+                value[c]    = pose[(first[path] + c) * stride + j];
+                expected[c] = reference[(first[path] + c) * stride + j];
+            }
+            max_error[path] = SDL_max(max_error[path], gfx_anim_value_error(cast(Gfx_Anim_Path)path, value, expected));
+        }
+    }
+}
+
+static bool bench_clip(int runs, int character_count) {
+    Anim_Rig rig;
+    defer { free_rig(&rig); };
+    if (!build_rig(&rig, 0, CLIP_SECONDS, true, 0x9e3779b97f4a7c15ull)) return false;
+
+    Gfx_Clip_Compress_Settings settings;
+    Gfx_Clip_Compress_Report report;
+    Gfx_Compressed_Clip compressed;
+    defer { gfx_compressed_clip_free(&compressed); };
+    u64 start = SDL_GetPerformanceCounter();
+    if (!gfx_clip_compress(&compressed, &rig.clip, &settings, &report)) return false;
+    f64 compress_ms = elapsed_ms(start);
+
+    Gfx_Skeleton raw_skeleton, skeleton;
+    defer {
+        gfx_skeleton_free(&raw_skeleton);
+        gfx_skeleton_free(&skeleton);
+    };
+    if (!gfx_skeleton_build(&raw_skeleton, &rig.scene, &rig.skin, &rig.clip, 1)) return false;
+    if (!gfx_skeleton_build(&skeleton, &rig.scene, &rig.skin, &rig.clip, 1)) return false;
+    skeleton.compressed = &compressed;
+
+    // The same characters twice, first half raw, second half compressed.
+    auto characters = cast(Gfx_Anim_Character *)SDL_calloc(2 * cast(usize)character_count, sizeof(Gfx_Anim_Character));
+    if (!characters) return false;
+    defer {
+        for (int i = 0; i < 2 * character_count; i++) gfx_anim_character_free(&characters[i]);
+        SDL_free(characters);
+    };
+    Gfx_Anim_Character *raw = characters;
+    Gfx_Anim_Character *decoded = characters + character_count;
+
+    u64 seed = 0x2545f4914f6cdd1dull;
+    for (int i = 0; i < character_count; i++) {
+        if (!gfx_anim_character_init(&raw[i], &raw_skeleton, 0)) return false;
+        if (!gfx_anim_character_init(&decoded[i], &skeleton, 0)) return false;
+        f32 speed = 0.8f + cast(f32)(next_random(&seed) % 400) / 1000.0f;
+        f32 time  = cast(f32)(next_random(&seed) % 60000) / 1000.0f;
+        Gfx_Anim_Character *pair[2] = {&raw[i], &decoded[i]};
+        for (Gfx_Anim_Character *character : pair) {
+            character->speed = speed;
+            gfx_anim_advance(character, time);
+            gfx_anim_sample(character);
+            character->searches = 0;
+        }
+    }
+
+    const f32 step = 1.0f / 60.0f;
+    f64 raw_ms = 0.0, decoded_ms = 0.0;
+    f32 pose_error[GFX_ANIM_PATH_COUNT] = {};
+    for (int run = 0; run < runs; run++) {
+        start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < character_count; i++) {
+            gfx_anim_advance(&raw[i], step);
+            gfx_anim_sample(&raw[i]);
+        }
+        raw_ms += elapsed_ms(start);
+
+        start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < character_count; i++) {
+            gfx_anim_advance(&decoded[i], step);
+            gfx_anim_sample(&decoded[i]);
+        }
+        decoded_ms += elapsed_ms(start);
+
+        for (int i = 0; i < character_count; i++) pose_difference(&skeleton, decoded[i].pose, raw[i].pose, pose_error);
+    }
+
+    u32 raw_searches = 0, searches = 0;
+    for (int i = 0; i < character_count; i++) {
+        raw_searches += raw[i].searches;
+        searches     += decoded[i].searches;
+    }
+    raw_ms     /= runs;
+    decoded_ms /= runs;
+
+    f64 samples = cast(f64)character_count * rig.clip.channel_count;
+    auto per_character = [&](f64 ms) { return ms * 1000.0 / character_count; };
+    auto per_sample    = [&](f64 ms) { return ms * 1e6 / samples; };
+
+    SDL_Log("clip: %d channels, %.0f s at %d keys/s, %d characters, %d runs", rig.clip.channel_count, CLIP_SECONDS,
+            ANIM_KEYS_PER_SECOND, character_count, runs);
+    SDL_Log("  raw:        %9zu bytes  %8llu keys", report.raw_bytes, cast(unsigned long long)report.raw_keys);
+    SDL_Log("  compressed: %9zu bytes  %8llu keys  %.1f:1, %.3f ms to compress", report.compressed_bytes,
+            cast(unsigned long long)report.kept_keys, cast(f64)report.raw_bytes / cast(f64)report.compressed_bytes, compress_ms);
+    SDL_Log("  max error:  translation %.2e (%.0e), rotation %.2e rad (%.0e), scale %.2e (%.0e)",
+            report.max_error[GFX_ANIM_TRANSLATION], settings.translation_error, report.max_error[GFX_ANIM_ROTATION],
+            settings.rotation_error, report.max_error[GFX_ANIM_SCALE], settings.scale_error);
+    SDL_Log("  sample raw:        %8.3f ms  %8.2f us/character  %6.2f ns/channel  %u searches", raw_ms, per_character(raw_ms),
+            per_sample(raw_ms), raw_searches);
+    SDL_Log("  sample compressed: %8.3f ms  %8.2f us/character  %6.2f ns/channel  %u searches", decoded_ms,
+            per_character(decoded_ms), per_sample(decoded_ms), searches);
+    SDL_Log("  max pose difference: translation %.2e, rotation %.2e rad, scale %.2e", pose_error[GFX_ANIM_TRANSLATION],
+            pose_error[GFX_ANIM_ROTATION], pose_error[GFX_ANIM_SCALE]);
+
+    // The settings bound reduction and quantization together.
+    if (report.max_error[GFX_ANIM_TRANSLATION] > settings.translation_error ||
+        report.max_error[GFX_ANIM_ROTATION] > settings.rotation_error || report.max_error[GFX_ANIM_SCALE] > settings.scale_error) {
+        SDL_Log("  FAILED: the compressed clip is off by more than the settings allow");
+        return false;
+    }
+    return true;
+}
+
+#define LOD_MESH_COUNT 48
+
+enum Lod_Mesh_Kind {
+    LOD_MESH_HEIGHTFIELD,
+    LOD_MESH_SPHERE,
+    LOD_MESH_BOX,
+    LOD_MESH_KIND_COUNT,
+};
+
+static Lod_Mesh_Kind lod_mesh_kind(int i) {
+    return cast(Lod_Mesh_Kind)(i % LOD_MESH_KIND_COUNT);
+}
+
+// Cells per side of a heightfield or a box face, segments of a sphere. Boxes
+// stay small enough that their last level is below the triangles their edges
+// need.
+static int lod_mesh_resolution(int i) {
+    if (lod_mesh_kind(i) == LOD_MESH_BOX) return 16 + (i * 5) % 12;
+    return 64 + (i * 37) % 160;
+}
+
+static void lod_mesh_counts(int i, int *vertex_count, int *triangle_count) {
+    int n = lod_mesh_resolution(i);
+    switch (lod_mesh_kind(i)) {
+    case LOD_MESH_HEIGHTFIELD:
+        *vertex_count   = (n + 1) * (n + 1);
+        *triangle_count = 2 * n * n;
+        break;
+    case LOD_MESH_SPHERE:
+        *vertex_count   = (n / 2 + 1) * (n + 1);
+        *triangle_count = n / 2 * n * 2;
+        break;
+    default:
+        *vertex_count   = 6 * (n + 1) * (n + 1);
+        *triangle_count = 6 * 2 * n * n;
+        break;
+    }
+}
+
+// Triangles a box keeps when the vertices on its edges never move: every
+// face a fan over its 4n border vertices.
+static int lod_box_edge_triangles(int i) {
+    return 6 * (4 * lod_mesh_resolution(i) - 2);
+}
+
+static f32 lod_bump(const f32 *phases, f32 u, f32 v) {
+    return 0.06f * SDL_sinf(7.0f * u + phases[0]) * SDL_cosf(5.0f * v + phases[1]) +
+           0.02f * SDL_sinf(19.0f * u + 13.0f * v + phases[2]);
+}
+
+// Heightfields over [-1, 1] and UV spheres of about unit radius, both with
+// smooth bumps, and flat shaded boxes over [-1, 1], a grid per face.
+static void generate_lod_mesh(Gfx_Mesh *mesh, int i, u64 *seed) {
+    int n = lod_mesh_resolution(i);
+    f32 phases[3];
+    for (f32 &phase : phases) phase = cast(f32)(next_random(seed) % 6283) / 1000.0f;
+
+    int v = 0, t = 0;
+    Lod_Mesh_Kind kind = lod_mesh_kind(i);
+    if (kind == LOD_MESH_HEIGHTFIELD) {
+        for (int z = 0; z <= n; z++) {
+            for (int x = 0; x <= n; x++, v++) {
+                f32 u = 2.0f * cast(f32)x / cast(f32)n - 1.0f;
+                f32 w = 2.0f * cast(f32)z / cast(f32)n - 1.0f;
+                mesh->vertices[v * 3 + 0] = u;
+                mesh->vertices[v * 3 + 1] = lod_bump(phases, u, w);
+                mesh->vertices[v * 3 + 2] = w;
+            }
+        }
+        for (int z = 0; z < n; z++) {
+            for (int x = 0; x < n; x++) {
+                u32 a = cast(u32)(z * (n + 1) + x);
+                u32 b = a + cast(u32)n + 1;
+                u32 corners[6] = {a, b, a + 1, a + 1, b, b + 1};
+                for (u32 corner : corners) gfx_mesh_set_index(mesh, t++, corner);
+            }
+        }
+    } else if (kind == LOD_MESH_SPHERE) {
+        int rings = n / 2;
+        for (int r = 0; r <= rings; r++) {
+            f32 theta = SDL_PI_F * cast(f32)r / cast(f32)rings;
+            for (int s = 0; s <= n; s++, v++) {
+                f32 phi = 2.0f * SDL_PI_F * cast(f32)(s % n) / cast(f32)n;
+                f32 radius = 1.0f + lod_bump(phases, 2.0f * phi, 2.0f * theta);
+                mesh->vertices[v * 3 + 0] = radius * SDL_sinf(theta) * SDL_cosf(phi);
+                mesh->vertices[v * 3 + 1] = radius * SDL_cosf(theta);
+                mesh->vertices[v * 3 + 2] = radius * SDL_sinf(theta) * SDL_sinf(phi);
+            }
+        }
+        for (int r = 0; r < rings; r++) {
+            for (int s = 0; s < n; s++) {
+                u32 a = cast(u32)(r * (n + 1) + s);
+                u32 b = a + cast(u32)n + 1;
+                u32 corners[6] = {a, b, a + 1, a + 1, b, b + 1};
+                for (u32 corner : corners) gfx_mesh_set_index(mesh, t++, corner);
+            }
+        }
+    } else {
+        // Face f lies at sign on axis f / 2, the grid runs along the other two
+        // axes, mirrored on the positive faces so that all of them face out.
+        // Integer numerators keep the positions on shared edges identical.
+        for (int f = 0; f < 6; f++) {
+            int axis = f / 2;
+            f32 sign = f % 2 == 0 ? -1.0f : 1.0f;
+            u32 first = cast(u32)v;
+            for (int z = 0; z <= n; z++) {
+                for (int x = 0; x <= n; x++, v++) {
+                    f32 *p = &mesh->vertices[v * 3];
+                    p[axis]           = sign;
+                    p[(axis + 1) % 3] = -sign * cast(f32)(2 * x - n) / cast(f32)n;
+                    p[(axis + 2) % 3] = cast(f32)(2 * z - n) / cast(f32)n;
+                }
+            }
+            for (int z = 0; z < n; z++) {
+                for (int x = 0; x < n; x++) {
+                    u32 a = first + cast(u32)(z * (n + 1) + x);
+                    u32 b = a + cast(u32)n + 1;
+                    u32 corners[6] = {a, b, a + 1, a + 1, b, b + 1};
+                    for (u32 corner : corners) gfx_mesh_set_index(mesh, t++, corner);
+                }
+            }
+        }
+    }
+    mesh->bounds = gfx_bounds_from_points(mesh->vertices, mesh->vertex_count);
+}
+
+static void layout_lod_model(Gfx_Model *model, Arena *storage) {
+    model->meshes = cast(Gfx_Mesh *)arena_push(storage, LOD_MESH_COUNT * sizeof(Gfx_Mesh));
+    for (int i = 0; i < LOD_MESH_COUNT; i++) {
+        int vertex_count, triangle_count;
+        lod_mesh_counts(i, &vertex_count, &triangle_count);
+        u32 index_size = gfx_mesh_index_size(vertex_count);
+        f32 *vertices = cast(f32 *)arena_push(storage, cast(usize)vertex_count * 3 * sizeof(f32));
+        void *indices = arena_push(storage, cast(usize)triangle_count * 3 * index_size);
+        if (model->meshes == NULL) continue;
+
+        Gfx_Mesh *mesh = &model->meshes[i];
+        *mesh = {};
+        mesh->vertex_count   = vertex_count;
+        mesh->triangle_count = triangle_count;
+        mesh->vertices   = vertices;
+        mesh->indices    = indices;
+        mesh->index_size = index_size;
+    }
+}
+
+static bool build_lod_model(Gfx_Model *model) {
+    Arena measure{};
+    layout_lod_model(model, &measure);
+    if (!arena_init(&model->storage, measure.used)) return false;
+    layout_lod_model(model, &model->storage);
+    model->mesh_count = LOD_MESH_COUNT;
+
+    u64 seed = 0x9e3779b97f4a7c15ull;
+    for (int i = 0; i < LOD_MESH_COUNT; i++) generate_lod_mesh(&model->meshes[i], i, &seed);
+    return true;
+}
+
+// Indices in range, no triangle with two corners at one position, and
+// fewer triangles every level.
+static bool check_lods(const Gfx_Mesh *mesh) {
+    u32 previous = cast(u32)mesh->triangle_count * 3;
+    for (int l = 0; l < mesh->lod_count; l++) {
+        const Gfx_Lod *lod = &mesh->lods[l];
+        if (lod->index_count >= previous || lod->index_count % 3 != 0) return false;
+        if (l > 0 && lod->error < mesh->lods[l - 1].error) return false;
+        previous = lod->index_count;
+
+        for (u32 i = lod->first_index; i < lod->first_index + lod->index_count; i += 3) {
+            glm::vec3 corners[3];
+            for (u32 k = 0; k < 3; k++) {
+                u32 index = mesh->index_size == sizeof(u32) ? (cast(const u32 *)mesh->lod_indices)[i + k]
+                                                            : (cast(const u16 *)mesh->lod_indices)[i + k];
+                if (index >= cast(u32)mesh->vertex_count) return false;
+                corners[k] = glm::vec3(mesh->vertices[index * 3], mesh->vertices[index * 3 + 1], mesh->vertices[index * 3 + 2]);
+            }
+            if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2]) return false;
+        }
+    }
+    return true;
+}
+
+static bool bench_lod(Job_System *jobs, int runs) {
+    Gfx_Model serial, parallel;
+    defer {
+        gfx_model_cleanup(&serial);
+        gfx_model_cleanup(&parallel);
+    };
+    if (!build_lod_model(&serial) || !build_lod_model(&parallel)) return false;
+
+    f64 serial_ms = 0.0, parallel_ms = 0.0;
+    for (int run = 0; run < runs; run++) {
+        u64 start = SDL_GetPerformanceCounter();
+        if (!gfx_model_build_lods(&serial, NULL, NULL, false)) return false;
+        serial_ms += elapsed_ms(start);
+
+        start = SDL_GetPerformanceCounter();
+        if (!gfx_model_build_lods(&parallel, NULL, jobs, false)) return false;
+        parallel_ms += elapsed_ms(start);
+    }
+    serial_ms   /= runs;
+    parallel_ms /= runs;
+
+    if (!gfx_model_equal(&serial, &parallel)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "lod: parallel LODs differ from serial ones");
+        return false;
+    }
+
+    // Meshes with fewer levels count with their coarsest one.
+    u64 triangles[GFX_LOD_MAX_LEVELS + 1] = {};
+    f32 max_error[GFX_LOD_MAX_LEVELS + 1] = {};
+    int meshes[GFX_LOD_MAX_LEVELS + 1] = {};
+    u64 box_triangles = 0, box_coarsest = 0, box_edges = 0;
+    for (int i = 0; i < serial.mesh_count; i++) {
+        const Gfx_Mesh *mesh = &serial.meshes[i];
+        if (!check_lods(mesh)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "lod: invalid levels of mesh %d", i);
+            return false;
+        }
+        if (lod_mesh_kind(i) == LOD_MESH_BOX) {
+            u32 coarsest = mesh->lod_count > 0 ? mesh->lods[mesh->lod_count - 1].index_count / 3 : cast(u32)mesh->triangle_count;
+            if (coarsest >= cast(u32)lod_box_edge_triangles(i)) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "lod: box %d kept %u triangles, its edges did not simplify", i, coarsest);
+                return false;
+            }
+            box_triangles += cast(u64)mesh->triangle_count;
+            box_coarsest  += coarsest;
+            box_edges     += cast(u64)lod_box_edge_triangles(i);
+        }
+        for (int l = 0; l <= GFX_LOD_MAX_LEVELS; l++) {
+            int level = SDL_min(l, mesh->lod_count);
+            triangles[l] += level == 0 ? cast(u64)mesh->triangle_count : mesh->lods[level - 1].index_count / 3;
+            if (l > 0 && l <= mesh->lod_count) {
+                max_error[l] = SDL_max(max_error[l], mesh->lods[l - 1].error);
+                meshes[l]++;
+            }
+        }
+    }
+
+    SDL_Log("lod: %d meshes, %d runs", serial.mesh_count, runs);
+    SDL_Log("  build serial:     %9.3f ms", serial_ms);
+    SDL_Log("  build (%2d thr):   %9.3f ms  %.1fx", job_worker_count(jobs), parallel_ms,
+            parallel_ms > 0.0 ? serial_ms / parallel_ms : 0.0);
+    for (int l = 0; l <= GFX_LOD_MAX_LEVELS; l++) {
+        SDL_Log("  LOD %d: %9llu triangles  %5.1f%%  %2d meshes  max error %.4f", l, cast(unsigned long long)triangles[l],
+                100.0 * cast(f64)triangles[l] / cast(f64)triangles[0], l == 0 ? serial.mesh_count : meshes[l], max_error[l]);
+    }
+    SDL_Log("  faceted boxes: %llu -> %llu triangles, %llu with their edges kept", cast(unsigned long long)box_triangles,
+            cast(unsigned long long)box_coarsest, cast(unsigned long long)box_edges);
+
+    // Every mesh at depths from 2 to 200 bounding radii, 1080 lines high.
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, GFX_FAR_PLANE);
+    const f32 threshold = 1.0f / 1080.0f;
+    const int steps = 100;
+    u64 drawn = 0, full = 0;
+    int picks[GFX_LOD_MAX_LEVELS + 1] = {};
+    for (int i = 0; i < serial.mesh_count; i++) {
+        const Gfx_Mesh *mesh = &serial.meshes[i];
+        for (int step = 0; step < steps; step++) {
+            f32 radius = mesh->bounds.radius;
+            f32 depth  = radius * (2.0f + 198.0f * cast(f32)step / cast(f32)(steps - 1));
+            int level  = gfx_lod_select(mesh->lods, mesh->lod_count, gfx_lod_screen_size(proj, radius, depth), threshold);
+            picks[level]++;
+            drawn += level == 0 ? cast(u64)mesh->triangle_count : mesh->lods[level - 1].index_count / 3;
+            full  += cast(u64)mesh->triangle_count;
+        }
+    }
+    SDL_Log("  row of %d instances per mesh: %.1f%% of the triangles, levels %d %d %d %d %d", steps,
+            100.0 * cast(f64)drawn / cast(f64)full, picks[0], picks[1], picks[2], picks[3], picks[4]);
+
+    return true;
+}
+
+// Unit cube around the origin, the occluder of every wall.
+static const f32 occlusion_cube_positions[8 * 3] = {
+    -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f, 0.5f, -0.5f,   -0.5f, 0.5f, -0.5f,
+    -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f, 0.5f,  0.5f,   -0.5f, 0.5f,  0.5f,
+};
+static const u16 occlusion_cube_indices[36] = {
+    0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,   0, 1, 5, 0, 5, 4,
+    3, 6, 2, 3, 7, 6,   0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5,
+};
+
+// The camera stands between the walls and turns a bit every run.
+static glm::mat4 occlusion_view_proj(int run) {
+    f32 angle = cast(f32)run * 0.7f;
+    glm::mat4 proj = glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    glm::vec3 eye(0.0f, 1.7f, 0.0f);
+    glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(SDL_sinf(angle), 0.0f, -SDL_cosf(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+    return proj * view;
+}
+
+static bool bench_occlusion(Job_System *jobs, int runs, int box_count) {
+    // Walls of 18 x 6 x 0.5 on a grid of 24, turned along x or z, with
+    // random boxes on the ground between them.
+    const int wall_side = 12;
+    const int wall_count = wall_side * wall_side;
+    const f32 wall_spacing = 24.0f;
+    const f32 extent = wall_spacing * cast(f32)wall_side * 0.5f;
+
+    Gfx_Occluder cube;
+    cube.positions    = occlusion_cube_positions;
+    cube.vertex_count = 8;
+    cube.indices      = occlusion_cube_indices;
+    cube.index_size   = sizeof(u16);
+    cube.index_count  = 36;
+
+    Gfx_Bounds unit_bounds = gfx_bounds_from_points(occlusion_cube_positions, 8);
+
+    auto walls   = cast(glm::mat4 *)SDL_malloc(cast(usize)wall_count * sizeof(glm::mat4));
+    auto boxes   = cast(glm::mat4 *)SDL_malloc(cast(usize)box_count * sizeof(glm::mat4));
+    auto results = cast(u8 *)SDL_malloc(cast(usize)box_count);
+    auto depth   = cast(f32 *)SDL_malloc(GFX_OCCLUSION_WIDTH * GFX_OCCLUSION_HEIGHT * sizeof(f32));
+    defer {
+        SDL_free(walls);
+        SDL_free(boxes);
+        SDL_free(results);
+        SDL_free(depth);
+    };
+    if (!walls || !boxes || !results || !depth) return false;
+
+    u64 seed = 0x5851f42d4c957f2dull;
+    auto next_f32 = [&](f32 min, f32 max) {
+        return min + (max - min) * cast(f32)(next_random(&seed) >> 40) / cast(f32)(1 << 24);
+    };
+    for (int i = 0; i < wall_count; i++) {
+        glm::vec3 position((cast(f32)(i % wall_side) + 0.5f) * wall_spacing - extent, 3.0f,
+                           (cast(f32)(i / wall_side) + 0.5f) * wall_spacing - extent);
+        glm::vec3 size = next_random(&seed) & 1 ? glm::vec3(18.0f, 6.0f, 0.5f) : glm::vec3(0.5f, 6.0f, 18.0f);
+        walls[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), size);
+    }
+    for (int i = 0; i < box_count; i++) {
+        glm::vec3 position(next_f32(-extent, extent), next_f32(0.25f, 2.0f), next_f32(-extent, extent));
+        boxes[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(next_f32(0.5f, 2.0f)));
+    }
+
+    Gfx_Occlusion_Buffer buffer, single;
+    defer {
+        gfx_occlusion_free(&buffer);
+        gfx_occlusion_free(&single);
+    };
+    if (!gfx_occlusion_init(&buffer, GFX_OCCLUSION_WIDTH, GFX_OCCLUSION_HEIGHT)) return false;
+    if (!gfx_occlusion_init(&single, GFX_OCCLUSION_WIDTH, GFX_OCCLUSION_HEIGHT)) return false;
+    for (int i = 0; i < wall_count; i++) {
+        if (!gfx_occlusion_add(&buffer, &cube, walls[i])) return false;
+    }
+
+    usize depth_size = cast(usize)buffer.width * cast(usize)buffer.height * sizeof(f32);
+    int tile_count = buffer.tiles_x * buffer.tiles_y;
+
+    f64 setup_ms = 0.0, scalar_ms = 0.0, simd_ms = 0.0, parallel_ms = 0.0;
+    f64 test_scalar_ms = 0.0, test_simd_ms = 0.0;
+    u64 in_frustum = 0, hidden = 0;
+
+    for (int run = 0; run < runs; run++) {
+        glm::mat4 view_proj = occlusion_view_proj(run);
+
+        // The reference: setup, then every tile with the scalar kernel.
+        u64 start = SDL_GetPerformanceCounter();
+        if (!gfx_occlusion_setup(&buffer, view_proj)) return false;
+        setup_ms += elapsed_ms(start);
+
+        start = SDL_GetPerformanceCounter();
+        for (int tile = 0; tile < tile_count; tile++) gfx_occlusion_rasterize_tile_scalar(&buffer, tile);
+        scalar_ms += elapsed_ms(start);
+        SDL_memcpy(depth, buffer.depth, depth_size);
+
+        start = SDL_GetPerformanceCounter();
+        for (int tile = 0; tile < tile_count; tile++) gfx_occlusion_rasterize_tile(&buffer, tile);
+        simd_ms += elapsed_ms(start);
+        if (SDL_memcmp(depth, buffer.depth, depth_size) != 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "occlusion: SIMD depths differ from the reference in run %d", run);
+            return false;
+        }
+
+        start = SDL_GetPerformanceCounter();
+        if (!gfx_occlusion_render(&buffer, view_proj, jobs)) return false;
+        parallel_ms += elapsed_ms(start);
+        if (SDL_memcmp(depth, buffer.depth, depth_size) != 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "occlusion: parallel depths differ from the reference in run %d", run);
+            return false;
+        }
+
+        start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < box_count; i++) results[i] = gfx_occlusion_test_box_scalar(&buffer, &unit_bounds, boxes[i]);
+        test_scalar_ms += elapsed_ms(start);
+
+        int mismatch = -1;
+        start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < box_count; i++) {
+            if (gfx_occlusion_test_box(&buffer, &unit_bounds, boxes[i]) != (results[i] != 0)) mismatch = i;
+        }
+        test_simd_ms += elapsed_ms(start);
+        if (mismatch >= 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "occlusion: test kernels disagree on box %d in run %d", mismatch, run);
+            return false;
+        }
+
+        Gfx_Frustum frustum = gfx_frustum_from_matrix(view_proj);
+        for (int i = 0; i < box_count; i++) {
+            glm::vec3 center;
+            f32 radius;
+            gfx_bounds_transform_sphere(&unit_bounds, boxes[i], &center, &radius);
+            if (!gfx_frustum_test_sphere(&frustum, center, radius)) continue;
+            in_frustum++;
+            hidden += results[i] == 0;
+        }
+
+        // A wall alone never hides itself. Those off screen cover no pixel.
+        for (int i = run; i < wall_count; i += runs) {
+            glm::vec3 center;
+            f32 radius;
+            gfx_bounds_transform_sphere(&unit_bounds, walls[i], &center, &radius);
+            if (!gfx_frustum_test_sphere(&frustum, center, radius)) continue;
+
+            gfx_occlusion_clear(&single);
+            if (!gfx_occlusion_add(&single, &cube, walls[i])) return false;
+            if (!gfx_occlusion_render(&single, view_proj, NULL)) return false;
+            if (single.stats.rasterized > 0 && !gfx_occlusion_test_box(&single, &unit_bounds, walls[i])) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "occlusion: wall %d hides its own bounds in run %d", i, run);
+                return false;
+            }
+        }
+    }
+
+    setup_ms       /= runs;
+    scalar_ms      /= runs;
+    simd_ms        /= runs;
+    parallel_ms    /= runs;
+    test_scalar_ms /= runs;
+    test_simd_ms   /= runs;
+
+#if SIMD_AVX2
+    const char *kernel = "AVX2";
+#elif SIMD_SSE2
+    const char *kernel = "SSE2";
+#else
+    const char *kernel = "scalar";
+#endif
+
+    const Gfx_Occlusion_Stats *stats = &buffer.stats;
+    SDL_Log("occlusion: %d walls, %d boxes, %dx%d pixels in %d tiles, %d runs", wall_count, box_count,
+            buffer.width, buffer.height, tile_count, runs);
+    SDL_Log("  triangles: %llu, %llu after clipping, %llu binned in the last run", cast(unsigned long long)stats->triangles,
+            cast(unsigned long long)stats->rasterized, cast(unsigned long long)stats->binned);
+    SDL_Log("  setup:              %8.3f ms", setup_ms);
+    SDL_Log("  raster scalar:      %8.3f ms", scalar_ms);
+    SDL_Log("  raster %-6s:      %8.3f ms  %.1fx", kernel, simd_ms, simd_ms > 0.0 ? scalar_ms / simd_ms : 0.0);
+    SDL_Log("  render (%2d thr):    %8.3f ms  setup and raster", job_worker_count(jobs), parallel_ms);
+    SDL_Log("  test scalar:        %8.3f ms  %6.1f Mboxes/s", test_scalar_ms, test_scalar_ms > 0.0 ? box_count / test_scalar_ms / 1000.0 : 0.0);
+    SDL_Log("  test %-6s:        %8.3f ms  %6.1f Mboxes/s", kernel, test_simd_ms, test_simd_ms > 0.0 ? box_count / test_simd_ms / 1000.0 : 0.0);
+    SDL_Log("  hidden: %.1f%% of %.0f boxes in the frustum per run", in_frustum > 0 ? 100.0 * cast(f64)hidden / cast(f64)in_frustum : 0.0,
+            cast(f64)in_frustum / runs);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    const char *name = NULL;
+    int runs    = 10;
+    int packets = 100000;
+    int instances = 1000000;
+    int nodes = 100000;
+    int threads = 0;
+    int image   = 2048;
+    int characters = 256;
+    int vertices   = 4096;
+
+    for (int i = 1; i < argc; i++) {
+        if (SDL_strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = SDL_atoi(argv[++i]);
+            runs = SDL_max(runs, 1);
+        } else if (SDL_strcmp(argv[i], "--packets") == 0 && i + 1 < argc) {
+            packets = SDL_atoi(argv[++i]);
+            packets = SDL_max(packets, 1);
+        } else if (SDL_strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+            instances = SDL_atoi(argv[++i]);
+            instances = SDL_max(instances, 1);
+        } else if (SDL_strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) {
+            nodes = SDL_atoi(argv[++i]);
+            nodes = SDL_max(nodes, 1);
+        } else if (SDL_strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = SDL_atoi(argv[++i]);
+            threads = SDL_clamp(threads, 1, JOB_MAX_WORKERS);
+        } else if (SDL_strcmp(argv[i], "--image") == 0 && i + 1 < argc) {
+            image = SDL_atoi(argv[++i]);
+            image = SDL_clamp(image, 1, 16384);
+        } else if (SDL_strcmp(argv[i], "--characters") == 0 && i + 1 < argc) {
+            characters = SDL_atoi(argv[++i]);
+            characters = SDL_max(characters, 1);
+        } else if (SDL_strcmp(argv[i], "--vertices") == 0 && i + 1 < argc) {
+            vertices = SDL_atoi(argv[++i]);
+            vertices = SDL_max(vertices, 1);
+        } else if (name == NULL) {
+            name = argv[i];
+        }
+    }
+
+    auto selected = [&](const char *bench) {
+        return name == NULL || SDL_strcmp(name, bench) == 0;
+    };
+
+    if (threads == 0) threads = SDL_min(SDL_GetNumLogicalCPUCores(), JOB_MAX_WORKERS);
+
+    bool ok = true;
+    if (selected("queue")) ok = bench_queue(runs, packets) && ok;
+
+    // The scaling table starts its own job systems.
+    {
+        Job_System jobs;
+        job_system_init(&jobs, threads);
+        defer { job_system_shutdown(&jobs); };
+
+        if (selected("cull"))  ok = bench_cull(&jobs, runs, instances) && ok;
+        if (selected("scene")) ok = bench_scene(&jobs, runs, nodes) && ok;
+        if (selected("mips"))  ok = bench_mips(&jobs, runs, image) && ok;
+        if (selected("bc"))    ok = bench_bc(&jobs, runs, image) && ok;
+        if (selected("anim"))  ok = bench_anim(&jobs, runs, characters, vertices) && ok;
+        if (selected("lod"))   ok = bench_lod(&jobs, runs) && ok;
+        if (selected("occlusion")) ok = bench_occlusion(&jobs, runs, SDL_max(instances / 10, 1)) && ok;
+    }
+
+    if (selected("jobs")) ok = bench_jobs(runs, instances, nodes, threads) && ok;
+    if (selected("staging")) ok = bench_staging(runs) && ok;
+    if (selected("residency")) ok = bench_residency(runs) && ok;
+    if (selected("clip")) ok = bench_clip(runs, characters) && ok;
+
+    return ok ? 0 : 1;
+}
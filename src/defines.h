@@ -55,8 +55,46 @@ class ExitScopeHelp {
 #define defer const auto& GLUE(defer__, __LINE__) = ExitScopeHelp() + [&]()
 
 
+// SIMD.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SIMD_SSE2 1
+#endif
+
+#if defined(__AVX2__)
+    #define SIMD_AVX2 1
+#endif
+
+// MSVC has no flag of its own for F16C, it comes with /arch:AVX2.
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+    #define SIMD_F16C 1
+#endif
+
+
 // Misc.
 
 #define ARRAY_COUNT(a) (sizeof((a)) / sizeof((a)[0]))
 
 #define ASSERT(expr) SDL_assert((expr))
+
+
+// Hashing.
+
+// 64-bit FNV-1a. Pass the previous result as seed to hash data in pieces.
+inline u64 hash_fnv1a64(const void *data, usize size, u64 seed = 0xcbf29ce484222325ull) {
+    auto bytes = cast(const u8 *)data;
+    u64 hash = seed;
+    for (usize i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+
+// GPU recording.
+
+// The headless benchmark records the SDL GPU calls instead of making them.
+#if GFX_GPU_RECORD
+    #include "gfx_gpu_record.h"
+#endif
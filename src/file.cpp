@@ -0,0 +1,16 @@
+#include "file.h"
+
+#include <SDL3/SDL.h>
+
+bool save_file_atomic(const char *path, const void *data, usize size) {
+    char temp_file[1024];
+    if (SDL_snprintf(temp_file, sizeof(temp_file), "%s.tmp", path) >= cast(int)sizeof(temp_file)) return false;
+    if (!SDL_SaveFile(temp_file, data, size)) return false;
+
+    // Replaces an existing file.
+    if (!SDL_RenamePath(temp_file, path)) {
+        SDL_RemovePath(temp_file);
+        return false;
+    }
+    return true;
+}
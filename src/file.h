@@ -0,0 +1,12 @@
+#pragma once
+
+#include "defines.h"
+
+//
+// File helpers.
+//
+
+// Writes data to a temporary file next to path, then renames it over path, so
+// a failed write never leaves a truncated file behind. Returns false on
+// failure, path is unchanged then.
+bool save_file_atomic(const char *path, const void *data, usize size);
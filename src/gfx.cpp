@@ -1,4 +1,6 @@
 #include "gfx.h"
+#include "gfx_cache.h"
+#include "profile.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -10,41 +12,39 @@ struct Uniform_Block {
     glm::mat4 mvp;
 };
 
-struct Vertex_Data {
-    glm::vec3 position;
-    glm::vec4 color;
-    glm::vec2 texcoord;
+struct Mesh_Uniform_Block {
+    glm::mat4 view_proj;
+    glm::vec4 dequant_scale;
+    glm::vec4 dequant_offset;
 };
 
-static void init_graphics_pipeline(Gfx_Context *context);
-static void init_vertex_and_index_buffers(Gfx_Context *context, SDL_GPUCopyPass *copy_pass);
-static void init_texture(Gfx_Context *context, SDL_GPUCopyPass *copy_pass);
+static void init_pipelines(Gfx_Context *context);
+static void init_vertex_and_index_buffers(Gfx_Context *context);
+static void init_texture(Gfx_Context *context);
 
 void gfx_init(Gfx_Context *context, SDL_Window *window) {
     context->window = window;
+    context->residency.userdata = context;
 
     context->device = SDL_CreateGPUDevice(SDL_GPU_SHADERFORMAT_SPIRV, true, NULL);
     ASSERT(context->device != NULL);
     ASSERT(SDL_ClaimWindowForGPUDevice(context->device, context->window));
 
-    init_graphics_pipeline(context);
+    // ASSERT compiles out in optimized builds, the calls must not be in it.
+    bool staging_ready   = gfx_staging_init(&context->staging, context->device, GFX_STAGING_CAPACITY);
+    bool occlusion_ready = gfx_occlusion_init(&context->occlusion, GFX_OCCLUSION_WIDTH, GFX_OCCLUSION_HEIGHT);
+    ASSERT(staging_ready);
+    ASSERT(occlusion_ready);
 
-    {
-        auto command_buffer = SDL_AcquireGPUCommandBuffer(context->device);
-        defer { ASSERT(SDL_SubmitGPUCommandBuffer(command_buffer)); };
-
-        auto copy_pass = SDL_BeginGPUCopyPass(command_buffer);
-        defer { SDL_EndGPUCopyPass(copy_pass); };
-
-        init_vertex_and_index_buffers(context, copy_pass);
-        init_texture(context, copy_pass);
-    }
+    init_pipelines(context);
+    init_vertex_and_index_buffers(context);
+    init_texture(context);
 
     int _w, _h;
     ASSERT(SDL_GetWindowSizeInPixels(context->window, &_w, &_h));
     f32 width  = static_cast<f32>(_w);
     f32 height = static_cast<f32>(_h);
-    context->proj = glm::perspective(glm::radians(70.0f), width/height, 0.0001f, 1000.0f);
+    context->proj = glm::perspective(glm::radians(70.0f), width/height, 0.0001f, GFX_FAR_PLANE);
 
     #if 0
     SDL_GPUPresentMode present_mode = SDL_GPU_PRESENTMODE_VSYNC;
@@ -58,116 +58,74 @@ void gfx_init(Gfx_Context *context, SDL_Window *window) {
 }
 
 void gfx_cleanup(Gfx_Context *context) {
-    SDL_ReleaseGPUSampler(context->device, context->sampler);
-    SDL_ReleaseGPUTexture(context->device, context->texture);
+    gfx_staging_free(&context->staging);
+    for (int i = 0; i < GFX_SAMPLER_FILTER_COUNT; i++) SDL_ReleaseGPUSampler(context->device, context->samplers[i]);
+    SDL_ReleaseGPUTexture(context->device, context->white_texture);
     SDL_ReleaseGPUBuffer(context->device, context->index_buffer);
     SDL_ReleaseGPUBuffer(context->device, context->vertex_buffer);
-    SDL_ReleaseGPUGraphicsPipeline(context->device, context->graphics_pipeline);
+    gfx_pipeline_cache_free(&context->pipelines);
+    SDL_ReleaseGPUBuffer(context->device, context->instance_buffer);
     SDL_DestroyGPUDevice(context->device);
 
+    SDL_free(context->submissions);
+    gfx_queue_free(&context->queue);
+    gfx_sphere_set_free(&context->cull_set);
+    gfx_occlusion_free(&context->occlusion);
+    SDL_free(context->visible);
+    context->submissions = NULL;
+    context->submission_count = 0;
+    context->submission_capacity = 0;
+    context->visible = NULL;
+    context->visible_capacity = 0;
+    context->instance_buffer = NULL;
+    context->instance_capacity = 0;
+
+    SDL_free(context->draw_ranges);
+    context->draw_ranges = NULL;
+    context->draw_range_capacity = 0;
+
     context->window = NULL;
 }
 
-static void init_graphics_pipeline(Gfx_Context *context) {
-    u64 vertex_code_size;
-    auto vertex_code = SDL_LoadFile("res/shaders/basic.vert.spv", &vertex_code_size);
-    defer { SDL_free(vertex_code); };
-
-    SDL_GPUShaderCreateInfo vertex_info{};
-    vertex_info.code_size    = vertex_code_size;
-    vertex_info.code         = static_cast<u8 *>(vertex_code);
-    vertex_info.entrypoint   = "main";
-    vertex_info.format       = SDL_GPU_SHADERFORMAT_SPIRV;
-    vertex_info.stage        = SDL_GPU_SHADERSTAGE_VERTEX;
-    vertex_info.num_samplers = 0;
-    vertex_info.num_storage_textures = 0;
-    vertex_info.num_storage_buffers  = 0;
-    vertex_info.num_uniform_buffers  = 1;
-    auto vertex_shader = SDL_CreateGPUShader(context->device, &vertex_info);
-    defer { SDL_ReleaseGPUShader(context->device, vertex_shader); };
-
-    u64 fragment_code_size;
-    auto fragment_code = SDL_LoadFile("res/shaders/basic.frag.spv", &fragment_code_size);
-    defer { SDL_free(fragment_code); };
-
-    SDL_GPUShaderCreateInfo fragment_info{};
-    fragment_info.code_size    = fragment_code_size;
-    fragment_info.code         = static_cast<u8 *>(fragment_code);
-    fragment_info.entrypoint   = "main";
-    fragment_info.format       = SDL_GPU_SHADERFORMAT_SPIRV;
-    fragment_info.stage        = SDL_GPU_SHADERSTAGE_FRAGMENT;
-    fragment_info.num_samplers = 1;
-    fragment_info.num_storage_textures = 0;
-    fragment_info.num_storage_buffers  = 0;
-    fragment_info.num_uniform_buffers  = 0;
-    auto fragment_shader = SDL_CreateGPUShader(context->device, &fragment_info);
-    defer { SDL_ReleaseGPUShader(context->device, fragment_shader); };
-
-    // Configure vertex input state.
-    
-    SDL_GPUVertexBufferDescription description0{};
-    description0.slot  = 0;
-    description0.pitch = sizeof(Vertex_Data);
-    description0.input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX;
-    description0.instance_step_rate = 0;
-
-    SDL_GPUVertexBufferDescription vertex_buffer_descriptions[] = {
-        description0,
-    };
+// The variants the frame draws with, to the swapchain.
+static Gfx_Pipeline_Key quad_pipeline_key(Gfx_Context *context) {
+    Gfx_Pipeline_Key key;
+    key.vertex_shader   = GFX_SHADER_BASIC_VERT;
+    key.fragment_shader = GFX_SHADER_BASIC_FRAG;
+    key.vertex_input    = GFX_PIPELINE_INPUT_QUAD;
+    key.color_format    = SDL_GetGPUSwapchainTextureFormat(context->device, context->window);
+    return key;
+}
 
-    SDL_GPUVertexAttribute attribute0{};
-    attribute0.location    = 0;
-    attribute0.buffer_slot = 0;
-    attribute0.format      = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3;
-    attribute0.offset      = offsetof(Vertex_Data, position);
-
-    SDL_GPUVertexAttribute attribute1{};
-    attribute1.location    = 1;
-    attribute1.buffer_slot = 0;
-    attribute1.format      = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4;
-    attribute1.offset      = offsetof(Vertex_Data, color);
-
-    SDL_GPUVertexAttribute attribute2{};
-    attribute2.location    = 2;
-    attribute2.buffer_slot = 0;
-    attribute2.format      = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2;
-    attribute2.offset      = offsetof(Vertex_Data, texcoord);
-
-    SDL_GPUVertexAttribute vertex_attributes[] = {
-        attribute0,
-        attribute1,
-        attribute2,
+static Gfx_Pipeline_Key mesh_pipeline_key(Gfx_Context *context, Gfx_Vertex_Layout layout) {
+    const Gfx_Shader mesh_shaders[GFX_VERTEX_LAYOUT_COUNT] = {
+        GFX_SHADER_MESH_VERT,
+        GFX_SHADER_MESH_COMPACT_VERT,
+        GFX_SHADER_MESH_COMPACT_TANGENT_VERT,
     };
 
-    SDL_GPUVertexInputState vertex_input_state{};
-    vertex_input_state.vertex_buffer_descriptions = vertex_buffer_descriptions;
-    vertex_input_state.num_vertex_buffers = ARRAY_COUNT(vertex_buffer_descriptions);
-    vertex_input_state.vertex_attributes  = vertex_attributes;
-    vertex_input_state.num_vertex_attributes = ARRAY_COUNT(vertex_attributes);
-
-    // Create graphics pipeline.
+    Gfx_Pipeline_Key key = quad_pipeline_key(context);
+    key.vertex_shader = mesh_shaders[layout];
+    key.vertex_input  = layout;
+    return key;
+}
 
-    SDL_GPUColorTargetDescription color_target_description{};
-    color_target_description.format = SDL_GetGPUSwapchainTextureFormat(context->device, context->window);
-    
-    SDL_GPUGraphicsPipelineTargetInfo target_info{};
-    target_info.color_target_descriptions = &color_target_description;
-    target_info.num_color_targets = 1;
-    
-    SDL_GPUGraphicsPipelineCreateInfo pipeline_info{};
-    pipeline_info.vertex_shader   = vertex_shader;
-    pipeline_info.fragment_shader = fragment_shader;
-    pipeline_info.primitive_type  = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST;
-    pipeline_info.target_info     = target_info;
-    pipeline_info.vertex_input_state = vertex_input_state;
+static void init_pipelines(Gfx_Context *context) {
+    bool pipelines_ready = gfx_pipeline_cache_init(&context->pipelines, context->device);
+    ASSERT(pipelines_ready);
 
-    context->graphics_pipeline = SDL_CreateGPUGraphicsPipeline(context->device, &pipeline_info);
+    Gfx_Pipeline_Key key = quad_pipeline_key(context);
+    gfx_pipeline_request(&context->pipelines, &key);
+    for (int i = 0; i < GFX_VERTEX_LAYOUT_COUNT; i++) {
+        key = mesh_pipeline_key(context, cast(Gfx_Vertex_Layout)i);
+        gfx_pipeline_request(&context->pipelines, &key);
+    }
 }
 
-static void init_vertex_and_index_buffers(Gfx_Context *context, SDL_GPUCopyPass *copy_pass) {
+static void init_vertex_and_index_buffers(Gfx_Context *context) {
     const auto white = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 
-    Vertex_Data vertices[] = {
+    Gfx_Quad_Vertex vertices[] = {
         {glm::vec3(-0.5f, -0.5f, 0.0f), white, glm::vec2(0.0f, 1.0f)}, // Bottom-left
         {glm::vec3( 0.5f, -0.5f, 0.0f), white, glm::vec2(1.0f, 1.0f)}, // Bottom-right
         {glm::vec3( 0.5f,  0.5f, 0.0f), white, glm::vec2(1.0f, 0.0f)}, // Top-right
@@ -189,91 +147,378 @@ static void init_vertex_and_index_buffers(Gfx_Context *context, SDL_GPUCopyPass
     index_info.usage = SDL_GPU_BUFFERUSAGE_INDEX;
     context->index_buffer = SDL_CreateGPUBuffer(context->device, &index_info);
 
-    SDL_GPUTransferBufferCreateInfo transfer_info{};
-    transfer_info.size  = vertex_info.size + index_info.size;
-    transfer_info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-    auto transfer_buffer = SDL_CreateGPUTransferBuffer(context->device, &transfer_info);
+    bool vertices_queued = gfx_upload_buffer(context, context->vertex_buffer, 0, vertices, vertex_info.size);
+    bool indices_queued  = gfx_upload_buffer(context, context->index_buffer, 0, vertex_indices, index_info.size);
+    ASSERT(vertices_queued && indices_queued);
+    gfx_residency_add(&context->residency, &context->quad_resident, GFX_RESIDENT_BUFFER, vertex_info.size + index_info.size);
+}
+
+// size is the memory of all levels, room is made for it under the budget.
+static SDL_GPUTexture *create_texture(Gfx_Context *context, SDL_GPUTextureFormat format, int width, int height, int level_count, u64 size) {
+    gfx_residency_reserve(&context->residency, size);
+
+    SDL_GPUTextureCreateInfo texture_info{};
+    texture_info.type   = SDL_GPU_TEXTURETYPE_2D;
+    texture_info.format = format;
+    texture_info.usage  = SDL_GPU_TEXTUREUSAGE_SAMPLER;
+    texture_info.width  = static_cast<u32>(width);
+    texture_info.height = static_cast<u32>(height);
+    texture_info.layer_count_or_depth = 1;
+    texture_info.num_levels = static_cast<u32>(level_count);
+    return SDL_CreateGPUTexture(context->device, &texture_info);
+}
 
-    auto data = static_cast<u8 *>(SDL_MapGPUTransferBuffer(context->device, transfer_buffer, false));
-    u32 offset = 0;
-    SDL_memcpy(data + offset, vertices, vertex_info.size);
-    offset += vertex_info.size;
-    SDL_memcpy(data + offset, vertex_indices, index_info.size);
-    offset += index_info.size;
-    SDL_UnmapGPUTransferBuffer(context->device, transfer_buffer);
+SDL_GPUTexture *gfx_texture_upload(Gfx_Context *context, const u8 *pixels, int width, int height) {
+    if (pixels == NULL || width <= 0 || height <= 0) return NULL;
 
-    gfx_upload_buffer_begin(context, copy_pass, transfer_buffer, false);
-    gfx_upload_buffer_push(context, vertex_info.size, 0, context->vertex_buffer);
-    gfx_upload_buffer_push(context, index_info.size, 0, context->index_buffer);
-    gfx_upload_buffer_end(context);
+    auto texture = create_texture(context, SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM, width, height, 1, cast(u64)width * cast(u64)height * 4);
+    if (texture == NULL) return NULL;
+
+    if (!gfx_upload_texture(context, texture, 0, static_cast<u32>(width), static_cast<u32>(height), pixels)) {
+        gfx_staging_cancel_texture(&context->staging, texture);
+        SDL_ReleaseGPUTexture(context->device, texture);
+        return NULL;
+    }
 
-    SDL_ReleaseGPUTransferBuffer(context->device, transfer_buffer);
+    return texture;
 }
 
-static void init_texture(Gfx_Context *context, SDL_GPUCopyPass *copy_pass) {
-    s32 img_width  = 0;
-    s32 img_height = 0;
-    auto img_data  = stbi_load("res/images/Sample.png", &img_width, &img_height, NULL, 4);
-    ASSERT(img_data != NULL);
-    defer { stbi_image_free(img_data); };
+SDL_GPUTexture *gfx_texture_upload_mips(Gfx_Context *context, const Gfx_Mip_Chain *chain) {
+    if (chain->data == NULL || chain->level_count <= 0) return NULL;
+
+    // The levels were filtered in linear space but are stored as sRGB bytes in
+    // a UNORM texture, like every other texture here.
+    const Gfx_Mip_Level *base = &chain->levels[0];
+    auto texture = create_texture(context, SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM, base->width, base->height, chain->level_count, chain->size);
+    if (texture == NULL) return NULL;
+
+    for (int i = 0; i < chain->level_count; i++) {
+        const Gfx_Mip_Level *level = &chain->levels[i];
+        if (!gfx_upload_texture(context, texture, static_cast<u32>(i), static_cast<u32>(level->width),
+                                static_cast<u32>(level->height), chain->data + level->offset)) {
+            // The levels before are still waiting to be copied into it.
+            gfx_staging_cancel_texture(&context->staging, texture);
+            SDL_ReleaseGPUTexture(context->device, texture);
+            return NULL;
+        }
+    }
+
+    return texture;
+}
+
+SDL_GPUTexture *gfx_texture_upload_baked(Gfx_Context *context, const Gfx_Baked_Texture *texture) {
+    if (texture->data == NULL || texture->level_count <= 0) return NULL;
 
-    SDL_GPUTransferBufferCreateInfo transfer_info{};
-    transfer_info.size  = static_cast<u32>(img_width * img_height * 4);
-    transfer_info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-    auto transfer_buffer = SDL_CreateGPUTransferBuffer(context->device, &transfer_info);
-    defer { SDL_ReleaseGPUTransferBuffer(context->device, transfer_buffer); };
+    SDL_GPUTextureFormat format = SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM;
+    if (texture->format == GFX_BC1) format = SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM;
+    if (texture->format == GFX_BC3) format = SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM;
+    if (!SDL_GPUTextureSupportsFormat(context->device, format, SDL_GPU_TEXTURETYPE_2D, SDL_GPU_TEXTUREUSAGE_SAMPLER)) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "The GPU cannot sample %s textures", gfx_bc_format_name(texture->format));
+        return NULL;
+    }
+
+    u64 size = 0;
+    for (int i = 0; i < texture->level_count; i++) size += texture->levels[i].size;
+
+    const Gfx_Mip_Level *base = &texture->levels[0];
+    auto gpu_texture = create_texture(context, format, base->width, base->height, texture->level_count, size);
+    if (gpu_texture == NULL) return NULL;
+
+    for (int i = 0; i < texture->level_count; i++) {
+        const Gfx_Mip_Level *level = &texture->levels[i];
+        u8 *staged = gfx_staging_reserve_texture(&context->staging, gpu_texture, static_cast<u32>(i), static_cast<u32>(level->width),
+                                                 static_cast<u32>(level->height), static_cast<u32>(level->size));
+        if (!staged) {
+            gfx_staging_cancel_texture(&context->staging, gpu_texture);
+            SDL_ReleaseGPUTexture(context->device, gpu_texture);
+            return NULL;
+        }
+        SDL_memcpy(staged, texture->data + level->offset, level->size);
+    }
+
+    return gpu_texture;
+}
+
+static void init_texture(Gfx_Context *context) {
+    // White until the application sets a real texture, which is streamed in
+    // instead of blocking startup on the image decode.
+    const u8 white[4] = {255, 255, 255, 255};
+    context->white_texture = gfx_texture_upload(context, white, 1, 1);
+    ASSERT(context->white_texture != NULL);
+    gfx_residency_add(&context->residency, &context->white_resident, GFX_RESIDENT_TEXTURE, sizeof(white));
+    context->texture = context->white_texture;
+
+    for (int i = 0; i < GFX_SAMPLER_FILTER_COUNT; i++) {
+        auto filter = cast(Gfx_Sampler_Filter)i;
+        bool linear = filter != GFX_SAMPLER_NEAREST;
+        bool mips   = filter == GFX_SAMPLER_TRILINEAR || filter == GFX_SAMPLER_ANISOTROPIC;
+
+        SDL_GPUSamplerCreateInfo sampler_info{};
+        sampler_info.min_filter  = linear ? SDL_GPU_FILTER_LINEAR : SDL_GPU_FILTER_NEAREST;
+        sampler_info.mag_filter  = linear ? SDL_GPU_FILTER_LINEAR : SDL_GPU_FILTER_NEAREST;
+        sampler_info.mipmap_mode = mips ? SDL_GPU_SAMPLERMIPMAPMODE_LINEAR : SDL_GPU_SAMPLERMIPMAPMODE_NEAREST;
+        sampler_info.address_mode_u = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE;
+        sampler_info.address_mode_v = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE;
+        sampler_info.address_mode_w = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE;
+        // Nearest and bilinear stay on the first level.
+        sampler_info.max_lod = mips ? 1000.0f : 0.0f;
+        if (filter == GFX_SAMPLER_ANISOTROPIC) {
+            sampler_info.enable_anisotropy = true;
+            sampler_info.max_anisotropy    = 16.0f;
+        }
+        context->samplers[i] = SDL_CreateGPUSampler(context->device, &sampler_info);
+        ASSERT(context->samplers[i] != NULL);
+    }
+}
+
+const char *gfx_sampler_filter_name(Gfx_Sampler_Filter filter) {
+    switch (filter) {
+        case GFX_SAMPLER_NEAREST:     return "nearest";
+        case GFX_SAMPLER_BILINEAR:    return "bilinear";
+        case GFX_SAMPLER_TRILINEAR:   return "trilinear";
+        case GFX_SAMPLER_ANISOTROPIC: return "anisotropic";
+        default:                      return "unknown";
+    }
+}
+
+void gfx_set_texture(Gfx_Context *context, SDL_GPUTexture *texture) {
+    context->texture = texture ? texture : context->white_texture;
+}
+
+static bool upload_mesh_buffers(Gfx_Context *context, Gfx_GPU_Mesh *gpu_mesh, const Gfx_Mesh *mesh, Gfx_Vertex_Layout layout);
+
+void gfx_submit(Gfx_Context *context, Gfx_GPU_Mesh *mesh, const glm::mat4 &transform) {
+    if (mesh->resident.evicted && mesh->source && gfx_residency_can_restore(&context->residency, mesh->resident.size)) {
+        upload_mesh_buffers(context, mesh, mesh->source, mesh->layout);
+    }
+    if (mesh->vertex_buffer == NULL || mesh->index_buffer == NULL) return;
+    gfx_residency_touch(&context->residency, &mesh->resident);
+
+    if (context->submission_count == context->submission_capacity) {
+        int capacity = SDL_max(256, context->submission_capacity * 2);
+        auto submissions = cast(Gfx_Submission *)SDL_realloc(context->submissions, cast(usize)capacity * sizeof(Gfx_Submission));
+        if (!submissions) return;
+        context->submissions = submissions;
+        context->submission_capacity = capacity;
+    }
+
+    glm::vec3 center;
+    f32 radius;
+    gfx_bounds_transform_sphere(&mesh->bounds, transform, &center, &radius);
+    if (!gfx_sphere_set_push(&context->cull_set, center, radius)) return;
+
+    Gfx_Submission *submission = &context->submissions[context->submission_count++];
+    submission->mesh = mesh;
+    submission->instance.transform = transform;
+}
+
+void gfx_submit_occluder(Gfx_Context *context, const Gfx_Occluder *occluder, const glm::mat4 &transform) {
+    gfx_occlusion_add(&context->occlusion, occluder, transform);
+}
+
+// Ranges per worker, as for frustum culling.
+#define OCCLUSION_RANGES_PER_WORKER 4
+#define OCCLUSION_MAX_RANGES (JOB_MAX_WORKERS * OCCLUSION_RANGES_PER_WORKER)
+
+struct Occlusion_Test_Work {
+    Gfx_Context *context;
+    int count;
+    int range_size;
+    int counts[OCCLUSION_MAX_RANGES];
+};
+
+static void test_occlusion_ranges(void *data, int begin, int end) {
+    auto work = cast(Occlusion_Test_Work *)data;
+    Gfx_Context *context = work->context;
+    u32 *visible = context->visible;
+
+    // Each range compacts its part of visible in place, the writes never
+    // pass the reads.
+    for (int range = begin; range < end; range++) {
+        int first = range * work->range_size;
+        int last  = SDL_min(first + work->range_size, work->count);
+        int count = 0;
+        for (int i = first; i < last; i++) {
+            const Gfx_Submission *submission = &context->submissions[visible[i]];
+            visible[first + count] = visible[i];
+            count += gfx_occlusion_test_box(&context->occlusion, &submission->mesh->bounds, submission->instance.transform) ? 1 : 0;
+        }
+        work->counts[range] = count;
+    }
+}
+
+// Rasterizes the occluders and drops the visible instances they hide, keeping
+// the order. Returns how many are left.
+static int cull_occluded(Gfx_Context *context, const glm::mat4 &view_proj, int visible_count) {
+    Gfx_Occlusion_Buffer *occlusion = &context->occlusion;
+    if (occlusion->occluder_count == 0) {
+        occlusion->stats = {};
+        return visible_count;
+    }
 
     {
-        auto data = SDL_MapGPUTransferBuffer(context->device, transfer_buffer, false);
-        memcpy(data, img_data, transfer_info.size);
-        SDL_UnmapGPUTransferBuffer(context->device, transfer_buffer);
+        PROFILE_ZONE("occlusion_render");
+        gfx_occlusion_render(occlusion, view_proj, context->jobs);
     }
 
-    SDL_GPUTextureCreateInfo texture_info{};
-    texture_info.type   = SDL_GPU_TEXTURETYPE_2D;
-    texture_info.format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
-    texture_info.usage  = SDL_GPU_TEXTUREUSAGE_SAMPLER;
-    texture_info.width  = static_cast<u32>(img_width);
-    texture_info.height = static_cast<u32>(img_height);
-    texture_info.layer_count_or_depth = 1;
-    texture_info.num_levels = 1;
-    context->texture = SDL_CreateGPUTexture(context->device, &texture_info);
-
-    SDL_GPUSamplerCreateInfo sampler_info{};
-    sampler_info.min_filter  = SDL_GPU_FILTER_NEAREST;
-    sampler_info.mag_filter  = SDL_GPU_FILTER_NEAREST;
-    sampler_info.mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_NEAREST;
-    sampler_info.address_mode_u = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE;
-    sampler_info.address_mode_v = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE;
-    sampler_info.address_mode_w = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE;
-    context->sampler = SDL_CreateGPUSampler(context->device, &sampler_info);
+    PROFILE_ZONE("occlusion_test");
+    u64 start = SDL_GetPerformanceCounter();
+
+    // Below this, scheduling costs more than testing.
+    const int MIN_RANGE = 512;
+
+    Occlusion_Test_Work work;
+    work.context = context;
+    work.count   = visible_count;
+
+    int range_count = job_worker_count(context->jobs) * OCCLUSION_RANGES_PER_WORKER;
+    range_count = SDL_min(range_count, SDL_max(visible_count / MIN_RANGE, 1));
+    work.range_size = SDL_max((visible_count + range_count - 1) / range_count, 1);
+    range_count = (visible_count + work.range_size - 1) / work.range_size;
+
+    job_parallel_for(context->jobs, range_count, 1, test_occlusion_ranges, &work);
+
+    int count = range_count > 0 ? work.counts[0] : 0;
+    for (int range = 1; range < range_count; range++) {
+        SDL_memmove(context->visible + count, context->visible + range * work.range_size, cast(usize)work.counts[range] * sizeof(u32));
+        count += work.counts[range];
+    }
+
+    occlusion->stats.tested  = visible_count;
+    occlusion->stats.culled  = visible_count - count;
+    occlusion->stats.test_ms = cast(f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / cast(f64)SDL_GetPerformanceFrequency();
+    return count;
+}
+
+// Frustum and occlusion culls the submissions and queues a packet for each
+// visible one.
+static void queue_visible(Gfx_Context *context) {
+    PROFILE_ZONE("cull");
+    int count = context->submission_count;
+    if (context->visible_capacity < count) {
+        auto visible = cast(u32 *)SDL_realloc(context->visible, cast(usize)context->submission_capacity * sizeof(u32));
+        if (!visible) return;
+        context->visible = visible;
+        context->visible_capacity = context->submission_capacity;
+    }
+
+    glm::mat4 view_proj = context->proj * context->view;
+    Gfx_Frustum frustum = gfx_frustum_from_matrix(view_proj);
+    int visible_count = gfx_cull_spheres_parallel(&frustum, &context->cull_set, context->visible, context->jobs);
+    context->frustum_culled = count - visible_count;
+
+    visible_count = cull_occluded(context, view_proj, visible_count);
+
+    Gfx_Lod_Stats *lod_stats = &context->lod_stats;
+    *lod_stats = {};
+
+    for (int i = 0; i < visible_count; i++) {
+        u32 index = context->visible[i];
+        Gfx_Submission *submission = &context->submissions[index];
+        const Gfx_GPU_Mesh *mesh = submission->mesh;
+
+        // w of the clip position is the view depth.
+        f32 view_depth = (view_proj * submission->instance.transform[3]).w;
+        f32 depth = view_depth / GFX_FAR_PLANE;
 
+        submission->lod = 0;
+        if (mesh->lod_count > 0 && context->lod_threshold > 0.0f) {
+            f32 size = gfx_lod_screen_size(context->proj, context->cull_set.radius[index], view_depth);
+            submission->lod = gfx_lod_select(mesh->lods, mesh->lod_count, size, context->lod_threshold);
+        }
+
+        // The level is not part of the key. Far instances sort together
+        // within a mesh, so they still mostly form runs of one level.
+        u64 key = gfx_draw_key(mesh->layout, 0, mesh->id, depth);
+        if (!gfx_queue_push(&context->queue, key, index)) break;
+
+        // Only queued instances count.
+        u32 triangles = (submission->lod == 0 ? mesh->index_count : mesh->lods[submission->lod - 1].index_count) / 3;
+        lod_stats->instances[submission->lod]++;
+        lod_stats->triangles[submission->lod] += triangles;
+        lod_stats->full_triangles += mesh->index_count / 3;
+    }
+}
+
+// Sorts the queue and stages the instance data for the instance buffer in
+// queue order, growing it to the next power of two when needed.
+static bool upload_instances(Gfx_Context *context) {
+    PROFILE_ZONE("upload_instances");
     {
-        SDL_GPUTextureTransferInfo copy_src{};
-        copy_src.transfer_buffer = transfer_buffer;
-        copy_src.offset = 0;
+        PROFILE_ZONE("sort");
+        gfx_queue_sort(&context->queue);
+    }
+
+    u32 instance_count = cast(u32)context->queue.count;
+    if (instance_count > context->instance_capacity) {
+        u32 capacity = SDL_max(context->instance_capacity, 256u);
+        while (capacity < instance_count) capacity *= 2;
 
-        SDL_GPUTextureRegion copy_dst{};
-        copy_dst.texture = context->texture;
-        copy_dst.w = static_cast<u32>(img_width);
-        copy_dst.h = static_cast<u32>(img_height);
-        copy_dst.d = 1;
+        SDL_ReleaseGPUBuffer(context->device, context->instance_buffer);
+        gfx_residency_remove(&context->residency, &context->instance_resident);
+        context->instance_capacity = 0;
 
-        SDL_UploadToGPUTexture(copy_pass, &copy_src, &copy_dst, false);
+        SDL_GPUBufferCreateInfo buffer_info{};
+        buffer_info.size  = capacity * sizeof(Gfx_Instance);
+        buffer_info.usage = SDL_GPU_BUFFERUSAGE_VERTEX;
+        gfx_residency_reserve(&context->residency, buffer_info.size);
+        context->instance_buffer = SDL_CreateGPUBuffer(context->device, &buffer_info);
+
+        if (!context->instance_buffer) return false;
+        context->instance_capacity = capacity;
+        gfx_residency_add(&context->residency, &context->instance_resident, GFX_RESIDENT_BUFFER, buffer_info.size);
     }
 
+    // Cycling lets the previous frame keep reading its copy.
+    u32 size = instance_count * sizeof(Gfx_Instance);
+    auto instances = cast(Gfx_Instance *)gfx_staging_reserve_buffer(&context->staging, context->instance_buffer, 0, size, true);
+    if (!instances) return false;
+    for (u32 i = 0; i < instance_count; i++) instances[i] = context->submissions[context->queue.packets[i].index].instance;
+    return true;
 }
 
 void gfx_draw(Gfx_Context *context, f32 rotate, SDL_FColor clear_color) {
+    PROFILE_ZONE("gfx_draw");
+
     auto command_buffer = SDL_AcquireGPUCommandBuffer(context->device);
-    defer { ASSERT(SDL_SubmitGPUCommandBuffer(command_buffer)); };
+    defer {
+        if (!gfx_staging_submit(&context->staging, command_buffer)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to submit the frame: %s", SDL_GetError());
+        }
+    };
+
+    // Submissions are consumed even if the frame is skipped.
+    defer {
+        context->submission_count = 0;
+        gfx_sphere_set_clear(&context->cull_set);
+        gfx_occlusion_clear(&context->occlusion);
+        gfx_queue_clear(&context->queue);
+        gfx_residency_next_frame(&context->residency);
+    };
+
+    gfx_staging_collect(&context->staging);
+
+    queue_visible(context);
+    if (context->queue.count > 0 && !upload_instances(context)) {
+        gfx_queue_clear(&context->queue);
+    }
+
+    // Everything uploaded since the last frame, in one copy pass.
+    {
+        PROFILE_ZONE("staging_record");
+        gfx_staging_record(&context->staging, command_buffer);
+    }
+    context->upload_stats = gfx_staging_take_stats(&context->staging);
 
     SDL_GPUTexture *swapchain_texture;
     u32 swapchain_width;
     u32 swapchain_height;
 
-    ASSERT(SDL_WaitAndAcquireGPUSwapchainTexture(command_buffer, context->window,
-                                                 &swapchain_texture, &swapchain_width, &swapchain_height));
+    {
+        PROFILE_ZONE("acquire_swapchain");
+        ASSERT(SDL_WaitAndAcquireGPUSwapchainTexture(command_buffer, context->window,
+                                                     &swapchain_texture, &swapchain_width, &swapchain_height));
+    }
 
     SDL_GPUColorTargetInfo color_target{};
     color_target.clear_color = clear_color;
@@ -282,107 +527,610 @@ void gfx_draw(Gfx_Context *context, f32 rotate, SDL_FColor clear_color) {
     color_target.texture     = swapchain_texture;
 
     if (swapchain_texture != NULL) {
+        PROFILE_ZONE("encode");
         auto render_pass = SDL_BeginGPURenderPass(command_buffer, &color_target, 1, NULL);
         defer { SDL_EndGPURenderPass(render_pass); };
 
-        SDL_BindGPUGraphicsPipeline(render_pass, context->graphics_pipeline);
+        // A variant still being created in the background is skipped for
+        // this frame rather than waited for.
+        Gfx_Pipeline_Key quad_key = quad_pipeline_key(context);
+        SDL_GPUGraphicsPipeline *quad_pipeline = gfx_pipeline_get(&context->pipelines, &quad_key);
+
+        SDL_GPUGraphicsPipeline *mesh_pipelines[GFX_VERTEX_LAYOUT_COUNT];
+        for (int i = 0; i < GFX_VERTEX_LAYOUT_COUNT; i++) {
+            Gfx_Pipeline_Key key = mesh_pipeline_key(context, cast(Gfx_Vertex_Layout)i);
+            mesh_pipelines[i] = gfx_pipeline_get(&context->pipelines, &key);
+        }
+
+        SDL_GPUTextureSamplerBinding texture_binding{};
+        texture_binding.texture = context->texture;
+        texture_binding.sampler = context->samplers[context->sampler_filter];
 
-        SDL_GPUBufferBinding vertex_binding{};
-        vertex_binding.buffer = context->vertex_buffer;
-        vertex_binding.offset = 0;
-        SDL_BindGPUVertexBuffers(render_pass, 0, &vertex_binding, 1);
+        if (quad_pipeline) {
+            SDL_BindGPUGraphicsPipeline(render_pass, quad_pipeline);
 
-        SDL_GPUBufferBinding index_binding{};
-        index_binding.buffer = context->index_buffer;
-        index_binding.offset = 0;
-        SDL_BindGPUIndexBuffer(render_pass, &index_binding, SDL_GPU_INDEXELEMENTSIZE_16BIT);
+            SDL_GPUBufferBinding vertex_binding{};
+            vertex_binding.buffer = context->vertex_buffer;
+            vertex_binding.offset = 0;
+            SDL_BindGPUVertexBuffers(render_pass, 0, &vertex_binding, 1);
 
-        {
-            auto model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(0.0f, 0.0f, -5.0f));
-            model = glm::rotate(model, rotate, glm::vec3(0.0f, 1.0f, 0.0f));
+            SDL_GPUBufferBinding index_binding{};
+            index_binding.buffer = context->index_buffer;
+            index_binding.offset = 0;
+            SDL_BindGPUIndexBuffer(render_pass, &index_binding, SDL_GPU_INDEXELEMENTSIZE_16BIT);
 
-            Uniform_Block uniform_block{};
-            uniform_block.mvp = context->proj * model;
-            SDL_PushGPUVertexUniformData(command_buffer, 0, &uniform_block, sizeof(Uniform_Block));
+            {
+                auto model = glm::mat4(1.0f);
+                model = glm::translate(model, glm::vec3(0.0f, 0.0f, -5.0f));
+                model = glm::rotate(model, rotate, glm::vec3(0.0f, 1.0f, 0.0f));
+
+                Uniform_Block uniform_block{};
+                uniform_block.mvp = context->proj * model;
+                SDL_PushGPUVertexUniformData(command_buffer, 0, &uniform_block, sizeof(Uniform_Block));
+            }
+
+            SDL_BindGPUFragmentSamplers(render_pass, 0, &texture_binding, 1);
+
+            SDL_DrawGPUIndexedPrimitives(render_pass, 6, 1, 0, 0, 0);
         }
 
-        SDL_GPUTextureSamplerBinding texture_binding{};
-        texture_binding.texture = context->texture;
-        texture_binding.sampler = context->sampler;
-        SDL_BindGPUFragmentSamplers(render_pass, 0, &texture_binding, 1);
+        // Walk the sorted queue, binding state only when the key says it
+        // changed. Each run of packets with the same mesh and level is one
+        // instanced draw.
+        const Gfx_Draw_Packet *packets = context->queue.packets;
+        int packet_count = context->queue.count;
+        context->queue_stats = gfx_queue_stats(&context->queue);
+
+        u64 last_key = 0;
+        const Gfx_GPU_Mesh *last_mesh = NULL;
+
+        for (int first = 0; first < packet_count;) {
+            u64 key = packets[first].key;
+            const Gfx_GPU_Mesh *mesh = context->submissions[packets[first].index].mesh;
+            int lod = context->submissions[packets[first].index].lod;
+
+            // Mesh ids wrap around, so the pointer decides where a run ends.
+            int count = 1;
+            while (first + count < packet_count) {
+                const Gfx_Submission *next = &context->submissions[packets[first + count].index];
+                if (next->mesh != mesh || next->lod != lod) break;
+                count++;
+            }
+            defer { first += count; };
+
+            // Skipped before the bind tracking, the next run compares with
+            // the last one drawn.
+            SDL_GPUGraphicsPipeline *pipeline = mesh_pipelines[mesh->layout];
+            if (!pipeline) continue;
 
-        SDL_DrawGPUIndexedPrimitives(render_pass, 6, 1, 0, 0, 0);
+            bool pipeline_changed = last_mesh == NULL || gfx_key_pipeline(key) != gfx_key_pipeline(last_key);
+            bool material_changed = last_mesh == NULL || gfx_key_material(key) != gfx_key_material(last_key);
+            bool mesh_changed     = pipeline_changed || material_changed || mesh != last_mesh;
+            last_key  = key;
+            last_mesh = mesh;
+
+            if (pipeline_changed) {
+                SDL_BindGPUGraphicsPipeline(render_pass, pipeline);
+            }
+
+            // All meshes share the context texture for now, material 0.
+            if (material_changed) {
+                SDL_BindGPUFragmentSamplers(render_pass, 0, &texture_binding, 1);
+            }
+
+            if (mesh_changed) {
+                SDL_GPUBufferBinding mesh_vertex_bindings[2]{};
+                mesh_vertex_bindings[0].buffer = mesh->vertex_buffer;
+                mesh_vertex_bindings[GFX_INSTANCE_BUFFER_SLOT].buffer = context->instance_buffer;
+                SDL_BindGPUVertexBuffers(render_pass, 0, mesh_vertex_bindings, ARRAY_COUNT(mesh_vertex_bindings));
+
+                SDL_GPUBufferBinding mesh_index_binding{};
+                mesh_index_binding.buffer = mesh->index_buffer;
+                SDL_BindGPUIndexBuffer(render_pass, &mesh_index_binding, mesh->index_element_size);
+
+                Mesh_Uniform_Block uniform_block{};
+                uniform_block.view_proj = context->proj * context->view;
+                uniform_block.dequant_scale  = glm::vec4(mesh->dequant_scale, 0.0f);
+                uniform_block.dequant_offset = glm::vec4(mesh->dequant_offset, 0.0f);
+                SDL_PushGPUVertexUniformData(command_buffer, 0, &uniform_block, sizeof(Mesh_Uniform_Block));
+            }
+
+            if (lod > 0) {
+                const Gfx_Lod *level = &mesh->lods[lod - 1];
+                SDL_DrawGPUIndexedPrimitives(render_pass, level->index_count, cast(u32)count, mesh->index_count + level->first_index, 0, cast(u32)first);
+                continue;
+            }
+            if (mesh->meshlets == NULL) {
+                SDL_DrawGPUIndexedPrimitives(render_pass, mesh->index_count, cast(u32)count, 0, 0, cast(u32)first);
+                continue;
+            }
+
+            // Meshlet culling depends on the transform, so these meshes are
+            // culled and drawn per instance.
+            if (context->draw_range_capacity < mesh->meshlets->count) {
+                int capacity = SDL_max(mesh->meshlets->count, context->draw_range_capacity * 2);
+                auto ranges = cast(Gfx_Draw_Range *)SDL_realloc(context->draw_ranges, cast(usize)capacity * sizeof(Gfx_Draw_Range));
+                if (!ranges) continue;
+                context->draw_ranges = ranges;
+                context->draw_range_capacity = capacity;
+            }
+
+            for (int i = first; i < first + count; i++) {
+                glm::mat4 model_view = context->view * context->submissions[packets[i].index].instance.transform;
+
+                // The camera sits at the view-space origin.
+                glm::vec3 eye = glm::vec3(glm::inverse(model_view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+                int range_count = gfx_meshlets_cull(mesh->meshlets, context->proj * model_view, eye, context->draw_ranges, &context->cull_stats);
+
+                for (int ri = 0; ri < range_count; ri++) {
+                    const Gfx_Draw_Range *range = &context->draw_ranges[ri];
+                    SDL_DrawGPUIndexedPrimitives(render_pass, range->index_count, 1, range->first_index, 0, cast(u32)i);
+                }
+            }
+        }
     }
 }
 
+// The residency releases only the buffers, the rest of the mesh stays valid.
+// Also drops the copies into them still pending, of a failed or recent upload.
+static void evict_mesh(void *userdata, void *owner) {
+    auto context  = cast(Gfx_Context *)userdata;
+    auto gpu_mesh = cast(Gfx_GPU_Mesh *)owner;
+    gfx_staging_cancel_buffer(&context->staging, gpu_mesh->vertex_buffer);
+    gfx_staging_cancel_buffer(&context->staging, gpu_mesh->index_buffer);
+    SDL_ReleaseGPUBuffer(context->device, gpu_mesh->vertex_buffer);
+    SDL_ReleaseGPUBuffer(context->device, gpu_mesh->index_buffer);
+    gpu_mesh->vertex_buffer = NULL;
+    gpu_mesh->index_buffer  = NULL;
+}
 
-void gfx_immediate_upload_buffer_ex(Gfx_Context *context, u32 src_offset, SDL_GPUTransferBuffer *src_buffer, u32 size,
-                                    u32 dst_offset, SDL_GPUBuffer *dst_buffer, bool cyclic) {
-    auto command_buffer = SDL_AcquireGPUCommandBuffer(context->device);
-    auto copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+// Packs and uploads the buffers of gpu_mesh, for a new mesh or a restore.
+static bool upload_mesh_buffers(Gfx_Context *context, Gfx_GPU_Mesh *gpu_mesh, const Gfx_Mesh *mesh, Gfx_Vertex_Layout layout) {
+    Gfx_Packed_Vertices packed;
+    if (!gfx_vertex_pack(mesh, layout, &packed, context->jobs)) return false;
+    defer { gfx_vertex_free(&packed); };
+
+    // The LOD indices follow the full ones.
+    u32 vertex_size    = packed.vertex_count * packed.stride;
+    u32 full_size      = cast(u32)mesh->triangle_count * 3 * mesh->index_size;
+    u32 lod_index_size = gfx_mesh_lod_index_count(mesh) * mesh->index_size;
+    u32 index_size     = full_size + lod_index_size;
+    if (vertex_size == 0 || full_size == 0) return false;
+
+    gfx_residency_reserve(&context->residency, cast(u64)vertex_size + index_size);
+
+    SDL_GPUBufferCreateInfo vertex_info{};
+    vertex_info.size  = vertex_size;
+    vertex_info.usage = SDL_GPU_BUFFERUSAGE_VERTEX;
+    gpu_mesh->vertex_buffer = SDL_CreateGPUBuffer(context->device, &vertex_info);
+
+    SDL_GPUBufferCreateInfo index_info{};
+    index_info.size  = index_size;
+    index_info.usage = SDL_GPU_BUFFERUSAGE_INDEX;
+    gpu_mesh->index_buffer = SDL_CreateGPUBuffer(context->device, &index_info);
+
+    if (!gfx_upload_buffer(context, gpu_mesh->vertex_buffer, 0, packed.data, vertex_size) ||
+        !gfx_upload_buffer(context, gpu_mesh->index_buffer, 0, mesh->indices, full_size) ||
+        (lod_index_size > 0 && !gfx_upload_buffer(context, gpu_mesh->index_buffer, full_size, mesh->lod_indices, lod_index_size))) {
+        evict_mesh(context, gpu_mesh);
+        return false;
+    }
+
+    gpu_mesh->layout         = layout;
+    gpu_mesh->index_count    = cast(u32)mesh->triangle_count * 3;
+    gpu_mesh->index_element_size = mesh->index_size == sizeof(u32) ? SDL_GPU_INDEXELEMENTSIZE_32BIT : SDL_GPU_INDEXELEMENTSIZE_16BIT;
+    gpu_mesh->dequant_scale  = packed.dequant_scale;
+    gpu_mesh->dequant_offset = packed.dequant_offset;
+    gpu_mesh->bounds         = mesh->bounds;
+    gpu_mesh->lod_count      = mesh->lod_count;
+    SDL_memcpy(gpu_mesh->lods, mesh->lods, sizeof(gpu_mesh->lods));
+    gfx_residency_add(&context->residency, &gpu_mesh->resident, GFX_RESIDENT_BUFFER, cast(u64)vertex_size + index_size);
+    return true;
+}
+
+void gfx_mesh_upload(Gfx_Context *context, Gfx_GPU_Mesh *gpu_mesh, const Gfx_Mesh *mesh, Gfx_Vertex_Layout layout) {
+    *gpu_mesh = {};
+    gpu_mesh->resident.evict = evict_mesh;
+    gpu_mesh->resident.owner = gpu_mesh;
+    if (!upload_mesh_buffers(context, gpu_mesh, mesh, layout)) {
+        *gpu_mesh = {};
+        return;
+    }
+
+    gpu_mesh->id     = context->next_mesh_id++;
+    gpu_mesh->source = mesh;
+}
+
+void gfx_mesh_release(Gfx_Context *context, Gfx_GPU_Mesh *gpu_mesh) {
+    gfx_residency_remove(&context->residency, &gpu_mesh->resident);
+    gfx_staging_cancel_buffer(&context->staging, gpu_mesh->vertex_buffer);
+    gfx_staging_cancel_buffer(&context->staging, gpu_mesh->index_buffer);
+    SDL_ReleaseGPUBuffer(context->device, gpu_mesh->vertex_buffer);
+    SDL_ReleaseGPUBuffer(context->device, gpu_mesh->index_buffer);
+    *gpu_mesh = {};
+}
 
-    SDL_GPUTransferBufferLocation copy_src{};
-    copy_src.transfer_buffer = src_buffer;
-    copy_src.offset = src_offset;
 
-    SDL_GPUBufferRegion copy_dst{};
-    copy_dst.buffer = dst_buffer;
-    copy_dst.offset = dst_offset;
-    copy_dst.size = size;
-    
-    SDL_UploadToGPUBuffer(copy_pass, &copy_src, &copy_dst, cyclic);
+bool gfx_upload_buffer(Gfx_Context *context, SDL_GPUBuffer *buffer, u32 offset, const void *data, u32 size) {
+    u8 *staged = gfx_staging_reserve_buffer(&context->staging, buffer, offset, size, false);
+    if (!staged) return false;
+    SDL_memcpy(staged, data, size);
+    return true;
+}
+
+bool gfx_upload_texture(Gfx_Context *context, SDL_GPUTexture *texture, u32 mip_level, u32 width, u32 height, const u8 *pixels) {
+    u32 size = width * height * 4;
+    u8 *staged = gfx_staging_reserve_texture(&context->staging, texture, mip_level, width, height, size);
+    if (!staged) return false;
+    SDL_memcpy(staged, pixels, size);
+    return true;
+}
+
+void gfx_upload_flush(Gfx_Context *context) {
+    gfx_staging_flush(&context->staging);
+}
+
+// Returns the mesh stream an attribute is loaded into, NULL if it is skipped.
+static f32 **attribute_stream(Gfx_Mesh *mesh, const cgltf_attribute *attribute) {
+    if (attribute->type == cgltf_attribute_type_position) { // Vertices.
+        return &mesh->vertices;
+    } else if (attribute->type == cgltf_attribute_type_normal) {
+        return &mesh->normals;
+    } else if (attribute->type == cgltf_attribute_type_tangent) {
+        return &mesh->tangents;
+    } else if (attribute->type == cgltf_attribute_type_texcoord) {
+        if (attribute->index == 0) return &mesh->texcoords;
+        if (attribute->index == 1) return &mesh->texcoords2;
+    } else if (attribute->type == cgltf_attribute_type_color) {
+        // TODO: color attribute.
+    }
+    return NULL;
+}
+
+static const cgltf_accessor *find_attribute(const cgltf_primitive *prim, cgltf_attribute_type type, int index) {
+    for (cgltf_size ai = 0; ai < prim->attributes_count; ai++) {
+        const cgltf_attribute *attribute = &prim->attributes[ai];
+        if (attribute->type == type && attribute->index == index) return attribute->data;
+    }
+    return NULL;
+}
 
-    SDL_EndGPUCopyPass(copy_pass);
-    ASSERT(SDL_SubmitGPUCommandBuffer(command_buffer));
+// The first set of joints and weights, if both have a vec4 per vertex.
+static bool find_skin_attributes(const cgltf_primitive *prim, int vertex_count, const cgltf_accessor **joints, const cgltf_accessor **weights) {
+    *joints  = find_attribute(prim, cgltf_attribute_type_joints, 0);
+    *weights = find_attribute(prim, cgltf_attribute_type_weights, 0);
+    if (!*joints || !*weights) return false;
+    if ((*joints)->type != cgltf_type_vec4 || (*weights)->type != cgltf_type_vec4) return false;
+    return (*joints)->count == cast(cgltf_size)vertex_count && (*weights)->count == cast(cgltf_size)vertex_count;
 }
 
-void gfx_immediate_upload_buffer(Gfx_Context *context, SDL_GPUTransferBuffer *src_buffer, u32 size, SDL_GPUBuffer *dst_buffer) {
-    gfx_immediate_upload_buffer_ex(context, 0, src_buffer, size, 0, dst_buffer, false);
+// Places the streams of a primitive in the model storage. Run against a
+// measuring arena first to size the storage (see arena.h). Joints and
+// weights are only kept for meshes placed by a skinned node.
+static void layout_primitive(Gfx_Mesh *mesh, const cgltf_primitive *prim, bool skinned, Arena *storage) {
+    for (cgltf_size ai = 0; ai < prim->attributes_count; ai++) {
+        cgltf_attribute *attribute = &(prim->attributes[ai]);
+        cgltf_accessor *accessor = attribute->data;
+
+        f32 **stream = attribute_stream(mesh, attribute);
+        if (!stream) continue;
+
+        cgltf_size floats_needed = cgltf_accessor_unpack_floats(accessor, NULL, 0);
+        if (floats_needed == 0) continue;
+
+        if (attribute->type == cgltf_attribute_type_position) {
+            mesh->vertex_count = cast(int)accessor->count;
+        }
+        *stream = cast(f32 *)arena_push(storage, floats_needed * sizeof(f32));
+    }
+
+    const cgltf_accessor *joints, *weights;
+    if (skinned && find_skin_attributes(prim, mesh->vertex_count, &joints, &weights)) {
+        mesh->joints  = cast(u16 *)arena_push(storage, cast(usize)mesh->vertex_count * 4 * sizeof(u16));
+        mesh->weights = cast(f32 *)arena_push(storage, cast(usize)mesh->vertex_count * 4 * sizeof(f32));
+    }
+
+    // Non-indexed primitives get a sequential index list.
+    cgltf_size index_count = prim->indices ? prim->indices->count : cast(cgltf_size)mesh->vertex_count;
+    mesh->triangle_count = cast(int)(index_count / 3);
+    mesh->index_size = gfx_mesh_index_size(mesh->vertex_count);
+    mesh->indices = arena_push(storage, index_count * mesh->index_size);
 }
 
-void gfx_upload_buffer_begin(Gfx_Context *context, SDL_GPUCopyPass *copy_pass, SDL_GPUTransferBuffer *transfer_buffer, bool cyclic) {
-    Gfx_Upload_Buffer *upload = &context->upload;
+// Reads joints and weights. Joints outside the skin get no weight, and the
+// weights are scaled to sum to 1, all to the first joint if they are zero.
+static void load_skin_attributes(Gfx_Mesh *mesh, const cgltf_primitive *prim, int joint_count) {
+    const cgltf_accessor *joints, *weights;
+    if (!find_skin_attributes(prim, mesh->vertex_count, &joints, &weights)) return;
+
+    cgltf_accessor_unpack_floats(weights, mesh->weights, cast(cgltf_size)mesh->vertex_count * 4);
+
+    for (int v = 0; v < mesh->vertex_count; v++) {
+        cgltf_uint joint[4] = {};
+        cgltf_accessor_read_uint(joints, cast(cgltf_size)v, joint, 4);
+
+        u16 *out_joints = mesh->joints  + v * 4;
+        f32 *out_weights = mesh->weights + v * 4;
+        f32 sum = 0.0f;
+        for (int k = 0; k < 4; k++) {
+            bool valid = joint[k] < cast(cgltf_uint)joint_count && out_weights[k] > 0.0f;
+            out_joints[k]   = valid ? cast(u16)joint[k] : 0;
+            out_weights[k] = valid ? out_weights[k] : 0.0f;
+            sum += out_weights[k];
+        }
 
-    if (copy_pass != NULL) {
-        upload->copy_pass = copy_pass;
-        upload->using_new_copy_pass = false;
+        if (sum > 0.0f) {
+            for (int k = 0; k < 4; k++) out_weights[k] /= sum;
+        } else {
+            out_weights[0] = 1.0f;
+        }
+    }
+}
+
+static void load_primitive(Gfx_Mesh *mesh, const cgltf_primitive *prim, int joint_count) {
+    //
+    // Load following attributes:
+    // - Vertices
+    // - Normals
+    // - Tangents
+    // - Texcoords
+    // - Texcoords2
+    // - Colors
+    // - Joints and weights
+    //
+    for (cgltf_size ai = 0; ai < prim->attributes_count; ai++) {
+        cgltf_attribute *attribute = &(prim->attributes[ai]);
+        cgltf_accessor *accessor = attribute->data;
+
+        f32 **stream = attribute_stream(mesh, attribute);
+        if (!stream || !*stream) continue;
+
+        cgltf_size floats_needed = cgltf_accessor_unpack_floats(accessor, NULL, 0);
+        cgltf_accessor_unpack_floats(accessor, *stream, floats_needed);
+    }
+    if (mesh->joints) load_skin_attributes(mesh, prim, joint_count);
+
+    //
+    // Load primitive indices data.
+    //
+    if (prim->indices) {
+        cgltf_accessor *accessor = prim->indices;
+        cgltf_accessor_unpack_indices(accessor, mesh->indices, mesh->index_size, accessor->count);
     } else {
-        upload->command_buffer = SDL_AcquireGPUCommandBuffer(context->device);
-        upload->copy_pass = SDL_BeginGPUCopyPass(upload ->command_buffer);
-        upload->using_new_copy_pass = true;
+        for (int i = 0; i < mesh->triangle_count * 3; i++) gfx_mesh_set_index(mesh, i, cast(u32)i);
     }
-    upload->transfer_buffer = transfer_buffer;
-    upload->cyclic = cyclic;
+
+    if (mesh->vertices) mesh->bounds = gfx_bounds_from_points(mesh->vertices, mesh->vertex_count);
 }
 
-void gfx_upload_buffer_end(Gfx_Context *context) {
-    Gfx_Upload_Buffer *upload = &context->upload;
+struct Load_Primitives_Work {
+    Gfx_Mesh *meshes;
+    const cgltf_primitive **prims;
+    const Gfx_Skin *skins;
+};
 
-    if (upload->using_new_copy_pass) {
-        SDL_EndGPUCopyPass(upload->copy_pass);
-        ASSERT(SDL_SubmitGPUCommandBuffer(upload->command_buffer));
+// Primitives are independent and each one always lands in the same mesh slot,
+// which keeps the result identical to the serial path.
+static void load_primitives(void *data, int begin, int end) {
+    auto work = cast(Load_Primitives_Work *)data;
+    for (int i = begin; i < end; i++) {
+        Gfx_Mesh *mesh = &work->meshes[i];
+        load_primitive(mesh, work->prims[i], mesh->skin >= 0 ? work->skins[mesh->skin].joint_count : 0);
     }
 }
 
-void gfx_upload_buffer_push(Gfx_Context *context, u32 size, u32 offset, SDL_GPUBuffer *buffer) {
-    Gfx_Upload_Buffer *upload = &context->upload;
+// Splits a node matrix into translation, rotation and scale. glTF only allows
+// matrices that decompose this way.
+static void decompose_node_matrix(const cgltf_float *m, glm::vec3 *translation, glm::quat *rotation, glm::vec3 *scale) {
+    glm::vec3 x(m[0], m[1], m[2]);
+    glm::vec3 y(m[4], m[5], m[6]);
+    glm::vec3 z(m[8], m[9], m[10]);
 
-    SDL_GPUTransferBufferLocation copy_src{};
-    copy_src.transfer_buffer = upload->transfer_buffer;
-    copy_src.offset = upload->offset;
+    *translation = glm::vec3(m[12], m[13], m[14]);
+    *scale = glm::vec3(glm::length(x), glm::length(y), glm::length(z));
 
-    SDL_GPUBufferRegion copy_dst{};
-    copy_dst.buffer = buffer;
-    copy_dst.offset = offset;
-    copy_dst.size = size;
+    // A mirrored basis keeps a proper rotation with a negative x scale.
+    if (glm::dot(glm::cross(x, y), z) < 0.0f) scale->x = -scale->x;
 
-    SDL_UploadToGPUBuffer(upload->copy_pass, &copy_src, &copy_dst, upload->cyclic);
+    glm::mat3 basis(x / (scale->x != 0.0f ? scale->x : 1.0f),
+                    y / (scale->y != 0.0f ? scale->y : 1.0f),
+                    z / (scale->z != 0.0f ? scale->z : 1.0f));
+    *rotation = glm::normalize(glm::quat_cast(basis));
+}
+
+// Flattens the node forest into scene in depth-first order, roots in file
+// order. order receives the cgltf node index of every scene node.
+static bool load_scene(Gfx_Scene *scene, const cgltf_data *data, s32 *order) {
+    int node_count = cast(int)data->nodes_count;
+    if (!gfx_scene_init(scene, node_count)) return false;
+
+    // Children are pushed in reverse so they come out in file order. The
+    // stack holds the node and its parent's scene index.
+    auto stack = cast(s32 *)SDL_malloc(cast(usize)SDL_max(node_count, 1) * 2 * sizeof(s32));
+    if (!stack) {
+        gfx_scene_free(scene);
+        return false;
+    }
+    defer { SDL_free(stack); };
+
+    int count = 0;
+    for (cgltf_size ri = 0; ri < data->nodes_count; ri++) {
+        if (data->nodes[ri].parent != NULL) continue;
+
+        int depth = 0;
+        stack[depth * 2 + 0] = cast(s32)ri;
+        stack[depth * 2 + 1] = GFX_SCENE_NO_PARENT;
+        depth++;
+
+        while (depth > 0 && count < node_count) {
+            depth--;
+            const cgltf_node *node = &data->nodes[stack[depth * 2 + 0]];
+            int index = count++;
+            order[index] = stack[depth * 2 + 0];
+            scene->parent[index] = stack[depth * 2 + 1];
+
+            if (node->has_matrix) {
+                decompose_node_matrix(node->matrix, &scene->translation[index], &scene->rotation[index], &scene->scale[index]);
+            } else {
+                if (node->has_translation) scene->translation[index] = glm::vec3(node->translation[0], node->translation[1], node->translation[2]);
+                if (node->has_rotation)    scene->rotation[index] = glm::quat(node->rotation[3], node->rotation[0], node->rotation[1], node->rotation[2]);
+                if (node->has_scale)       scene->scale[index] = glm::vec3(node->scale[0], node->scale[1], node->scale[2]);
+            }
+
+            for (cgltf_size ci = node->children_count; ci > 0 && depth < node_count; ci--) {
+                stack[depth * 2 + 0] = cast(s32)cgltf_node_index(data, node->children[ci - 1]);
+                stack[depth * 2 + 1] = index;
+                depth++;
+            }
+        }
+    }
+
+    // Nodes on a parent cycle are never reached from a root.
+    scene->node_count = count;
+    if (!gfx_scene_link(scene)) {
+        gfx_scene_free(scene);
+        return false;
+    }
+
+    gfx_scene_update(scene, NULL);
+    return true;
+}
 
-    upload->offset += size;
+//
+// Skins and animation clips.
+//
+
+// Components per key of a channel that can be played, 0 for the others: a
+// transform path, a node of the scene and one value per key, three with
+// tangents for cubic splines.
+static int channel_components(const cgltf_data *data, const cgltf_animation_channel *channel, const s32 *scene_of_node) {
+    const cgltf_animation_sampler *sampler = channel->sampler;
+    if (!channel->target_node || !sampler || !sampler->input || !sampler->output) return 0;
+    if (scene_of_node[cgltf_node_index(data, channel->target_node)] < 0) return 0;
+
+    int components = 0;
+    if (channel->target_path == cgltf_animation_path_type_translation) components = 3;
+    if (channel->target_path == cgltf_animation_path_type_rotation)    components = 4;
+    if (channel->target_path == cgltf_animation_path_type_scale)       components = 3;
+    if (components == 0 || cgltf_num_components(sampler->output->type) != cast(cgltf_size)components) return 0;
+
+    cgltf_size key_count = sampler->input->count;
+    cgltf_size value_count = sampler->interpolation == cgltf_interpolation_type_cubic_spline ? key_count * 3 : key_count;
+    if (key_count == 0 || sampler->input->type != cgltf_type_scalar || sampler->output->count != value_count) return 0;
+    return components;
+}
+
+// Places the skins, clips and keys in the animation storage. Run against a
+// measuring arena first, the arrays are NULL then.
+static void layout_animation(const cgltf_data *data, const s32 *scene_of_node, Gfx_Skin **skins, Gfx_Clip **clips, Arena *storage) {
+    *skins = cast(Gfx_Skin *)arena_push(storage, data->skins_count * sizeof(Gfx_Skin));
+    for (cgltf_size si = 0; si < data->skins_count; si++) {
+        Gfx_Skin scratch{};
+        Gfx_Skin *skin = *skins ? &(*skins)[si] : &scratch;
+        *skin = {};
+
+        usize joint_count = data->skins[si].joints_count;
+        skin->joint_count  = cast(int)joint_count;
+        skin->joints       = cast(s32 *)arena_push(storage, joint_count * sizeof(s32));
+        skin->inverse_bind = cast(glm::mat4 *)arena_push(storage, joint_count * sizeof(glm::mat4));
+    }
+
+    *clips = cast(Gfx_Clip *)arena_push(storage, data->animations_count * sizeof(Gfx_Clip));
+    for (cgltf_size ai = 0; ai < data->animations_count; ai++) {
+        const cgltf_animation *animation = &data->animations[ai];
+        Gfx_Clip scratch{};
+        Gfx_Clip *clip = *clips ? &(*clips)[ai] : &scratch;
+        *clip = {};
+
+        for (cgltf_size ci = 0; ci < animation->channels_count; ci++) {
+            if (channel_components(data, &animation->channels[ci], scene_of_node) > 0) clip->channel_count++;
+        }
+        clip->channels = cast(Gfx_Anim_Channel *)arena_push(storage, cast(usize)clip->channel_count * sizeof(Gfx_Anim_Channel));
+
+        int channel_index = 0;
+        for (cgltf_size ci = 0; ci < animation->channels_count; ci++) {
+            int components = channel_components(data, &animation->channels[ci], scene_of_node);
+            if (components == 0) continue;
+
+            Gfx_Anim_Channel scratch_channel{};
+            Gfx_Anim_Channel *channel = clip->channels ? &clip->channels[channel_index] : &scratch_channel;
+            channel_index++;
+            *channel = {};
+
+            usize key_count = animation->channels[ci].sampler->input->count;
+            channel->key_count = cast(int)key_count;
+            channel->times     = cast(f32 *)arena_push(storage, key_count * sizeof(f32));
+            channel->values    = cast(f32 *)arena_push(storage, key_count * cast(usize)components * sizeof(f32));
+        }
+    }
+}
+
+// Fills the skins and clips placed by layout_animation(). Returns false on
+// allocation failure.
+static bool load_animation(const cgltf_data *data, const s32 *scene_of_node, Gfx_Skin *skins, Gfx_Clip *clips) {
+    for (cgltf_size si = 0; si < data->skins_count; si++) {
+        const cgltf_skin *source = &data->skins[si];
+        Gfx_Skin *skin = &skins[si];
+
+        for (int j = 0; j < skin->joint_count; j++) {
+            skin->joints[j]       = scene_of_node[cgltf_node_index(data, source->joints[j])];
+            skin->inverse_bind[j] = glm::mat4(1.0f);
+        }
+
+        const cgltf_accessor *inverse_bind = source->inverse_bind_matrices;
+        if (inverse_bind && inverse_bind->type == cgltf_type_mat4 && inverse_bind->count >= cast(cgltf_size)skin->joint_count) {
+            cgltf_accessor_unpack_floats(inverse_bind, cast(f32 *)skin->inverse_bind, cast(cgltf_size)skin->joint_count * 16);
+        }
+    }
+
+    for (cgltf_size ai = 0; ai < data->animations_count; ai++) {
+        const cgltf_animation *animation = &data->animations[ai];
+        Gfx_Clip *clip = &clips[ai];
+        if (animation->name) SDL_strlcpy(clip->name, animation->name, sizeof(clip->name));
+
+        int channel_index = 0;
+        for (cgltf_size ci = 0; ci < animation->channels_count; ci++) {
+            const cgltf_animation_channel *source = &animation->channels[ci];
+            int components = channel_components(data, source, scene_of_node);
+            if (components == 0) continue;
+
+            const cgltf_animation_sampler *sampler = source->sampler;
+            Gfx_Anim_Channel *channel = &clip->channels[channel_index++];
+            channel->node = scene_of_node[cgltf_node_index(data, source->target_node)];
+            channel->path = source->target_path == cgltf_animation_path_type_translation ? GFX_ANIM_TRANSLATION :
+                            source->target_path == cgltf_animation_path_type_rotation    ? GFX_ANIM_ROTATION : GFX_ANIM_SCALE;
+            channel->interpolation = sampler->interpolation == cgltf_interpolation_type_step ? GFX_ANIM_STEP : GFX_ANIM_LINEAR;
+
+            usize key_count = cast(usize)channel->key_count;
+            cgltf_accessor_unpack_floats(sampler->input, channel->times, key_count);
+            clip->duration = SDL_max(clip->duration, channel->times[key_count - 1]);
+
+            usize floats = key_count * cast(usize)components;
+            if (sampler->interpolation != cgltf_interpolation_type_cubic_spline) {
+                cgltf_accessor_unpack_floats(sampler->output, channel->values, floats);
+                continue;
+            }
+
+            // Keys are in-tangent, value, out-tangent. Only the values are kept.
+            auto keys = cast(f32 *)SDL_malloc(floats * 3 * sizeof(f32));
+            if (!keys) return false;
+            cgltf_accessor_unpack_floats(sampler->output, keys, floats * 3);
+            for (usize k = 0; k < key_count; k++) {
+                SDL_memcpy(channel->values + k * cast(usize)components, keys + (k * 3 + 1) * cast(usize)components,
+                           cast(usize)components * sizeof(f32));
+            }
+            SDL_free(keys);
+        }
+    }
+
+    return true;
 }
 
 void gfx_model_load(Gfx_Model *model, const char *file) {
+    gfx_model_load_ex(model, file, NULL);
+}
+
+void gfx_model_load_ex(Gfx_Model *model, const char *file, Job_System *jobs) {
     *model = {};
 
     cgltf_options options{};
@@ -392,15 +1140,63 @@ void gfx_model_load(Gfx_Model *model, const char *file) {
     if (result != cgltf_result_success) return;
     defer { cgltf_free(data); };
 
-    result = cgltf_load_buffers(&options, data, file);
-    if (result != cgltf_result_success) {
-        cgltf_free(data);
+    gfx_model_load_parsed(model, data, file, jobs);
+}
+
+void gfx_model_load_parsed(Gfx_Model *model, cgltf_data *data, const char *file, Job_System *jobs) {
+    PROFILE_ZONE("gfx_model_load");
+    *model = {};
+
+    cgltf_options options{};
+    cgltf_result result = cgltf_load_buffers(&options, data, file);
+    if (result != cgltf_result_success) return;
+
+    Gfx_Scene scene;
+    auto order = cast(s32 *)SDL_malloc(cast(usize)SDL_max(data->nodes_count, 1) * sizeof(s32));
+    if (!order) return;
+    defer { SDL_free(order); };
+    if (!load_scene(&scene, data, order)) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Invalid node hierarchy in %s", file);
         return;
     }
 
+    // Scene index of every cgltf node, -1 for nodes left out.
+    auto scene_of_node = cast(s32 *)SDL_malloc(cast(usize)SDL_max(data->nodes_count, 1) * sizeof(s32));
+    if (!scene_of_node) {
+        gfx_scene_free(&scene);
+        return;
+    }
+    defer { SDL_free(scene_of_node); };
+    for (cgltf_size i = 0; i < data->nodes_count; i++) scene_of_node[i] = -1;
+    for (int i = 0; i < scene.node_count; i++) scene_of_node[order[i]] = i;
+
+    //
+    // Skins and clips go in a block of their own. Without them the model
+    // loads unskinned.
+    //
+    Gfx_Skin *skins = NULL;
+    Gfx_Clip *clips = NULL;
+    Arena animation;
+
+    Arena animation_measure{};
+    layout_animation(data, scene_of_node, &skins, &clips, &animation_measure);
+    if (animation_measure.used > 0) {
+        if (arena_init(&animation, animation_measure.used)) {
+            layout_animation(data, scene_of_node, &skins, &clips, &animation);
+            if (!load_animation(data, scene_of_node, skins, clips)) arena_release(&animation);
+        }
+        if (animation.base == NULL) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Out of memory for the animation of %s", file);
+            skins = NULL;
+            clips = NULL;
+        }
+    }
+    int skin_count = skins ? cast(int)data->skins_count : 0;
+    int clip_count = clips ? cast(int)data->animations_count : 0;
+
     int prim_count = 0;
-    for (cgltf_size ni = 0; ni < data->nodes_count; ni++) {
-        cgltf_node *node = &(data->nodes[ni]);
+    for (int ni = 0; ni < scene.node_count; ni++) {
+        cgltf_node *node = &(data->nodes[order[ni]]);
         cgltf_mesh *mesh = node->mesh;
         if (!mesh) continue;
 
@@ -410,100 +1206,365 @@ void gfx_model_load(Gfx_Model *model, const char *file) {
         }
     }
 
-    // Get mesh count.
+    // Gather primitives in scene order, with the node that places them.
     int mesh_count = prim_count;
-    auto meshes = cast(Gfx_Mesh *)SDL_calloc(cast(size_t)mesh_count, sizeof(Gfx_Mesh));
-    if (!meshes) {
-        cgltf_free(data);
-        return;
-    }
-
+    auto prims = cast(const cgltf_primitive **)SDL_malloc(cast(size_t)SDL_max(prim_count, 1) * sizeof(cgltf_primitive *));
+    auto prim_nodes = cast(int *)SDL_malloc(cast(size_t)SDL_max(prim_count, 1) * sizeof(int));
+    auto prim_skins = cast(int *)SDL_malloc(cast(size_t)SDL_max(prim_count, 1) * sizeof(int));
     defer {
-        model->mesh_count = mesh_count;
-        model->meshes = meshes;
+        SDL_free(prims);
+        SDL_free(prim_nodes);
+        SDL_free(prim_skins);
     };
+    if (!prims || !prim_nodes || !prim_skins) {
+        arena_release(&animation);
+        gfx_scene_free(&scene);
+        return;
+    }
 
-    // Get mesh data.
     ssize mesh_index = 0;
-    for (cgltf_size ni = 0; ni < data->nodes_count; ni++) {
-        cgltf_node *node = &(data->nodes[ni]);
+    for (int ni = 0; ni < scene.node_count; ni++) {
+        cgltf_node *node = &(data->nodes[order[ni]]);
         cgltf_mesh *mesh = node->mesh;
         if (!mesh) continue;
 
-        // TODO: get matrix transform.
-
         for (cgltf_size pi = 0; pi < mesh->primitives_count; pi++) {
             cgltf_primitive *prim = &(mesh->primitives[pi]);
 
             // Only support primitive triangles.
             if (prim->type != cgltf_primitive_type_triangles) continue;
 
-            defer { mesh_index++; };
-
-            //
-            // Load following attributes:
-            // - Vertices
-            // - Normals
-            // - Tangents
-            // - Texcoords
-            // - Texcoords2
-            // - Colors
-            //
-            for (cgltf_size ai = 0; ai < prim->attributes_count; ai++) {
-                cgltf_attribute *attribute = &(prim->attributes[ai]);
-                cgltf_accessor *accessor = attribute->data;
-
-                cgltf_size floats_needed = cgltf_accessor_unpack_floats(accessor, NULL, 0);
-                if (floats_needed == 0) continue;
-
-                if (attribute->type == cgltf_attribute_type_position) { // Vertices.
-                    meshes[mesh_index].vertex_count = cast(int)accessor->count;
-                    meshes[mesh_index].vertices = cast(f32 *)SDL_malloc(floats_needed * sizeof(f32));
-                    cgltf_accessor_unpack_floats(accessor, meshes[mesh_index].vertices, floats_needed);
-                } else if (attribute->type == cgltf_attribute_type_normal) {
-                    meshes[mesh_index].normals = cast(f32 *)SDL_malloc(floats_needed * sizeof(f32));
-                    cgltf_accessor_unpack_floats(accessor, meshes[mesh_index].normals, floats_needed);
-                } else if (attribute->type == cgltf_attribute_type_tangent) {
-                    // TODO: normal attribute.
-                } else if (attribute->type == cgltf_attribute_type_texcoord) {
-                    if (attribute->index == 0) {
-                        meshes[mesh_index].texcoords = cast(f32 *)SDL_malloc(floats_needed * sizeof(f32));
-                        cgltf_accessor_unpack_floats(accessor, meshes[mesh_index].texcoords, floats_needed);
-                    } else if (attribute->index == 1) {
-                        meshes[mesh_index].texcoords2 = cast(f32 *)SDL_malloc(floats_needed * sizeof(f32));
-                        cgltf_accessor_unpack_floats(accessor, meshes[mesh_index].texcoords2, floats_needed);
-                    }
-                } else if (attribute->type == cgltf_attribute_type_color) {
-                    // TODO: color attribute.
-                }
+            prim_nodes[mesh_index] = ni;
+            prim_skins[mesh_index] = node->skin && skin_count > 0 ? cast(int)cgltf_skin_index(data, node->skin) : -1;
+            prims[mesh_index++] = prim;
+        }
+    }
+
+    //
+    // Size the model storage, then place the mesh array and every stream in
+    // one block.
+    //
+    Arena measure{};
+    arena_push(&measure, cast(usize)mesh_count * sizeof(Gfx_Mesh));
+    for (int i = 0; i < prim_count; i++) {
+        Gfx_Mesh scratch{};
+        layout_primitive(&scratch, prims[i], prim_skins[i] >= 0, &measure);
+    }
+
+    Arena storage;
+    if (!arena_init(&storage, measure.used)) {
+        arena_release(&animation);
+        gfx_scene_free(&scene);
+        return;
+    }
+
+    auto meshes = cast(Gfx_Mesh *)arena_push(&storage, cast(usize)mesh_count * sizeof(Gfx_Mesh));
+    for (int i = 0; i < mesh_count; i++) {
+        meshes[i] = {};
+        layout_primitive(&meshes[i], prims[i], prim_skins[i] >= 0, &storage);
+        meshes[i].node = prim_nodes[i];
+        meshes[i].skin = meshes[i].joints ? prim_skins[i] : -1;
+    }
+
+    defer {
+        model->scene      = scene;
+        model->mesh_count = mesh_count;
+        model->meshes  = meshes;
+        model->storage = storage;
+        model->skin_count = skin_count;
+        model->skins      = skins;
+        model->clip_count = clip_count;
+        model->clips      = clips;
+        model->animation  = animation;
+    };
+
+    // Get mesh data. Primitives differ a lot in size, so one per job.
+    Load_Primitives_Work work;
+    work.meshes = meshes;
+    work.prims  = prims;
+    work.skins  = skins;
+    job_parallel_for(jobs, prim_count, 1, load_primitives, &work);
+}
+
+//
+// Mesh splitting.
+//
+
+struct Split_Chunk {
+    int source_mesh;
+    int first_triangle;
+    int triangle_count;
+    int vertex_count;
+};
+
+// Cuts the triangles of a mesh, in order, into runs that reference at most
+// max_vertices vertices. stamp holds one zeroed u32 per vertex. Returns the
+// chunk count, chunks may be NULL to only count them.
+static int plan_split(const Gfx_Mesh *mesh, int mesh_index, int max_vertices, u32 *stamp, Split_Chunk *chunks) {
+    int chunk_count = 0;
+    Split_Chunk chunk{mesh_index, 0, 0, 0};
+
+    for (int t = 0; t < mesh->triangle_count; t++) {
+        u32 v[3];
+        for (int k = 0; k < 3; k++) v[k] = gfx_mesh_get_index(mesh, t * 3 + k);
+
+        // Stamps start at 1 so that 0 means unused.
+        u32 id = cast(u32)chunk_count + 1;
+        int added = (stamp[v[0]] != id) + (stamp[v[1]] != id && v[1] != v[0]) +
+                    (stamp[v[2]] != id && v[2] != v[0] && v[2] != v[1]);
+
+        if (chunk.vertex_count + added > max_vertices) {
+            if (chunks) chunks[chunk_count] = chunk;
+            chunk_count++;
+            chunk = {mesh_index, t, 0, 0};
+            id++;
+            added = 1 + (v[1] != v[0]) + (v[2] != v[0] && v[2] != v[1]);
+        }
+
+        for (int k = 0; k < 3; k++) stamp[v[k]] = id;
+        chunk.triangle_count++;
+        chunk.vertex_count += added;
+    }
+
+    if (chunk.triangle_count > 0) {
+        if (chunks) chunks[chunk_count] = chunk;
+        chunk_count++;
+    }
+    return chunk_count;
+}
+
+// Places the streams the source mesh has for a mesh of the given size.
+static void layout_split_mesh(Gfx_Mesh *mesh, const Gfx_Mesh *source, int vertex_count, int triangle_count, Arena *storage) {
+    usize vc = cast(usize)vertex_count;
+
+    mesh->vertex_count   = vertex_count;
+    mesh->triangle_count = triangle_count;
+    if (source->vertices)   mesh->vertices   = cast(f32 *)arena_push(storage, vc * 3 * sizeof(f32));
+    if (source->texcoords)  mesh->texcoords  = cast(f32 *)arena_push(storage, vc * 2 * sizeof(f32));
+    if (source->texcoords2) mesh->texcoords2 = cast(f32 *)arena_push(storage, vc * 2 * sizeof(f32));
+    if (source->normals)    mesh->normals    = cast(f32 *)arena_push(storage, vc * 3 * sizeof(f32));
+    if (source->tangents)   mesh->tangents   = cast(f32 *)arena_push(storage, vc * 4 * sizeof(f32));
+    if (source->colors)     mesh->colors     = cast(u8 *)arena_push(storage, vc * 4 * sizeof(u8));
+    if (source->joints)     mesh->joints     = cast(u16 *)arena_push(storage, vc * 4 * sizeof(u16));
+    if (source->weights)    mesh->weights    = cast(f32 *)arena_push(storage, vc * 4 * sizeof(f32));
+
+    mesh->index_size = gfx_mesh_index_size(vertex_count);
+    mesh->indices    = arena_push(storage, cast(usize)triangle_count * 3 * mesh->index_size);
+}
+
+// Copies the vertices listed in vertex_map, or all of them if it is NULL.
+static void gather_stream(void *dst, const void *src, usize vertex_size, const u32 *vertex_map, int vertex_count) {
+    if (dst == NULL || src == NULL) return;
+
+    if (vertex_map == NULL) {
+        SDL_memcpy(dst, src, vertex_size * cast(usize)vertex_count);
+        return;
+    }
+
+    auto out = cast(u8 *)dst;
+    auto in  = cast(const u8 *)src;
+    for (int i = 0; i < vertex_count; i++) {
+        SDL_memcpy(out + cast(usize)i * vertex_size, in + vertex_map[i] * vertex_size, vertex_size);
+    }
+}
+
+static void gather_mesh(Gfx_Mesh *mesh, const Gfx_Mesh *source, const u32 *vertex_map) {
+    gather_stream(mesh->vertices,   source->vertices,   3 * sizeof(f32), vertex_map, mesh->vertex_count);
+    gather_stream(mesh->texcoords,  source->texcoords,  2 * sizeof(f32), vertex_map, mesh->vertex_count);
+    gather_stream(mesh->texcoords2, source->texcoords2, 2 * sizeof(f32), vertex_map, mesh->vertex_count);
+    gather_stream(mesh->normals,    source->normals,    3 * sizeof(f32), vertex_map, mesh->vertex_count);
+    gather_stream(mesh->tangents,   source->tangents,   4 * sizeof(f32), vertex_map, mesh->vertex_count);
+    gather_stream(mesh->colors,     source->colors,     4 * sizeof(u8),  vertex_map, mesh->vertex_count);
+    gather_stream(mesh->joints,     source->joints,     4 * sizeof(u16), vertex_map, mesh->vertex_count);
+    gather_stream(mesh->weights,    source->weights,    4 * sizeof(f32), vertex_map, mesh->vertex_count);
+
+    if (mesh->vertices) mesh->bounds = gfx_bounds_from_points(mesh->vertices, mesh->vertex_count);
+}
+
+bool gfx_model_split(Gfx_Model *model, int max_vertices) {
+    ASSERT(max_vertices >= 3);
+
+    int largest = 0;
+    for (int i = 0; i < model->mesh_count; i++) largest = SDL_max(largest, model->meshes[i].vertex_count);
+    if (largest <= max_vertices) return true;
+
+    auto stamp      = cast(u32 *)SDL_malloc(cast(usize)largest * sizeof(u32));
+    auto remap      = cast(u32 *)SDL_malloc(cast(usize)largest * sizeof(u32));
+    auto vertex_map = cast(u32 *)SDL_malloc(cast(usize)max_vertices * sizeof(u32));
+    defer {
+        SDL_free(stamp);
+        SDL_free(remap);
+        SDL_free(vertex_map);
+    };
+    if (!stamp || !remap || !vertex_map) return false;
+
+    // Count, then fill the chunks. Meshes under the limit are one chunk.
+    auto plan = [&](Split_Chunk *chunks) {
+        int count = 0;
+        for (int i = 0; i < model->mesh_count; i++) {
+            const Gfx_Mesh *mesh = &model->meshes[i];
+            if (mesh->vertex_count <= max_vertices) {
+                if (chunks) chunks[count] = {i, 0, mesh->triangle_count, mesh->vertex_count};
+                count++;
+                continue;
             }
+            SDL_memset(stamp, 0, cast(usize)mesh->vertex_count * sizeof(u32));
+            count += plan_split(mesh, i, max_vertices, stamp, chunks ? chunks + count : NULL);
+        }
+        return count;
+    };
 
-            //
-            // Load primitive indices data.
-            //
-            {
-                cgltf_accessor *accessor = prim->indices;
+    int mesh_count = plan(NULL);
+    auto chunks = cast(Split_Chunk *)SDL_malloc(cast(usize)mesh_count * sizeof(Split_Chunk));
+    if (!chunks) return false;
+    defer { SDL_free(chunks); };
+    plan(chunks);
+
+    Arena measure{};
+    arena_push(&measure, cast(usize)mesh_count * sizeof(Gfx_Mesh));
+    for (int i = 0; i < mesh_count; i++) {
+        Gfx_Mesh scratch{};
+        layout_split_mesh(&scratch, &model->meshes[chunks[i].source_mesh], chunks[i].vertex_count, chunks[i].triangle_count, &measure);
+    }
+
+    Arena storage;
+    if (!arena_init(&storage, measure.used)) return false;
 
-                cgltf_size triangle_count = accessor->count / 3;
-                meshes[mesh_index].triangle_count = triangle_count;
+    auto meshes = cast(Gfx_Mesh *)arena_push(&storage, cast(usize)mesh_count * sizeof(Gfx_Mesh));
+    for (int i = 0; i < mesh_count; i++) {
+        const Split_Chunk *chunk = &chunks[i];
+        const Gfx_Mesh *source = &model->meshes[chunk->source_mesh];
+        Gfx_Mesh *mesh = &meshes[i];
 
-                cgltf_size alloc_size = accessor->count * sizeof(u16);
-                meshes[mesh_index].indices = cast(u16 *)SDL_malloc(alloc_size);
-                cgltf_accessor_unpack_indices(accessor, meshes[mesh_index].indices, alloc_size, triangle_count);
+        *mesh = {};
+        layout_split_mesh(mesh, source, chunk->vertex_count, chunk->triangle_count, &storage);
+        mesh->node = source->node;
+        mesh->skin = source->skin;
+
+        if (source->vertex_count <= max_vertices) {
+            gather_mesh(mesh, source, NULL);
+            for (int j = 0; j < mesh->triangle_count * 3; j++) gfx_mesh_set_index(mesh, j, gfx_mesh_get_index(source, j));
+            continue;
+        }
+
+        // Vertices are numbered in first-use order within the chunk.
+        SDL_memset(stamp, 0, cast(usize)source->vertex_count * sizeof(u32));
+        int vertex_count = 0;
+        for (int j = 0; j < chunk->triangle_count * 3; j++) {
+            u32 v = gfx_mesh_get_index(source, chunk->first_triangle * 3 + j);
+            if (!stamp[v]) {
+                stamp[v] = 1;
+                remap[v] = cast(u32)vertex_count;
+                vertex_map[vertex_count++] = v;
             }
+            gfx_mesh_set_index(mesh, j, remap[v]);
+        }
+        ASSERT(vertex_count == chunk->vertex_count);
+
+        gather_mesh(mesh, source, vertex_map);
+    }
+
+    if (mesh_count != model->mesh_count) {
+        SDL_Log("Split %d mesh(es) into %d to fit %d vertices each", model->mesh_count, mesh_count, max_vertices);
+    }
+
+    // The old streams may live in a mapped cache.
+    if (model->cache != NULL) gfx_cache_release(model->cache);
+    arena_release(&model->storage);
+
+    // The levels and meshlets index the old meshes.
+    arena_release(&model->lods);
+    arena_release(&model->meshlets);
+
+    model->cache      = NULL;
+    model->mesh_count = mesh_count;
+    model->meshes     = meshes;
+    model->storage    = storage;
+    return true;
+}
+
+bool gfx_model_equal(const Gfx_Model *a, const Gfx_Model *b) {
+    if (a->mesh_count != b->mesh_count) return false;
+    if (a->skin_count != b->skin_count || a->clip_count != b->clip_count) return false;
+
+    auto stream_equal = [](const void *x, const void *y, usize size) {
+        if ((x == NULL) != (y == NULL)) return false;
+        return x == NULL || SDL_memcmp(x, y, size) == 0;
+    };
+
+    const Gfx_Scene *sa = &a->scene;
+    const Gfx_Scene *sb = &b->scene;
+    if (sa->node_count != sb->node_count) return false;
+
+    usize nc = cast(usize)sa->node_count;
+    if (!stream_equal(sa->parent,      sb->parent,      nc * sizeof(s32)))       return false;
+    if (!stream_equal(sa->translation, sb->translation, nc * sizeof(glm::vec3))) return false;
+    if (!stream_equal(sa->rotation,    sb->rotation,    nc * sizeof(glm::quat))) return false;
+    if (!stream_equal(sa->scale,       sb->scale,       nc * sizeof(glm::vec3))) return false;
+
+    for (int i = 0; i < a->mesh_count; i++) {
+        const Gfx_Mesh *ma = &a->meshes[i];
+        const Gfx_Mesh *mb = &b->meshes[i];
+        if (ma->vertex_count != mb->vertex_count || ma->triangle_count != mb->triangle_count) return false;
+        if (ma->index_size != mb->index_size || ma->node != mb->node || ma->skin != mb->skin) return false;
+        if (SDL_memcmp(&ma->bounds, &mb->bounds, sizeof(Gfx_Bounds)) != 0) return false;
+
+        usize vc = cast(usize)ma->vertex_count;
+        if (!stream_equal(ma->vertices,   mb->vertices,   vc * 3 * sizeof(f32))) return false;
+        if (!stream_equal(ma->texcoords,  mb->texcoords,  vc * 2 * sizeof(f32))) return false;
+        if (!stream_equal(ma->texcoords2, mb->texcoords2, vc * 2 * sizeof(f32))) return false;
+        if (!stream_equal(ma->normals,    mb->normals,    vc * 3 * sizeof(f32))) return false;
+        if (!stream_equal(ma->tangents,   mb->tangents,   vc * 4 * sizeof(f32))) return false;
+        if (!stream_equal(ma->colors,     mb->colors,     vc * 4 * sizeof(u8)))  return false;
+        if (!stream_equal(ma->joints,     mb->joints,     vc * 4 * sizeof(u16))) return false;
+        if (!stream_equal(ma->weights,    mb->weights,    vc * 4 * sizeof(f32))) return false;
+        if (!stream_equal(ma->indices,    mb->indices,    cast(usize)ma->triangle_count * 3 * ma->index_size)) return false;
+
+        if (ma->lod_count != mb->lod_count) return false;
+        if (SDL_memcmp(ma->lods, mb->lods, cast(usize)ma->lod_count * sizeof(Gfx_Lod)) != 0) return false;
+        if (!stream_equal(ma->lod_indices, mb->lod_indices, cast(usize)gfx_mesh_lod_index_count(ma) * ma->index_size)) return false;
+
+        if (ma->meshlets.count != mb->meshlets.count) return false;
+        if (!stream_equal(ma->meshlets.meshlets, mb->meshlets.meshlets, cast(usize)ma->meshlets.count * sizeof(Gfx_Meshlet))) return false;
+    }
+
+    for (int i = 0; i < a->skin_count; i++) {
+        const Gfx_Skin *ka = &a->skins[i];
+        const Gfx_Skin *kb = &b->skins[i];
+        usize jc = cast(usize)ka->joint_count;
+        if (ka->joint_count != kb->joint_count) return false;
+        if (!stream_equal(ka->joints,       kb->joints,       jc * sizeof(s32)))       return false;
+        if (!stream_equal(ka->inverse_bind, kb->inverse_bind, jc * sizeof(glm::mat4))) return false;
+    }
+
+    for (int i = 0; i < a->clip_count; i++) {
+        const Gfx_Clip *ca = &a->clips[i];
+        const Gfx_Clip *cb = &b->clips[i];
+        if (ca->channel_count != cb->channel_count || ca->duration != cb->duration) return false;
+
+        for (int ci = 0; ci < ca->channel_count; ci++) {
+            const Gfx_Anim_Channel *ha = &ca->channels[ci];
+            const Gfx_Anim_Channel *hb = &cb->channels[ci];
+            if (ha->node != hb->node || ha->path != hb->path || ha->interpolation != hb->interpolation) return false;
+            if (ha->key_count != hb->key_count) return false;
+
+            usize kc = cast(usize)ha->key_count;
+            if (!stream_equal(ha->times,  hb->times,  kc * sizeof(f32))) return false;
+            if (!stream_equal(ha->values, hb->values, kc * cast(usize)gfx_anim_path_components(ha->path) * sizeof(f32))) return false;
         }
     }
+
+    return true;
 }
 
 void gfx_model_cleanup(Gfx_Model *model) {
-    for (int i = 0; i < model->mesh_count; i++) {
-        Gfx_Mesh mesh = model->meshes[i];
-        if (mesh.vertices != NULL)   SDL_free(mesh.vertices);
-        if (mesh.texcoords != NULL)  SDL_free(mesh.texcoords);
-        if (mesh.texcoords2 != NULL) SDL_free(mesh.texcoords2);
-        if (mesh.normals != NULL)    SDL_free(mesh.normals);
-        if (mesh.indices != NULL)    SDL_free(mesh.indices);
-    }
-    SDL_free(model->meshes);
+    // Cached meshes live in the mapping, the storage only holds the mesh array.
+    if (model->cache != NULL) gfx_cache_release(model->cache);
+
+    arena_release(&model->storage);
+    arena_release(&model->lods);
+    arena_release(&model->meshlets);
+    arena_release(&model->animation);
+    gfx_scene_free(&model->scene);
     *model = {};
 }
@@ -1,50 +1,181 @@
 #pragma once
 
 #include "defines.h"
+#include "arena.h"
+#include "gfx_anim.h"
+#include "gfx_cull.h"
+#include "gfx_lod.h"
+#include "gfx_meshlet.h"
+#include "gfx_mip.h"
+#include "gfx_occlusion.h"
+#include "gfx_pipeline.h"
+#include "gfx_queue.h"
+#include "gfx_residency.h"
+#include "gfx_scene.h"
+#include "gfx_staging.h"
+#include "gfx_texture.h"
+#include "gfx_vertex.h"
 
 #include <SDL3/SDL.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-struct Gfx_Upload_Buffer {
-    SDL_GPUCommandBuffer *command_buffer;
-    SDL_GPUCopyPass *copy_pass;
-    SDL_GPUTransferBuffer *transfer_buffer;
-    bool cyclic;
-    bool using_new_copy_pass;
-    u32 offset = 0;
+struct Gfx_GPU_Mesh;
+struct cgltf_data;
+
+#define GFX_FAR_PLANE 1000.0f
+
+// Texture filtering of the draws. Trilinear and anisotropic blend between
+// mip levels, so they need textures with a full chain.
+enum Gfx_Sampler_Filter {
+    GFX_SAMPLER_NEAREST,
+    GFX_SAMPLER_BILINEAR,
+    GFX_SAMPLER_TRILINEAR,
+    GFX_SAMPLER_ANISOTROPIC, // Trilinear with 16x anisotropy.
+
+    GFX_SAMPLER_FILTER_COUNT,
+};
+
+struct Gfx_Submission {
+    const Gfx_GPU_Mesh *mesh;
+    Gfx_Instance instance;
+    int lod; // Level picked by gfx_draw(), 0 for the full mesh.
 };
 
 struct Gfx_Context {
     SDL_Window *window;
     SDL_GPUDevice *device;
-    SDL_GPUGraphicsPipeline *graphics_pipeline;
+
+    // Variants are created on first use, the ones of the quad and the mesh
+    // layouts in the background from gfx_init().
+    Gfx_Pipeline_Cache pipelines;
+
     SDL_GPUBuffer *vertex_buffer;
     SDL_GPUBuffer *index_buffer;
+
+    // Drawn with, set by gfx_set_texture(). Borrowed, except for the white
+    // placeholder.
     SDL_GPUTexture *texture;
-    SDL_GPUSampler *sampler;
-    Gfx_Upload_Buffer upload;
+    SDL_GPUTexture *white_texture;
+
+    // One sampler per filter, sampler_filter is used by gfx_draw().
+    SDL_GPUSampler *samplers[GFX_SAMPLER_FILTER_COUNT];
+    Gfx_Sampler_Filter sampler_filter = GFX_SAMPLER_TRILINEAR;
+
+    // All uploads go through here and are copied at the start of the next
+    // gfx_draw().
+    Gfx_Staging staging;
+
+    // Uploads copied by the last gfx_draw().
+    Gfx_Staging_Stats upload_stats;
+
+    // Optional, spreads culling and vertex packing over the workers.
+    Job_System *jobs = NULL;
+
+    // Every buffer and texture with its size, see gfx_residency.h. Meshes
+    // and cached textures are evicted when residency.budget_bytes is set.
+    // residency.last_frame has the stats of the last gfx_draw().
+    Gfx_Residency residency;
+    Gfx_Resident quad_resident;
+    Gfx_Resident instance_resident;
+    Gfx_Resident white_resident;
 
     glm::mat4 proj;
+    glm::mat4 view = glm::mat4(1.0f);
+
+    // Instances submitted with gfx_submit() since the last gfx_draw(), with
+    // their world-space bounding spheres in the same order. gfx_draw() queues
+    // one packet per instance that survives frustum culling.
+    Gfx_Submission *submissions = NULL;
+    int submission_count    = 0;
+    int submission_capacity = 0;
+    Gfx_Sphere_Set cull_set;
+    u32 *visible = NULL;
+    int visible_capacity = 0;
+    Gfx_Render_Queue queue;
+
+    // Instances removed by frustum culling in the last gfx_draw().
+    int frustum_culled = 0;
+
+    // Occluders submitted with gfx_submit_occluder() since the last
+    // gfx_draw(). When there are any, gfx_draw() rasterizes them and drops
+    // the instances left after frustum culling that they hide, see
+    // gfx_occlusion.h. occlusion.stats has the counts and times of the last
+    // gfx_draw().
+    Gfx_Occlusion_Buffer occlusion;
+
+    // Instances of meshes with LODs draw the coarsest level whose error
+    // stays under this on screen, in fractions of the viewport height (see
+    // gfx_lod.h). 0 always draws the full meshes.
+    f32 lod_threshold = 1.0f / 1080.0f;
+
+    // Levels drawn by the last gfx_draw().
+    Gfx_Lod_Stats lod_stats;
+
+    // Binds of the last gfx_draw().
+    Gfx_Queue_Stats queue_stats;
+
+    // Assigned to meshes by gfx_mesh_upload() for the sort key.
+    u16 next_mesh_id = 0;
+
+    // Per-instance data of the current frame, grown on demand.
+    SDL_GPUBuffer *instance_buffer = NULL;
+    u32 instance_capacity = 0;
+
+    // Scratch for the index ranges left after meshlet culling.
+    Gfx_Draw_Range *draw_ranges = NULL;
+    int draw_range_capacity = 0;
+
+    // Accumulated by gfx_draw(), reset by the caller.
+    Gfx_Meshlet_Cull_Stats cull_stats;
 };
 
 void gfx_init(Gfx_Context *context, SDL_Window *window);
 void gfx_cleanup(Gfx_Context *context);
+
+// Queues one instance of a mesh for the next gfx_draw(). The mesh must stay
+// alive until then. An evicted mesh is uploaded again first, within the
+// restore budget, and skipped for this frame when over it.
+void gfx_submit(Gfx_Context *context, Gfx_GPU_Mesh *mesh, const glm::mat4 &transform);
+
+// Queues an occluder for the next gfx_draw(), its data must stay alive until
+// then. Occluders are only rasterized for culling, submit their mesh as well
+// to draw them.
+void gfx_submit_occluder(Gfx_Context *context, const Gfx_Occluder *occluder, const glm::mat4 &transform);
+
+// Culls the submitted instances against the view frustum and the occluders,
+// picks their LOD, sorts the rest by pipeline, material, mesh and depth (see
+// gfx_queue.h) and draws them, one instanced draw per run of the same mesh
+// and level. Clears the submissions and the occluders.
 void gfx_draw(Gfx_Context *context, f32 rotate, SDL_FColor clear_color);
 
-void gfx_immediate_upload_buffer_ex(Gfx_Context *context, u32 src_offset, SDL_GPUTransferBuffer *src_buffer, u32 size,
-                                    u32 dst_offset, SDL_GPUBuffer *dst_buffer, bool cyclic);
-void gfx_immediate_upload_buffer(Gfx_Context *context, SDL_GPUTransferBuffer *src_buffer, u32 size, SDL_GPUBuffer *dst_buffer);
+// Creates an RGBA8 texture from width * height pixels and queues its upload.
+// Returns NULL on failure.
+SDL_GPUTexture *gfx_texture_upload(Gfx_Context *context, const u8 *pixels, int width, int height);
+
+// Same with every level of a mip chain (see gfx_mip.h).
+SDL_GPUTexture *gfx_texture_upload_mips(Gfx_Context *context, const Gfx_Mip_Chain *chain);
+
+// Same with the block-compressed levels of a baked texture (see
+// gfx_texture.h), uploaded as they are. Returns NULL if the device cannot
+// sample the format.
+SDL_GPUTexture *gfx_texture_upload_baked(Gfx_Context *context, const Gfx_Baked_Texture *texture);
 
-// To upload using an existing copy_pass, provide it through the parameter.
-// Otherwise, a new copy_pass will be created automatically.
-//
-// Note: If gfx_upload_buffer_begin() is called, it must be paired with
-// gfx_upload_buffer_end() before starting a new upload session.
-void gfx_upload_buffer_begin(Gfx_Context *context, SDL_GPUCopyPass *copy_pass, SDL_GPUTransferBuffer *transfer_buffer, bool cyclic);
-void gfx_upload_buffer_end(Gfx_Context *context);
+const char *gfx_sampler_filter_name(Gfx_Sampler_Filter filter);
 
-void gfx_upload_buffer_push(Gfx_Context *context, u32 size, u32 offset, SDL_GPUBuffer *buffer);
+// Sets the texture of the next draws, owned by the caller (see
+// gfx_texture_cache.h) and kept alive while it is set. NULL restores the
+// white placeholder the context starts with.
+void gfx_set_texture(Gfx_Context *context, SDL_GPUTexture *texture);
+
+// Copy data into the staging ring (see gfx_staging.h) and queue its upload.
+// The copies run in one copy pass at the start of the next gfx_draw(), or on
+// gfx_upload_flush(). Return false on failure.
+bool gfx_upload_buffer(Gfx_Context *context, SDL_GPUBuffer *buffer, u32 offset, const void *data, u32 size);
+bool gfx_upload_texture(Gfx_Context *context, SDL_GPUTexture *texture, u32 mip_level, u32 width, u32 height, const u8 *pixels);
+
+// Submits the queued uploads now, for when no gfx_draw() follows.
+void gfx_upload_flush(Gfx_Context *context);
 
 struct Gfx_Mesh {
     int vertex_count   = 0;
@@ -56,19 +187,161 @@ struct Gfx_Mesh {
     f32 *normals    = NULL;
     f32 *tangents   = NULL;
     u8  *colors     = NULL;
-    u16 *indices    = NULL;
 
-    // TODO: animation.
+    // u16 when the vertices fit in 16 bits, u32 otherwise.
+    void *indices   = NULL;
+    u32 index_size  = sizeof(u16);
+
+    Gfx_Bounds bounds;
+
+    // Node in Gfx_Model::scene that places the mesh, -1 for none.
+    int node = -1;
+
+    // Skin in Gfx_Model::skins, -1 for none. Skinned meshes have 4 joints
+    // into the skin and 4 weights per vertex, weights sum to 1.
+    int skin = -1;
+    u16 *joints  = NULL;
+    f32 *weights = NULL;
+
+    // Simplified levels over the same vertices, coarser with every level,
+    // see gfx_lod.h. Their indices are in lod_indices, in index_size.
+    int lod_count = 0;
+    Gfx_Lod lods[GFX_LOD_MAX_LEVELS];
+    void *lod_indices = NULL;
+
+    // Meshlets over the indices, see gfx_meshlet.h. Baked into the mesh
+    // cache, none unless gfx_model_build_meshlets() ran otherwise.
+    Gfx_Meshlets meshlets;
 };
 
+// Meshes with more vertices than this need 32-bit indices.
+#define GFX_MESH_MAX_VERTICES_16 65536
+
+inline u32 gfx_mesh_index_size(int vertex_count) {
+    return vertex_count > GFX_MESH_MAX_VERTICES_16 ? sizeof(u32) : sizeof(u16);
+}
+
+inline u32 gfx_mesh_get_index(const Gfx_Mesh *mesh, int i) {
+    if (mesh->index_size == sizeof(u32)) return (cast(const u32 *)mesh->indices)[i];
+    return (cast(const u16 *)mesh->indices)[i];
+}
+
+inline void gfx_mesh_set_index(Gfx_Mesh *mesh, int i, u32 index) {
+    if (mesh->index_size == sizeof(u32)) (cast(u32 *)mesh->indices)[i] = index;
+    else                                 (cast(u16 *)mesh->indices)[i] = cast(u16)index;
+}
+
+// Indices of all LOD levels together.
+inline u32 gfx_mesh_lod_index_count(const Gfx_Mesh *mesh) {
+    if (mesh->lod_count == 0) return 0;
+    const Gfx_Lod *last = &mesh->lods[mesh->lod_count - 1];
+    return last->first_index + last->index_count;
+}
+
 struct Gfx_Model {
-    glm::mat4 transform = glm::mat4(1.0f);
+    // The glTF node tree, meshes reference their node.
+    Gfx_Scene scene;
 
     int mesh_count = 0;
     Gfx_Mesh *meshes = NULL;
 
-    // TODO:materials, animation.
+    // Holds the mesh array and all mesh streams, released as one block.
+    Arena storage;
+
+    // Holds the LOD indices of the meshes, see gfx_model_build_lods().
+    Arena lods;
+
+    // Holds the meshlets of the meshes, see gfx_model_build_meshlets().
+    Arena meshlets;
+
+    // Set when the mesh streams point into a mapped mesh cache (see gfx_cache.h).
+    void *cache = NULL;
+
+    // Skins and animation clips, see gfx_anim.h. Channels and skins
+    // reference nodes of the scene.
+    int skin_count = 0;
+    Gfx_Skin *skins = NULL;
+    int clip_count = 0;
+    Gfx_Clip *clips = NULL;
+
+    // Holds the skins, the clips and their keys, released as one block. Apart
+    // from the mesh storage, which splitting replaces.
+    Arena animation;
+
+    // TODO: materials.
 };
 
+// GPU copy of a mesh in one of the vertex layouts from gfx_vertex.h.
+struct Gfx_GPU_Mesh {
+    Gfx_Vertex_Layout layout = GFX_VERTEX_LAYOUT_FLOAT;
+    SDL_GPUBuffer *vertex_buffer = NULL;
+    SDL_GPUBuffer *index_buffer  = NULL;
+    SDL_GPUIndexElementSize index_element_size = SDL_GPU_INDEXELEMENTSIZE_16BIT;
+    u32 index_count = 0;
+
+    glm::vec3 dequant_scale  = glm::vec3(1.0f);
+    glm::vec3 dequant_offset = glm::vec3(0.0f);
+
+    // Object space, copied from the mesh.
+    Gfx_Bounds bounds;
+
+    // Optional, built from the mesh before upload. When set, gfx_draw() culls
+    // the meshlets and only draws the visible index ranges. Of the full mesh
+    // only, LODs draw whole.
+    const Gfx_Meshlets *meshlets = NULL;
+
+    // Copied from the mesh, their indices follow the full ones in
+    // index_buffer and first_index counts from there.
+    int lod_count = 0;
+    Gfx_Lod lods[GFX_LOD_MAX_LEVELS];
+
+    u16 id = 0; // Render queue key, see gfx_queue.h.
+
+    // The buffers of both, evicted under the budget of the context and
+    // packed again from source when submitted.
+    Gfx_Resident resident;
+    const Gfx_Mesh *source = NULL;
+};
+
+// Packs the mesh into the given layout and queues its upload. The mesh must
+// stay alive as long as the GPU mesh, for restoring it after an eviction.
+void gfx_mesh_upload(Gfx_Context *context, Gfx_GPU_Mesh *gpu_mesh, const Gfx_Mesh *mesh, Gfx_Vertex_Layout layout);
+void gfx_mesh_release(Gfx_Context *context, Gfx_GPU_Mesh *gpu_mesh);
+
 void gfx_model_load(Gfx_Model *model, const char *file);
 void gfx_model_cleanup(Gfx_Model *model);
+
+// Decodes the primitives as parallel jobs, serially when jobs is NULL. The
+// result is identical to gfx_model_load().
+void gfx_model_load_ex(Gfx_Model *model, const char *file, Job_System *jobs);
+
+// Same as gfx_model_load_ex() for a glTF already parsed from file, whose
+// buffers are loaded here. data stays owned by the caller.
+void gfx_model_load_parsed(Gfx_Model *model, cgltf_data *data, const char *file, Job_System *jobs);
+
+// Splits every mesh with more than max_vertices vertices into chunks of at
+// most max_vertices, so they can use 16-bit indices. Triangles keep their
+// order. The model storage is rebuilt and the LODs are dropped; returns false
+// and leaves the model untouched on allocation failure.
+bool gfx_model_split(Gfx_Model *model, int max_vertices);
+
+// World transform of a mesh from the last gfx_scene_update().
+inline glm::mat4 gfx_model_mesh_transform(const Gfx_Model *model, int mesh) {
+    int node = model->meshes[mesh].node;
+    return node >= 0 ? model->scene.world[node] : glm::mat4(1.0f);
+}
+
+// Input of gfx_skin_vertices() for a skinned mesh.
+inline Gfx_Skin_Source gfx_mesh_skin_source(const Gfx_Mesh *mesh) {
+    Gfx_Skin_Source source;
+    source.vertex_count = mesh->vertex_count;
+    source.positions    = mesh->vertices;
+    source.normals      = mesh->normals;
+    source.joints       = mesh->joints;
+    source.weights      = mesh->weights;
+    return source;
+}
+
+// Compares mesh counts, the node tree, the content of every mesh stream and
+// LOD, and the skins and clips.
+bool gfx_model_equal(const Gfx_Model *a, const Gfx_Model *b);
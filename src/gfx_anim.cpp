@@ -0,0 +1,508 @@
+#include "gfx_anim.h"
+
+#include "gfx_anim_compress.h"
+#include "profile.h"
+
+#include <SDL3/SDL.h>
+
+#if SIMD_SSE2
+    #include <emmintrin.h>
+#endif
+
+const char *gfx_anim_path_name(Gfx_Anim_Path path) {
+    switch (path) {
+        case GFX_ANIM_TRANSLATION: return "translation";
+        case GFX_ANIM_ROTATION:    return "rotation";
+        case GFX_ANIM_SCALE:       return "scale";
+        default: break;
+    }
+    return "unknown";
+}
+
+//
+// Skeleton.
+//
+
+// Places the arrays of a skeleton. Run against a measuring arena first.
+static void layout_skeleton(Gfx_Skeleton *skeleton, const Gfx_Clip *clips, int clip_count, Arena *storage) {
+    usize jc = cast(usize)skeleton->joint_count;
+    usize stride = cast(usize)skeleton->stride;
+
+    skeleton->parent       = cast(s32 *)arena_push(storage, jc * sizeof(s32));
+    skeleton->skin_joint   = cast(s32 *)arena_push(storage, jc * sizeof(s32));
+    skeleton->has_offset   = cast(u8 *)arena_push(storage, jc * sizeof(u8));
+    skeleton->offset       = cast(glm::mat4 *)arena_push(storage, jc * sizeof(glm::mat4));
+    skeleton->inverse_bind = cast(glm::mat4 *)arena_push(storage, jc * sizeof(glm::mat4));
+    skeleton->rest         = cast(f32 *)arena_push(storage, GFX_POSE_COMPONENT_COUNT * stride * sizeof(f32));
+
+    skeleton->channel_joints = cast(s32 **)arena_push(storage, cast(usize)clip_count * sizeof(s32 *));
+    for (int ci = 0; ci < clip_count; ci++) {
+        s32 *joints = cast(s32 *)arena_push(storage, cast(usize)clips[ci].channel_count * sizeof(s32));
+        if (skeleton->channel_joints) skeleton->channel_joints[ci] = joints;
+    }
+}
+
+static void set_pose(f32 *pose, int stride, int joint, glm::vec3 t, glm::quat r, glm::vec3 s) {
+    f32 values[GFX_POSE_COMPONENT_COUNT] = {t.x, t.y, t.z, r.x, r.y, r.z, r.w, s.x, s.y, s.z};
+    for (int c = 0; c < GFX_POSE_COMPONENT_COUNT; c++) pose[c * stride + joint] = values[c];
+}
+
+bool gfx_skeleton_build(Gfx_Skeleton *skeleton, const Gfx_Scene *scene, const Gfx_Skin *skin, const Gfx_Clip *clips, int clip_count) {
+    *skeleton = {};
+
+    // Joint of every scene node, -1 for other nodes.
+    auto joint_of_node = cast(s32 *)SDL_malloc(cast(usize)SDL_max(scene->node_count, 1) * sizeof(s32));
+    if (!joint_of_node) return false;
+    defer { SDL_free(joint_of_node); };
+    for (int i = 0; i < scene->node_count; i++) joint_of_node[i] = -1;
+
+    for (int j = 0; j < skin->joint_count; j++) {
+        s32 node = skin->joints[j];
+        if (node < 0 || node >= scene->node_count || joint_of_node[node] >= 0) return false;
+        joint_of_node[node] = 0;
+    }
+
+    // Scene order keeps parents in front of their children.
+    int joint_count = 0;
+    for (int i = 0; i < scene->node_count; i++) {
+        if (joint_of_node[i] >= 0) joint_of_node[i] = joint_count++;
+    }
+
+    skeleton->joint_count = joint_count;
+    skeleton->stride      = (joint_count + 3) & ~3;
+
+    Arena measure{};
+    layout_skeleton(skeleton, clips, clip_count, &measure);
+    if (!arena_init(&skeleton->storage, SDL_max(measure.used, cast(usize)1))) {
+        *skeleton = {};
+        return false;
+    }
+    layout_skeleton(skeleton, clips, clip_count, &skeleton->storage);
+
+    for (int sj = 0; sj < skin->joint_count; sj++) {
+        s32 node = skin->joints[sj];
+        int j = joint_of_node[node];
+        skeleton->skin_joint[j]   = sj;
+        skeleton->inverse_bind[j] = skin->inverse_bind[sj];
+        set_pose(skeleton->rest, skeleton->stride, j, scene->translation[node], scene->rotation[node], scene->scale[node]);
+
+        // Walk up to the parent joint, collecting the nodes in between.
+        glm::mat4 offset(1.0f);
+        bool has_offset = false;
+        s32 parent = scene->parent[node];
+        while (parent != GFX_SCENE_NO_PARENT && joint_of_node[parent] < 0) {
+            offset = gfx_scene_local_matrix(scene, parent) * offset;
+            has_offset = true;
+            parent = scene->parent[parent];
+        }
+        skeleton->parent[j]     = parent != GFX_SCENE_NO_PARENT ? joint_of_node[parent] : -1;
+        skeleton->offset[j]     = offset;
+        skeleton->has_offset[j] = has_offset;
+    }
+    for (int j = joint_count; j < skeleton->stride; j++) {
+        set_pose(skeleton->rest, skeleton->stride, j, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+    }
+
+    skeleton->clip_count = clip_count;
+    skeleton->clips      = clips;
+    for (int ci = 0; ci < clip_count; ci++) {
+        const Gfx_Clip *clip = &clips[ci];
+        for (int i = 0; i < clip->channel_count; i++) {
+            s32 node = clip->channels[i].node;
+            bool valid = node >= 0 && node < scene->node_count && clip->channels[i].key_count > 0;
+            skeleton->channel_joints[ci][i] = valid ? joint_of_node[node] : -1;
+        }
+    }
+
+    return true;
+}
+
+void gfx_skeleton_free(Gfx_Skeleton *skeleton) {
+    arena_release(&skeleton->storage);
+    *skeleton = {};
+}
+
+//
+// Characters.
+//
+
+static void layout_character(Gfx_Anim_Character *character, const Gfx_Skeleton *skeleton, Arena *storage) {
+    int channel_count = 0;
+    for (int ci = 0; ci < skeleton->clip_count; ci++) channel_count = SDL_max(channel_count, skeleton->clips[ci].channel_count);
+
+    usize stride = cast(usize)skeleton->stride;
+    character->cursors = cast(u32 *)arena_push(storage, cast(usize)channel_count * sizeof(u32));
+    character->pose    = cast(f32 *)arena_push(storage, GFX_POSE_COMPONENT_COUNT * stride * sizeof(f32));
+    character->local   = cast(glm::mat4 *)arena_push(storage, stride * sizeof(glm::mat4));
+    character->world   = cast(glm::mat4 *)arena_push(storage, stride * sizeof(glm::mat4));
+    character->palette = cast(glm::mat4 *)arena_push(storage, stride * sizeof(glm::mat4));
+}
+
+bool gfx_anim_character_init(Gfx_Anim_Character *character, const Gfx_Skeleton *skeleton, int clip) {
+    *character = {};
+    character->skeleton = skeleton;
+
+    Arena measure{};
+    layout_character(character, skeleton, &measure);
+    if (!arena_init(&character->storage, SDL_max(measure.used, cast(usize)1))) {
+        *character = {};
+        return false;
+    }
+    layout_character(character, skeleton, &character->storage);
+
+    gfx_anim_character_set_clip(character, clip);
+    gfx_anim_sample(character);
+    gfx_anim_compute_palette(character);
+    return true;
+}
+
+void gfx_anim_character_free(Gfx_Anim_Character *character) {
+    arena_release(&character->storage);
+    *character = {};
+}
+
+void gfx_anim_character_set_clip(Gfx_Anim_Character *character, int clip) {
+    const Gfx_Skeleton *skeleton = character->skeleton;
+    ASSERT(clip >= -1 && clip < skeleton->clip_count);
+
+    character->clip = clip;
+    character->time = 0.0f;
+    if (clip >= 0) SDL_memset(character->cursors, 0, cast(usize)skeleton->clips[clip].channel_count * sizeof(u32));
+}
+
+void gfx_anim_advance(Gfx_Anim_Character *character, f32 seconds) {
+    if (character->clip < 0) return;
+
+    f32 duration = character->skeleton->clips[character->clip].duration;
+    f32 time = character->time + seconds * character->speed;
+    if (duration <= 0.0f) {
+        time = 0.0f;
+    } else if (character->loop) {
+        time = SDL_fmodf(time, duration);
+        if (time < 0.0f) time += duration;
+    } else {
+        time = SDL_clamp(time, 0.0f, duration);
+    }
+    character->time = time;
+}
+
+//
+// Sampling.
+//
+
+void gfx_anim_interpolate(Gfx_Anim_Path path, const f32 *a, const f32 *b, f32 t, f32 *value) {
+    if (path != GFX_ANIM_ROTATION) {
+        for (int c = 0; c < 3; c++) value[c] = a[c] + (b[c] - a[c]) * t;
+        return;
+    }
+
+    // Normalized lerp along the shorter arc.
+    f32 sign = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < 0.0f ? -1.0f : 1.0f;
+    f32 length2 = 0.0f;
+    for (int c = 0; c < 4; c++) {
+        value[c] = a[c] + (sign * b[c] - a[c]) * t;
+        length2 += value[c] * value[c];
+    }
+    f32 scale = length2 > 0.0f ? 1.0f / SDL_sqrtf(length2) : 0.0f;
+    for (int c = 0; c < 4; c++) value[c] *= scale;
+}
+
+void gfx_anim_channel_sample(const Gfx_Anim_Channel *channel, f32 time, u32 *cursor, u32 *searches, f32 *value) {
+    int components = gfx_anim_path_components(channel->path);
+    int last_key = channel->key_count - 1;
+
+    // Key and blend factor toward the next key.
+    int k = 0;
+    f32 t = 0.0f;
+    if (time >= channel->times[last_key]) {
+        k = last_key;
+    } else if (time > channel->times[0]) {
+        k = gfx_anim_find_key(channel->times, channel->key_count, time, cursor, searches);
+        if (channel->interpolation == GFX_ANIM_LINEAR) {
+            f32 span = channel->times[k + 1] - channel->times[k];
+            t = span > 0.0f ? (time - channel->times[k]) / span : 0.0f;
+        }
+    }
+
+    const f32 *a = channel->values + k * components;
+    gfx_anim_interpolate(channel->path, a, t > 0.0f ? a + components : a, t, value);
+}
+
+void gfx_anim_sample(Gfx_Anim_Character *character) {
+    const Gfx_Skeleton *skeleton = character->skeleton;
+    int stride = skeleton->stride;
+    SDL_memcpy(character->pose, skeleton->rest, GFX_POSE_COMPONENT_COUNT * cast(usize)stride * sizeof(f32));
+    if (character->clip < 0) return;
+
+    const Gfx_Clip *clip = &skeleton->clips[character->clip];
+    const Gfx_Compressed_Clip *compressed = skeleton->compressed ? &skeleton->compressed[character->clip] : NULL;
+    const s32 *channel_joints = skeleton->channel_joints[character->clip];
+    f32 time = character->time;
+
+    for (int i = 0; i < clip->channel_count; i++) {
+        int joint = channel_joints[i];
+        if (joint < 0) continue;
+
+        Gfx_Anim_Path path = clip->channels[i].path;
+        f32 value[4];
+        if (compressed) gfx_compressed_clip_sample(compressed, i, time, &character->cursors[i], &character->searches, value);
+        else            gfx_anim_channel_sample(&clip->channels[i], time, &character->cursors[i], &character->searches, value);
+
+        int first = path == GFX_ANIM_TRANSLATION ? GFX_POSE_TX :
+                    path == GFX_ANIM_ROTATION    ? GFX_POSE_QX : GFX_POSE_SX;
+        for (int c = 0; c < gfx_anim_path_components(path); c++) character->pose[(first + c) * stride + joint] = value[c];
+    }
+}
+
+//
+// Palette.
+//
+
+static void local_matrices_scalar(const f32 *pose, int stride, int begin, int end, glm::mat4 *local) {
+    const f32 *tx = pose + GFX_POSE_TX * stride, *ty = pose + GFX_POSE_TY * stride, *tz = pose + GFX_POSE_TZ * stride;
+    const f32 *qx = pose + GFX_POSE_QX * stride, *qy = pose + GFX_POSE_QY * stride;
+    const f32 *qz = pose + GFX_POSE_QZ * stride, *qw = pose + GFX_POSE_QW * stride;
+    const f32 *sx = pose + GFX_POSE_SX * stride, *sy = pose + GFX_POSE_SY * stride, *sz = pose + GFX_POSE_SZ * stride;
+
+    for (int j = begin; j < end; j++) {
+        f32 x2 = qx[j] + qx[j], y2 = qy[j] + qy[j], z2 = qz[j] + qz[j];
+        f32 xx = qx[j] * x2, yy = qy[j] * y2, zz = qz[j] * z2;
+        f32 xy = qx[j] * y2, xz = qx[j] * z2, yz = qy[j] * z2;
+        f32 wx = qw[j] * x2, wy = qw[j] * y2, wz = qw[j] * z2;
+
+        glm::mat4 &m = local[j];
+        m[0] = glm::vec4((1.0f - (yy + zz)) * sx[j], (xy + wz) * sx[j], (xz - wy) * sx[j], 0.0f);
+        m[1] = glm::vec4((xy - wz) * sy[j], (1.0f - (xx + zz)) * sy[j], (yz + wx) * sy[j], 0.0f);
+        m[2] = glm::vec4((xz + wy) * sz[j], (yz - wx) * sz[j], (1.0f - (xx + yy)) * sz[j], 0.0f);
+        m[3] = glm::vec4(tx[j], ty[j], tz[j], 1.0f);
+    }
+}
+
+#if SIMD_SSE2
+
+// Same as local_matrices_scalar(), 4 joints per iteration. The matrices are
+// computed as rows of 4 joints, then transposed into columns.
+static void local_matrices_sse2(const f32 *pose, int stride, glm::mat4 *local) {
+    const f32 *p = pose;
+    __m128 one  = _mm_set1_ps(1.0f);
+    __m128 zero = _mm_setzero_ps();
+
+    for (int j = 0; j < stride; j += 4) {
+        __m128 qx = _mm_loadu_ps(p + GFX_POSE_QX * stride + j);
+        __m128 qy = _mm_loadu_ps(p + GFX_POSE_QY * stride + j);
+        __m128 qz = _mm_loadu_ps(p + GFX_POSE_QZ * stride + j);
+        __m128 qw = _mm_loadu_ps(p + GFX_POSE_QW * stride + j);
+        __m128 sx = _mm_loadu_ps(p + GFX_POSE_SX * stride + j);
+        __m128 sy = _mm_loadu_ps(p + GFX_POSE_SY * stride + j);
+        __m128 sz = _mm_loadu_ps(p + GFX_POSE_SZ * stride + j);
+
+        __m128 x2 = _mm_add_ps(qx, qx), y2 = _mm_add_ps(qy, qy), z2 = _mm_add_ps(qz, qz);
+        __m128 xx = _mm_mul_ps(qx, x2), yy = _mm_mul_ps(qy, y2), zz = _mm_mul_ps(qz, z2);
+        __m128 xy = _mm_mul_ps(qx, y2), xz = _mm_mul_ps(qx, z2), yz = _mm_mul_ps(qy, z2);
+        __m128 wx = _mm_mul_ps(qw, x2), wy = _mm_mul_ps(qw, y2), wz = _mm_mul_ps(qw, z2);
+
+        __m128 c0[4] = {
+            _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx),
+            _mm_mul_ps(_mm_add_ps(xy, wz), sx),
+            _mm_mul_ps(_mm_sub_ps(xz, wy), sx),
+            zero,
+        };
+        __m128 c1[4] = {
+            _mm_mul_ps(_mm_sub_ps(xy, wz), sy),
+            _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+            _mm_mul_ps(_mm_add_ps(yz, wx), sy),
+            zero,
+        };
+        __m128 c2[4] = {
+            _mm_mul_ps(_mm_add_ps(xz, wy), sz),
+            _mm_mul_ps(_mm_sub_ps(yz, wx), sz),
+            _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz),
+            zero,
+        };
+        __m128 c3[4] = {
+            _mm_loadu_ps(p + GFX_POSE_TX * stride + j),
+            _mm_loadu_ps(p + GFX_POSE_TY * stride + j),
+            _mm_loadu_ps(p + GFX_POSE_TZ * stride + j),
+            one,
+        };
+
+        _MM_TRANSPOSE4_PS(c0[0], c0[1], c0[2], c0[3]);
+        _MM_TRANSPOSE4_PS(c1[0], c1[1], c1[2], c1[3]);
+        _MM_TRANSPOSE4_PS(c2[0], c2[1], c2[2], c2[3]);
+        _MM_TRANSPOSE4_PS(c3[0], c3[1], c3[2], c3[3]);
+
+        for (int i = 0; i < 4; i++) {
+            f32 *m = &local[j + i][0][0];
+            _mm_storeu_ps(m + 0,  c0[i]);
+            _mm_storeu_ps(m + 4,  c1[i]);
+            _mm_storeu_ps(m + 8,  c2[i]);
+            _mm_storeu_ps(m + 12, c3[i]);
+        }
+    }
+}
+
+// out = a * b, column-major. out must not alias a or b.
+static inline void mul_mat4_sse2(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 *out) {
+    __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+    for (int c = 0; c < 4; c++) {
+        __m128 column = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[c][0])), _mm_mul_ps(a1, _mm_set1_ps(b[c][1]))),
+            _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(b[c][2])), _mm_mul_ps(a3, _mm_set1_ps(b[c][3]))));
+        _mm_storeu_ps(&(*out)[c][0], column);
+    }
+}
+
+#endif
+
+void gfx_anim_compute_palette_scalar(Gfx_Anim_Character *character) {
+    const Gfx_Skeleton *skeleton = character->skeleton;
+    local_matrices_scalar(character->pose, skeleton->stride, 0, skeleton->joint_count, character->local);
+
+    for (int j = 0; j < skeleton->joint_count; j++) {
+        s32 parent = skeleton->parent[j];
+        glm::mat4 local = skeleton->has_offset[j] ? skeleton->offset[j] * character->local[j] : character->local[j];
+        character->world[j] = parent >= 0 ? character->world[parent] * local : local;
+        character->palette[skeleton->skin_joint[j]] = character->world[j] * skeleton->inverse_bind[j];
+    }
+}
+
+void gfx_anim_compute_palette(Gfx_Anim_Character *character) {
+#if SIMD_SSE2
+    const Gfx_Skeleton *skeleton = character->skeleton;
+    local_matrices_sse2(character->pose, skeleton->stride, character->local);
+
+    glm::mat4 local;
+    for (int j = 0; j < skeleton->joint_count; j++) {
+        s32 parent = skeleton->parent[j];
+        const glm::mat4 *m = &character->local[j];
+        if (skeleton->has_offset[j]) {
+            mul_mat4_sse2(skeleton->offset[j], *m, &local);
+            m = &local;
+        }
+        if (parent >= 0) mul_mat4_sse2(character->world[parent], *m, &character->world[j]);
+        else             character->world[j] = *m;
+        mul_mat4_sse2(character->world[j], skeleton->inverse_bind[j], &character->palette[skeleton->skin_joint[j]]);
+    }
+#else
+    gfx_anim_compute_palette_scalar(character);
+#endif
+}
+
+struct Update_Work {
+    Gfx_Anim_Character *characters;
+    f32 seconds;
+};
+
+static void update_characters(void *data, int begin, int end) {
+    PROFILE_ZONE("anim_update");
+    auto work = cast(Update_Work *)data;
+    for (int i = begin; i < end; i++) {
+        Gfx_Anim_Character *character = &work->characters[i];
+        gfx_anim_advance(character, work->seconds);
+        gfx_anim_sample(character);
+        gfx_anim_compute_palette(character);
+    }
+}
+
+void gfx_anim_update(Gfx_Anim_Character *characters, int count, f32 seconds, Job_System *jobs) {
+    Update_Work work;
+    work.characters = characters;
+    work.seconds    = seconds;
+    job_parallel_for(jobs, count, 0, update_characters, &work);
+}
+
+//
+// Skinning.
+//
+
+void gfx_skin_vertices_scalar(const Gfx_Skin_Source *source, const glm::mat4 *palette, int begin, int end, f32 *positions, f32 *normals) {
+    bool skin_normals = normals && source->normals;
+
+    for (int v = begin; v < end; v++) {
+        const u16 *joints  = source->joints  + v * 4;
+        const f32 *weights = source->weights + v * 4;
+        glm::mat4 m = palette[joints[0]] * weights[0] + palette[joints[1]] * weights[1] +
+                      palette[joints[2]] * weights[2] + palette[joints[3]] * weights[3];
+
+        const f32 *p = source->positions + v * 3;
+        glm::vec4 position = m[0] * p[0] + m[1] * p[1] + m[2] * p[2] + m[3];
+        positions[v * 3 + 0] = position.x;
+        positions[v * 3 + 1] = position.y;
+        positions[v * 3 + 2] = position.z;
+
+        if (skin_normals) {
+            const f32 *n = source->normals + v * 3;
+            glm::vec3 normal = glm::vec3(m[0] * n[0] + m[1] * n[1] + m[2] * n[2]);
+            f32 length2 = glm::dot(normal, normal);
+            if (length2 > 0.0f) normal /= SDL_sqrtf(length2);
+            normals[v * 3 + 0] = normal.x;
+            normals[v * 3 + 1] = normal.y;
+            normals[v * 3 + 2] = normal.z;
+        }
+    }
+}
+
+#if SIMD_SSE2
+
+static inline void store_float3(f32 *out, __m128 value) {
+    _mm_storel_pi(cast(__m64 *)out, value);
+    _mm_store_ss(out + 2, _mm_movehl_ps(value, value));
+}
+
+// Column of the weighted sum of four matrices, m are their first floats.
+static inline __m128 blend_column(const f32 *const *m, const __m128 *w, int column) {
+    return _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m[0] + column * 4), w[0]), _mm_mul_ps(_mm_loadu_ps(m[1] + column * 4), w[1])),
+        _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m[2] + column * 4), w[2]), _mm_mul_ps(_mm_loadu_ps(m[3] + column * 4), w[3])));
+}
+
+#endif
+
+void gfx_skin_vertices(const Gfx_Skin_Source *source, const glm::mat4 *palette, int begin, int end, f32 *positions, f32 *normals) {
+#if SIMD_SSE2
+    // Locals, so the stores cannot alias them.
+    const f32 *source_positions = source->positions;
+    const f32 *source_normals   = normals ? source->normals : NULL;
+    const u16 *source_joints    = source->joints;
+    const f32 *source_weights   = source->weights;
+    auto matrices = cast(const f32 *)palette;
+
+    for (int v = begin; v < end; v++) {
+        const u16 *joints  = source_joints  + v * 4;
+        const f32 *weights = source_weights + v * 4;
+
+        const f32 *m[4] = {matrices + joints[0] * 16, matrices + joints[1] * 16, matrices + joints[2] * 16, matrices + joints[3] * 16};
+        __m128 w[4] = {_mm_set1_ps(weights[0]), _mm_set1_ps(weights[1]), _mm_set1_ps(weights[2]), _mm_set1_ps(weights[3])};
+        __m128 c[4] = {blend_column(m, w, 0), blend_column(m, w, 1), blend_column(m, w, 2), blend_column(m, w, 3)};
+
+        const f32 *p = source_positions + v * 3;
+        __m128 position = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(c[0], _mm_set1_ps(p[0])), _mm_mul_ps(c[1], _mm_set1_ps(p[1]))),
+            _mm_add_ps(_mm_mul_ps(c[2], _mm_set1_ps(p[2])), c[3]));
+        store_float3(positions + v * 3, position);
+
+        if (source_normals) {
+            const f32 *n = source_normals + v * 3;
+            __m128 normal = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(c[0], _mm_set1_ps(n[0])), _mm_mul_ps(c[1], _mm_set1_ps(n[1]))),
+                _mm_mul_ps(c[2], _mm_set1_ps(n[2])));
+
+            // Squared length in lane 0, w is zero.
+            __m128 square = _mm_mul_ps(normal, normal);
+            __m128 length2 = _mm_add_ss(_mm_add_ss(square, _mm_shuffle_ps(square, square, _MM_SHUFFLE(1, 1, 1, 1))),
+                                        _mm_shuffle_ps(square, square, _MM_SHUFFLE(2, 2, 2, 2)));
+            if (_mm_cvtss_f32(length2) > 0.0f) {
+                __m128 length = _mm_sqrt_ss(length2);
+                normal = _mm_div_ps(normal, _mm_shuffle_ps(length, length, _MM_SHUFFLE(0, 0, 0, 0)));
+            }
+            store_float3(normals + v * 3, normal);
+        }
+    }
+#else
+    gfx_skin_vertices_scalar(source, palette, begin, end, positions, normals);
+#endif
+}
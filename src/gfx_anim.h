@@ -0,0 +1,230 @@
+#pragma once
+
+#include "defines.h"
+#include "arena.h"
+#include "gfx_scene.h"
+#include "job.h"
+
+#include <glm/glm.hpp>
+
+//
+// Skeletal animation.
+//
+// gfx_model_load() imports the glTF skins and animation clips with the
+// model. A skin lists its joints as scene nodes, with their inverse bind
+// matrices. Skinned meshes carry four joint indices into that list and four
+// weights per vertex. A clip is a set of channels, each of them keyframes of
+// the translation, rotation or scale of one node. Cubic spline channels keep
+// their values and drop the tangents, so they play linearly.
+//
+// Playback never touches the scene of the model. A Gfx_Skeleton is built
+// once per skin: the joints in scene order, so parents come first, the rest
+// pose, and for every clip the joint each channel drives. Every
+// Gfx_Anim_Character then owns a clip time, a pose, a cursor per channel and
+// a joint palette. Nodes between two joints that are not joints themselves
+// stay in their rest pose.
+//
+// The pose is structure of arrays, one array per component. Sampling starts
+// from the rest pose and writes the animated components over it. The cursor
+// of a channel is the key it found last time: playback moves forward by a
+// key or two per frame, so finding the next one is a short forward walk
+// from there instead of a binary search. Only a jump further than
+// GFX_ANIM_MAX_WALK keys searches, a loop back to the start walks from key 0.
+// A skeleton may sample compressed copies of its clips instead, see
+// gfx_anim_compress.h.
+//
+// The palette is built 4 joints at a time from the pose with SSE2, local
+// matrices first, then one forward walk for the hierarchy and the inverse
+// binds. gfx_anim_update() spreads the characters over the job system.
+// gfx_skin_vertices() blends 4 palette matrices per vertex into positions
+// and normals. Both have a scalar reference version.
+//
+
+#define GFX_ANIM_MAX_WALK 4 // Keys walked forward before searching instead.
+
+struct Gfx_Compressed_Clip;
+
+struct Gfx_Skin {
+    int joint_count = 0;
+    s32 *joints = NULL;             // Scene node of every joint, -1 if unreachable.
+    glm::mat4 *inverse_bind = NULL; // Identity when the file has none.
+};
+
+enum Gfx_Anim_Path {
+    GFX_ANIM_TRANSLATION,
+    GFX_ANIM_ROTATION,
+    GFX_ANIM_SCALE,
+
+    GFX_ANIM_PATH_COUNT,
+};
+
+enum Gfx_Anim_Interpolation {
+    GFX_ANIM_STEP,
+    GFX_ANIM_LINEAR,
+
+    GFX_ANIM_INTERPOLATION_COUNT,
+};
+
+struct Gfx_Anim_Channel {
+    s32 node = -1; // In the scene of the model.
+    Gfx_Anim_Path path = GFX_ANIM_TRANSLATION;
+    Gfx_Anim_Interpolation interpolation = GFX_ANIM_LINEAR;
+
+    int key_count = 0;
+    f32 *times  = NULL; // Ascending, in seconds.
+    f32 *values = NULL; // 3 per key, 4 for rotations (x, y, z, w).
+};
+
+struct Gfx_Clip {
+    char name[64] = {};
+    f32 duration = 0.0f; // Last key time.
+
+    int channel_count = 0;
+    Gfx_Anim_Channel *channels = NULL;
+};
+
+inline int gfx_anim_path_components(Gfx_Anim_Path path) {
+    return path == GFX_ANIM_ROTATION ? 4 : 3;
+}
+
+const char *gfx_anim_path_name(Gfx_Anim_Path path);
+
+// Key k with times[k] <= time < times[k + 1], for times[0] <= time <
+// times[key_count - 1]. Walks forward from the cursor and updates it, counts
+// a search when the walk gives up. T is f32 or the u16 of compressed clips.
+template<typename T>
+int gfx_anim_find_key(const T *times, int key_count, f32 time, u32 *cursor, u32 *searches) {
+    int last = key_count - 2; // Last segment.
+
+    int k = cast(int)*cursor < last ? cast(int)*cursor : last;
+    if (time < times[k]) k = 0; // Looped back.
+
+    for (int walked = 0; k < last && time >= times[k + 1]; walked++) {
+        if (walked == GFX_ANIM_MAX_WALK) {
+            // Last key in [0, last] at or before time.
+            int low = 0, high = last;
+            while (low < high) {
+                int middle = (low + high + 1) / 2;
+                if (times[middle] <= time) low = middle;
+                else                       high = middle - 1;
+            }
+            k = low;
+            (*searches)++;
+            break;
+        }
+        k++;
+    }
+
+    *cursor = cast(u32)k;
+    return k;
+}
+
+// Lerps a and b of path into value, nlerp along the shorter arc for
+// rotations. value may not alias a or b.
+void gfx_anim_interpolate(Gfx_Anim_Path path, const f32 *a, const f32 *b, f32 t, f32 *value);
+
+// Samples channel at time into value, 3 or 4 floats. cursor is the key found
+// last time, see above.
+void gfx_anim_channel_sample(const Gfx_Anim_Channel *channel, f32 time, u32 *cursor, u32 *searches, f32 *value);
+
+// Arrays of a pose, each Gfx_Skeleton::stride floats long.
+enum Gfx_Pose_Component {
+    GFX_POSE_TX, GFX_POSE_TY, GFX_POSE_TZ,
+    GFX_POSE_QX, GFX_POSE_QY, GFX_POSE_QZ, GFX_POSE_QW,
+    GFX_POSE_SX, GFX_POSE_SY, GFX_POSE_SZ,
+
+    GFX_POSE_COMPONENT_COUNT,
+};
+
+struct Gfx_Skeleton {
+    int joint_count = 0;
+    int stride = 0; // joint_count rounded up to 4, the padding is identity.
+
+    // Per joint, in scene order.
+    s32 *parent     = NULL; // Joint index, -1 for roots.
+    s32 *skin_joint = NULL; // Index in the skin, and in the palette.
+    u8  *has_offset = NULL;
+    // Rest transform of the nodes between the parent joint and the joint, of
+    // the nodes above a root joint for roots.
+    glm::mat4 *offset       = NULL;
+    glm::mat4 *inverse_bind = NULL;
+
+    f32 *rest = NULL; // GFX_POSE_COMPONENT_COUNT arrays.
+
+    // The joint every channel of a clip drives, -1 for other nodes.
+    int clip_count = 0;
+    const Gfx_Clip *clips = NULL; // Borrowed.
+    s32 **channel_joints = NULL;
+
+    // Optional, one per clip with a track per channel, sampled instead of the
+    // clips when set. Borrowed.
+    const Gfx_Compressed_Clip *compressed = NULL;
+
+    Arena storage;
+};
+
+struct Gfx_Anim_Character {
+    const Gfx_Skeleton *skeleton = NULL;
+    int clip = -1;
+
+    f32 time  = 0.0f;
+    f32 speed = 1.0f;
+    bool loop = true;
+
+    u32 *cursors = NULL; // Per channel of the clip.
+    u32 searches = 0;    // Binary searches, a cursor miss each.
+
+    f32 *pose = NULL;          // GFX_POSE_COMPONENT_COUNT arrays.
+    glm::mat4 *local   = NULL; // Scratch of the palette, stride matrices.
+    glm::mat4 *world   = NULL; // Model space, per joint.
+    glm::mat4 *palette = NULL; // world * inverse bind, in skin order.
+
+    Arena storage;
+};
+
+// Source streams of a skinned mesh, see gfx_mesh_skin_source().
+struct Gfx_Skin_Source {
+    int vertex_count = 0;
+    const f32 *positions = NULL; // float3.
+    const f32 *normals   = NULL; // float3, optional.
+    const u16 *joints    = NULL; // 4 per vertex, into the palette.
+    const f32 *weights   = NULL; // 4 per vertex, summing to 1.
+};
+
+// scene must be up to date, the rest pose comes from it. The clips are
+// borrowed and must outlive the skeleton. Returns false on allocation
+// failure or when a joint is not in the scene.
+bool gfx_skeleton_build(Gfx_Skeleton *skeleton, const Gfx_Scene *scene, const Gfx_Skin *skin, const Gfx_Clip *clips, int clip_count);
+void gfx_skeleton_free(Gfx_Skeleton *skeleton);
+
+// Starts clip at time 0, -1 holds the rest pose. Returns false on allocation
+// failure.
+bool gfx_anim_character_init(Gfx_Anim_Character *character, const Gfx_Skeleton *skeleton, int clip);
+void gfx_anim_character_free(Gfx_Anim_Character *character);
+
+void gfx_anim_character_set_clip(Gfx_Anim_Character *character, int clip);
+
+// Moves the time by seconds * speed, looping or clamping it to the clip.
+void gfx_anim_advance(Gfx_Anim_Character *character, f32 seconds);
+
+// Samples the clip at the current time into the pose.
+void gfx_anim_sample(Gfx_Anim_Character *character);
+
+// Computes world and palette from the pose.
+void gfx_anim_compute_palette(Gfx_Anim_Character *character);
+
+// Reference version of gfx_anim_compute_palette() without SIMD.
+void gfx_anim_compute_palette_scalar(Gfx_Anim_Character *character);
+
+// Advances, samples and computes the palette of every character, spread
+// over jobs, serially when jobs is NULL.
+void gfx_anim_update(Gfx_Anim_Character *characters, int count, f32 seconds, Job_System *jobs);
+
+// Skins the vertices [begin, end) of source with palette into float3
+// positions and normals, indexed like the source. normals may be NULL, it is
+// ignored when the source has none. Normals are transformed by the blended
+// matrix and renormalized, which is exact for uniform scale.
+void gfx_skin_vertices(const Gfx_Skin_Source *source, const glm::mat4 *palette, int begin, int end, f32 *positions, f32 *normals);
+
+// Reference version of gfx_skin_vertices() without SIMD.
+void gfx_skin_vertices_scalar(const Gfx_Skin_Source *source, const glm::mat4 *palette, int begin, int end, f32 *positions, f32 *normals);
@@ -0,0 +1,444 @@
+#include "gfx_anim_compress.h"
+
+#include <SDL3/SDL.h>
+
+#define ROTATION_QUANTIZED_MAX 32767.0f // 15 bits per component.
+#define VECTOR_QUANTIZED_MAX   65535.0f // 16 bits per component.
+
+static f32 path_tolerance(const Gfx_Clip_Compress_Settings *settings, Gfx_Anim_Path path) {
+    switch (path) {
+        case GFX_ANIM_TRANSLATION: return settings->translation_error;
+        case GFX_ANIM_ROTATION:    return settings->rotation_error;
+        case GFX_ANIM_SCALE:       return settings->scale_error;
+        case GFX_ANIM_PATH_COUNT:  break;
+    }
+    return 0.0f;
+}
+
+f32 gfx_anim_value_error(Gfx_Anim_Path path, const f32 *value, const f32 *reference) {
+    if (path == GFX_ANIM_ROTATION) {
+        // The angle between the rotations from the chord between the
+        // quaternions, |a - b| = 2 sin(angle / 4), on the same hemisphere. The
+        // arc cosine of the dot product is too coarse near 1 in floats.
+        f32 dot = 0.0f;
+        for (int c = 0; c < 4; c++) dot += value[c] * reference[c];
+        f32 sign = dot < 0.0f ? -1.0f : 1.0f;
+        f32 chord2 = 0.0f;
+        for (int c = 0; c < 4; c++) chord2 += (value[c] - sign * reference[c]) * (value[c] - sign * reference[c]);
+        return 4.0f * SDL_asinf(SDL_min(0.5f * SDL_sqrtf(chord2), 1.0f));
+    }
+
+    f32 distance2 = 0.0f, largest = 0.0f;
+    for (int c = 0; c < 3; c++) {
+        f32 difference = SDL_fabsf(value[c] - reference[c]);
+        distance2 += difference * difference;
+        largest = SDL_max(largest, difference);
+    }
+    return path == GFX_ANIM_TRANSLATION ? SDL_sqrtf(distance2) : largest;
+}
+
+//
+// Keyframe reduction.
+//
+
+// Whether interpolating keys a and b stays within tolerance at every key
+// between them. Linear curves are furthest apart at the keys, but nlerp
+// does not move at a constant rate, so rotations are checked halfway
+// between the keys too.
+static bool segment_fits(const Gfx_Anim_Channel *channel, int a, int b, f32 tolerance) {
+    int components = gfx_anim_path_components(channel->path);
+    const f32 *first = channel->values + a * components;
+    const f32 *last  = channel->values + b * components;
+    f32 span = channel->times[b] - channel->times[a];
+    int halves = channel->path == GFX_ANIM_ROTATION ? 2 : 1;
+
+    for (int k = a; k < b; k++) {
+        for (int half = 0; half < halves; half++) {
+            if (k == a && half == 0) continue;
+
+            const f32 *key = channel->values + k * components;
+            f32 time = channel->times[k];
+            f32 expected[4];
+            if (half) {
+                time = 0.5f * (time + channel->times[k + 1]);
+                gfx_anim_interpolate(channel->path, key, key + components, 0.5f, expected);
+            } else {
+                SDL_memcpy(expected, key, cast(usize)components * sizeof(f32));
+            }
+
+            f32 t = span > 0.0f ? (time - channel->times[a]) / span : 0.0f;
+            f32 value[4];
+            gfx_anim_interpolate(channel->path, first, last, t, value);
+            if (gfx_anim_value_error(channel->path, value, expected) > tolerance) return false;
+        }
+    }
+    return true;
+}
+
+// Flags the keys of channel to keep, returns how many.
+static int reduce_keys(const Gfx_Anim_Channel *channel, f32 tolerance, u8 *keep) {
+    int key_count = channel->key_count;
+    if (key_count == 0) return 0;
+
+    int components = gfx_anim_path_components(channel->path);
+    const f32 *values = channel->values;
+    SDL_memset(keep, 0, cast(usize)key_count);
+    keep[0] = 1;
+
+    bool constant = true;
+    for (int k = 1; k < key_count && constant; k++) {
+        constant = gfx_anim_value_error(channel->path, values + k * components, values) <= tolerance;
+    }
+    if (constant) return 1;
+
+    int count = 1;
+    if (channel->interpolation == GFX_ANIM_STEP) {
+        // Held until the next kept key, so only changes matter.
+        int held = 0;
+        for (int k = 1; k < key_count; k++) {
+            if (gfx_anim_value_error(channel->path, values + k * components, values + held * components) <= tolerance) continue;
+            keep[k] = 1;
+            held = k;
+            count++;
+        }
+        return count;
+    }
+
+    // Greedy: extend every segment as far as it fits. The last key is
+    // always kept.
+    for (int a = 0; a < key_count - 1;) {
+        int b = a + 1;
+        while (b + 1 < key_count && segment_fits(channel, a, b + 1, tolerance)) b++;
+        keep[b] = 1;
+        count++;
+        a = b;
+    }
+    return count;
+}
+
+//
+// Quantization.
+//
+
+static u16 quantize(f32 value, f32 min, f32 step, f32 max) {
+    if (step <= 0.0f) return 0;
+    f32 q = (value - min) / step + 0.5f;
+    return cast(u16)SDL_clamp(q, 0.0f, max);
+}
+
+// Smallest three of a unit quaternion: the index of the largest component
+// and the other three in order, negated if that made the largest positive.
+static int smallest_three(const f32 *q, f32 *rest) {
+    int largest = 0;
+    for (int c = 1; c < 4; c++) {
+        if (SDL_fabsf(q[c]) > SDL_fabsf(q[largest])) largest = c;
+    }
+    f32 sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+    for (int c = 0, slot = 0; c < 4; c++) {
+        if (c != largest) rest[slot++] = sign * q[c];
+    }
+    return largest;
+}
+
+// The value of key, or of its smallest three for rotations, normalized.
+static void key_components(const Gfx_Anim_Channel *channel, int key, f32 *out, int *largest) {
+    const f32 *value = channel->values + key * gfx_anim_path_components(channel->path);
+    if (channel->path != GFX_ANIM_ROTATION) {
+        for (int c = 0; c < 3; c++) out[c] = value[c];
+        return;
+    }
+
+    f32 length2 = value[0] * value[0] + value[1] * value[1] + value[2] * value[2] + value[3] * value[3];
+    f32 scale = length2 > 0.0f ? 1.0f / SDL_sqrtf(length2) : 0.0f;
+    f32 q[4] = {value[0] * scale, value[1] * scale, value[2] * scale, value[3] * scale};
+    if (length2 <= 0.0f) q[3] = 1.0f;
+    *largest = smallest_three(q, out);
+}
+
+// The rate of the frame grid every key time of clip is on, 0 when they are
+// not on one. The shortest gap between keys is one frame or a few.
+static f32 frame_rate(const Gfx_Clip *clip, f32 duration) {
+    f32 shortest = duration;
+    for (int i = 0; i < clip->channel_count; i++) {
+        const Gfx_Anim_Channel *channel = &clip->channels[i];
+        for (int k = 0; k + 1 < channel->key_count; k++) {
+            f32 gap = channel->times[k + 1] - channel->times[k];
+            if (gap > 0.0f) shortest = SDL_min(shortest, gap);
+        }
+    }
+    if (shortest <= 0.0f) return 0.0f;
+
+    // Rates like 23.976 are kept, float noise in the gap is not.
+    f32 rate = SDL_roundf(1000.0f / shortest) / 1000.0f;
+    if (rate <= 0.0f || SDL_roundf(duration * rate) > GFX_CLIP_TIME_MAX) return 0.0f;
+    for (int i = 0; i < clip->channel_count; i++) {
+        const Gfx_Anim_Channel *channel = &clip->channels[i];
+        for (int k = 0; k < channel->key_count; k++) {
+            f32 frame = channel->times[k] * rate;
+            if (SDL_fabsf(frame - SDL_roundf(frame)) > 0.01f) return 0.0f;
+        }
+    }
+    return rate;
+}
+
+// Bound on the error quantization adds to a key: half a step per component,
+// with the steps from the range of all keys, which the kept ones stay
+// within. For rotations, the largest component is rebuilt from the others;
+// being at least 1/2, it moves at most 3 times as much as they do.
+static f32 quantization_error(const Gfx_Anim_Channel *channel) {
+    if (channel->key_count == 0) return 0.0f;
+    bool rotation = channel->path == GFX_ANIM_ROTATION;
+    f32 max = rotation ? ROTATION_QUANTIZED_MAX : VECTOR_QUANTIZED_MAX;
+
+    f32 low[3], high[3];
+    int largest = 0;
+    key_components(channel, 0, low, &largest);
+    SDL_memcpy(high, low, sizeof(high));
+    for (int k = 1; k < channel->key_count; k++) {
+        f32 components[3];
+        key_components(channel, k, components, &largest);
+        for (int c = 0; c < 3; c++) {
+            low[c]  = SDL_min(low[c], components[c]);
+            high[c] = SDL_max(high[c], components[c]);
+        }
+    }
+
+    f32 half[3], distance2 = 0.0f, widest = 0.0f;
+    for (int c = 0; c < 3; c++) {
+        half[c] = 0.5f * (high[c] - low[c]) / max;
+        distance2 += half[c] * half[c];
+        widest = SDL_max(widest, half[c]);
+    }
+
+    switch (channel->path) {
+        case GFX_ANIM_TRANSLATION: return SDL_sqrtf(distance2);
+        case GFX_ANIM_SCALE:       return widest;
+        default: {
+            // Three components off by widest and the largest by 3 times that,
+            // as an angle like gfx_anim_value_error().
+            f32 chord = SDL_sqrtf(12.0f) * widest;
+            return 4.0f * SDL_asinf(SDL_min(0.5f * chord, 1.0f));
+        }
+    }
+}
+
+static void encode_track(Gfx_Compressed_Track *track, const Gfx_Anim_Channel *channel, const u8 *keep, f32 time_scale,
+                         bool frames, u16 *times, u16 *values) {
+    bool rotation = channel->path == GFX_ANIM_ROTATION;
+    f32 max = rotation ? ROTATION_QUANTIZED_MAX : VECTOR_QUANTIZED_MAX;
+
+    // The first key is always kept.
+    f32 low[3], high[3];
+    int largest = 0;
+    key_components(channel, 0, low, &largest);
+    SDL_memcpy(high, low, sizeof(high));
+    for (int k = 1; k < channel->key_count; k++) {
+        if (!keep[k]) continue;
+        f32 components[3];
+        key_components(channel, k, components, &largest);
+        for (int c = 0; c < 3; c++) {
+            low[c]  = SDL_min(low[c], components[c]);
+            high[c] = SDL_max(high[c], components[c]);
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        track->min[c]  = low[c];
+        track->step[c] = (high[c] - low[c]) / max;
+    }
+
+    int kept = 0;
+    for (int k = 0; k < channel->key_count; k++) {
+        if (!keep[k]) continue;
+
+        // Off the grid rounded down, so a step key switches at or before its
+        // raw time.
+        f32 time = frames ? SDL_roundf(channel->times[k] * time_scale) : SDL_floorf(channel->times[k] * time_scale);
+        times[kept] = cast(u16)SDL_clamp(time, 0.0f, GFX_CLIP_TIME_MAX);
+
+        f32 components[3];
+        key_components(channel, k, components, &largest);
+        u16 q[3];
+        for (int c = 0; c < 3; c++) q[c] = quantize(components[c], track->min[c], track->step[c], max);
+
+        u16 *value = values + kept * 3;
+        if (rotation) {
+            u64 bits = cast(u64)largest | cast(u64)q[0] << 2 | cast(u64)q[1] << 17 | cast(u64)q[2] << 32;
+            value[0] = cast(u16)bits;
+            value[1] = cast(u16)(bits >> 16);
+            value[2] = cast(u16)(bits >> 32);
+        } else {
+            for (int c = 0; c < 3; c++) value[c] = q[c];
+        }
+        kept++;
+    }
+}
+
+static void decode_key(const Gfx_Compressed_Track *track, const u16 *key, f32 *value) {
+    if (track->path != GFX_ANIM_ROTATION) {
+        for (int c = 0; c < 3; c++) value[c] = track->min[c] + cast(f32)key[c] * track->step[c];
+        return;
+    }
+
+    u64 bits = cast(u64)key[0] | cast(u64)key[1] << 16 | cast(u64)key[2] << 32;
+    int largest = cast(int)(bits & 3);
+    f32 sum = 0.0f;
+    for (int c = 0, slot = 0; c < 4; c++) {
+        if (c == largest) continue;
+        u32 q = cast(u32)(bits >> (2 + 15 * slot)) & 0x7fff;
+        value[c] = track->min[slot] + cast(f32)q * track->step[slot];
+        sum += value[c] * value[c];
+        slot++;
+    }
+    value[largest] = SDL_sqrtf(SDL_max(1.0f - sum, 0.0f));
+}
+
+//
+// Clips.
+//
+
+// Tracks first, then the times and values of every track. Offsets are taken
+// from `used`, so they come out the same when measuring.
+static void layout_clip(Gfx_Compressed_Clip *out, const Gfx_Clip *clip, const int *kept_counts, Arena *storage) {
+    auto tracks = cast(Gfx_Compressed_Track *)arena_push(storage, cast(usize)clip->channel_count * sizeof(Gfx_Compressed_Track));
+    out->tracks = tracks;
+
+    for (int i = 0; i < clip->channel_count; i++) {
+        usize time_bytes  = cast(usize)kept_counts[i] * sizeof(u16);
+        usize value_bytes = cast(usize)kept_counts[i] * 3 * sizeof(u16);
+        arena_push(storage, time_bytes, alignof(u16));
+        u32 times = cast(u32)(storage->used - time_bytes);
+        arena_push(storage, value_bytes, alignof(u16));
+        u32 values = cast(u32)(storage->used - value_bytes);
+
+        if (tracks) {
+            tracks[i] = {};
+            tracks[i].key_count = cast(u32)kept_counts[i];
+            tracks[i].times     = times;
+            tracks[i].values    = values;
+        }
+    }
+}
+
+bool gfx_clip_compress(Gfx_Compressed_Clip *out, const Gfx_Clip *clip, const Gfx_Clip_Compress_Settings *settings,
+                       Gfx_Clip_Compress_Report *report) {
+    *out = {};
+    Gfx_Clip_Compress_Settings defaults;
+    if (!settings) settings = &defaults;
+
+    int channel_count = clip->channel_count;
+    usize raw_keys = 0;
+    f32 duration = clip->duration;
+    for (int i = 0; i < channel_count; i++) {
+        const Gfx_Anim_Channel *channel = &clip->channels[i];
+        raw_keys += cast(usize)channel->key_count;
+        if (channel->key_count > 0) duration = SDL_max(duration, channel->times[channel->key_count - 1]);
+    }
+
+    // Flags of the kept keys, all channels back to back, and the kept count
+    // of each channel.
+    auto kept_counts = cast(int *)SDL_malloc(cast(usize)SDL_max(channel_count, 1) * sizeof(int) + SDL_max(raw_keys, cast(usize)1));
+    if (!kept_counts) return false;
+    defer { SDL_free(kept_counts); };
+    auto keep = cast(u8 *)(kept_counts + SDL_max(channel_count, 1));
+
+    Gfx_Clip_Compress_Report result;
+    u8 *channel_keep = keep;
+    for (int i = 0; i < channel_count; i++) {
+        const Gfx_Anim_Channel *channel = &clip->channels[i];
+        // The quantization error comes on top of the reduction, its bound is
+        // kept out of the tolerance.
+        f32 tolerance = SDL_max(path_tolerance(settings, channel->path) - quantization_error(channel), 0.0f);
+        kept_counts[i] = reduce_keys(channel, tolerance, channel_keep);
+        channel_keep += channel->key_count;
+
+        result.raw_bytes += cast(usize)channel->key_count * cast(usize)(1 + gfx_anim_path_components(channel->path)) * sizeof(f32);
+        result.raw_keys  += cast(u64)channel->key_count;
+        result.kept_keys += cast(u64)kept_counts[i];
+    }
+
+    Arena measure{};
+    layout_clip(out, clip, kept_counts, &measure);
+    if (!arena_init(&out->storage, SDL_max(measure.used, cast(usize)1))) {
+        *out = {};
+        return false;
+    }
+    layout_clip(out, clip, kept_counts, &out->storage);
+
+    SDL_strlcpy(out->name, clip->name, sizeof(out->name));
+    out->duration    = duration;
+    f32 rate = frame_rate(clip, duration);
+    out->time_scale  = rate > 0.0f ? rate : duration > 0.0f ? GFX_CLIP_TIME_MAX / duration : 0.0f;
+    out->track_count = channel_count;
+
+    auto tracks = cast(Gfx_Compressed_Track *)out->storage.base;
+    channel_keep = keep;
+    for (int i = 0; i < channel_count; i++) {
+        const Gfx_Anim_Channel *channel = &clip->channels[i];
+        Gfx_Compressed_Track *track = &tracks[i];
+        track->node          = channel->node;
+        track->path          = cast(u8)channel->path;
+        track->interpolation = cast(u8)channel->interpolation;
+        encode_track(track, channel, channel_keep, out->time_scale, rate > 0.0f, cast(u16 *)(out->storage.base + track->times),
+                     cast(u16 *)(out->storage.base + track->values));
+        channel_keep += channel->key_count;
+    }
+    result.compressed_bytes = out->storage.used;
+
+    // Error against the raw clip at its keys and halfway between them.
+    for (int i = 0; i < channel_count; i++) {
+        const Gfx_Anim_Channel *channel = &clip->channels[i];
+        u32 raw_cursor = 0, cursor = 0, searches = 0;
+        f32 *max_error = &result.max_error[channel->path];
+        for (int k = 0; k < channel->key_count; k++) {
+            for (int half = 0; half < 2; half++) {
+                if (half && k + 1 == channel->key_count) break;
+                f32 time = half ? 0.5f * (channel->times[k] + channel->times[k + 1]) : channel->times[k];
+
+                f32 raw[4], value[4];
+                gfx_anim_channel_sample(channel, time, &raw_cursor, &searches, raw);
+                gfx_compressed_clip_sample(out, i, time, &cursor, &searches, value);
+                *max_error = SDL_max(*max_error, gfx_anim_value_error(channel->path, value, raw));
+            }
+        }
+    }
+
+    if (report) *report = result;
+    return true;
+}
+
+void gfx_compressed_clip_free(Gfx_Compressed_Clip *clip) {
+    arena_release(&clip->storage);
+    *clip = {};
+}
+
+void gfx_compressed_clip_sample(const Gfx_Compressed_Clip *clip, int track_index, f32 time, u32 *cursor, u32 *searches, f32 *value) {
+    const Gfx_Compressed_Track *track = &clip->tracks[track_index];
+    const u16 *times  = cast(const u16 *)(clip->storage.base + track->times);
+    const u16 *values = cast(const u16 *)(clip->storage.base + track->values);
+    Gfx_Anim_Path path = cast(Gfx_Anim_Path)track->path;
+
+    f32 key_time = time * clip->time_scale;
+    int last_key = cast(int)track->key_count - 1;
+
+    // Key and blend factor toward the next key, as for raw channels.
+    int k = 0;
+    f32 t = 0.0f;
+    if (key_time >= times[last_key]) {
+        k = last_key;
+    } else if (key_time > times[0]) {
+        k = gfx_anim_find_key(times, cast(int)track->key_count, key_time, cursor, searches);
+        if (track->interpolation == GFX_ANIM_LINEAR) {
+            f32 span = cast(f32)(times[k + 1] - times[k]);
+            t = span > 0.0f ? (key_time - times[k]) / span : 0.0f;
+        }
+    }
+
+    if (t <= 0.0f) {
+        decode_key(track, values + k * 3, value);
+        return;
+    }
+    f32 a[4], b[4];
+    decode_key(track, values + k * 3, a);
+    decode_key(track, values + (k + 1) * 3, b);
+    gfx_anim_interpolate(path, a, b, t, value);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "defines.h"
+#include "arena.h"
+#include "gfx_anim.h"
+
+//
+// Compressed animation clips.
+//
+// gfx_clip_compress() turns a Gfx_Clip, the floats the glTF accessors unpack
+// to, into one contiguous block a skeleton samples directly:
+//
+//   - Keyframe reduction. Keys are dropped greedily as long as interpolating
+//     their neighbours stays within the tolerance of the path at every
+//     dropped key. Step tracks keep a key only where the value changes, and
+//     a track that never leaves the tolerance of its first key keeps only
+//     that key.
+//   - Range normalization. Every track stores the minimum and the extent of
+//     each component over its kept keys, the keys are fractions of that.
+//   - Quantization. Translations and scales are 3 x 16 bits per key.
+//     Rotations are 48 bits "smallest three": the index of the largest
+//     component in 2 bits, made positive so it can be rebuilt from the
+//     others, which are 15 bits each.
+//   - Key times are 16 bits. When every key of the clip is on a frame grid,
+//     as exporters that bake at a frame rate write them, they are frame
+//     numbers and exact. Otherwise they are fractions of the clip duration,
+//     a resolution of duration / 65535: about 1 ms for a minute long clip,
+//     which moves fast motion noticeably.
+//
+// The block holds the tracks, then their times and values, addressed by byte
+// offsets from its start, so it can be copied or written to disk as is.
+// Sampling finds keys with the same cursors as the raw clips, decodes the
+// two keys around the time and interpolates them, so playback is unchanged
+// apart from the error. The reduction keeps within the tolerance less a bound
+// on the quantization error of the track, so the total stays within the
+// tolerance; gfx_clip_compress() measures it in joint space against the raw
+// clip and reports it. Key times off a frame grid add their own error, which
+// the tolerance does not cover.
+//
+
+#define GFX_CLIP_TIME_MAX 65535.0f // Largest key time.
+
+struct Gfx_Compressed_Track {
+    s32 node = -1;
+    u8 path          = GFX_ANIM_TRANSLATION; // Gfx_Anim_Path.
+    u8 interpolation = GFX_ANIM_LINEAR;      // Gfx_Anim_Interpolation.
+    u32 key_count = 0;
+    u32 times  = 0; // Byte offset of key_count u16 times.
+    u32 values = 0; // Byte offset of key_count * 3 u16 values.
+
+    // value = min + quantized * step, per component. For rotations, per
+    // component left after dropping the largest one.
+    f32 min[3]  = {};
+    f32 step[3] = {};
+};
+
+struct Gfx_Compressed_Clip {
+    char name[64] = {};
+    f32 duration   = 0.0f;
+    f32 time_scale = 0.0f; // Seconds to key times: the frame rate, or GFX_CLIP_TIME_MAX / duration.
+
+    int track_count = 0;                       // One per channel of the clip.
+    const Gfx_Compressed_Track *tracks = NULL; // Start of the block.
+
+    Arena storage; // The block, storage.used bytes.
+};
+
+// Largest error to allow against the raw clip at its keys, per path, from
+// dropping keys and quantization together.
+struct Gfx_Clip_Compress_Settings {
+    f32 translation_error = 0.0005f; // Distance, in the units of the model.
+    f32 rotation_error    = 0.0005f; // Angle, in radians.
+    f32 scale_error       = 0.0005f; // Per component.
+};
+
+struct Gfx_Clip_Compress_Report {
+    usize raw_bytes        = 0; // Times and values of the raw clip.
+    usize compressed_bytes = 0; // The whole block.
+    u64 raw_keys  = 0;
+    u64 kept_keys = 0;
+
+    // Largest difference to the raw clip, sampled at the raw keys and
+    // halfway between them, in the units of the settings.
+    f32 max_error[GFX_ANIM_PATH_COUNT] = {};
+};
+
+// settings may be NULL for the defaults, report may be NULL. Returns false
+// on allocation failure.
+bool gfx_clip_compress(Gfx_Compressed_Clip *out, const Gfx_Clip *clip, const Gfx_Clip_Compress_Settings *settings,
+                       Gfx_Clip_Compress_Report *report);
+void gfx_compressed_clip_free(Gfx_Compressed_Clip *clip);
+
+// Error of a path value against reference, in the units of the settings:
+// the distance between translations, the angle between rotations and the
+// largest difference of a scale component.
+f32 gfx_anim_value_error(Gfx_Anim_Path path, const f32 *value, const f32 *reference);
+
+// Samples track at time into value, 3 or 4 floats, like
+// gfx_anim_channel_sample(). The track must have keys.
+void gfx_compressed_clip_sample(const Gfx_Compressed_Clip *clip, int track, f32 time, u32 *cursor, u32 *searches, f32 *value);
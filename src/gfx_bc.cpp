@@ -0,0 +1,605 @@
+#include "gfx_bc.h"
+
+#include <SDL3/SDL.h>
+
+// Blocks per job, rows of blocks are batched up to this.
+#define JOB_BLOCKS 512
+
+// Endpoint refits after the first fit.
+#define REFIT_COUNT 2
+
+//
+// Endpoint fitting, on texels as floats in [0, 255].
+//
+
+template <typename T>
+static void exchange(T &a, T &b) {
+    T t = a;
+    a = b;
+    b = t;
+}
+
+static f32 clamp_255(f32 v) {
+    return SDL_clamp(v, 0.0f, 255.0f);
+}
+
+// Endpoints at both ends of the principal axis of the texels, over the first
+// channel_count channels.
+static void principal_endpoints(const f32 (*texels)[4], int channel_count, f32 *lo, f32 *hi) {
+    f32 mean[4] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < channel_count; c++) mean[c] += texels[i][c];
+    }
+    for (int c = 0; c < channel_count; c++) mean[c] /= 16.0f;
+
+    f32 covariance[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        f32 d[4];
+        for (int c = 0; c < channel_count; c++) d[c] = texels[i][c] - mean[c];
+        for (int a = 0; a < channel_count; a++) {
+            for (int b = 0; b < channel_count; b++) covariance[a][b] += d[a] * d[b];
+        }
+    }
+
+    // Power iteration, from the row of the channel that varies most.
+    int widest = 0;
+    for (int c = 1; c < channel_count; c++) {
+        if (covariance[c][c] > covariance[widest][widest]) widest = c;
+    }
+    f32 axis[4] = {};
+    for (int c = 0; c < channel_count; c++) axis[c] = covariance[widest][c];
+
+    for (int iteration = 0; iteration < 8; iteration++) {
+        f32 next[4] = {};
+        f32 largest = 0.0f;
+        for (int a = 0; a < channel_count; a++) {
+            for (int b = 0; b < channel_count; b++) next[a] += covariance[a][b] * axis[b];
+            largest = SDL_max(largest, SDL_fabsf(next[a]));
+        }
+        if (largest < 1e-6f) break;
+        for (int c = 0; c < channel_count; c++) axis[c] = next[c] / largest;
+    }
+
+    f32 length = 0.0f;
+    for (int c = 0; c < channel_count; c++) length += axis[c] * axis[c];
+    length = SDL_sqrtf(length);
+    if (length < 1e-6f) {
+        // Flat block.
+        for (int c = 0; c < channel_count; c++) lo[c] = hi[c] = mean[c];
+        return;
+    }
+    for (int c = 0; c < channel_count; c++) axis[c] /= length;
+
+    f32 t_min = 0.0f;
+    f32 t_max = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        f32 t = 0.0f;
+        for (int c = 0; c < channel_count; c++) t += (texels[i][c] - mean[c]) * axis[c];
+        t_min = SDL_min(t_min, t);
+        t_max = SDL_max(t_max, t);
+    }
+    for (int c = 0; c < channel_count; c++) {
+        lo[c] = clamp_255(mean[c] + axis[c] * t_min);
+        hi[c] = clamp_255(mean[c] + axis[c] * t_max);
+    }
+}
+
+// Endpoints e0 and e1 minimizing the squared error of every texel against
+// lerp(e0, e1, weights[i]). Returns false when the weights are all the same.
+static bool refit_endpoints(const f32 (*texels)[4], const f32 *weights, int channel_count, f32 *e0, f32 *e1) {
+    f32 aa = 0.0f;
+    f32 ab = 0.0f;
+    f32 bb = 0.0f;
+    f32 ax[4] = {};
+    f32 bx[4] = {};
+    for (int i = 0; i < 16; i++) {
+        f32 b = weights[i];
+        f32 a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < channel_count; c++) {
+            ax[c] += a * texels[i][c];
+            bx[c] += b * texels[i][c];
+        }
+    }
+
+    f32 det = aa * bb - ab * ab;
+    if (SDL_fabsf(det) < 1e-6f) return false;
+    for (int c = 0; c < channel_count; c++) {
+        e0[c] = clamp_255((bb * ax[c] - ab * bx[c]) / det);
+        e1[c] = clamp_255((aa * bx[c] - ab * ax[c]) / det);
+    }
+    return true;
+}
+
+//
+// BC1 color.
+//
+
+// Interpolation weight towards c1 of each index in four color mode.
+static const f32 BC1_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+static u16 pack_565(const f32 *color) {
+    int r = cast(int)(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = cast(int)(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = cast(int)(color[2] * 31.0f / 255.0f + 0.5f);
+    return cast(u16)((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(u16 value, int *color) {
+    int r = (value >> 11) & 31;
+    int g = (value >> 5) & 63;
+    int b = value & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Three color mode when c0 <= c1, with transparent black as index 3. BC3
+// color is always four color mode.
+static void bc1_palette(u16 c0, u16 c1, bool four_color, int (*palette)[4]) {
+    unpack_565(c0, palette[0]);
+    unpack_565(c1, palette[1]);
+    palette[0][3] = 255;
+    palette[1][3] = 255;
+    for (int c = 0; c < 3; c++) {
+        if (four_color || c0 > c1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = four_color || c0 > c1 ? 255 : 0;
+}
+
+// Nearest palette entry of every texel, 2 bits each. Returns the squared error.
+static f32 bc1_indices(const f32 (*texels)[4], u16 c0, u16 c1, u32 *indices) {
+    int palette[4][4];
+    bc1_palette(c0, c1, true, palette);
+    int entries = c0 == c1 ? 1 : 4;
+
+    *indices = 0;
+    f32 error = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        f32 best = 1e30f;
+        u32 best_index = 0;
+        for (int p = 0; p < entries; p++) {
+            f32 d = 0.0f;
+            for (int c = 0; c < 3; c++) {
+                f32 delta = texels[i][c] - cast(f32)palette[p][c];
+                d += delta * delta;
+            }
+            if (d < best) {
+                best = d;
+                best_index = cast(u32)p;
+            }
+        }
+        *indices |= best_index << (i * 2);
+        error += best;
+    }
+    return error;
+}
+
+// Always four color mode, c0 > c1 unless the block is flat.
+static void encode_bc1(const f32 (*texels)[4], u8 *block) {
+    f32 e0[4];
+    f32 e1[4];
+    principal_endpoints(texels, 3, e1, e0);
+
+    u16 best_c0 = 0;
+    u16 best_c1 = 0;
+    u32 best_indices = 0;
+    f32 best_error = 1e30f;
+    for (int iteration = 0; iteration <= REFIT_COUNT; iteration++) {
+        u16 c0 = pack_565(e0);
+        u16 c1 = pack_565(e1);
+        if (c0 < c1) {
+            exchange(c0, c1);
+            for (int c = 0; c < 3; c++) exchange(e0[c], e1[c]);
+        }
+
+        u32 indices = 0;
+        f32 error = bc1_indices(texels, c0, c1, &indices);
+        if (error < best_error) {
+            best_c0 = c0;
+            best_c1 = c1;
+            best_indices = indices;
+            best_error = error;
+        }
+        if (c0 == c1 || error == 0.0f) break;
+
+        f32 weights[16];
+        for (int i = 0; i < 16; i++) weights[i] = BC1_WEIGHTS[(indices >> (i * 2)) & 3];
+        if (!refit_endpoints(texels, weights, 3, e0, e1)) break;
+    }
+
+    block[0] = cast(u8)best_c0;
+    block[1] = cast(u8)(best_c0 >> 8);
+    block[2] = cast(u8)best_c1;
+    block[3] = cast(u8)(best_c1 >> 8);
+    for (int i = 0; i < 4; i++) block[4 + i] = cast(u8)(best_indices >> (i * 8));
+}
+
+static void decode_bc1(const u8 *block, bool four_color, u8 *texels) {
+    u16 c0 = cast(u16)(block[0] | (block[1] << 8));
+    u16 c1 = cast(u16)(block[2] | (block[3] << 8));
+    u32 indices = cast(u32)block[4] | (cast(u32)block[5] << 8) | (cast(u32)block[6] << 16) | (cast(u32)block[7] << 24);
+
+    int palette[4][4];
+    bc1_palette(c0, c1, four_color, palette);
+    for (int i = 0; i < 16; i++) {
+        const int *entry = palette[(indices >> (i * 2)) & 3];
+        for (int c = 0; c < 4; c++) texels[i * 4 + c] = cast(u8)entry[c];
+    }
+}
+
+//
+// BC4 alpha, the first half of BC3.
+//
+
+// Eight value mode when a0 > a1, the only one written.
+static void bc4_palette(int a0, int a1, int *palette) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i <= 6; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    } else {
+        for (int i = 1; i <= 4; i++) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static void encode_bc4(const f32 (*texels)[4], u8 *block) {
+    int a0 = 0;
+    int a1 = 255;
+    for (int i = 0; i < 16; i++) {
+        int a = cast(int)(texels[i][3] + 0.5f);
+        a0 = SDL_max(a0, a);
+        a1 = SDL_min(a1, a);
+    }
+
+    int palette[8];
+    bc4_palette(a0, a1, palette);
+    int entries = a0 == a1 ? 1 : 8;
+
+    u64 indices = 0;
+    for (int i = 0; i < 16; i++) {
+        f32 best = 1e30f;
+        u64 best_index = 0;
+        for (int p = 0; p < entries; p++) {
+            f32 d = SDL_fabsf(texels[i][3] - cast(f32)palette[p]);
+            if (d < best) {
+                best = d;
+                best_index = cast(u64)p;
+            }
+        }
+        indices |= best_index << (i * 3);
+    }
+
+    block[0] = cast(u8)a0;
+    block[1] = cast(u8)a1;
+    for (int i = 0; i < 6; i++) block[2 + i] = cast(u8)(indices >> (i * 8));
+}
+
+static void decode_bc4(const u8 *block, u8 *texels) {
+    int palette[8];
+    bc4_palette(block[0], block[1], palette);
+
+    u64 indices = 0;
+    for (int i = 0; i < 6; i++) indices |= cast(u64)block[2 + i] << (i * 8);
+    for (int i = 0; i < 16; i++) texels[i * 4 + 3] = cast(u8)palette[(indices >> (i * 3)) & 7];
+}
+
+//
+// BC7 mode 6.
+//
+
+static const int BC7_WEIGHTS_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct Bit_Stream {
+    u8 *data;
+    int position;
+};
+
+static void write_bits(Bit_Stream *stream, u32 value, int count) {
+    for (int i = 0; i < count; i++, stream->position++) {
+        if ((value >> i) & 1) stream->data[stream->position >> 3] |= cast(u8)(1 << (stream->position & 7));
+    }
+}
+
+static u32 read_bits(Bit_Stream *stream, int count) {
+    u32 value = 0;
+    for (int i = 0; i < count; i++, stream->position++) {
+        value |= cast(u32)((stream->data[stream->position >> 3] >> (stream->position & 7)) & 1) << i;
+    }
+    return value;
+}
+
+// Quantizes an endpoint to 7 bits per channel and picks the p-bit, shared by
+// the four channels, with the least error.
+static void bc7_quantize(const f32 *endpoint, int *quantized, int *p_bit) {
+    f32 best = 1e30f;
+    for (int p = 0; p < 2; p++) {
+        int q[4];
+        f32 error = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            q[c] = SDL_clamp(cast(int)((endpoint[c] - p) * 0.5f + 0.5f), 0, 127);
+            f32 d = cast(f32)((q[c] << 1) | p) - endpoint[c];
+            error += d * d;
+        }
+        if (error < best) {
+            best = error;
+            *p_bit = p;
+            SDL_memcpy(quantized, q, sizeof(q));
+        }
+    }
+}
+
+static void bc7_palette(const int *q0, int p0, const int *q1, int p1, int (*palette)[4]) {
+    for (int c = 0; c < 4; c++) {
+        int e0 = (q0[c] << 1) | p0;
+        int e1 = (q1[c] << 1) | p1;
+        for (int i = 0; i < 16; i++) palette[i][c] = ((64 - BC7_WEIGHTS_4[i]) * e0 + BC7_WEIGHTS_4[i] * e1 + 32) >> 6;
+    }
+}
+
+// The palette lies on a line, so the nearest entry is the one closest to the
+// projection of the texel, checked against its neighbors for rounding.
+static f32 bc7_indices(const f32 (*texels)[4], const int (*palette)[4], u8 *indices) {
+    f32 axis[4];
+    f32 length = 0.0f;
+    for (int c = 0; c < 4; c++) {
+        axis[c] = cast(f32)(palette[15][c] - palette[0][c]);
+        length += axis[c] * axis[c];
+    }
+
+    f32 error = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        int guess = 0;
+        if (length > 0.0f) {
+            f32 t = 0.0f;
+            for (int c = 0; c < 4; c++) t += (texels[i][c] - palette[0][c]) * axis[c];
+            guess = SDL_clamp(cast(int)(t / length * 15.0f + 0.5f), 0, 15);
+        }
+
+        f32 best = 1e30f;
+        for (int p = SDL_max(guess - 1, 0); p <= SDL_min(guess + 1, 15); p++) {
+            f32 d = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                f32 delta = texels[i][c] - cast(f32)palette[p][c];
+                d += delta * delta;
+            }
+            if (d < best) {
+                best = d;
+                indices[i] = cast(u8)p;
+            }
+        }
+        error += best;
+    }
+    return error;
+}
+
+static void encode_bc7(const f32 (*texels)[4], u8 *block) {
+    f32 e0[4];
+    f32 e1[4];
+    principal_endpoints(texels, 4, e0, e1);
+
+    int best_q[2][4] = {};
+    int best_p[2] = {};
+    u8 best_indices[16] = {};
+    f32 best_error = 1e30f;
+    for (int iteration = 0; iteration <= REFIT_COUNT; iteration++) {
+        int q[2][4];
+        int p[2];
+        bc7_quantize(e0, q[0], &p[0]);
+        bc7_quantize(e1, q[1], &p[1]);
+
+        int palette[16][4];
+        bc7_palette(q[0], p[0], q[1], p[1], palette);
+        u8 indices[16];
+        f32 error = bc7_indices(texels, palette, indices);
+        if (error < best_error) {
+            SDL_memcpy(best_q, q, sizeof(q));
+            SDL_memcpy(best_p, p, sizeof(p));
+            SDL_memcpy(best_indices, indices, sizeof(indices));
+            best_error = error;
+        }
+        if (error == 0.0f) break;
+
+        f32 weights[16];
+        for (int i = 0; i < 16; i++) weights[i] = BC7_WEIGHTS_4[indices[i]] / 64.0f;
+        if (!refit_endpoints(texels, weights, 4, e0, e1)) break;
+    }
+
+    // The top bit of the first index is implied 0, swap the endpoints when
+    // it would be set.
+    if (best_indices[0] & 8) {
+        for (int c = 0; c < 4; c++) exchange(best_q[0][c], best_q[1][c]);
+        exchange(best_p[0], best_p[1]);
+        for (int i = 0; i < 16; i++) best_indices[i] = cast(u8)(15 - best_indices[i]);
+    }
+
+    SDL_memset(block, 0, 16);
+    Bit_Stream stream = {block, 0};
+    write_bits(&stream, 1 << 6, 7); // Mode 6.
+    for (int c = 0; c < 4; c++) {
+        write_bits(&stream, cast(u32)best_q[0][c], 7);
+        write_bits(&stream, cast(u32)best_q[1][c], 7);
+    }
+    write_bits(&stream, cast(u32)best_p[0], 1);
+    write_bits(&stream, cast(u32)best_p[1], 1);
+    for (int i = 0; i < 16; i++) write_bits(&stream, best_indices[i], i == 0 ? 3 : 4);
+}
+
+static bool decode_bc7(const u8 *block, u8 *texels) {
+    if ((block[0] & 0x7f) != 0x40) return false;
+
+    Bit_Stream stream = {cast(u8 *)block, 7};
+    int q[2][4];
+    for (int c = 0; c < 4; c++) {
+        q[0][c] = cast(int)read_bits(&stream, 7);
+        q[1][c] = cast(int)read_bits(&stream, 7);
+    }
+    int p0 = cast(int)read_bits(&stream, 1);
+    int p1 = cast(int)read_bits(&stream, 1);
+
+    int palette[16][4];
+    bc7_palette(q[0], p0, q[1], p1, palette);
+    for (int i = 0; i < 16; i++) {
+        int index = cast(int)read_bits(&stream, i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; c++) texels[i * 4 + c] = cast(u8)palette[index][c];
+    }
+    return true;
+}
+
+//
+// Blocks.
+//
+
+u32 gfx_bc_block_size(Gfx_BC_Format format) {
+    return format == GFX_BC1 ? 8 : 16;
+}
+
+usize gfx_bc_size(Gfx_BC_Format format, int width, int height) {
+    usize blocks_x = cast(usize)(width + 3) / 4;
+    usize blocks_y = cast(usize)(height + 3) / 4;
+    return blocks_x * blocks_y * gfx_bc_block_size(format);
+}
+
+void gfx_bc_encode_block(Gfx_BC_Format format, const u8 *texels, u8 *block) {
+    f32 values[16][4];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) values[i][c] = texels[i * 4 + c];
+    }
+
+    switch (format) {
+        case GFX_BC1: {
+            encode_bc1(values, block);
+            break;
+        }
+        case GFX_BC3: {
+            encode_bc4(values, block);
+            encode_bc1(values, block + 8);
+            break;
+        }
+        case GFX_BC7: {
+            encode_bc7(values, block);
+            break;
+        }
+        default: ASSERT(false);
+    }
+}
+
+bool gfx_bc_decode_block(Gfx_BC_Format format, const u8 *block, u8 *texels) {
+    switch (format) {
+        case GFX_BC1: {
+            decode_bc1(block, false, texels);
+            return true;
+        }
+        case GFX_BC3: {
+            decode_bc1(block + 8, true, texels);
+            decode_bc4(block, texels);
+            return true;
+        }
+        case GFX_BC7: {
+            return decode_bc7(block, texels);
+        }
+        default: return false;
+    }
+}
+
+struct Encode_Work {
+    Gfx_BC_Format format;
+    const u8 *pixels;
+    int width;
+    int height;
+    u8 *blocks;
+};
+
+static void encode_rows(void *data, int begin, int end) {
+    auto work = cast(const Encode_Work *)data;
+    int blocks_x = (work->width + 3) / 4;
+    u32 block_size = gfx_bc_block_size(work->format);
+
+    for (int by = begin; by < end; by++) {
+        for (int bx = 0; bx < blocks_x; bx++) {
+            // Past the edge, the last row and column repeat.
+            u8 texels[16 * 4];
+            for (int y = 0; y < 4; y++) {
+                int sy = SDL_min(by * 4 + y, work->height - 1);
+                for (int x = 0; x < 4; x++) {
+                    int sx = SDL_min(bx * 4 + x, work->width - 1);
+                    SDL_memcpy(texels + (y * 4 + x) * 4, work->pixels + (cast(usize)sy * cast(usize)work->width + cast(usize)sx) * 4, 4);
+                }
+            }
+
+            u8 *block = work->blocks + (cast(usize)by * cast(usize)blocks_x + cast(usize)bx) * block_size;
+            gfx_bc_encode_block(work->format, texels, block);
+        }
+    }
+}
+
+void gfx_bc_encode(Gfx_BC_Format format, const u8 *pixels, int width, int height, u8 *blocks, Job_System *jobs) {
+    if (width <= 0 || height <= 0) return;
+
+    Encode_Work work = {format, pixels, width, height, blocks};
+    int blocks_x = (width + 3) / 4;
+    int blocks_y = (height + 3) / 4;
+    job_parallel_for(jobs, blocks_y, SDL_max(JOB_BLOCKS / blocks_x, 1), encode_rows, &work);
+}
+
+bool gfx_bc_decode(Gfx_BC_Format format, const u8 *blocks, int width, int height, u8 *pixels) {
+    int blocks_x = (width + 3) / 4;
+    int blocks_y = (height + 3) / 4;
+    u32 block_size = gfx_bc_block_size(format);
+
+    for (int by = 0; by < blocks_y; by++) {
+        for (int bx = 0; bx < blocks_x; bx++) {
+            u8 texels[16 * 4];
+            const u8 *block = blocks + (cast(usize)by * cast(usize)blocks_x + cast(usize)bx) * block_size;
+            if (!gfx_bc_decode_block(format, block, texels)) return false;
+
+            for (int y = 0; y < 4 && by * 4 + y < height; y++) {
+                int w = SDL_min(4, width - bx * 4);
+                usize offset = (cast(usize)(by * 4 + y) * cast(usize)width + cast(usize)bx * 4) * 4;
+                SDL_memcpy(pixels + offset, texels + y * 16, cast(usize)w * 4);
+            }
+        }
+    }
+    return true;
+}
+
+f64 gfx_bc_psnr(Gfx_BC_Format format, const u8 *pixels, const u8 *blocks, int width, int height) {
+    usize texel_count = cast(usize)width * cast(usize)height;
+    auto decoded = cast(u8 *)SDL_malloc(texel_count * 4);
+    if (!decoded) return 0.0;
+    defer { SDL_free(decoded); };
+    if (!gfx_bc_decode(format, blocks, width, height, decoded)) return 0.0;
+
+    int channel_count = format == GFX_BC1 ? 3 : 4;
+    f64 squared = 0.0;
+    for (usize i = 0; i < texel_count; i++) {
+        for (int c = 0; c < channel_count; c++) {
+            f64 d = cast(f64)pixels[i * 4 + c] - cast(f64)decoded[i * 4 + c];
+            squared += d * d;
+        }
+    }
+
+    f64 mse = squared / (cast(f64)texel_count * channel_count);
+    if (mse == 0.0) return 100.0;
+    return 10.0 * SDL_log10(255.0 * 255.0 / mse);
+}
+
+const char *gfx_bc_format_name(Gfx_BC_Format format) {
+    switch (format) {
+        case GFX_BC1: return "bc1";
+        case GFX_BC3: return "bc3";
+        case GFX_BC7: return "bc7";
+        default:      return "unknown";
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "defines.h"
+#include "job.h"
+
+//
+// Block compression of RGBA8 images.
+//
+// Every 4x4 block of texels is encoded on its own into a fixed number of
+// bytes, which the GPU samples directly:
+//
+//     BC1   8 bytes, 4 bpp. Two RGB565 endpoints and 2-bit indices. Opaque,
+//           alpha is dropped.
+//     BC3  16 bytes, 8 bpp. BC1 color plus BC4 alpha, two 8-bit endpoints
+//           and 3-bit indices.
+//     BC7  16 bytes, 8 bpp. Written in mode 6 only: one RGBA 7.7.7.7 endpoint
+//           pair with a p-bit each and 4-bit indices. Much better color than
+//           BC1/BC3, without the partition search of a full encoder.
+//
+// Endpoints start on the principal axis of the block and are refitted to
+// the chosen indices by least squares. Blocks past the edge of an image
+// repeat the edge texels. Rows of blocks are encoded as parallel jobs when
+// jobs is set.
+//
+// The decoders are the reference for the PSNR report, they handle the blocks
+// the encoder writes. BC7 blocks of modes other than 6 fail to decode.
+//
+
+enum Gfx_BC_Format {
+    GFX_BC1,
+    GFX_BC3,
+    GFX_BC7,
+
+    GFX_BC_FORMAT_COUNT,
+};
+
+// 8 or 16.
+u32 gfx_bc_block_size(Gfx_BC_Format format);
+
+// Bytes of the blocks covering a width * height image.
+usize gfx_bc_size(Gfx_BC_Format format, int width, int height);
+
+// A block from and to 16 RGBA8 texels, row by row.
+void gfx_bc_encode_block(Gfx_BC_Format format, const u8 *texels, u8 *block);
+bool gfx_bc_decode_block(Gfx_BC_Format format, const u8 *block, u8 *texels);
+
+// Whole images, blocks row by row. blocks holds gfx_bc_size() bytes.
+void gfx_bc_encode(Gfx_BC_Format format, const u8 *pixels, int width, int height, u8 *blocks, Job_System *jobs = NULL);
+bool gfx_bc_decode(Gfx_BC_Format format, const u8 *blocks, int width, int height, u8 *pixels);
+
+// Peak signal-to-noise ratio in dB of the encoded image against the source,
+// over the channels the format keeps (RGB for BC1). Returns 0 on failure, and
+// a large value when the images are identical.
+f64 gfx_bc_psnr(Gfx_BC_Format format, const u8 *pixels, const u8 *blocks, int width, int height);
+
+const char *gfx_bc_format_name(Gfx_BC_Format format);
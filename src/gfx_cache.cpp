@@ -0,0 +1,564 @@
+#include "gfx_cache.h"
+#include "file.h"
+#include "gfx_optimize.h"
+
+#include <cgltf.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+struct Mapped_File {
+    u8 *data;
+    usize size;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+};
+
+// Maps the file copy-on-write, so in-place mesh processing never touches the
+// file on disk.
+static Mapped_File *map_file(const char *file) {
+    auto mapped = cast(Mapped_File *)SDL_calloc(1, sizeof(Mapped_File));
+    if (!mapped) return NULL;
+
+#if defined(_WIN32)
+    mapped->file = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mapped->file == INVALID_HANDLE_VALUE) {
+        SDL_free(mapped);
+        return NULL;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mapped->file, &size) || size.QuadPart == 0) {
+        CloseHandle(mapped->file);
+        SDL_free(mapped);
+        return NULL;
+    }
+    mapped->size = cast(usize)size.QuadPart;
+
+    mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (mapped->mapping == NULL) {
+        CloseHandle(mapped->file);
+        SDL_free(mapped);
+        return NULL;
+    }
+
+    mapped->data = cast(u8 *)MapViewOfFile(mapped->mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (mapped->data == NULL) {
+        CloseHandle(mapped->mapping);
+        CloseHandle(mapped->file);
+        SDL_free(mapped);
+        return NULL;
+    }
+#else
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        SDL_free(mapped);
+        return NULL;
+    }
+    defer { close(fd); };
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        SDL_free(mapped);
+        return NULL;
+    }
+    mapped->size = cast(usize)st.st_size;
+
+    void *data = mmap(NULL, mapped->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        SDL_free(mapped);
+        return NULL;
+    }
+    mapped->data = cast(u8 *)data;
+#endif
+
+    return mapped;
+}
+
+static void unmap_file(Mapped_File *mapped) {
+#if defined(_WIN32)
+    UnmapViewOfFile(mapped->data);
+    CloseHandle(mapped->mapping);
+    CloseHandle(mapped->file);
+#else
+    munmap(mapped->data, mapped->size);
+#endif
+    SDL_free(mapped);
+}
+
+static usize align_up(usize value, usize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// The meshlet stream holds Gfx_Meshlet as it is.
+static_assert(sizeof(Gfx_Meshlet) == 56, "Gfx_Meshlet changed, bump GFX_CACHE_VERSION");
+
+static usize stream_size(const Gfx_Cache_Mesh *entry, int stream) {
+    usize vc = entry->vertex_count;
+    switch (stream) {
+        case GFX_CACHE_STREAM_VERTICES:   return vc * 3 * sizeof(f32);
+        case GFX_CACHE_STREAM_TEXCOORDS:  return vc * 2 * sizeof(f32);
+        case GFX_CACHE_STREAM_TEXCOORDS2: return vc * 2 * sizeof(f32);
+        case GFX_CACHE_STREAM_NORMALS:    return vc * 3 * sizeof(f32);
+        case GFX_CACHE_STREAM_TANGENTS:   return vc * 4 * sizeof(f32);
+        case GFX_CACHE_STREAM_COLORS:     return vc * 4 * sizeof(u8);
+        case GFX_CACHE_STREAM_INDICES:    return cast(usize)entry->triangle_count * 3 * entry->index_size;
+        case GFX_CACHE_STREAM_LOD_INDICES: {
+            usize count = 0;
+            for (u32 l = 0; l < entry->lod_count && l < GFX_LOD_MAX_LEVELS; l++) count += entry->lod_index_counts[l];
+            return count * entry->index_size;
+        }
+        case GFX_CACHE_STREAM_MESHLETS:   return cast(usize)entry->meshlet_count * sizeof(Gfx_Meshlet);
+    }
+    return 0;
+}
+
+// Returns the directory part of file including the trailing separator.
+static void get_directory(const char *file, char *out, usize out_size) {
+    SDL_strlcpy(out, file, out_size);
+
+    char *last = NULL;
+    for (char *c = out; *c; c++) {
+        if (*c == '/' || *c == '\\') last = c;
+    }
+
+    if (last) last[1] = '\0';
+    else      out[0]  = '\0';
+}
+
+static bool read_dependency(Gfx_Cache_Dependency *dep, const char *file, bool with_hash) {
+    SDL_PathInfo info;
+    if (!SDL_GetPathInfo(file, &info) || info.type != SDL_PATHTYPE_FILE) return false;
+
+    dep->mtime = info.modify_time;
+    dep->size  = info.size;
+    dep->hash  = 0;
+
+    if (with_hash) {
+        usize size;
+        void *data = SDL_LoadFile(file, &size);
+        if (!data) return false;
+        dep->hash = hash_fnv1a64(data, size);
+        SDL_free(data);
+    }
+
+    return true;
+}
+
+// Collects the glTF file and its external buffers, from the parsed glTF.
+// Embedded and GLB buffers are covered by the hash of the glTF file itself.
+static int collect_dependencies(const cgltf_data *data, const char *source_file, Gfx_Cache_Dependency **out) {
+    *out = NULL;
+
+    int count = 1 + cast(int)data->buffers_count;
+    auto deps = cast(Gfx_Cache_Dependency *)SDL_calloc(cast(usize)count, sizeof(Gfx_Cache_Dependency));
+    if (!deps) return -1;
+
+    char dir[sizeof(deps->path)];
+    get_directory(source_file, dir, sizeof(dir));
+
+    const char *name = source_file + SDL_strlen(dir);
+    SDL_strlcpy(deps[0].path, name, sizeof(deps[0].path));
+    if (!read_dependency(&deps[0], source_file, true)) {
+        SDL_free(deps);
+        return -1;
+    }
+
+    int dep_count = 1;
+    for (cgltf_size bi = 0; bi < data->buffers_count; bi++) {
+        const char *uri = data->buffers[bi].uri;
+        if (!uri || SDL_strncmp(uri, "data:", 5) == 0) continue;
+
+        Gfx_Cache_Dependency *dep = &deps[dep_count];
+        SDL_strlcpy(dep->path, uri, sizeof(dep->path));
+        cgltf_decode_uri(dep->path);
+
+        char path[2 * sizeof(dep->path)];
+        SDL_snprintf(path, sizeof(path), "%s%s", dir, dep->path);
+        if (!read_dependency(dep, path, true)) {
+            SDL_free(deps);
+            return -1;
+        }
+
+        dep_count++;
+    }
+
+    *out = deps;
+    return dep_count;
+}
+
+// The cache has no skins, clips or skinned streams. Checked on the parsed
+// glTF, so animated models skip hashing their dependencies.
+static bool is_animated(const cgltf_data *data) {
+    return data->skins_count > 0 || data->animations_count > 0;
+}
+
+// Processes the loaded model of the dependencies and writes it to
+// cache_file. The model is left as it was written.
+static bool write_cache(Gfx_Model *model, const Gfx_Cache_Dependency *deps, int dep_count, const char *cache_file, bool split_meshes,
+                        Job_System *jobs) {
+    if (split_meshes && !gfx_model_split(model, GFX_MESH_MAX_VERTICES_16)) return false;
+    if (!gfx_model_build_meshlets(model, jobs)) return false;
+    gfx_model_optimize(model, true);
+    if (!gfx_model_build_lods(model, NULL, jobs, true)) return false;
+
+    // Compute the file layout.
+    const Gfx_Scene *scene = &model->scene;
+    usize table_offset = sizeof(Gfx_Cache_Header) + cast(usize)dep_count * sizeof(Gfx_Cache_Dependency);
+    usize node_offset  = table_offset + cast(usize)model->mesh_count * sizeof(Gfx_Cache_Mesh);
+    usize file_size    = align_up(node_offset + cast(usize)scene->node_count * sizeof(Gfx_Cache_Node), GFX_CACHE_ALIGNMENT);
+
+    auto table = cast(Gfx_Cache_Mesh *)SDL_calloc(cast(usize)SDL_max(model->mesh_count, 1), sizeof(Gfx_Cache_Mesh));
+    auto nodes = cast(Gfx_Cache_Node *)SDL_calloc(cast(usize)SDL_max(scene->node_count, 1), sizeof(Gfx_Cache_Node));
+    defer {
+        SDL_free(table);
+        SDL_free(nodes);
+    };
+    if (!table || !nodes) return false;
+
+    for (int ni = 0; ni < scene->node_count; ni++) {
+        nodes[ni].parent = scene->parent[ni];
+        for (int axis = 0; axis < 3; axis++) {
+            nodes[ni].translation[axis] = scene->translation[ni][axis];
+            nodes[ni].scale[axis]       = scene->scale[ni][axis];
+        }
+        nodes[ni].rotation[0] = scene->rotation[ni].x;
+        nodes[ni].rotation[1] = scene->rotation[ni].y;
+        nodes[ni].rotation[2] = scene->rotation[ni].z;
+        nodes[ni].rotation[3] = scene->rotation[ni].w;
+    }
+
+    const void *sources[GFX_CACHE_STREAM_COUNT];
+
+    auto get_streams = [&](const Gfx_Mesh *mesh) {
+        sources[GFX_CACHE_STREAM_VERTICES]   = mesh->vertices;
+        sources[GFX_CACHE_STREAM_TEXCOORDS]  = mesh->texcoords;
+        sources[GFX_CACHE_STREAM_TEXCOORDS2] = mesh->texcoords2;
+        sources[GFX_CACHE_STREAM_NORMALS]    = mesh->normals;
+        sources[GFX_CACHE_STREAM_TANGENTS]   = mesh->tangents;
+        sources[GFX_CACHE_STREAM_COLORS]     = mesh->colors;
+        sources[GFX_CACHE_STREAM_INDICES]    = mesh->indices;
+        sources[GFX_CACHE_STREAM_LOD_INDICES] = mesh->lod_indices;
+        sources[GFX_CACHE_STREAM_MESHLETS]    = mesh->meshlets.meshlets;
+    };
+
+    for (int mi = 0; mi < model->mesh_count; mi++) {
+        const Gfx_Mesh *mesh = &model->meshes[mi];
+        table[mi].vertex_count   = cast(u32)mesh->vertex_count;
+        table[mi].triangle_count = cast(u32)mesh->triangle_count;
+        table[mi].index_size     = mesh->index_size;
+        table[mi].node           = mesh->node;
+        table[mi].bounds_radius  = mesh->bounds.radius;
+        for (int axis = 0; axis < 3; axis++) {
+            table[mi].bounds_min[axis]    = mesh->bounds.min[axis];
+            table[mi].bounds_max[axis]    = mesh->bounds.max[axis];
+            table[mi].bounds_center[axis] = mesh->bounds.center[axis];
+        }
+        table[mi].lod_count = cast(u32)mesh->lod_count;
+        for (int l = 0; l < mesh->lod_count; l++) {
+            table[mi].lod_index_counts[l] = mesh->lods[l].index_count;
+            table[mi].lod_errors[l]       = mesh->lods[l].error;
+        }
+        table[mi].meshlet_count = cast(u32)mesh->meshlets.count;
+
+        get_streams(mesh);
+        for (int si = 0; si < GFX_CACHE_STREAM_COUNT; si++) {
+            usize size = stream_size(&table[mi], si);
+            if (sources[si] == NULL || size == 0) continue;
+            table[mi].offsets[si] = file_size;
+            file_size = align_up(file_size + size, GFX_CACHE_ALIGNMENT);
+        }
+    }
+
+    // Write the file into memory, then to disk in one go.
+    auto bytes = cast(u8 *)SDL_calloc(1, file_size);
+    if (!bytes) return false;
+    defer { SDL_free(bytes); };
+
+    Gfx_Cache_Header header{};
+    header.magic            = GFX_CACHE_MAGIC;
+    header.version          = GFX_CACHE_VERSION;
+    header.file_size        = file_size;
+    header.dependency_count = cast(u32)dep_count;
+    header.mesh_count       = cast(u32)model->mesh_count;
+    header.node_count       = cast(u32)scene->node_count;
+
+    SDL_memcpy(bytes, &header, sizeof(header));
+    SDL_memcpy(bytes + sizeof(header), deps, cast(usize)dep_count * sizeof(Gfx_Cache_Dependency));
+    SDL_memcpy(bytes + table_offset, table, cast(usize)model->mesh_count * sizeof(Gfx_Cache_Mesh));
+    SDL_memcpy(bytes + node_offset, nodes, cast(usize)scene->node_count * sizeof(Gfx_Cache_Node));
+
+    for (int mi = 0; mi < model->mesh_count; mi++) {
+        get_streams(&model->meshes[mi]);
+        for (int si = 0; si < GFX_CACHE_STREAM_COUNT; si++) {
+            if (table[mi].offsets[si] == 0) continue;
+            SDL_memcpy(bytes + table[mi].offsets[si], sources[si], stream_size(&table[mi], si));
+        }
+    }
+
+    return save_file_atomic(cache_file, bytes, file_size);
+}
+
+bool gfx_cache_bake(const char *source_file, const char *cache_file, bool split_meshes, Job_System *jobs) {
+    cgltf_options options{};
+    cgltf_data *data = NULL;
+    if (cgltf_parse_file(&options, source_file, &data) != cgltf_result_success) return false;
+    defer { cgltf_free(data); };
+
+    if (is_animated(data)) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "%s is animated, which the mesh cache does not store", source_file);
+        return false;
+    }
+
+    Gfx_Cache_Dependency *deps = NULL;
+    int dep_count = collect_dependencies(data, source_file, &deps);
+    if (dep_count < 0) return false;
+    defer { SDL_free(deps); };
+
+    Gfx_Model model;
+    gfx_model_load_parsed(&model, data, source_file, jobs);
+    defer { gfx_model_cleanup(&model); };
+    if (model.meshes == NULL) return false;
+
+    return write_cache(&model, deps, dep_count, cache_file, split_meshes, jobs);
+}
+
+static const Gfx_Cache_Header *validate_header(const u8 *data, usize size) {
+    if (size < sizeof(Gfx_Cache_Header)) return NULL;
+
+    auto header = cast(const Gfx_Cache_Header *)data;
+    if (header->magic != GFX_CACHE_MAGIC)     return NULL;
+    if (header->version != GFX_CACHE_VERSION) return NULL;
+    if (header->file_size != size)            return NULL;
+
+    usize tables_size = header->dependency_count * sizeof(Gfx_Cache_Dependency) +
+                        header->mesh_count * sizeof(Gfx_Cache_Mesh) +
+                        header->node_count * sizeof(Gfx_Cache_Node);
+    if (sizeof(Gfx_Cache_Header) + tables_size > size) return NULL;
+
+    return header;
+}
+
+bool gfx_cache_is_valid(const char *cache_file, const char *source_file) {
+    // Only the header and the dependency table are needed here.
+    auto stream = SDL_IOFromFile(cache_file, "rb");
+    if (!stream) return false;
+    defer { SDL_CloseIO(stream); };
+
+    Gfx_Cache_Header header;
+    if (SDL_ReadIO(stream, &header, sizeof(header)) != sizeof(header)) return false;
+    if (header.magic != GFX_CACHE_MAGIC || header.version != GFX_CACHE_VERSION) return false;
+    if (header.dependency_count == 0) return false;
+    if (cast(u64)SDL_GetIOSize(stream) != header.file_size) return false;
+
+    char dir[sizeof(Gfx_Cache_Dependency::path)];
+    get_directory(source_file, dir, sizeof(dir));
+
+    // Opened when a timestamp has to be refreshed.
+    SDL_IOStream *update = NULL;
+    bool update_opened = false;
+    defer { if (update) SDL_CloseIO(update); };
+
+    for (u32 di = 0; di < header.dependency_count; di++) {
+        Gfx_Cache_Dependency baked;
+        if (SDL_ReadIO(stream, &baked, sizeof(baked)) != sizeof(baked)) return false;
+        baked.path[sizeof(baked.path) - 1] = '\0';
+
+        char path[2 * sizeof(baked.path)];
+        if (di == 0) SDL_strlcpy(path, source_file, sizeof(path));
+        else         SDL_snprintf(path, sizeof(path), "%s%s", dir, baked.path);
+
+        // Cheap check first, only hash when the timestamp moved.
+        Gfx_Cache_Dependency current;
+        if (!read_dependency(&current, path, false)) return false;
+        if (current.size != baked.size) return false;
+        if (current.mtime == baked.mtime) continue;
+
+        if (!read_dependency(&current, path, true)) return false;
+        if (current.hash != baked.hash) return false;
+
+        // Same content, store the new timestamp so the next check skips the
+        // hash again. A read-only cache keeps hashing.
+        if (!update_opened) {
+            update = SDL_IOFromFile(cache_file, "r+b");
+            update_opened = true;
+        }
+        if (update) {
+            Sint64 offset = cast(Sint64)(sizeof(Gfx_Cache_Header) + di * sizeof(Gfx_Cache_Dependency) + offsetof(Gfx_Cache_Dependency, mtime));
+            if (SDL_SeekIO(update, offset, SDL_IO_SEEK_SET) == offset) SDL_WriteIO(update, &current.mtime, sizeof(current.mtime));
+        }
+    }
+
+    return true;
+}
+
+bool gfx_cache_load(Gfx_Model *model, const char *cache_file) {
+    *model = {};
+
+    Mapped_File *mapped = map_file(cache_file);
+    if (!mapped) return false;
+
+    auto header = validate_header(mapped->data, mapped->size);
+    if (!header) {
+        unmap_file(mapped);
+        return false;
+    }
+
+    int mesh_count = cast(int)header->mesh_count;
+    int node_count = cast(int)header->node_count;
+    usize table_offset = sizeof(Gfx_Cache_Header) + header->dependency_count * sizeof(Gfx_Cache_Dependency);
+    usize node_offset  = table_offset + cast(usize)mesh_count * sizeof(Gfx_Cache_Mesh);
+    auto table = cast(const Gfx_Cache_Mesh *)(mapped->data + table_offset);
+    auto nodes = cast(const Gfx_Cache_Node *)(mapped->data + node_offset);
+
+    Gfx_Scene scene;
+    if (!gfx_scene_init(&scene, node_count)) {
+        unmap_file(mapped);
+        return false;
+    }
+    for (int ni = 0; ni < node_count; ni++) {
+        const Gfx_Cache_Node *node = &nodes[ni];
+        scene.parent[ni]      = node->parent;
+        scene.translation[ni] = glm::vec3(node->translation[0], node->translation[1], node->translation[2]);
+        scene.rotation[ni]    = glm::quat(node->rotation[3], node->rotation[0], node->rotation[1], node->rotation[2]);
+        scene.scale[ni]       = glm::vec3(node->scale[0], node->scale[1], node->scale[2]);
+    }
+    if (!gfx_scene_link(&scene)) {
+        gfx_scene_free(&scene);
+        unmap_file(mapped);
+        return false;
+    }
+    gfx_scene_update(&scene, NULL);
+
+    Arena storage;
+    if (!arena_init(&storage, cast(usize)mesh_count * sizeof(Gfx_Mesh))) {
+        gfx_scene_free(&scene);
+        unmap_file(mapped);
+        return false;
+    }
+    auto meshes = cast(Gfx_Mesh *)arena_push(&storage, cast(usize)mesh_count * sizeof(Gfx_Mesh));
+
+    for (int mi = 0; mi < mesh_count; mi++) {
+        const Gfx_Cache_Mesh *entry = &table[mi];
+
+        // Reject unknown index widths, missing nodes, LODs or meshlets
+        // without their stream, streams pointing outside the file and
+        // meshlets outside the indices.
+        bool valid = (entry->index_size == sizeof(u16) || entry->index_size == sizeof(u32)) &&
+                     entry->node >= -1 && entry->node < node_count && entry->lod_count <= GFX_LOD_MAX_LEVELS &&
+                     (entry->lod_count == 0 || entry->offsets[GFX_CACHE_STREAM_LOD_INDICES] != 0) &&
+                     (entry->meshlet_count == 0 || entry->offsets[GFX_CACHE_STREAM_MESHLETS] != 0);
+        for (int si = 0; si < GFX_CACHE_STREAM_COUNT; si++) {
+            if (entry->offsets[si] == 0) continue;
+            if (entry->offsets[si] + stream_size(entry, si) > mapped->size) valid = false;
+        }
+        if (valid && entry->meshlet_count > 0) {
+            auto meshlets = cast(const Gfx_Meshlet *)(mapped->data + entry->offsets[GFX_CACHE_STREAM_MESHLETS]);
+            u64 index_count = cast(u64)entry->triangle_count * 3;
+            for (u32 i = 0; i < entry->meshlet_count; i++) {
+                if (cast(u64)meshlets[i].first_index + meshlets[i].index_count > index_count) valid = false;
+            }
+        }
+        if (!valid) {
+            arena_release(&storage);
+            gfx_scene_free(&scene);
+            unmap_file(mapped);
+            return false;
+        }
+
+        auto stream = [&](Gfx_Cache_Stream si) -> void * {
+            return entry->offsets[si] ? mapped->data + entry->offsets[si] : NULL;
+        };
+
+        Gfx_Mesh *mesh = &meshes[mi];
+        *mesh = {};
+        mesh->vertex_count   = cast(int)entry->vertex_count;
+        mesh->triangle_count = cast(int)entry->triangle_count;
+        mesh->vertices   = cast(f32 *)stream(GFX_CACHE_STREAM_VERTICES);
+        mesh->texcoords  = cast(f32 *)stream(GFX_CACHE_STREAM_TEXCOORDS);
+        mesh->texcoords2 = cast(f32 *)stream(GFX_CACHE_STREAM_TEXCOORDS2);
+        mesh->normals    = cast(f32 *)stream(GFX_CACHE_STREAM_NORMALS);
+        mesh->tangents   = cast(f32 *)stream(GFX_CACHE_STREAM_TANGENTS);
+        mesh->colors     = cast(u8 *)stream(GFX_CACHE_STREAM_COLORS);
+        mesh->indices    = stream(GFX_CACHE_STREAM_INDICES);
+        mesh->index_size = entry->index_size;
+        mesh->node       = entry->node;
+
+        mesh->lod_indices = stream(GFX_CACHE_STREAM_LOD_INDICES);
+        mesh->lod_count   = cast(int)entry->lod_count;
+        u32 first_index = 0;
+        for (int l = 0; l < mesh->lod_count; l++) {
+            mesh->lods[l].first_index = first_index;
+            mesh->lods[l].index_count = entry->lod_index_counts[l];
+            mesh->lods[l].error       = entry->lod_errors[l];
+            first_index += entry->lod_index_counts[l];
+        }
+
+        mesh->meshlets.count    = cast(int)entry->meshlet_count;
+        mesh->meshlets.meshlets = cast(Gfx_Meshlet *)stream(GFX_CACHE_STREAM_MESHLETS);
+
+        mesh->bounds.radius = entry->bounds_radius;
+        for (int axis = 0; axis < 3; axis++) {
+            mesh->bounds.min[axis]    = entry->bounds_min[axis];
+            mesh->bounds.max[axis]    = entry->bounds_max[axis];
+            mesh->bounds.center[axis] = entry->bounds_center[axis];
+        }
+    }
+
+    model->scene      = scene;
+    model->mesh_count = mesh_count;
+    model->meshes  = meshes;
+    model->storage = storage;
+    model->cache   = mapped;
+    return true;
+}
+
+void gfx_model_load_cached(Gfx_Model *model, const char *source_file, const char *cache_file, Job_System *jobs) {
+    u64 start = SDL_GetPerformanceCounter();
+
+    // The glTF is parsed once: the model baked from it is the one returned,
+    // and animated models, which are never cached, are loaded without
+    // hashing their dependencies.
+    if (!gfx_cache_is_valid(cache_file, source_file)) {
+        *model = {};
+        cgltf_options options{};
+        cgltf_data *data = NULL;
+        if (cgltf_parse_file(&options, source_file, &data) != cgltf_result_success) return;
+        defer { cgltf_free(data); };
+
+        Gfx_Cache_Dependency *deps = NULL;
+        int dep_count = is_animated(data) ? 0 : collect_dependencies(data, source_file, &deps);
+        defer { SDL_free(deps); };
+
+        gfx_model_load_parsed(model, data, source_file, jobs);
+        if (model->meshes == NULL || is_animated(data)) return;
+
+        SDL_Log("Baking mesh cache %s", cache_file);
+        if (dep_count < 0 || !write_cache(model, deps, dep_count, cache_file, true, jobs)) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to bake %s, using the glTF as loaded", source_file);
+        }
+        return;
+    }
+
+    if (!gfx_cache_load(model, cache_file)) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to map %s, loading glTF directly", cache_file);
+        gfx_model_load_ex(model, source_file, jobs);
+        return;
+    }
+
+    f64 ms = cast(f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / cast(f64)SDL_GetPerformanceFrequency();
+    SDL_Log("Loaded %s from cache in %.3f ms", source_file, ms);
+}
+
+void gfx_cache_release(void *cache) {
+    if (cache != NULL) unmap_file(cast(Mapped_File *)cache);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "defines.h"
+
+#include "gfx.h"
+
+//
+// Baked binary mesh cache.
+//
+// A cache file is written once from a glTF file by gfx_cache_bake() and is
+// memory-mapped at runtime by gfx_cache_load(). Meshes are run through
+// gfx_model_build_meshlets(), gfx_model_optimize() and gfx_model_build_lods()
+// before they are written, the LOD indices and the meshlet table are two more
+// streams. The mesh streams of the loaded
+// Gfx_Model point straight into the mapping, so there is no parsing and no
+// per-attribute copy. The mapping is released by gfx_model_cleanup().
+//
+// Layout (little-endian):
+//
+//     Gfx_Cache_Header
+//     Gfx_Cache_Dependency[dependency_count]
+//     Gfx_Cache_Mesh[mesh_count]
+//     Gfx_Cache_Node[node_count]
+//     stream data, each stream aligned to GFX_CACHE_ALIGNMENT
+//
+// The first dependency is the glTF file itself, followed by its external
+// buffers. A cache is stale when a dependency changed size, or changed mtime
+// and content hash. Bump GFX_CACHE_VERSION whenever the layout changes.
+//
+// Models with skins or animation clips are not baked, gfx_model_load_cached()
+// loads them from the glTF file, parsing it once per load.
+//
+
+#define GFX_CACHE_MAGIC     SDL_FOURCC('S', '3', 'D', 'M')
+#define GFX_CACHE_VERSION   8
+#define GFX_CACHE_ALIGNMENT 16
+
+enum Gfx_Cache_Stream {
+    GFX_CACHE_STREAM_VERTICES,
+    GFX_CACHE_STREAM_TEXCOORDS,
+    GFX_CACHE_STREAM_TEXCOORDS2,
+    GFX_CACHE_STREAM_NORMALS,
+    GFX_CACHE_STREAM_TANGENTS,
+    GFX_CACHE_STREAM_COLORS,
+    GFX_CACHE_STREAM_INDICES,
+    GFX_CACHE_STREAM_LOD_INDICES,
+    GFX_CACHE_STREAM_MESHLETS,
+
+    GFX_CACHE_STREAM_COUNT,
+};
+
+struct Gfx_Cache_Header {
+    u32 magic;
+    u32 version;
+    u64 file_size;
+    u32 dependency_count;
+    u32 mesh_count;
+    u32 node_count;
+    u32 reserved;
+};
+
+struct Gfx_Cache_Dependency {
+    u64 hash;
+    s64 mtime;
+    u64 size;
+    char path[232]; // Relative to the glTF file directory.
+};
+
+struct Gfx_Cache_Mesh {
+    u32 vertex_count;
+    u32 triangle_count;
+    u32 index_size; // 2 or 4 bytes.
+    s32 node;       // -1 for none.
+
+    // Gfx_Bounds of the mesh.
+    f32 bounds_min[3];
+    f32 bounds_max[3];
+    f32 bounds_center[3];
+    f32 bounds_radius;
+
+    // Byte offset of each stream from the start of the file, 0 if absent.
+    u64 offsets[GFX_CACHE_STREAM_COUNT];
+
+    // Gfx_Lod of every level, back to back in the LOD index stream.
+    u32 lod_count;
+    u32 lod_index_counts[GFX_LOD_MAX_LEVELS];
+    f32 lod_errors[GFX_LOD_MAX_LEVELS];
+
+    // Gfx_Meshlet entries in the meshlet stream, stored as they are.
+    u32 meshlet_count;
+};
+
+// Local transform of a Gfx_Scene node, in scene order.
+struct Gfx_Cache_Node {
+    s32 parent;
+    f32 translation[3];
+    f32 rotation[4]; // x, y, z, w
+    f32 scale[3];
+};
+
+// Bakes source_file (.gltf/.glb) into cache_file. Returns false on failure.
+// With split_meshes, meshes too large for 16-bit indices are split with
+// gfx_model_split(), otherwise they are stored with 32-bit indices. jobs may
+// be NULL.
+bool gfx_cache_bake(const char *source_file, const char *cache_file, bool split_meshes = true, Job_System *jobs = NULL);
+
+// Returns true if cache_file exists, has the current version, and none of its
+// dependencies changed since it was baked. Dependencies with a new mtime but
+// the baked content get the new mtime written into the cache file.
+bool gfx_cache_is_valid(const char *cache_file, const char *source_file);
+
+// Maps cache_file into model. Returns false if the file is missing or invalid.
+// Does not check the dependencies, see gfx_cache_is_valid().
+bool gfx_cache_load(Gfx_Model *model, const char *cache_file);
+
+// Loads model through cache_file. If it is missing or stale, source_file is
+// loaded with gfx_model_load_ex() instead and baked into cache_file from
+// memory, unless it is animated; the model is then the one in memory, also
+// when the bake fails.
+void gfx_model_load_cached(Gfx_Model *model, const char *source_file, const char *cache_file, Job_System *jobs = NULL);
+
+// Unmaps a cache previously attached to a model by gfx_cache_load().
+void gfx_cache_release(void *cache);
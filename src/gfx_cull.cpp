@@ -0,0 +1,284 @@
+#include "gfx_cull.h"
+
+#include <SDL3/SDL.h>
+
+#if SIMD_SSE2
+    #include <emmintrin.h>
+#endif
+
+#if SIMD_AVX2
+    #include <immintrin.h>
+#endif
+
+Gfx_Frustum gfx_frustum_from_matrix(const glm::mat4 &clip) {
+    // glm is column-major, row i is (clip[0][i], clip[1][i], clip[2][i], clip[3][i]).
+    auto row = [&](int i) {
+        return glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+    };
+
+    Gfx_Frustum frustum;
+    frustum.planes[GFX_FRUSTUM_LEFT]   = row(3) + row(0);
+    frustum.planes[GFX_FRUSTUM_RIGHT]  = row(3) - row(0);
+    frustum.planes[GFX_FRUSTUM_BOTTOM] = row(3) + row(1);
+    frustum.planes[GFX_FRUSTUM_TOP]    = row(3) - row(1);
+    frustum.planes[GFX_FRUSTUM_NEAR]   = row(3) + row(2);
+    frustum.planes[GFX_FRUSTUM_FAR]    = row(3) - row(2);
+
+    // Normalize so that the plane distance is in world units, which the
+    // sphere radius is compared against.
+    for (int i = 0; i < GFX_FRUSTUM_PLANE_COUNT; i++) {
+        f32 length = glm::length(glm::vec3(frustum.planes[i]));
+        if (length > 0.0f) frustum.planes[i] /= length;
+    }
+
+    return frustum;
+}
+
+bool gfx_frustum_test_sphere(const Gfx_Frustum *frustum, glm::vec3 center, f32 radius) {
+    for (int i = 0; i < GFX_FRUSTUM_PLANE_COUNT; i++) {
+        const glm::vec4 &plane = frustum->planes[i];
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+    }
+    return true;
+}
+
+//
+// Bounds.
+//
+
+Gfx_Bounds gfx_bounds_from_points(const f32 *positions, int count) {
+    Gfx_Bounds bounds{};
+    if (count <= 0) return bounds;
+
+    glm::vec3 min(positions[0], positions[1], positions[2]);
+    glm::vec3 max = min;
+    for (int i = 1; i < count; i++) {
+        glm::vec3 p(positions[i * 3 + 0], positions[i * 3 + 1], positions[i * 3 + 2]);
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    bounds.min    = min;
+    bounds.max    = max;
+    bounds.center = (min + max) * 0.5f;
+    bounds.radius = glm::length(max - min) * 0.5f;
+    return bounds;
+}
+
+void gfx_bounds_transform_sphere(const Gfx_Bounds *bounds, const glm::mat4 &transform, glm::vec3 *center, f32 *radius) {
+    *center = glm::vec3(transform * glm::vec4(bounds->center, 1.0f));
+
+    f32 scale = SDL_max(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])));
+    scale = SDL_max(scale, glm::length(glm::vec3(transform[2])));
+    *radius = bounds->radius * scale;
+}
+
+//
+// Sphere sets.
+//
+
+void gfx_sphere_set_free(Gfx_Sphere_Set *set) {
+    // All four arrays live in the block x points to.
+    SDL_aligned_free(set->x);
+    *set = {};
+}
+
+void gfx_sphere_set_clear(Gfx_Sphere_Set *set) {
+    set->count = 0;
+}
+
+bool gfx_sphere_set_push(Gfx_Sphere_Set *set, glm::vec3 center, f32 radius) {
+    if (set->count == set->capacity) {
+        int capacity = SDL_max(1024, set->capacity * 2);
+        auto block = cast(f32 *)SDL_aligned_alloc(32, cast(usize)capacity * 4 * sizeof(f32));
+        if (!block) return false;
+
+        f32 *arrays[4] = { block, block + capacity, block + capacity * 2, block + capacity * 3 };
+        if (set->count > 0) {
+            usize size = cast(usize)set->count * sizeof(f32);
+            SDL_memcpy(arrays[0], set->x, size);
+            SDL_memcpy(arrays[1], set->y, size);
+            SDL_memcpy(arrays[2], set->z, size);
+            SDL_memcpy(arrays[3], set->radius, size);
+        }
+
+        SDL_aligned_free(set->x);
+        set->x        = arrays[0];
+        set->y        = arrays[1];
+        set->z        = arrays[2];
+        set->radius   = arrays[3];
+        set->capacity = capacity;
+    }
+
+    int i = set->count++;
+    set->x[i]      = center.x;
+    set->y[i]      = center.y;
+    set->z[i]      = center.z;
+    set->radius[i] = radius;
+    return true;
+}
+
+//
+// Sphere culling.
+//
+// Every kernel computes dot(plane.xyz, center) + plane.w in the same order,
+// so all of them agree exactly with the scalar reference. Indices are written
+// without branching: the slot is always stored and the count only advances
+// for visible spheres, out has room since count <= index.
+//
+
+int gfx_cull_spheres_scalar(const Gfx_Frustum *frustum, const Gfx_Sphere_Set *set, int begin, int end, u32 *out) {
+    int count = 0;
+    for (int i = begin; i < end; i++) {
+        bool visible = true;
+        for (int p = 0; p < GFX_FRUSTUM_PLANE_COUNT; p++) {
+            const glm::vec4 &plane = frustum->planes[p];
+            f32 distance = plane.x * set->x[i] + plane.y * set->y[i] + plane.z * set->z[i] + plane.w;
+            visible = visible && !(distance < -set->radius[i]);
+        }
+
+        out[count] = cast(u32)i;
+        count += visible;
+    }
+    return count;
+}
+
+#if SIMD_AVX2
+
+static int cull_spheres_avx2(const Gfx_Frustum *frustum, const Gfx_Sphere_Set *set, int begin, int end, u32 *out) {
+    __m256 px[GFX_FRUSTUM_PLANE_COUNT], py[GFX_FRUSTUM_PLANE_COUNT];
+    __m256 pz[GFX_FRUSTUM_PLANE_COUNT], pw[GFX_FRUSTUM_PLANE_COUNT];
+    for (int p = 0; p < GFX_FRUSTUM_PLANE_COUNT; p++) {
+        px[p] = _mm256_set1_ps(frustum->planes[p].x);
+        py[p] = _mm256_set1_ps(frustum->planes[p].y);
+        pz[p] = _mm256_set1_ps(frustum->planes[p].z);
+        pw[p] = _mm256_set1_ps(frustum->planes[p].w);
+    }
+    __m256 sign = _mm256_set1_ps(-0.0f);
+
+    int count = 0;
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(set->x + i);
+        __m256 y = _mm256_loadu_ps(set->y + i);
+        __m256 z = _mm256_loadu_ps(set->z + i);
+        __m256 neg_radius = _mm256_xor_ps(_mm256_loadu_ps(set->radius + i), sign);
+
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < GFX_FRUSTUM_PLANE_COUNT; p++) {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(px[p], x), _mm256_mul_ps(py[p], y)), _mm256_mul_ps(pz[p], z)), pw[p]);
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, neg_radius, _CMP_LT_OQ));
+        }
+
+        int visible = ~_mm256_movemask_ps(outside);
+        for (int lane = 0; lane < 8; lane++) {
+            out[count] = cast(u32)(i + lane);
+            count += (visible >> lane) & 1;
+        }
+    }
+
+    return count + gfx_cull_spheres_scalar(frustum, set, i, end, out + count);
+}
+
+#elif SIMD_SSE2
+
+static int cull_spheres_sse2(const Gfx_Frustum *frustum, const Gfx_Sphere_Set *set, int begin, int end, u32 *out) {
+    __m128 px[GFX_FRUSTUM_PLANE_COUNT], py[GFX_FRUSTUM_PLANE_COUNT];
+    __m128 pz[GFX_FRUSTUM_PLANE_COUNT], pw[GFX_FRUSTUM_PLANE_COUNT];
+    for (int p = 0; p < GFX_FRUSTUM_PLANE_COUNT; p++) {
+        px[p] = _mm_set1_ps(frustum->planes[p].x);
+        py[p] = _mm_set1_ps(frustum->planes[p].y);
+        pz[p] = _mm_set1_ps(frustum->planes[p].z);
+        pw[p] = _mm_set1_ps(frustum->planes[p].w);
+    }
+    __m128 sign = _mm_set1_ps(-0.0f);
+
+    int count = 0;
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(set->x + i);
+        __m128 y = _mm_loadu_ps(set->y + i);
+        __m128 z = _mm_loadu_ps(set->z + i);
+        __m128 neg_radius = _mm_xor_ps(_mm_loadu_ps(set->radius + i), sign);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < GFX_FRUSTUM_PLANE_COUNT; p++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)), _mm_mul_ps(pz[p], z)), pw[p]);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, neg_radius));
+        }
+
+        int visible = ~_mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; lane++) {
+            out[count] = cast(u32)(i + lane);
+            count += (visible >> lane) & 1;
+        }
+    }
+
+    return count + gfx_cull_spheres_scalar(frustum, set, i, end, out + count);
+}
+
+#endif
+
+int gfx_cull_spheres(const Gfx_Frustum *frustum, const Gfx_Sphere_Set *set, int begin, int end, u32 *out) {
+#if SIMD_AVX2
+    return cull_spheres_avx2(frustum, set, begin, end, out);
+#elif SIMD_SSE2
+    return cull_spheres_sse2(frustum, set, begin, end, out);
+#else
+    return gfx_cull_spheres_scalar(frustum, set, begin, end, out);
+#endif
+}
+
+// Ranges per worker, so faster workers can pick up more of them.
+#define CULL_RANGES_PER_WORKER 4
+#define CULL_MAX_RANGES (JOB_MAX_WORKERS * CULL_RANGES_PER_WORKER)
+
+struct Cull_Spheres_Work {
+    const Gfx_Frustum *frustum;
+    const Gfx_Sphere_Set *set;
+    u32 *out;
+    int range_size;
+    int counts[CULL_MAX_RANGES];
+};
+
+static void cull_spheres_ranges(void *data, int begin, int end) {
+    auto work = cast(Cull_Spheres_Work *)data;
+
+    // Each range writes to its own part of out, compacted afterwards.
+    for (int range = begin; range < end; range++) {
+        int first = range * work->range_size;
+        int last  = SDL_min(first + work->range_size, work->set->count);
+        work->counts[range] = gfx_cull_spheres(work->frustum, work->set, first, last, work->out + first);
+    }
+}
+
+int gfx_cull_spheres_parallel(const Gfx_Frustum *frustum, const Gfx_Sphere_Set *set, u32 *out, Job_System *jobs) {
+    // Below this, scheduling costs more than culling.
+    const int MIN_RANGE = 16384;
+
+    int range_count = job_worker_count(jobs) * CULL_RANGES_PER_WORKER;
+    range_count = SDL_min(range_count, SDL_max(set->count / MIN_RANGE, 1));
+    if (range_count == 1) return gfx_cull_spheres(frustum, set, 0, set->count, out);
+
+    Cull_Spheres_Work work;
+    work.frustum = frustum;
+    work.set     = set;
+    work.out     = out;
+
+    // Ranges start on multiples of 8 so every kernel stays on full vectors.
+    work.range_size = (set->count / range_count + 7) & ~7;
+    range_count = (set->count + work.range_size - 1) / work.range_size;
+
+    job_parallel_for(jobs, range_count, 1, cull_spheres_ranges, &work);
+
+    // Ranges are in order and each starts at or after count.
+    int count = work.counts[0];
+    for (int range = 1; range < range_count; range++) {
+        SDL_memmove(out + count, out + range * work.range_size, cast(usize)work.counts[range] * sizeof(u32));
+        count += work.counts[range];
+    }
+
+    return count;
+}
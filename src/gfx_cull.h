@@ -0,0 +1,84 @@
+#pragma once
+
+#include "defines.h"
+#include "job.h"
+
+#include <glm/glm.hpp>
+
+//
+// View frustum tests.
+//
+// Planes are extracted from a clip matrix (Gribb & Hartmann), so the space of
+// the planes is the space the matrix transforms from: pass proj * view for
+// world space, proj * view * model for object space. A point p is inside a
+// plane when dot(plane.xyz, p) + plane.w >= 0.
+//
+// Many spheres are culled at once from a Gfx_Sphere_Set, which keeps them as
+// structure of arrays so the kernels test 4 (SSE2) or 8 (AVX2) spheres per
+// plane with one instruction each.
+//
+
+enum Gfx_Frustum_Plane {
+    GFX_FRUSTUM_LEFT,
+    GFX_FRUSTUM_RIGHT,
+    GFX_FRUSTUM_BOTTOM,
+    GFX_FRUSTUM_TOP,
+    GFX_FRUSTUM_NEAR,
+    GFX_FRUSTUM_FAR,
+
+    GFX_FRUSTUM_PLANE_COUNT,
+};
+
+struct Gfx_Frustum {
+    glm::vec4 planes[GFX_FRUSTUM_PLANE_COUNT];
+};
+
+// Object-space bounds of a mesh. The sphere is centered on the box.
+struct Gfx_Bounds {
+    glm::vec3 min    = glm::vec3(0.0f);
+    glm::vec3 max    = glm::vec3(0.0f);
+    glm::vec3 center = glm::vec3(0.0f);
+    f32 radius = 0.0f;
+};
+
+// Arrays are 32-byte aligned and padded to a multiple of 8 entries.
+struct Gfx_Sphere_Set {
+    f32 *x      = NULL;
+    f32 *y      = NULL;
+    f32 *z      = NULL;
+    f32 *radius = NULL;
+    int count    = 0;
+    int capacity = 0;
+};
+
+// The near plane assumes OpenGL clip depth (-w..w), which also holds for the
+// 0..w convention, only less tight.
+Gfx_Frustum gfx_frustum_from_matrix(const glm::mat4 &clip);
+
+// False when the sphere is fully outside one of the planes.
+bool gfx_frustum_test_sphere(const Gfx_Frustum *frustum, glm::vec3 center, f32 radius);
+
+// positions is float3 per point. Zero bounds for count 0.
+Gfx_Bounds gfx_bounds_from_points(const f32 *positions, int count);
+
+// Sphere around the bounds after transform, the radius is scaled by the
+// largest axis scale.
+void gfx_bounds_transform_sphere(const Gfx_Bounds *bounds, const glm::mat4 &transform, glm::vec3 *center, f32 *radius);
+
+void gfx_sphere_set_free(Gfx_Sphere_Set *set);
+void gfx_sphere_set_clear(Gfx_Sphere_Set *set);
+
+// Returns false on allocation failure, the sphere is dropped then.
+bool gfx_sphere_set_push(Gfx_Sphere_Set *set, glm::vec3 center, f32 radius);
+
+// Writes the indices of the spheres in [begin, end) that intersect the
+// frustum to out, in increasing order, and returns how many there are.
+int gfx_cull_spheres(const Gfx_Frustum *frustum, const Gfx_Sphere_Set *set, int begin, int end, u32 *out);
+
+// Reference version of gfx_cull_spheres() without SIMD.
+int gfx_cull_spheres_scalar(const Gfx_Frustum *frustum, const Gfx_Sphere_Set *set, int begin, int end, u32 *out);
+
+// Splits the set into ranges culled as jobs, serially when jobs is NULL. out
+// needs room for set->count indices. Same result as gfx_cull_spheres() over
+// the whole set.
+int gfx_cull_spheres_parallel(const Gfx_Frustum *frustum, const Gfx_Sphere_Set *set, u32 *out, Job_System *jobs);
@@ -0,0 +1,354 @@
+#include "gfx_gpu_record.h"
+
+struct SDL_GPUDevice {
+    int unused;
+};
+
+struct SDL_GPUBuffer {
+    u32 size;
+};
+
+struct SDL_GPUTexture {
+    SDL_GPUTextureFormat format;
+    u32 width;
+    u32 height;
+};
+
+struct SDL_GPUSampler {
+    int unused;
+};
+
+struct SDL_GPUShader {
+    int unused;
+};
+
+struct SDL_GPUGraphicsPipeline {
+    int unused;
+};
+
+struct SDL_GPUTransferBuffer {
+    u8 *data;
+    u32 size;
+    bool mapped;
+};
+
+struct SDL_GPUFence {
+    int unused;
+};
+
+// The passes live in their command buffer, one of each kind open at a time.
+struct SDL_GPUCopyPass {
+    SDL_GPUCommandBuffer *command_buffer;
+    bool open;
+};
+
+struct SDL_GPURenderPass {
+    SDL_GPUCommandBuffer *command_buffer;
+    bool open;
+    bool pipeline_bound;
+};
+
+struct SDL_GPUCommandBuffer {
+    SDL_GPUCopyPass copy_pass;
+    SDL_GPURenderPass render_pass;
+};
+
+static SDL_SpinLock stats_lock = 0;
+static Gfx_GPU_Record_Stats record_stats;
+
+static SDL_GPUTexture swapchain_texture = {SDL_GPU_TEXTUREFORMAT_B8G8R8A8_UNORM, GFX_GPU_RECORD_WIDTH, GFX_GPU_RECORD_HEIGHT};
+
+#define RECORD(statement)                   \
+    do {                                    \
+        SDL_LockSpinlock(&stats_lock);      \
+        statement;                          \
+        SDL_UnlockSpinlock(&stats_lock);    \
+    } while (0)
+
+Gfx_GPU_Record_Stats gfx_gpu_record_stats() {
+    Gfx_GPU_Record_Stats stats;
+    RECORD(stats = record_stats);
+    return stats;
+}
+
+void gfx_gpu_record_reset() {
+    RECORD(record_stats = {});
+}
+
+// Allocates a zeroed handle and counts it.
+template <typename T>
+static T *create_object() {
+    auto object = cast(T *)SDL_calloc(1, sizeof(T));
+    if (object) RECORD(record_stats.created++);
+    return object;
+}
+
+template <typename T>
+static void release_object(T *object) {
+    if (!object) return;
+    SDL_free(object);
+    RECORD(record_stats.released++);
+}
+
+// Bytes of a w * h * d region, block-compressed formats by 4x4 blocks.
+static u64 region_bytes(SDL_GPUTextureFormat format, u32 w, u32 h, u32 d) {
+    u64 blocks = cast(u64)((w + 3) / 4) * ((h + 3) / 4) * SDL_max(d, 1u);
+    switch (format) {
+    case SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM:
+    case SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM_SRGB:
+        return blocks * 8;
+    case SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM:
+    case SDL_GPU_TEXTUREFORMAT_BC3_RGBA_UNORM_SRGB:
+    case SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM:
+    case SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM_SRGB:
+        return blocks * 16;
+    default:
+        return cast(u64)w * h * SDL_max(d, 1u) * 4;
+    }
+}
+
+SDL_GPUDevice *gfx_record_create_device(SDL_GPUShaderFormat, bool, const char *) {
+    return cast(SDL_GPUDevice *)SDL_calloc(1, sizeof(SDL_GPUDevice));
+}
+
+void gfx_record_destroy_device(SDL_GPUDevice *device) {
+    SDL_free(device);
+}
+
+bool gfx_record_claim_window(SDL_GPUDevice *, SDL_Window *) {
+    return true;
+}
+
+bool gfx_record_get_window_size(SDL_Window *, int *w, int *h) {
+    if (w) *w = GFX_GPU_RECORD_WIDTH;
+    if (h) *h = GFX_GPU_RECORD_HEIGHT;
+    return true;
+}
+
+bool gfx_record_supports_present_mode(SDL_GPUDevice *, SDL_Window *, SDL_GPUPresentMode) {
+    return true;
+}
+
+bool gfx_record_set_swapchain_parameters(SDL_GPUDevice *, SDL_Window *, SDL_GPUSwapchainComposition, SDL_GPUPresentMode) {
+    return true;
+}
+
+SDL_GPUTextureFormat gfx_record_swapchain_format(SDL_GPUDevice *, SDL_Window *) {
+    return swapchain_texture.format;
+}
+
+bool gfx_record_supports_format(SDL_GPUDevice *, SDL_GPUTextureFormat, SDL_GPUTextureType, SDL_GPUTextureUsageFlags) {
+    return true;
+}
+
+SDL_GPUBuffer *gfx_record_create_buffer(SDL_GPUDevice *, const SDL_GPUBufferCreateInfo *info) {
+    auto buffer = create_object<SDL_GPUBuffer>();
+    if (buffer) buffer->size = info->size;
+    return buffer;
+}
+
+void gfx_record_release_buffer(SDL_GPUDevice *, SDL_GPUBuffer *buffer) {
+    release_object(buffer);
+}
+
+SDL_GPUTexture *gfx_record_create_texture(SDL_GPUDevice *, const SDL_GPUTextureCreateInfo *info) {
+    auto texture = create_object<SDL_GPUTexture>();
+    if (!texture) return NULL;
+    texture->format = info->format;
+    texture->width  = info->width;
+    texture->height = info->height;
+    return texture;
+}
+
+void gfx_record_release_texture(SDL_GPUDevice *, SDL_GPUTexture *texture) {
+    if (texture == &swapchain_texture) {
+        RECORD(record_stats.errors++);
+        return;
+    }
+    release_object(texture);
+}
+
+SDL_GPUSampler *gfx_record_create_sampler(SDL_GPUDevice *, const SDL_GPUSamplerCreateInfo *) {
+    return create_object<SDL_GPUSampler>();
+}
+
+void gfx_record_release_sampler(SDL_GPUDevice *, SDL_GPUSampler *sampler) {
+    release_object(sampler);
+}
+
+SDL_GPUShader *gfx_record_create_shader(SDL_GPUDevice *, const SDL_GPUShaderCreateInfo *) {
+    return create_object<SDL_GPUShader>();
+}
+
+void gfx_record_release_shader(SDL_GPUDevice *, SDL_GPUShader *shader) {
+    release_object(shader);
+}
+
+SDL_GPUGraphicsPipeline *gfx_record_create_pipeline(SDL_GPUDevice *, const SDL_GPUGraphicsPipelineCreateInfo *info) {
+    if (!info->vertex_shader || !info->fragment_shader) {
+        RECORD(record_stats.errors++);
+        return NULL;
+    }
+    return create_object<SDL_GPUGraphicsPipeline>();
+}
+
+void gfx_record_release_pipeline(SDL_GPUDevice *, SDL_GPUGraphicsPipeline *pipeline) {
+    release_object(pipeline);
+}
+
+SDL_GPUTransferBuffer *gfx_record_create_transfer_buffer(SDL_GPUDevice *, const SDL_GPUTransferBufferCreateInfo *info) {
+    auto transfer_buffer = create_object<SDL_GPUTransferBuffer>();
+    if (!transfer_buffer) return NULL;
+
+    transfer_buffer->data = cast(u8 *)SDL_malloc(SDL_max(info->size, 1u));
+    if (!transfer_buffer->data) {
+        release_object(transfer_buffer);
+        return NULL;
+    }
+    transfer_buffer->size = info->size;
+    return transfer_buffer;
+}
+
+void gfx_record_release_transfer_buffer(SDL_GPUDevice *, SDL_GPUTransferBuffer *transfer_buffer) {
+    if (!transfer_buffer) return;
+    SDL_free(transfer_buffer->data);
+    release_object(transfer_buffer);
+}
+
+void *gfx_record_map_transfer_buffer(SDL_GPUDevice *, SDL_GPUTransferBuffer *transfer_buffer, bool) {
+    if (transfer_buffer->mapped) RECORD(record_stats.errors++);
+    transfer_buffer->mapped = true;
+    return transfer_buffer->data;
+}
+
+void gfx_record_unmap_transfer_buffer(SDL_GPUDevice *, SDL_GPUTransferBuffer *transfer_buffer) {
+    if (!transfer_buffer->mapped) RECORD(record_stats.errors++);
+    transfer_buffer->mapped = false;
+}
+
+SDL_GPUCommandBuffer *gfx_record_acquire_command_buffer(SDL_GPUDevice *) {
+    auto command_buffer = cast(SDL_GPUCommandBuffer *)SDL_calloc(1, sizeof(SDL_GPUCommandBuffer));
+    if (!command_buffer) return NULL;
+    command_buffer->copy_pass.command_buffer   = command_buffer;
+    command_buffer->render_pass.command_buffer = command_buffer;
+    RECORD(record_stats.command_buffers++);
+    return command_buffer;
+}
+
+// Everything recorded has completed by the time this returns.
+bool gfx_record_submit(SDL_GPUCommandBuffer *command_buffer) {
+    if (command_buffer->copy_pass.open || command_buffer->render_pass.open) RECORD(record_stats.errors++);
+    SDL_free(command_buffer);
+    return true;
+}
+
+SDL_GPUFence *gfx_record_submit_and_acquire_fence(SDL_GPUCommandBuffer *command_buffer) {
+    gfx_record_submit(command_buffer);
+    return cast(SDL_GPUFence *)SDL_calloc(1, sizeof(SDL_GPUFence));
+}
+
+bool gfx_record_query_fence(SDL_GPUDevice *, SDL_GPUFence *) {
+    return true;
+}
+
+void gfx_record_release_fence(SDL_GPUDevice *, SDL_GPUFence *fence) {
+    SDL_free(fence);
+}
+
+bool gfx_record_wait_for_fences(SDL_GPUDevice *, bool, SDL_GPUFence *const *, Uint32) {
+    return true;
+}
+
+bool gfx_record_acquire_swapchain(SDL_GPUCommandBuffer *, SDL_Window *, SDL_GPUTexture **texture, Uint32 *width, Uint32 *height) {
+    *texture = &swapchain_texture;
+    if (width)  *width  = swapchain_texture.width;
+    if (height) *height = swapchain_texture.height;
+    return true;
+}
+
+SDL_GPUCopyPass *gfx_record_begin_copy_pass(SDL_GPUCommandBuffer *command_buffer) {
+    SDL_GPUCopyPass *copy_pass = &command_buffer->copy_pass;
+    if (copy_pass->open || command_buffer->render_pass.open) RECORD(record_stats.errors++);
+    copy_pass->open = true;
+    RECORD(record_stats.copy_passes++);
+    return copy_pass;
+}
+
+void gfx_record_end_copy_pass(SDL_GPUCopyPass *copy_pass) {
+    copy_pass->open = false;
+}
+
+void gfx_record_upload_buffer(SDL_GPUCopyPass *copy_pass, const SDL_GPUTransferBufferLocation *source,
+                              const SDL_GPUBufferRegion *destination, bool) {
+    SDL_GPUTransferBuffer *transfer_buffer = source->transfer_buffer;
+    bool valid = copy_pass->open && !transfer_buffer->mapped &&
+                 cast(u64)source->offset + destination->size <= transfer_buffer->size &&
+                 cast(u64)destination->offset + destination->size <= destination->buffer->size;
+
+    RECORD(
+        record_stats.buffer_uploads++;
+        record_stats.upload_bytes += destination->size;
+        if (!valid) record_stats.errors++;
+    );
+}
+
+void gfx_record_upload_texture(SDL_GPUCopyPass *copy_pass, const SDL_GPUTextureTransferInfo *source,
+                               const SDL_GPUTextureRegion *destination, bool) {
+    u64 bytes  = region_bytes(destination->texture->format, destination->w, destination->h, destination->d);
+    bool valid = copy_pass->open && !source->transfer_buffer->mapped &&
+                 source->offset + bytes <= source->transfer_buffer->size;
+
+    RECORD(
+        record_stats.texture_uploads++;
+        record_stats.upload_bytes += bytes;
+        if (!valid) record_stats.errors++;
+    );
+}
+
+SDL_GPURenderPass *gfx_record_begin_render_pass(SDL_GPUCommandBuffer *command_buffer, const SDL_GPUColorTargetInfo *,
+                                                Uint32, const SDL_GPUDepthStencilTargetInfo *) {
+    SDL_GPURenderPass *render_pass = &command_buffer->render_pass;
+    if (render_pass->open || command_buffer->copy_pass.open) RECORD(record_stats.errors++);
+    render_pass->open = true;
+    render_pass->pipeline_bound = false;
+    RECORD(record_stats.render_passes++);
+    return render_pass;
+}
+
+void gfx_record_end_render_pass(SDL_GPURenderPass *render_pass) {
+    render_pass->open = false;
+}
+
+void gfx_record_bind_pipeline(SDL_GPURenderPass *render_pass, SDL_GPUGraphicsPipeline *pipeline) {
+    render_pass->pipeline_bound = pipeline != NULL;
+    RECORD(
+        record_stats.pipeline_binds++;
+        if (!pipeline) record_stats.errors++;
+    );
+}
+
+void gfx_record_bind_vertex_buffers(SDL_GPURenderPass *, Uint32, const SDL_GPUBufferBinding *, Uint32) {
+    RECORD(record_stats.vertex_buffer_binds++);
+}
+
+void gfx_record_bind_index_buffer(SDL_GPURenderPass *, const SDL_GPUBufferBinding *, SDL_GPUIndexElementSize) {
+    RECORD(record_stats.index_buffer_binds++);
+}
+
+void gfx_record_bind_fragment_samplers(SDL_GPURenderPass *, Uint32, const SDL_GPUTextureSamplerBinding *, Uint32) {
+    RECORD(record_stats.sampler_binds++);
+}
+
+void gfx_record_push_vertex_uniforms(SDL_GPUCommandBuffer *, Uint32, const void *, Uint32) {
+    RECORD(record_stats.uniform_pushes++);
+}
+
+void gfx_record_draw_indexed(SDL_GPURenderPass *render_pass, Uint32 index_count, Uint32 instance_count, Uint32, Sint32, Uint32) {
+    bool valid = render_pass->open && render_pass->pipeline_bound;
+    RECORD(
+        record_stats.draws++;
+        record_stats.instances += instance_count;
+        record_stats.indices   += cast(u64)index_count * instance_count;
+        if (!valid) record_stats.errors++;
+    );
+}
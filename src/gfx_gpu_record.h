@@ -0,0 +1,159 @@
+#pragma once
+
+#include "defines.h"
+
+#include <SDL3/SDL.h>
+
+//
+// Recording SDL GPU device.
+//
+// Builds with GFX_GPU_RECORD (the app_bench target) get this header from
+// defines.h. It renames every SDL GPU call the gfx code makes, and the few
+// window calls that go with them, to the functions below. They record what
+// the call would have done and return at once: there is no driver, window
+// or GPU behind them, so the CPU side of a frame runs anywhere.
+//
+// Objects are small handles. Transfer buffers have real memory, so the
+// staging code writes into them as it would into mapped GPU memory. Copies
+// and draws are only counted. Command buffers complete on submit, fences
+// are signaled at once. The swapchain is a GFX_GPU_RECORD_WIDTH *
+// GFX_GPU_RECORD_HEIGHT texture, acquired every frame.
+//
+// Calls that would be invalid on a real device, like a copy from a mapped
+// transfer buffer or a submit with a pass still open, are counted as
+// errors. The functions are thread safe, as the SDL ones are.
+//
+
+#define GFX_GPU_RECORD_WIDTH  1920
+#define GFX_GPU_RECORD_HEIGHT 1080
+
+struct Gfx_GPU_Record_Stats {
+    u64 command_buffers = 0;
+    u64 render_passes   = 0;
+    u64 copy_passes     = 0;
+
+    u64 pipeline_binds      = 0;
+    u64 vertex_buffer_binds = 0;
+    u64 index_buffer_binds  = 0;
+    u64 sampler_binds       = 0;
+    u64 uniform_pushes      = 0;
+
+    u64 draws     = 0;
+    u64 instances = 0; // Summed over the draws.
+    u64 indices   = 0; // Indices times instances.
+
+    u64 buffer_uploads  = 0;
+    u64 texture_uploads = 0;
+    u64 upload_bytes    = 0;
+
+    // Buffers, textures, transfer buffers, samplers, shaders and pipelines.
+    u64 created  = 0;
+    u64 released = 0;
+
+    u64 errors = 0;
+};
+
+// A copy of the counters since the start or the last reset.
+Gfx_GPU_Record_Stats gfx_gpu_record_stats();
+
+// Zeroes the counters, created and released included.
+void gfx_gpu_record_reset();
+
+SDL_GPUDevice *gfx_record_create_device(SDL_GPUShaderFormat format_flags, bool debug_mode, const char *name);
+void gfx_record_destroy_device(SDL_GPUDevice *device);
+bool gfx_record_claim_window(SDL_GPUDevice *device, SDL_Window *window);
+bool gfx_record_get_window_size(SDL_Window *window, int *w, int *h);
+bool gfx_record_supports_present_mode(SDL_GPUDevice *device, SDL_Window *window, SDL_GPUPresentMode mode);
+bool gfx_record_set_swapchain_parameters(SDL_GPUDevice *device, SDL_Window *window,
+                                         SDL_GPUSwapchainComposition composition, SDL_GPUPresentMode mode);
+SDL_GPUTextureFormat gfx_record_swapchain_format(SDL_GPUDevice *device, SDL_Window *window);
+bool gfx_record_supports_format(SDL_GPUDevice *device, SDL_GPUTextureFormat format, SDL_GPUTextureType type,
+                                SDL_GPUTextureUsageFlags usage);
+
+SDL_GPUBuffer *gfx_record_create_buffer(SDL_GPUDevice *device, const SDL_GPUBufferCreateInfo *info);
+void gfx_record_release_buffer(SDL_GPUDevice *device, SDL_GPUBuffer *buffer);
+SDL_GPUTexture *gfx_record_create_texture(SDL_GPUDevice *device, const SDL_GPUTextureCreateInfo *info);
+void gfx_record_release_texture(SDL_GPUDevice *device, SDL_GPUTexture *texture);
+SDL_GPUSampler *gfx_record_create_sampler(SDL_GPUDevice *device, const SDL_GPUSamplerCreateInfo *info);
+void gfx_record_release_sampler(SDL_GPUDevice *device, SDL_GPUSampler *sampler);
+SDL_GPUShader *gfx_record_create_shader(SDL_GPUDevice *device, const SDL_GPUShaderCreateInfo *info);
+void gfx_record_release_shader(SDL_GPUDevice *device, SDL_GPUShader *shader);
+SDL_GPUGraphicsPipeline *gfx_record_create_pipeline(SDL_GPUDevice *device, const SDL_GPUGraphicsPipelineCreateInfo *info);
+void gfx_record_release_pipeline(SDL_GPUDevice *device, SDL_GPUGraphicsPipeline *pipeline);
+
+SDL_GPUTransferBuffer *gfx_record_create_transfer_buffer(SDL_GPUDevice *device, const SDL_GPUTransferBufferCreateInfo *info);
+void gfx_record_release_transfer_buffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transfer_buffer);
+void *gfx_record_map_transfer_buffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transfer_buffer, bool cycle);
+void gfx_record_unmap_transfer_buffer(SDL_GPUDevice *device, SDL_GPUTransferBuffer *transfer_buffer);
+
+SDL_GPUCommandBuffer *gfx_record_acquire_command_buffer(SDL_GPUDevice *device);
+bool gfx_record_submit(SDL_GPUCommandBuffer *command_buffer);
+SDL_GPUFence *gfx_record_submit_and_acquire_fence(SDL_GPUCommandBuffer *command_buffer);
+bool gfx_record_query_fence(SDL_GPUDevice *device, SDL_GPUFence *fence);
+void gfx_record_release_fence(SDL_GPUDevice *device, SDL_GPUFence *fence);
+bool gfx_record_wait_for_fences(SDL_GPUDevice *device, bool wait_all, SDL_GPUFence *const *fences, Uint32 count);
+bool gfx_record_acquire_swapchain(SDL_GPUCommandBuffer *command_buffer, SDL_Window *window, SDL_GPUTexture **texture,
+                                  Uint32 *width, Uint32 *height);
+
+SDL_GPUCopyPass *gfx_record_begin_copy_pass(SDL_GPUCommandBuffer *command_buffer);
+void gfx_record_end_copy_pass(SDL_GPUCopyPass *copy_pass);
+void gfx_record_upload_buffer(SDL_GPUCopyPass *copy_pass, const SDL_GPUTransferBufferLocation *source,
+                              const SDL_GPUBufferRegion *destination, bool cycle);
+void gfx_record_upload_texture(SDL_GPUCopyPass *copy_pass, const SDL_GPUTextureTransferInfo *source,
+                               const SDL_GPUTextureRegion *destination, bool cycle);
+
+SDL_GPURenderPass *gfx_record_begin_render_pass(SDL_GPUCommandBuffer *command_buffer, const SDL_GPUColorTargetInfo *color_targets,
+                                                Uint32 color_target_count, const SDL_GPUDepthStencilTargetInfo *depth_target);
+void gfx_record_end_render_pass(SDL_GPURenderPass *render_pass);
+void gfx_record_bind_pipeline(SDL_GPURenderPass *render_pass, SDL_GPUGraphicsPipeline *pipeline);
+void gfx_record_bind_vertex_buffers(SDL_GPURenderPass *render_pass, Uint32 first_slot, const SDL_GPUBufferBinding *bindings,
+                                    Uint32 binding_count);
+void gfx_record_bind_index_buffer(SDL_GPURenderPass *render_pass, const SDL_GPUBufferBinding *binding,
+                                  SDL_GPUIndexElementSize index_element_size);
+void gfx_record_bind_fragment_samplers(SDL_GPURenderPass *render_pass, Uint32 first_slot,
+                                       const SDL_GPUTextureSamplerBinding *bindings, Uint32 binding_count);
+void gfx_record_push_vertex_uniforms(SDL_GPUCommandBuffer *command_buffer, Uint32 slot, const void *data, Uint32 size);
+void gfx_record_draw_indexed(SDL_GPURenderPass *render_pass, Uint32 index_count, Uint32 instance_count, Uint32 first_index,
+                             Sint32 vertex_offset, Uint32 first_instance);
+
+#define SDL_CreateGPUDevice                       gfx_record_create_device
+#define SDL_DestroyGPUDevice                      gfx_record_destroy_device
+#define SDL_ClaimWindowForGPUDevice               gfx_record_claim_window
+#define SDL_GetWindowSizeInPixels                 gfx_record_get_window_size
+#define SDL_WindowSupportsGPUPresentMode          gfx_record_supports_present_mode
+#define SDL_SetGPUSwapchainParameters             gfx_record_set_swapchain_parameters
+#define SDL_GetGPUSwapchainTextureFormat          gfx_record_swapchain_format
+#define SDL_GPUTextureSupportsFormat              gfx_record_supports_format
+#define SDL_CreateGPUBuffer                       gfx_record_create_buffer
+#define SDL_ReleaseGPUBuffer                      gfx_record_release_buffer
+#define SDL_CreateGPUTexture                      gfx_record_create_texture
+#define SDL_ReleaseGPUTexture                     gfx_record_release_texture
+#define SDL_CreateGPUSampler                      gfx_record_create_sampler
+#define SDL_ReleaseGPUSampler                     gfx_record_release_sampler
+#define SDL_CreateGPUShader                       gfx_record_create_shader
+#define SDL_ReleaseGPUShader                      gfx_record_release_shader
+#define SDL_CreateGPUGraphicsPipeline             gfx_record_create_pipeline
+#define SDL_ReleaseGPUGraphicsPipeline            gfx_record_release_pipeline
+#define SDL_CreateGPUTransferBuffer               gfx_record_create_transfer_buffer
+#define SDL_ReleaseGPUTransferBuffer              gfx_record_release_transfer_buffer
+#define SDL_MapGPUTransferBuffer                  gfx_record_map_transfer_buffer
+#define SDL_UnmapGPUTransferBuffer                gfx_record_unmap_transfer_buffer
+#define SDL_AcquireGPUCommandBuffer               gfx_record_acquire_command_buffer
+#define SDL_SubmitGPUCommandBuffer                gfx_record_submit
+#define SDL_SubmitGPUCommandBufferAndAcquireFence gfx_record_submit_and_acquire_fence
+#define SDL_QueryGPUFence                         gfx_record_query_fence
+#define SDL_ReleaseGPUFence                       gfx_record_release_fence
+#define SDL_WaitForGPUFences                      gfx_record_wait_for_fences
+#define SDL_WaitAndAcquireGPUSwapchainTexture     gfx_record_acquire_swapchain
+#define SDL_BeginGPUCopyPass                      gfx_record_begin_copy_pass
+#define SDL_EndGPUCopyPass                        gfx_record_end_copy_pass
+#define SDL_UploadToGPUBuffer                     gfx_record_upload_buffer
+#define SDL_UploadToGPUTexture                    gfx_record_upload_texture
+#define SDL_BeginGPURenderPass                    gfx_record_begin_render_pass
+#define SDL_EndGPURenderPass                      gfx_record_end_render_pass
+#define SDL_BindGPUGraphicsPipeline               gfx_record_bind_pipeline
+#define SDL_BindGPUVertexBuffers                  gfx_record_bind_vertex_buffers
+#define SDL_BindGPUIndexBuffer                    gfx_record_bind_index_buffer
+#define SDL_BindGPUFragmentSamplers               gfx_record_bind_fragment_samplers
+#define SDL_PushGPUVertexUniformData              gfx_record_push_vertex_uniforms
+#define SDL_DrawGPUIndexedPrimitives              gfx_record_draw_indexed
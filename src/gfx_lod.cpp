@@ -0,0 +1,693 @@
+#include "gfx_lod.h"
+
+#include "gfx.h"
+#include "gfx_optimize.h"
+#include "profile.h"
+
+#define LOD_NONE 0xffffffffu
+
+// Border planes are weighted by squared edge length times this, so borders
+// hold their shape against the area weighted triangle planes.
+#define LOD_BORDER_WEIGHT 10.0
+
+// Seam planes only keep the seam on the surface, which its triangle planes
+// mostly do already.
+#define LOD_SEAM_WEIGHT 1.0
+
+// A level has to drop at least this fraction of the triangles of the level
+// before it to be kept.
+#define LOD_MIN_GAIN 0.1f
+
+enum Lod_Vertex_Kind : u8 {
+    LOD_INTERIOR,
+    LOD_BORDER,
+    LOD_SEAM,
+    LOD_LOCKED,
+};
+
+// Sum of squared distances to weighted planes n.p + d = 0, as the symmetric
+// matrix A = n n^T, the vector b = d n and c = d^2. Doubles, because the
+// error is a small difference of large terms far from the origin.
+struct Quadric {
+    f64 a00, a01, a02, a11, a12, a22;
+    f64 b0, b1, b2;
+    f64 c;
+    f64 weight;
+};
+
+static void quadric_add_plane(Quadric *q, glm::vec3 n, f32 d, f64 weight) {
+    f64 x = n.x, y = n.y, z = n.z;
+    q->a00 += weight * x * x;
+    q->a01 += weight * x * y;
+    q->a02 += weight * x * z;
+    q->a11 += weight * y * y;
+    q->a12 += weight * y * z;
+    q->a22 += weight * z * z;
+    q->b0  += weight * x * d;
+    q->b1  += weight * y * d;
+    q->b2  += weight * z * d;
+    q->c   += weight * d * d;
+    q->weight += weight;
+}
+
+static void quadric_add(Quadric *q, const Quadric *other) {
+    q->a00 += other->a00;
+    q->a01 += other->a01;
+    q->a02 += other->a02;
+    q->a11 += other->a11;
+    q->a12 += other->a12;
+    q->a22 += other->a22;
+    q->b0  += other->b0;
+    q->b1  += other->b1;
+    q->b2  += other->b2;
+    q->c   += other->c;
+    q->weight += other->weight;
+}
+
+// Mean squared distance of p to the planes.
+static f64 quadric_error(const Quadric *q, glm::vec3 p) {
+    if (q->weight <= 0.0) return 0.0;
+    f64 x = p.x, y = p.y, z = p.z;
+    f64 rx = q->a00 * x + q->a01 * y + q->a02 * z;
+    f64 ry = q->a01 * x + q->a11 * y + q->a12 * z;
+    f64 rz = q->a02 * x + q->a12 * y + q->a22 * z;
+    f64 error = x * rx + y * ry + z * rz + 2.0 * (q->b0 * x + q->b1 * y + q->b2 * z) + q->c;
+    return SDL_fabs(error) / q->weight;
+}
+
+// Welded edge, keyed by its vertices in the order of its first triangle.
+struct Lod_Edge {
+    u32 from;
+    u32 to;
+    u32 count;       // Triangles using it, 0 for an empty slot.
+    u32 forward;     // Of those, the ones with the first order.
+    u32 from_vertex; // The vertices of the first triangle at from and to.
+    u32 to_vertex;
+    bool seam;       // Another triangle uses other vertices at its position.
+};
+
+// Collapse of vertex v onto t.
+struct Lod_Collapse {
+    f32 cost;
+    u32 v;
+    u32 t;
+};
+
+// LSD radix sort by cost in 11-bit digits of its bits, which order like the
+// costs as they are not negative. Stable, so ties keep the edge order. The
+// result ends up in collapses.
+static void sort_collapses(Lod_Collapse *collapses, Lod_Collapse *scratch, int count) {
+    Lod_Collapse *from = collapses;
+    Lod_Collapse *to   = scratch;
+    for (u32 shift = 0; shift < 32; shift += 11) {
+        u32 offsets[2048] = {};
+        for (int i = 0; i < count; i++) {
+            u32 bits;
+            SDL_memcpy(&bits, &from[i].cost, sizeof(bits));
+            offsets[(bits >> shift) & 2047]++;
+        }
+        u32 sum = 0;
+        for (u32 &offset : offsets) {
+            u32 digit_count = offset;
+            offset = sum;
+            sum += digit_count;
+        }
+        for (int i = 0; i < count; i++) {
+            u32 bits;
+            SDL_memcpy(&bits, &from[i].cost, sizeof(bits));
+            to[offsets[(bits >> shift) & 2047]++] = from[i];
+        }
+        Lod_Collapse *swap = from;
+        from = to;
+        to   = swap;
+    }
+    // Three passes, the last one wrote to scratch.
+    SDL_memcpy(collapses, from, cast(usize)count * sizeof(Lod_Collapse));
+}
+
+// Everything but the positions is indexed by welded vertex, the first vertex
+// at a position, apart from weld and remap. The copies of a welded vertex are
+// the vertices at its position.
+struct Simplifier {
+    int vertex_count = 0;
+    const glm::vec3 *positions = NULL;
+
+    u32 *weld = NULL;
+    u8  *kind = NULL; // Lod_Vertex_Kind.
+    u32 *border_next = NULL;
+    u32 *border_prev = NULL;
+    u32 *seam_ends = NULL; // The other ends of the seam edges, two per vertex.
+    Quadric *quadrics = NULL;
+
+    u32 *indices = NULL; // The current triangles.
+    int index_count = 0;
+
+    // Scratch of a pass.
+    u32 *adjacency_offsets = NULL; // Triangles around each vertex.
+    u32 *adjacency = NULL;
+    Lod_Collapse *collapses = NULL;
+    Lod_Collapse *sorted = NULL;
+    u32 *remap = NULL;
+    u8 *touched = NULL;
+
+    // Scratch of the setup.
+    u32 weld_capacity = 0; // Powers of two.
+    u32 edge_capacity = 0;
+    u32 *weld_table = NULL;
+    Lod_Edge *edges = NULL;
+
+    // Scratch of the vertex cache pass.
+    u32 *cluster_starts = NULL;
+
+    Arena storage;
+};
+
+static void layout_simplifier(Simplifier *s, int vertex_count, int index_count, Arena *arena) {
+    usize vertices = cast(usize)vertex_count;
+    usize indices  = cast(usize)index_count;
+    s->weld              = cast(u32 *)arena_push(arena, vertices * sizeof(u32));
+    s->kind              = cast(u8 *)arena_push(arena, vertices);
+    s->border_next       = cast(u32 *)arena_push(arena, vertices * sizeof(u32));
+    s->border_prev       = cast(u32 *)arena_push(arena, vertices * sizeof(u32));
+    s->seam_ends         = cast(u32 *)arena_push(arena, vertices * 2 * sizeof(u32));
+    s->quadrics          = cast(Quadric *)arena_push(arena, vertices * sizeof(Quadric));
+    s->indices           = cast(u32 *)arena_push(arena, indices * sizeof(u32));
+    s->adjacency_offsets = cast(u32 *)arena_push(arena, (vertices + 1) * sizeof(u32));
+    s->adjacency         = cast(u32 *)arena_push(arena, indices * sizeof(u32));
+    s->collapses         = cast(Lod_Collapse *)arena_push(arena, indices * sizeof(Lod_Collapse));
+    s->sorted            = cast(Lod_Collapse *)arena_push(arena, indices * sizeof(Lod_Collapse));
+    s->remap             = cast(u32 *)arena_push(arena, vertices * sizeof(u32));
+    s->touched           = cast(u8 *)arena_push(arena, vertices);
+    s->weld_table        = cast(u32 *)arena_push(arena, s->weld_capacity * sizeof(u32));
+    s->edges             = cast(Lod_Edge *)arena_push(arena, s->edge_capacity * sizeof(Lod_Edge));
+    s->cluster_starts    = cast(u32 *)arena_push(arena, indices / 3 * sizeof(u32));
+}
+
+static u32 next_power_of_two(u32 x) {
+    u32 result = 1;
+    while (result < x) result *= 2;
+    return result;
+}
+
+// Position to weld by, -0 and 0 are the same place.
+static glm::vec3 weld_key(glm::vec3 p) {
+    return p + glm::vec3(0.0f);
+}
+
+// Slot of the edge between welded vertices a and b, empty if it is new.
+static u32 find_edge(const Simplifier *s, u32 a, u32 b) {
+    u64 key = a < b ? cast(u64)a << 32 | b : cast(u64)b << 32 | a;
+    u32 mask = s->edge_capacity - 1;
+    for (u32 slot = cast(u32)((key * 0x9e3779b97f4a7c15ull) >> 32) & mask;; slot = (slot + 1) & mask) {
+        const Lod_Edge *edge = &s->edges[slot];
+        if (edge->count == 0) return slot;
+        if ((edge->from == a && edge->to == b) || (edge->from == b && edge->to == a)) return slot;
+    }
+}
+
+// Welds the vertices, drops the triangles that are degenerate once welded,
+// classifies the vertices and accumulates their quadrics.
+static void setup_simplifier(Simplifier *s, const Gfx_Mesh *mesh) {
+    int vertex_count = s->vertex_count;
+
+    SDL_memset(s->weld_table, 0xff, s->weld_capacity * sizeof(u32));
+    u32 weld_mask = s->weld_capacity - 1;
+    for (int v = 0; v < vertex_count; v++) {
+        glm::vec3 p = weld_key(s->positions[v]);
+        for (u32 slot = cast(u32)hash_fnv1a64(&p, sizeof(p)) & weld_mask;; slot = (slot + 1) & weld_mask) {
+            u32 other = s->weld_table[slot];
+            if (other == LOD_NONE) {
+                s->weld_table[slot] = cast(u32)v;
+                s->weld[v] = cast(u32)v;
+                break;
+            }
+            glm::vec3 q = weld_key(s->positions[other]);
+            if (SDL_memcmp(&q, &p, sizeof(p)) == 0) {
+                s->weld[v] = other;
+                break;
+            }
+        }
+    }
+
+    // Vertices sharing their position are on attribute seams.
+    SDL_memset(s->kind, LOD_INTERIOR, cast(usize)vertex_count);
+    for (int v = 0; v < vertex_count; v++) {
+        if (s->weld[v] != cast(u32)v) {
+            s->kind[v] = LOD_SEAM;
+            s->kind[s->weld[v]] = LOD_SEAM;
+        }
+    }
+
+    int index_count = 0;
+    for (int i = 0; i < mesh->triangle_count * 3; i += 3) {
+        u32 a = gfx_mesh_get_index(mesh, i + 0);
+        u32 b = gfx_mesh_get_index(mesh, i + 1);
+        u32 c = gfx_mesh_get_index(mesh, i + 2);
+        if (s->weld[a] == s->weld[b] || s->weld[b] == s->weld[c] || s->weld[a] == s->weld[c]) continue;
+        s->indices[index_count++] = a;
+        s->indices[index_count++] = b;
+        s->indices[index_count++] = c;
+    }
+    s->index_count = index_count;
+
+    // The slot of the edge starting at every corner, in the adjacency
+    // scratch.
+    u32 *edge_slots = s->adjacency;
+    SDL_memset(s->edges, 0, s->edge_capacity * sizeof(Lod_Edge));
+    for (int i = 0; i < index_count; i++) {
+        u32 va = s->indices[i];
+        u32 vb = s->indices[i % 3 == 2 ? i - 2 : i + 1];
+        u32 a = s->weld[va];
+        u32 b = s->weld[vb];
+        edge_slots[i] = find_edge(s, a, b);
+        Lod_Edge *edge = &s->edges[edge_slots[i]];
+        if (edge->count == 0) {
+            edge->from        = a;
+            edge->to          = b;
+            edge->from_vertex = va;
+            edge->to_vertex   = vb;
+        }
+        edge->count++;
+        if (edge->from == a) edge->forward++;
+        if (edge->from == a) edge->seam |= edge->from_vertex != va || edge->to_vertex != vb;
+        else                 edge->seam |= edge->from_vertex != vb || edge->to_vertex != va;
+    }
+
+    // Edges of a single triangle are borders, and every border vertex needs
+    // exactly one border edge in and one out. Edges of more than two
+    // triangles, or of two with opposite winding, are not manifold. Edges
+    // whose two triangles use different vertices at an end are seams, and a
+    // seam vertex needs exactly two of them, which split the triangles
+    // around it into the two sides of the seam.
+    SDL_memset(s->border_next, 0xff, cast(usize)vertex_count * sizeof(u32));
+    SDL_memset(s->border_prev, 0xff, cast(usize)vertex_count * sizeof(u32));
+    SDL_memset(s->seam_ends, 0xff, cast(usize)vertex_count * 2 * sizeof(u32));
+    for (u32 slot = 0; slot < s->edge_capacity; slot++) {
+        const Lod_Edge *edge = &s->edges[slot];
+        if (edge->count == 0) continue;
+
+        if (edge->count > 2 || (edge->count == 2 && edge->forward != 1)) {
+            s->kind[edge->from] = LOD_LOCKED;
+            s->kind[edge->to]   = LOD_LOCKED;
+        } else if (edge->count == 1) {
+            if (s->border_next[edge->from] == LOD_NONE) s->border_next[edge->from] = edge->to;
+            else                                        s->kind[edge->from] = LOD_LOCKED;
+            if (s->border_prev[edge->to] == LOD_NONE) s->border_prev[edge->to] = edge->from;
+            else                                      s->kind[edge->to] = LOD_LOCKED;
+        } else if (edge->seam) {
+            u32 ends[2] = {edge->from, edge->to};
+            for (int k = 0; k < 2; k++) {
+                u32 *seam = &s->seam_ends[ends[k] * 2];
+                if (seam[0] == LOD_NONE)      seam[0] = ends[1 - k];
+                else if (seam[1] == LOD_NONE) seam[1] = ends[1 - k];
+                else                          s->kind[ends[k]] = LOD_LOCKED;
+            }
+        }
+    }
+    for (int v = 0; v < vertex_count; v++) {
+        if (s->kind[v] == LOD_LOCKED) continue;
+        bool next = s->border_next[v] != LOD_NONE;
+        bool prev = s->border_prev[v] != LOD_NONE;
+        if (s->kind[v] == LOD_SEAM) {
+            // Seams ending on a border, or in a corner of three, stay put.
+            if (next || prev || s->seam_ends[v * 2 + 1] == LOD_NONE) s->kind[v] = LOD_LOCKED;
+        } else if (next && prev) {
+            s->kind[v] = LOD_BORDER;
+        } else if (next || prev) {
+            s->kind[v] = LOD_LOCKED;
+        }
+    }
+
+    SDL_memset(s->quadrics, 0, cast(usize)vertex_count * sizeof(Quadric));
+    for (int i = 0; i < index_count; i += 3) {
+        u32 corners[3] = {s->indices[i], s->indices[i + 1], s->indices[i + 2]};
+        glm::vec3 p0 = s->positions[corners[0]];
+        glm::vec3 normal = glm::cross(s->positions[corners[1]] - p0, s->positions[corners[2]] - p0);
+        f32 length = glm::length(normal);
+        if (length == 0.0f) continue;
+        normal /= length;
+
+        f32 d = -glm::dot(normal, p0);
+        for (int k = 0; k < 3; k++) quadric_add_plane(&s->quadrics[s->weld[corners[k]]], normal, d, 0.5 * length);
+
+        // A plane through every border and seam edge, perpendicular to the
+        // triangle. Seam edges get one from each side.
+        for (int k = 0; k < 3; k++) {
+            u32 a = s->weld[corners[k]];
+            u32 b = s->weld[corners[(k + 1) % 3]];
+            const Lod_Edge *welded = &s->edges[edge_slots[i + k]];
+            bool border = welded->count == 1;
+            if (!border && !(welded->count == 2 && welded->seam)) continue;
+
+            glm::vec3 edge = s->positions[b] - s->positions[a];
+            glm::vec3 border_normal = glm::cross(edge, normal);
+            f32 border_length = glm::length(border_normal);
+            if (border_length == 0.0f) continue;
+            border_normal /= border_length;
+
+            f32 border_d = -glm::dot(border_normal, s->positions[a]);
+            f64 weight = cast(f64)glm::dot(edge, edge) * (border ? LOD_BORDER_WEIGHT : LOD_SEAM_WEIGHT);
+            quadric_add_plane(&s->quadrics[a], border_normal, border_d, weight);
+            quadric_add_plane(&s->quadrics[b], border_normal, border_d, weight);
+        }
+    }
+}
+
+// Whether v may collapse onto t, with its cost.
+static bool collapse_cost(const Simplifier *s, u32 v, u32 t, f32 *cost) {
+    u32 wv = s->weld[v];
+    u32 wt = s->weld[t];
+    if (s->kind[wv] == LOD_LOCKED) return false;
+    if (s->kind[wv] == LOD_BORDER && wt != s->border_next[wv] && wt != s->border_prev[wv]) return false;
+    if (s->kind[wv] == LOD_SEAM && wt != s->seam_ends[wv * 2] && wt != s->seam_ends[wv * 2 + 1]) return false;
+
+    *cost = cast(f32)quadric_error(&s->quadrics[wv], s->positions[t]);
+    return true;
+}
+
+// Whether moving v onto t turns a triangle around v over, or makes it
+// degenerate. Corners are read through the remap of the pass. Triangles
+// already collapsed, and the ones on the edge, are skipped.
+static bool collapse_flips(const Simplifier *s, u32 v, u32 t) {
+    u32 wv = s->weld[v];
+    u32 wt = s->weld[t];
+    glm::vec3 target = s->positions[t];
+
+    for (u32 ai = s->adjacency_offsets[wv]; ai < s->adjacency_offsets[wv + 1]; ai++) {
+        const u32 *triangle = &s->indices[s->adjacency[ai] * 3];
+        u32 corners[3] = {s->remap[triangle[0]], s->remap[triangle[1]], s->remap[triangle[2]]};
+        u32 w[3] = {s->weld[corners[0]], s->weld[corners[1]], s->weld[corners[2]]};
+        if (w[0] == w[1] || w[1] == w[2] || w[0] == w[2]) continue;
+        if (w[0] == wt || w[1] == wt || w[2] == wt) continue;
+
+        glm::vec3 before[3], after[3];
+        for (int k = 0; k < 3; k++) {
+            before[k] = s->positions[corners[k]];
+            after[k]  = w[k] == wv ? target : before[k];
+        }
+        glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::vec3 normal_after  = glm::cross(after[1] - after[0], after[2] - after[0]);
+        if (glm::dot(normal_before, normal_after) <= 0.0f) return true;
+    }
+    return false;
+}
+
+// Collapses the cheapest edges until target_triangles or max_cost. Returns
+// the collapse count and raises *error to the largest cost.
+//
+// Both vertices of a collapse are locked for the rest of the pass, so a
+// vertex moves at most once and never onto one that moved. The triangles
+// around a vertex stay the same set as long as it does not move itself, only
+// their corners change, which the remap tracks.
+static int simplify_pass(Simplifier *s, int target_triangles, f32 max_cost, f32 *error) {
+    int vertex_count = s->vertex_count;
+    int index_count  = s->index_count;
+
+    // Triangles around every welded vertex. remap is the fill cursor.
+    SDL_memset(s->adjacency_offsets, 0, (cast(usize)vertex_count + 1) * sizeof(u32));
+    for (int i = 0; i < index_count; i++) s->adjacency_offsets[s->weld[s->indices[i]] + 1]++;
+    for (int v = 0; v < vertex_count; v++) s->adjacency_offsets[v + 1] += s->adjacency_offsets[v];
+    SDL_memcpy(s->remap, s->adjacency_offsets, cast(usize)vertex_count * sizeof(u32));
+    for (int i = 0; i < index_count; i++) s->adjacency[s->remap[s->weld[s->indices[i]]]++] = cast(u32)(i / 3);
+
+    // Every edge once, in its cheaper direction. An edge between two
+    // triangles comes from the one where it runs from the lower welded
+    // vertex, a border edge from its only triangle.
+    int collapse_count = 0;
+    for (int i = 0; i < index_count; i++) {
+        u32 a = s->indices[i];
+        u32 b = s->indices[i % 3 == 2 ? i - 2 : i + 1];
+        if (s->weld[a] > s->weld[b] && s->border_next[s->weld[a]] != s->weld[b]) continue;
+
+        f32 cost_ab, cost_ba;
+        bool ab = collapse_cost(s, a, b, &cost_ab);
+        bool ba = collapse_cost(s, b, a, &cost_ba);
+        if (!ab && !ba) continue;
+
+        Lod_Collapse collapse;
+        if (ab && (!ba || cost_ab <= cost_ba)) collapse = {cost_ab, a, b};
+        else                                   collapse = {cost_ba, b, a};
+        if (collapse.cost <= max_cost) s->collapses[collapse_count++] = collapse;
+    }
+    sort_collapses(s->collapses, s->sorted, collapse_count);
+
+    for (int v = 0; v < vertex_count; v++) s->remap[v] = cast(u32)v;
+    SDL_memset(s->touched, 0, cast(usize)vertex_count);
+
+    int triangle_count = index_count / 3;
+    int applied = 0;
+    for (int ci = 0; ci < collapse_count && triangle_count > target_triangles; ci++) {
+        const Lod_Collapse *collapse = &s->collapses[ci];
+        u32 wv = s->weld[collapse->v];
+        u32 wt = s->weld[collapse->t];
+        if (s->touched[wv] || s->touched[wt]) continue;
+        if (collapse_flips(s, collapse->v, collapse->t)) continue;
+
+        for (u32 ai = s->adjacency_offsets[wv]; ai < s->adjacency_offsets[wv + 1]; ai++) {
+            const u32 *triangle = &s->indices[s->adjacency[ai] * 3];
+            u32 w[3] = {s->weld[s->remap[triangle[0]]], s->weld[s->remap[triangle[1]]], s->weld[s->remap[triangle[2]]]};
+            if (w[0] == w[1] || w[1] == w[2] || w[0] == w[2]) continue;
+            if (w[0] == wt || w[1] == wt || w[2] == wt) triangle_count--;
+        }
+
+        if (s->kind[wv] == LOD_SEAM) {
+            // Every copy of v moves onto the copy of t on its side of the
+            // seam, which the two triangles on the seam edge pair up. Neither
+            // moved yet, so the triangles still hold both as they were.
+            for (u32 ai = s->adjacency_offsets[wv]; ai < s->adjacency_offsets[wv + 1]; ai++) {
+                const u32 *triangle = &s->indices[s->adjacency[ai] * 3];
+                for (int k = 0; k < 3; k++) {
+                    if (s->weld[triangle[k]] != wt) continue;
+                    for (int j = 0; j < 3; j++) {
+                        if (s->weld[triangle[j]] == wv) s->remap[triangle[j]] = triangle[k];
+                    }
+                }
+            }
+
+            // The seam now runs from the other end of v to t.
+            u32 *ends = &s->seam_ends[wv * 2];
+            u32 other = ends[0] == wt ? ends[1] : ends[0];
+            for (int k = 0; k < 2; k++) {
+                if (s->seam_ends[wt * 2 + k] == wv) s->seam_ends[wt * 2 + k] = other;
+                if (s->seam_ends[other * 2 + k] == wv) s->seam_ends[other * 2 + k] = wt;
+            }
+        } else {
+            s->remap[collapse->v] = collapse->t;
+        }
+        quadric_add(&s->quadrics[wt], &s->quadrics[wv]);
+        s->touched[wv] = 1;
+        s->touched[wt] = 1;
+
+        if (s->kind[wv] == LOD_BORDER) {
+            u32 prev = s->border_prev[wv];
+            u32 next = s->border_next[wv];
+            s->border_next[prev] = next;
+            s->border_prev[next] = prev;
+        }
+
+        *error = SDL_max(*error, collapse->cost);
+        applied++;
+    }
+
+    int out = 0;
+    for (int i = 0; i < index_count; i += 3) {
+        u32 a = s->remap[s->indices[i + 0]];
+        u32 b = s->remap[s->indices[i + 1]];
+        u32 c = s->remap[s->indices[i + 2]];
+        if (s->weld[a] == s->weld[b] || s->weld[b] == s->weld[c] || s->weld[a] == s->weld[c]) continue;
+        s->indices[out++] = a;
+        s->indices[out++] = b;
+        s->indices[out++] = c;
+    }
+    s->index_count = out;
+    return applied;
+}
+
+int gfx_mesh_simplify(const Gfx_Mesh *mesh, const Gfx_Lod_Settings *settings, Gfx_Lod *lods, u32 **indices) {
+    *indices = NULL;
+    int index_count  = mesh->triangle_count * 3;
+    int vertex_count = mesh->vertex_count;
+    if (index_count == 0 || vertex_count == 0 || mesh->indices == NULL || mesh->vertices == NULL) return 0;
+
+    Simplifier s;
+    s.vertex_count  = vertex_count;
+    s.positions     = cast(const glm::vec3 *)mesh->vertices;
+    s.weld_capacity = next_power_of_two(cast(u32)vertex_count * 2);
+    s.edge_capacity = next_power_of_two(cast(u32)index_count);
+
+    Arena measure{};
+    layout_simplifier(&s, vertex_count, index_count, &measure);
+    if (!arena_init(&s.storage, measure.used)) return -1;
+    defer { arena_release(&s.storage); };
+    layout_simplifier(&s, vertex_count, index_count, &s.storage);
+
+    setup_simplifier(&s, mesh);
+
+    f32 radius = mesh->bounds.radius > 0.0f ? mesh->bounds.radius : 1.0f;
+    f32 max_cost = settings->max_error * radius * settings->max_error * radius;
+    f32 error = 0.0f;
+
+    u32 *out = NULL;
+    u32 total = 0;
+    int level_count = 0;
+    int previous = mesh->triangle_count;
+    int max_levels = SDL_min(settings->max_levels, GFX_LOD_MAX_LEVELS);
+
+    while (level_count < max_levels && previous > settings->min_triangles) {
+        int target = SDL_max(cast(int)(cast(f32)previous * settings->ratio), settings->min_triangles);
+        while (s.index_count / 3 > target && simplify_pass(&s, target, max_cost, &error) > 0) {}
+
+        int count = s.index_count;
+        if (cast(f32)(count / 3) > cast(f32)previous * (1.0f - LOD_MIN_GAIN)) break;
+
+        auto grown = cast(u32 *)SDL_realloc(out, (cast(usize)total + cast(usize)count) * sizeof(u32));
+        if (!grown) {
+            SDL_free(out);
+            return -1;
+        }
+        out = grown;
+
+        // Same as gfx_mesh_optimize(): keep the order unless Tipsify helps.
+        u32 *level = out + total;
+        gfx_optimize_vertex_cache(s.indices, level, count, vertex_count, GFX_VERTEX_CACHE_SIZE, s.cluster_starts);
+        Gfx_Vertex_Cache_Stats before = gfx_analyze_vertex_cache(s.indices, count, vertex_count, GFX_VERTEX_CACHE_SIZE);
+        Gfx_Vertex_Cache_Stats after  = gfx_analyze_vertex_cache(level, count, vertex_count, GFX_VERTEX_CACHE_SIZE);
+        if (after.acmr > before.acmr) SDL_memcpy(level, s.indices, cast(usize)count * sizeof(u32));
+
+        Gfx_Lod *lod = &lods[level_count++];
+        lod->first_index = total;
+        lod->index_count = cast(u32)count;
+        lod->error       = SDL_sqrtf(error) / radius;
+        total += cast(u32)count;
+
+        // Stopped by the error limit, the next level would be the same.
+        if (count / 3 > target) break;
+        previous = count / 3;
+    }
+
+    *indices = out;
+    return level_count;
+}
+
+struct Lod_Work {
+    const Gfx_Model *model;
+    const Gfx_Lod_Settings *settings;
+    int *level_counts;     // Per mesh, -1 on failure.
+    Gfx_Lod (*lods)[GFX_LOD_MAX_LEVELS];
+    u32 **indices;         // Per mesh.
+    void **lod_indices;    // Per mesh, in the new block.
+};
+
+static void simplify_meshes(void *data, int begin, int end) {
+    PROFILE_ZONE("lod_simplify");
+    auto work = cast(Lod_Work *)data;
+    for (int i = begin; i < end; i++) {
+        work->level_counts[i] = gfx_mesh_simplify(&work->model->meshes[i], work->settings, work->lods[i], &work->indices[i]);
+    }
+}
+
+static void layout_lods(const Gfx_Model *model, const Lod_Work *work, Arena *storage) {
+    for (int i = 0; i < model->mesh_count; i++) {
+        int level_count = work->level_counts[i];
+        work->lod_indices[i] = NULL;
+        if (level_count <= 0) continue;
+
+        const Gfx_Lod *last = &work->lods[i][level_count - 1];
+        usize count = cast(usize)last->first_index + last->index_count;
+        work->lod_indices[i] = arena_push(storage, count * model->meshes[i].index_size);
+    }
+}
+
+bool gfx_model_build_lods(Gfx_Model *model, const Gfx_Lod_Settings *settings, Job_System *jobs, bool log) {
+    Gfx_Lod_Settings defaults;
+    if (!settings) settings = &defaults;
+
+    int mesh_count = model->mesh_count;
+    if (mesh_count == 0) return true;
+
+    u64 start = SDL_GetPerformanceCounter();
+
+    Lod_Work work;
+    work.model        = model;
+    work.settings     = settings;
+    work.level_counts = cast(int *)SDL_calloc(cast(usize)mesh_count, sizeof(int));
+    work.lods         = cast(Gfx_Lod (*)[GFX_LOD_MAX_LEVELS])SDL_calloc(cast(usize)mesh_count, sizeof(*work.lods));
+    work.indices      = cast(u32 **)SDL_calloc(cast(usize)mesh_count, sizeof(u32 *));
+    work.lod_indices  = cast(void **)SDL_calloc(cast(usize)mesh_count, sizeof(void *));
+    defer {
+        for (int i = 0; work.indices && i < mesh_count; i++) SDL_free(work.indices[i]);
+        SDL_free(work.level_counts);
+        SDL_free(work.lods);
+        SDL_free(work.indices);
+        SDL_free(work.lod_indices);
+    };
+    if (!work.level_counts || !work.lods || !work.indices || !work.lod_indices) return false;
+
+    // Meshes vary a lot in size, so one per job.
+    job_parallel_for(jobs, mesh_count, 1, simplify_meshes, &work);
+
+    for (int i = 0; i < mesh_count; i++) {
+        if (work.level_counts[i] < 0) return false;
+    }
+
+    // The old levels stay until the new block exists.
+    Arena measure{};
+    layout_lods(model, &work, &measure);
+    Arena storage{};
+    if (measure.used > 0 && !arena_init(&storage, measure.used)) return false;
+    layout_lods(model, &work, &storage);
+    arena_release(&model->lods);
+    model->lods = storage;
+
+    for (int i = 0; i < mesh_count; i++) {
+        Gfx_Mesh *mesh = &model->meshes[i];
+        int level_count = SDL_max(work.level_counts[i], 0);
+        mesh->lod_count   = level_count;
+        mesh->lod_indices = work.lod_indices[i];
+        for (int l = 0; l < GFX_LOD_MAX_LEVELS; l++) mesh->lods[l] = l < level_count ? work.lods[i][l] : Gfx_Lod{};
+        if (level_count == 0) continue;
+
+        const Gfx_Lod *last = &mesh->lods[level_count - 1];
+        u32 count = last->first_index + last->index_count;
+        const u32 *indices = work.indices[i];
+        if (mesh->index_size == sizeof(u32)) {
+            SDL_memcpy(mesh->lod_indices, indices, count * sizeof(u32));
+        } else {
+            auto lod_indices = cast(u16 *)mesh->lod_indices;
+            for (u32 k = 0; k < count; k++) lod_indices[k] = cast(u16)indices[k];
+        }
+    }
+
+    if (log) {
+        f64 ms = cast(f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / cast(f64)SDL_GetPerformanceFrequency();
+
+        // Meshes with fewer levels count with their coarsest one.
+        u64 totals[GFX_LOD_MAX_LEVELS + 1] = {};
+        int max_count = 0;
+        for (int i = 0; i < mesh_count; i++) {
+            const Gfx_Mesh *mesh = &model->meshes[i];
+            char line[256];
+            int length = SDL_snprintf(line, sizeof(line), "mesh %3d: %6d tris", i, mesh->triangle_count);
+            for (int l = 0; l < mesh->lod_count && length < cast(int)sizeof(line); l++) {
+                length += SDL_snprintf(line + length, sizeof(line) - cast(usize)length, ", LOD %d %6u (%.4f)",
+                                       l + 1, mesh->lods[l].index_count / 3, mesh->lods[l].error);
+            }
+            SDL_Log("%s", line);
+
+            for (int l = 0; l <= GFX_LOD_MAX_LEVELS; l++) {
+                int level = SDL_min(l, mesh->lod_count);
+                totals[l] += level == 0 ? cast(u64)mesh->triangle_count : mesh->lods[level - 1].index_count / 3;
+            }
+            max_count = SDL_max(max_count, mesh->lod_count);
+        }
+
+        char line[256];
+        int length = SDL_snprintf(line, sizeof(line), "LODs of %d meshes in %.1f ms, triangles %llu", mesh_count, ms,
+                                  cast(unsigned long long)totals[0]);
+        for (int l = 1; l <= max_count && length < cast(int)sizeof(line); l++) {
+            length += SDL_snprintf(line + length, sizeof(line) - cast(usize)length, " -> %llu", cast(unsigned long long)totals[l]);
+        }
+        SDL_Log("%s", line);
+    }
+    return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "defines.h"
+#include "job.h"
+
+#include <glm/glm.hpp>
+
+struct Gfx_Mesh;
+struct Gfx_Model;
+
+//
+// Level of detail chains.
+//
+// gfx_model_build_lods() simplifies every mesh into up to GFX_LOD_MAX_LEVELS
+// coarser index lists over its own vertices, so all levels share the vertex
+// stream and only add indices. Meshes are simplified in parallel on the job
+// system, gfx_cache_bake() runs it after optimizing.
+//
+// The simplifier collapses edges ordered by quadric error (Garland, Heckbert,
+// "Surface Simplification Using Quadric Error Metrics", SIGGRAPH 1997). As
+// the vertices are shared it cannot place a new vertex at the optimum of the
+// quadric: an edge collapses onto one of its two vertices, whichever moves
+// the surface least. Vertices are welded by position first, so that
+// attribute seams do not look like holes, and then classified:
+//   - Interior vertices collapse onto any neighbour.
+//   - Border vertices, on an edge of a single triangle, only collapse along
+//     the border, which also gets planes through its edges in the quadrics.
+//   - Seam vertices, with more than one vertex at their position, only
+//     collapse along the seam, with all their vertices at once, each onto
+//     the vertex on its side of the seam. Seam edges get planes too.
+//   - Vertices where seams meet or end on a border, and vertices on edges of
+//     more than two triangles never move, so seams and non-manifold parts
+//     stay closed.
+// Collapses that would flip a triangle are rejected. A pass sorts all edges
+// by cost and collapses the cheapest ones whose neighbourhood no other
+// collapse of the pass touched, until the target triangle count or the
+// error limit. Each level continues from the last one, ratio times its
+// triangles, and is reordered for the vertex cache.
+//
+// The error of a level is the square root of the largest quadric error of
+// its collapses, the RMS distance of the moved vertices to their planes,
+// relative to the radius of the mesh bounds. gfx_lod_select() picks the
+// coarsest level whose error, projected to the screen, stays under a
+// threshold in fractions of the viewport height.
+//
+
+#define GFX_LOD_MAX_LEVELS 4 // Simplified levels, beyond the full mesh.
+
+// One simplified level. Levels are stored back to back in
+// Gfx_Mesh::lod_indices, each coarser than the one before.
+struct Gfx_Lod {
+    u32 first_index = 0;
+    u32 index_count = 0;
+    f32 error       = 0.0f; // Relative to the radius of the mesh bounds.
+};
+
+struct Gfx_Lod_Settings {
+    int max_levels    = GFX_LOD_MAX_LEVELS;
+    f32 ratio         = 0.5f;  // Triangles of a level relative to the one before.
+    f32 max_error     = 0.05f; // Relative to the radius of the mesh bounds.
+    int min_triangles = 64;    // Meshes this small are not simplified further.
+};
+
+// Instances and triangles per level, level 0 is the full mesh.
+struct Gfx_Lod_Stats {
+    u32 instances[GFX_LOD_MAX_LEVELS + 1] = {};
+    u64 triangles[GFX_LOD_MAX_LEVELS + 1] = {};
+    u64 full_triangles = 0; // Had every instance drawn level 0.
+};
+
+// Simplifies mesh into at most settings->max_levels levels, written to lods
+// with first_index into *indices, u32 and allocated with SDL_malloc(). Returns
+// the level count, 0 when nothing could be gained, -1 on allocation failure.
+int gfx_mesh_simplify(const Gfx_Mesh *mesh, const Gfx_Lod_Settings *settings, Gfx_Lod *lods, u32 **indices);
+
+// Replaces the levels of every mesh with new ones, built as parallel jobs,
+// serially when jobs is NULL. settings may be NULL for the defaults. Logs the
+// triangles per level of each mesh when log is set. Returns false and leaves
+// the model untouched on allocation failure.
+bool gfx_model_build_lods(Gfx_Model *model, const Gfx_Lod_Settings *settings, Job_System *jobs, bool log);
+
+// Projected radius of a bounding sphere in fractions of the viewport height,
+// depth is its distance along the view direction. Huge when the camera is
+// inside the sphere.
+inline f32 gfx_lod_screen_size(const glm::mat4 &proj, f32 radius, f32 depth) {
+    if (depth <= radius) return 1e30f;
+    return radius * proj[1][1] * 0.5f / depth;
+}
+
+// Level to draw, 0 for the full mesh: the coarsest whose error times
+// screen_size is at most threshold.
+inline int gfx_lod_select(const Gfx_Lod *lods, int lod_count, f32 screen_size, f32 threshold) {
+    int level = 0;
+    for (int i = 0; i < lod_count; i++) {
+        if (lods[i].error * screen_size > threshold) break;
+        level = i + 1;
+    }
+    return level;
+}
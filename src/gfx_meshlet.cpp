@@ -0,0 +1,324 @@
+#include "gfx_meshlet.h"
+
+#include "gfx.h"
+#include "gfx_cull.h"
+
+static glm::vec3 vertex_position(const Gfx_Mesh *mesh, u32 v) {
+    return glm::vec3(mesh->vertices[v * 3 + 0], mesh->vertices[v * 3 + 1], mesh->vertices[v * 3 + 2]);
+}
+
+// Bounding sphere and normal cone of the triangles in indices.
+static void compute_bounds(Gfx_Meshlet *meshlet, const Gfx_Mesh *mesh, const u32 *indices) {
+    int triangle_count = cast(int)meshlet->index_count / 3;
+
+    glm::vec3 lo = vertex_position(mesh, indices[0]);
+    glm::vec3 hi = lo;
+    for (u32 i = 1; i < meshlet->index_count; i++) {
+        glm::vec3 p = vertex_position(mesh, indices[i]);
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+
+    meshlet->center = (lo + hi) * 0.5f;
+    meshlet->radius = 0.0f;
+    for (u32 i = 0; i < meshlet->index_count; i++) {
+        meshlet->radius = SDL_max(meshlet->radius, glm::length(vertex_position(mesh, indices[i]) - meshlet->center));
+    }
+
+    glm::vec3 axis(0.0f);
+    for (int t = 0; t < triangle_count; t++) {
+        glm::vec3 a = vertex_position(mesh, indices[t * 3 + 0]);
+        glm::vec3 n = glm::cross(vertex_position(mesh, indices[t * 3 + 1]) - a, vertex_position(mesh, indices[t * 3 + 2]) - a);
+        f32 length = glm::length(n);
+        if (length > 0.0f) axis += n / length;
+    }
+
+    meshlet->cone_apex   = meshlet->center;
+    meshlet->cone_axis   = glm::vec3(0.0f);
+    meshlet->cone_cutoff = 1.0f;
+
+    f32 axis_length = glm::length(axis);
+    if (axis_length == 0.0f) return;
+    axis /= axis_length;
+
+    f32 min_dot = 1.0f;
+    for (int t = 0; t < triangle_count; t++) {
+        glm::vec3 a = vertex_position(mesh, indices[t * 3 + 0]);
+        glm::vec3 n = glm::cross(vertex_position(mesh, indices[t * 3 + 1]) - a, vertex_position(mesh, indices[t * 3 + 2]) - a);
+        f32 length = glm::length(n);
+        if (length > 0.0f) min_dot = SDL_min(min_dot, glm::dot(axis, n / length));
+    }
+
+    // Cones wider than ~84 degrees cull too rarely to be worth it.
+    if (min_dot <= 0.1f) return;
+
+    // Move the apex back along the axis until it is behind every triangle
+    // plane: the ray center - axis * t hits the plane of triangle (a, n) at
+    // t = dot(center - a, n) / dot(axis, n).
+    f32 max_t = 0.0f;
+    for (int t = 0; t < triangle_count; t++) {
+        glm::vec3 a = vertex_position(mesh, indices[t * 3 + 0]);
+        glm::vec3 n = glm::cross(vertex_position(mesh, indices[t * 3 + 1]) - a, vertex_position(mesh, indices[t * 3 + 2]) - a);
+        f32 length = glm::length(n);
+        if (length == 0.0f) continue;
+        n /= length;
+        max_t = SDL_max(max_t, glm::dot(meshlet->center - a, n) / glm::dot(axis, n));
+    }
+
+    meshlet->cone_apex   = meshlet->center - axis * max_t;
+    meshlet->cone_axis   = axis;
+    meshlet->cone_cutoff = SDL_sqrtf(1.0f - min_dot * min_dot);
+}
+
+bool gfx_meshlets_build(Gfx_Meshlets *out, Gfx_Mesh *mesh, int max_vertices, int max_triangles) {
+    *out = {};
+
+    ASSERT(max_vertices >= 3 && max_triangles >= 1);
+
+    int triangle_count = mesh->triangle_count;
+    int vertex_count   = mesh->vertex_count;
+    if (triangle_count == 0 || vertex_count == 0 || mesh->vertices == NULL || mesh->indices == NULL) return true;
+
+    int index_count = triangle_count * 3;
+
+    // Meshlet stamps start at 1 so that 0 means unused.
+    auto offsets   = cast(u32 *)SDL_calloc(cast(usize)vertex_count + 1, sizeof(u32));
+    auto stamp     = cast(u32 *)SDL_calloc(cast(usize)vertex_count, sizeof(u32));
+    auto adjacency = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    auto indices   = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    auto ordered   = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    auto emitted   = cast(u8 *)SDL_calloc(cast(usize)triangle_count, sizeof(u8));
+    auto local     = cast(u32 *)SDL_malloc(cast(usize)max_vertices * sizeof(u32));
+    auto centroids = cast(glm::vec3 *)SDL_malloc(cast(usize)triangle_count * sizeof(glm::vec3));
+
+    // Every meshlet has at least one triangle.
+    auto meshlets  = cast(Gfx_Meshlet *)SDL_malloc(cast(usize)triangle_count * sizeof(Gfx_Meshlet));
+    defer {
+        SDL_free(offsets);
+        SDL_free(stamp);
+        SDL_free(adjacency);
+        SDL_free(indices);
+        SDL_free(ordered);
+        SDL_free(emitted);
+        SDL_free(local);
+        SDL_free(centroids);
+    };
+    if (!offsets || !stamp || !adjacency || !indices || !ordered || !emitted || !local || !centroids || !meshlets) {
+        SDL_free(meshlets);
+        return false;
+    }
+
+    for (int i = 0; i < index_count; i++) indices[i] = gfx_mesh_get_index(mesh, i);
+    for (int t = 0; t < triangle_count; t++) {
+        centroids[t] = (vertex_position(mesh, indices[t * 3 + 0]) + vertex_position(mesh, indices[t * 3 + 1]) +
+                        vertex_position(mesh, indices[t * 3 + 2])) / 3.0f;
+    }
+
+    // Vertex to triangle adjacency.
+    for (int i = 0; i < index_count; i++) offsets[indices[i] + 1]++;
+    for (int v = 0; v < vertex_count; v++) offsets[v + 1] += offsets[v];
+    for (int i = 0; i < index_count; i++) {
+        u32 v = indices[i];
+        adjacency[offsets[v]++] = cast(u32)(i / 3);
+    }
+    for (int v = vertex_count; v > 0; v--) offsets[v] = offsets[v - 1];
+    offsets[0] = 0;
+
+    int meshlet_count = 0;
+    int out_count = 0;
+    int cursor = 0; // First triangle that may still be unemitted.
+
+    Gfx_Meshlet *meshlet = NULL;
+    int local_count = 0;
+    glm::vec3 centroid_sum(0.0f);
+
+    auto new_vertices = [&](u32 t) {
+        u32 a = indices[t * 3 + 0];
+        u32 b = indices[t * 3 + 1];
+        u32 c = indices[t * 3 + 2];
+        u32 id = cast(u32)meshlet_count;
+        return (stamp[a] != id) + (stamp[b] != id && b != a) + (stamp[c] != id && c != a && c != b);
+    };
+
+    while (out_count < index_count) {
+        s64 next = -1;
+
+        if (meshlet != NULL) {
+            // Look for the best triangle sharing a vertex with the meshlet.
+            glm::vec3 centroid = centroid_sum / (cast(f32)meshlet->index_count / 3.0f);
+            int best_new = 4;
+            f32 best_distance = 0.0f;
+
+            for (int li = 0; li < local_count; li++) {
+                u32 v = local[li];
+                for (u32 ai = offsets[v]; ai < offsets[v + 1]; ai++) {
+                    u32 t = adjacency[ai];
+                    if (emitted[t]) continue;
+
+                    int added = new_vertices(t);
+                    if (local_count + added > max_vertices || added > best_new) continue;
+
+                    glm::vec3 d = centroids[t] - centroid;
+                    f32 distance = glm::dot(d, d);
+                    if (next < 0 || added < best_new || distance < best_distance) {
+                        best_new = added;
+                        best_distance = distance;
+                        next = t;
+                    }
+                }
+            }
+
+            if (next < 0) meshlet = NULL;
+        }
+
+        if (meshlet == NULL) {
+            while (emitted[cursor]) cursor++;
+            next = cursor;
+
+            meshlet = &meshlets[meshlet_count++];
+            *meshlet = {};
+            meshlet->first_index = cast(u32)out_count;
+            local_count = 0;
+            centroid_sum = glm::vec3(0.0f);
+        }
+
+        u32 t = cast(u32)next;
+        emitted[t] = 1;
+        centroid_sum += centroids[t];
+
+        u32 id = cast(u32)meshlet_count;
+        for (int k = 0; k < 3; k++) {
+            u32 v = indices[t * 3 + k];
+            if (stamp[v] != id) {
+                stamp[v] = id;
+                local[local_count++] = v;
+            }
+            ordered[out_count++] = v;
+        }
+        meshlet->index_count += 3;
+        meshlet->vertex_count = cast(u32)local_count;
+
+        if (cast(int)meshlet->index_count / 3 >= max_triangles || local_count >= max_vertices) meshlet = NULL;
+    }
+
+    for (int mi = 0; mi < meshlet_count; mi++) {
+        compute_bounds(&meshlets[mi], mesh, ordered + meshlets[mi].first_index);
+    }
+    for (int i = 0; i < index_count; i++) gfx_mesh_set_index(mesh, i, ordered[i]);
+
+    out->count    = meshlet_count;
+    out->meshlets = meshlets;
+    return true;
+}
+
+void gfx_meshlets_free(Gfx_Meshlets *meshlets) {
+    SDL_free(meshlets->meshlets);
+    *meshlets = {};
+}
+
+struct Meshlet_Work {
+    Gfx_Model *model;
+    Gfx_Meshlets *meshlets;
+    bool *built;
+};
+
+static void build_meshes(void *data, int begin, int end) {
+    auto work = cast(Meshlet_Work *)data;
+    for (int i = begin; i < end; i++) {
+        work->built[i] = gfx_meshlets_build(&work->meshlets[i], &work->model->meshes[i], GFX_MESHLET_MAX_VERTICES,
+                                            GFX_MESHLET_MAX_TRIANGLES);
+    }
+}
+
+bool gfx_model_build_meshlets(Gfx_Model *model, Job_System *jobs) {
+    int mesh_count = model->mesh_count;
+
+    // The old tables no longer match once the triangles are reordered.
+    for (int i = 0; i < mesh_count; i++) model->meshes[i].meshlets = {};
+    arena_release(&model->meshlets);
+    if (mesh_count == 0) return true;
+
+    Meshlet_Work work;
+    work.model    = model;
+    work.meshlets = cast(Gfx_Meshlets *)SDL_calloc(cast(usize)mesh_count, sizeof(Gfx_Meshlets));
+    work.built    = cast(bool *)SDL_calloc(cast(usize)mesh_count, sizeof(bool));
+    defer {
+        for (int i = 0; work.meshlets && i < mesh_count; i++) gfx_meshlets_free(&work.meshlets[i]);
+        SDL_free(work.meshlets);
+        SDL_free(work.built);
+    };
+    if (!work.meshlets || !work.built) return false;
+
+    // Meshes vary a lot in size, so one per job.
+    job_parallel_for(jobs, mesh_count, 1, build_meshes, &work);
+
+    for (int i = 0; i < mesh_count; i++) {
+        if (!work.built[i]) return false;
+    }
+
+    auto layout = [&](Arena *arena) {
+        for (int i = 0; i < mesh_count; i++) {
+            usize size = cast(usize)work.meshlets[i].count * sizeof(Gfx_Meshlet);
+            if (size > 0) model->meshes[i].meshlets.meshlets = cast(Gfx_Meshlet *)arena_push(arena, size);
+        }
+    };
+
+    Arena measure{};
+    layout(&measure);
+    if (measure.used == 0) return true;
+    Arena storage{};
+    if (!arena_init(&storage, measure.used)) return false;
+    layout(&storage);
+    model->meshlets = storage;
+
+    for (int i = 0; i < mesh_count; i++) {
+        Gfx_Meshlets *meshlets = &model->meshes[i].meshlets;
+        meshlets->count = work.meshlets[i].count;
+        if (meshlets->count > 0) {
+            SDL_memcpy(meshlets->meshlets, work.meshlets[i].meshlets, cast(usize)meshlets->count * sizeof(Gfx_Meshlet));
+        }
+    }
+    return true;
+}
+
+int gfx_meshlets_cull(const Gfx_Meshlets *meshlets, const glm::mat4 &mvp, glm::vec3 eye, Gfx_Draw_Range *ranges,
+                      Gfx_Meshlet_Cull_Stats *stats) {
+    Gfx_Frustum frustum = gfx_frustum_from_matrix(mvp);
+
+    int range_count = 0;
+    int frustum_culled = 0;
+    int backface_culled = 0;
+
+    for (int i = 0; i < meshlets->count; i++) {
+        const Gfx_Meshlet *meshlet = &meshlets->meshlets[i];
+
+        if (!gfx_frustum_test_sphere(&frustum, meshlet->center, meshlet->radius)) {
+            frustum_culled++;
+            continue;
+        }
+
+        glm::vec3 to_apex = meshlet->cone_apex - eye;
+        f32 distance = glm::length(to_apex);
+        if (distance > 0.0f && glm::dot(to_apex, meshlet->cone_axis) >= meshlet->cone_cutoff * distance) {
+            backface_culled++;
+            continue;
+        }
+
+        // Meshlets are stored in index order, so neighbours merge into one draw.
+        if (range_count > 0) {
+            Gfx_Draw_Range *last = &ranges[range_count - 1];
+            if (last->first_index + last->index_count == meshlet->first_index) {
+                last->index_count += meshlet->index_count;
+                continue;
+            }
+        }
+        ranges[range_count++] = {meshlet->first_index, meshlet->index_count};
+    }
+
+    if (stats) {
+        stats->total           += meshlets->count;
+        stats->frustum_culled  += frustum_culled;
+        stats->backface_culled += backface_culled;
+    }
+    return range_count;
+}
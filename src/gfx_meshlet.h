@@ -0,0 +1,80 @@
+#pragma once
+
+#include "defines.h"
+
+#include <glm/glm.hpp>
+
+struct Gfx_Mesh;
+struct Gfx_Model;
+struct Job_System;
+
+//
+// Meshlets: small clusters of connected triangles with their own bounds, so
+// parts of a mesh can be culled on the CPU before drawing.
+//
+// gfx_meshlets_build() reorders the triangles of a mesh so every meshlet is a
+// contiguous range of its index buffer. Build them before the mesh is
+// uploaded. The mesh cache builds them at bake time with
+// gfx_model_build_meshlets(), before gfx_model_optimize(), and stores them
+// with the mesh (see gfx_cache.h), so cached meshes have them on load. Culling then returns the surviving index ranges, with adjacent
+// ranges merged, which are drawn with one SDL_DrawGPUIndexedPrimitives each.
+//
+// Each meshlet has a bounding sphere for frustum culling and a normal cone
+// for backface culling. The cone test follows meshoptimizer: the meshlet
+// faces away from every eye position with
+//
+//     dot(normalize(cone_apex - eye), cone_axis) >= cone_cutoff
+//
+// Meshlets whose triangle normals spread too far get a zero axis, which never
+// passes the test.
+//
+
+#define GFX_MESHLET_MAX_VERTICES  64
+#define GFX_MESHLET_MAX_TRIANGLES 124
+
+struct Gfx_Meshlet {
+    // Object space.
+    glm::vec3 center;
+    f32 radius;
+
+    glm::vec3 cone_apex;
+    glm::vec3 cone_axis;
+    f32 cone_cutoff;
+
+    u32 first_index;
+    u32 index_count;
+    u32 vertex_count;
+};
+
+struct Gfx_Meshlets {
+    int count = 0;
+    Gfx_Meshlet *meshlets = NULL;
+};
+
+struct Gfx_Draw_Range {
+    u32 first_index;
+    u32 index_count;
+};
+
+struct Gfx_Meshlet_Cull_Stats {
+    int total           = 0;
+    int frustum_culled  = 0;
+    int backface_culled = 0;
+};
+
+// Greedily grows meshlets over shared vertices, preferring triangles that add
+// the fewest new vertices. Rewrites the mesh indices. Returns false on
+// allocation failure, the mesh is unchanged then.
+bool gfx_meshlets_build(Gfx_Meshlets *out, Gfx_Mesh *mesh, int max_vertices, int max_triangles);
+void gfx_meshlets_free(Gfx_Meshlets *meshlets);
+
+// Builds the meshlets of every mesh into Gfx_Mesh::meshlets, replacing the
+// old ones. jobs may be NULL. Returns false on allocation failure, the meshes
+// have no meshlets then.
+bool gfx_model_build_meshlets(Gfx_Model *model, Job_System *jobs);
+
+// mvp transforms from object to clip space, eye is the camera position in
+// object space. ranges needs room for meshlets->count entries. Returns the
+// number of ranges written. stats may be NULL, counts are added to it.
+int gfx_meshlets_cull(const Gfx_Meshlets *meshlets, const glm::mat4 &mvp, glm::vec3 eye, Gfx_Draw_Range *ranges,
+                      Gfx_Meshlet_Cull_Stats *stats);
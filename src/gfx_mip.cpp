@@ -0,0 +1,423 @@
+#include "gfx_mip.h"
+
+#include <SDL3/SDL.h>
+
+#if SIMD_SSE2
+    #include <emmintrin.h>
+#endif
+
+#define MAX_SIZE 32768
+
+// Kaiser-windowed sinc, radius in destination texels.
+#define KAISER_TAPS   8
+#define KAISER_RADIUS 2.0
+#define KAISER_ALPHA  4.0
+
+// Texels per job, rows are batched up to this.
+#define JOB_TEXELS 8192
+
+//
+// Conversions.
+//
+
+// Linear to sRGB is a table over [0, 1] fine enough to round correctly
+// near black, where the curve is steepest.
+#define SRGB_ENCODE_SIZE 16384
+
+struct Srgb_Tables {
+    f32 srgb_decode[256];
+    f32 unorm_decode[256];
+    u8 srgb_encode[SRGB_ENCODE_SIZE];
+};
+
+static Srgb_Tables build_srgb_tables() {
+    Srgb_Tables tables;
+    for (int i = 0; i < 256; i++) {
+        f64 c = i / 255.0;
+        tables.srgb_decode[i]  = cast(f32)(c <= 0.04045 ? c / 12.92 : SDL_pow((c + 0.055) / 1.055, 2.4));
+        tables.unorm_decode[i] = cast(f32)c;
+    }
+    for (int i = 0; i < SRGB_ENCODE_SIZE; i++) {
+        f64 l = i / cast(f64)(SRGB_ENCODE_SIZE - 1);
+        f64 c = l <= 0.0031308 ? l * 12.92 : 1.055 * SDL_pow(l, 1.0 / 2.4) - 0.055;
+        tables.srgb_encode[i] = cast(u8)(c * 255.0 + 0.5);
+    }
+    return tables;
+}
+
+// Built on first use, thread-safe.
+static const Srgb_Tables *srgb_tables() {
+    static const Srgb_Tables tables = build_srgb_tables();
+    return &tables;
+}
+
+//
+// One RGBA texel of floats.
+//
+
+#if SIMD_SSE2
+
+typedef __m128 Texel;
+
+static inline Texel texel_load(const f32 *p)              { return _mm_loadu_ps(p); }
+static inline void  texel_store(f32 *p, Texel t)          { _mm_storeu_ps(p, t); }
+static inline Texel texel_zero()                          { return _mm_setzero_ps(); }
+static inline Texel texel_add(Texel a, Texel b)           { return _mm_add_ps(a, b); }
+static inline Texel texel_scale(Texel a, f32 s)           { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+static inline Texel texel_madd(Texel acc, Texel a, f32 w) { return _mm_add_ps(acc, _mm_mul_ps(a, _mm_set1_ps(w))); }
+static inline Texel texel_saturate(Texel a)               { return _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f)); }
+
+#else
+
+struct Texel {
+    f32 v[4];
+};
+
+static inline Texel texel_load(const f32 *p)     { return {{p[0], p[1], p[2], p[3]}}; }
+static inline void  texel_store(f32 *p, Texel t) { for (int i = 0; i < 4; i++) p[i] = t.v[i]; }
+static inline Texel texel_zero()                 { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+
+static inline Texel texel_add(Texel a, Texel b) {
+    for (int i = 0; i < 4; i++) a.v[i] += b.v[i];
+    return a;
+}
+
+static inline Texel texel_scale(Texel a, f32 s) {
+    for (int i = 0; i < 4; i++) a.v[i] *= s;
+    return a;
+}
+
+static inline Texel texel_madd(Texel acc, Texel a, f32 w) {
+    for (int i = 0; i < 4; i++) acc.v[i] += a.v[i] * w;
+    return acc;
+}
+
+static inline Texel texel_saturate(Texel a) {
+    for (int i = 0; i < 4; i++) a.v[i] = SDL_clamp(a.v[i], 0.0f, 1.0f);
+    return a;
+}
+
+#endif
+
+//
+// Levels.
+//
+
+struct Mip_Work {
+    bool srgb;
+    const Srgb_Tables *tables;
+
+    // The level above, as RGBA8 for level 0 and as linear floats after.
+    const u8 *src_pixels;
+    const f32 *src;
+    int src_width;
+    int src_height;
+
+    f32 *dst;
+    u8 *dst_pixels;
+    int dst_width;
+    int dst_height;
+
+    // Kaiser: the horizontal pass writes dst_width x src_height texels to
+    // tmp, and every output texel reads KAISER_TAPS clamped source indices.
+    f32 *tmp;
+    const s32 *x_index;
+    const f32 *x_weights;
+    const s32 *y_index;
+    const f32 *y_weights;
+
+    // Set by a job that could not allocate its scratch.
+    SDL_AtomicInt failed;
+};
+
+static f64 sinc(f64 x) {
+    if (SDL_fabs(x) < 1e-9) return 1.0;
+    return SDL_sin(SDL_PI_D * x) / (SDL_PI_D * x);
+}
+
+// Modified Bessel function of the first kind, order 0.
+static f64 bessel_i0(f64 x) {
+    f64 sum  = 1.0;
+    f64 term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum  += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+// d in destination texels.
+static f64 kaiser(f64 d) {
+    if (SDL_fabs(d) >= KAISER_RADIUS) return 0.0;
+    f64 t = d / KAISER_RADIUS;
+    return sinc(d) * bessel_i0(KAISER_ALPHA * SDL_sqrt(1.0 - t * t)) / bessel_i0(KAISER_ALPHA);
+}
+
+// Taps of every destination texel along one axis, normalized to sum to 1.
+static void kaiser_taps(int src_size, int dst_size, s32 *index, f32 *weights) {
+    f64 scale = cast(f64)src_size / cast(f64)dst_size;
+    for (int i = 0; i < dst_size; i++) {
+        f64 center = (i + 0.5) * scale - 0.5;
+        int first  = cast(int)SDL_floor(center) - KAISER_TAPS / 2 + 1;
+
+        f64 w[KAISER_TAPS];
+        f64 sum = 0.0;
+        for (int k = 0; k < KAISER_TAPS; k++) {
+            w[k] = kaiser((first + k - center) / scale);
+            sum += w[k];
+        }
+        for (int k = 0; k < KAISER_TAPS; k++) {
+            index[i * KAISER_TAPS + k]   = SDL_clamp(first + k, 0, src_size - 1);
+            weights[i * KAISER_TAPS + k] = cast(f32)(w[k] / sum);
+        }
+    }
+}
+
+static void decode_row(const Mip_Work *work, const u8 *pixels, f32 *out, int width) {
+    const f32 *rgb   = work->srgb ? work->tables->srgb_decode : work->tables->unorm_decode;
+    const f32 *alpha = work->tables->unorm_decode;
+    for (int x = 0; x < width * 4; x += 4) {
+        out[x + 0] = rgb[pixels[x + 0]];
+        out[x + 1] = rgb[pixels[x + 1]];
+        out[x + 2] = rgb[pixels[x + 2]];
+        out[x + 3] = alpha[pixels[x + 3]];
+    }
+}
+
+// Clamps the row to [0, 1] in place, then writes it as RGBA8.
+static void encode_row(const Mip_Work *work, f32 *row, u8 *out, int width) {
+    const u8 *encode = work->tables->srgb_encode;
+    f32 rgb_scale = work->srgb ? cast(f32)(SRGB_ENCODE_SIZE - 1) : 255.0f;
+
+#if SIMD_SSE2
+    const __m128 scale = _mm_setr_ps(rgb_scale, rgb_scale, rgb_scale, 255.0f);
+    alignas(16) s32 q[4];
+    for (int x = 0; x < width; x++) {
+        Texel t = texel_saturate(texel_load(row + x * 4));
+        texel_store(row + x * 4, t);
+
+        // Rounds half up like the scalar path, the values are not negative.
+        _mm_store_si128(cast(__m128i *)q, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(t, scale), _mm_set1_ps(0.5f))));
+        u8 *texel = out + x * 4;
+        if (work->srgb) {
+            texel[0] = encode[q[0]];
+            texel[1] = encode[q[1]];
+            texel[2] = encode[q[2]];
+        } else {
+            texel[0] = cast(u8)q[0];
+            texel[1] = cast(u8)q[1];
+            texel[2] = cast(u8)q[2];
+        }
+        texel[3] = cast(u8)q[3];
+    }
+#else
+    for (int x = 0; x < width * 4; x += 4) {
+        for (int c = 0; c < 4; c++) row[x + c] = SDL_clamp(row[x + c], 0.0f, 1.0f);
+        for (int c = 0; c < 3; c++) {
+            int q = cast(int)(row[x + c] * rgb_scale + 0.5f);
+            out[x + c] = work->srgb ? encode[q] : cast(u8)q;
+        }
+        out[x + 3] = cast(u8)(row[x + 3] * 255.0f + 0.5f);
+    }
+#endif
+}
+
+// Row y of the source level, decoded into scratch for level 0.
+static const f32 *source_row(const Mip_Work *work, int y, f32 *scratch) {
+    if (work->src) return work->src + cast(usize)y * cast(usize)work->src_width * 4;
+    decode_row(work, work->src_pixels + cast(usize)y * cast(usize)work->src_width * 4, scratch, work->src_width);
+    return scratch;
+}
+
+// Allocates scratch for two decoded source rows when the source is level 0.
+static f32 *row_scratch(Mip_Work *work) {
+    if (work->src) return NULL;
+    auto scratch = cast(f32 *)SDL_malloc(cast(usize)work->src_width * 2 * 4 * sizeof(f32));
+    if (!scratch) SDL_SetAtomicInt(&work->failed, 1);
+    return scratch;
+}
+
+static void box_rows(void *data, int begin, int end) {
+    auto work = cast(Mip_Work *)data;
+    f32 *scratch = row_scratch(work);
+    if (!work->src && !scratch) return;
+    defer { SDL_free(scratch); };
+
+    int sw = work->src_width;
+    int dw = work->dst_width;
+    for (int y = begin; y < end; y++) {
+        int y0 = SDL_min(2 * y, work->src_height - 1);
+        int y1 = SDL_min(2 * y + 1, work->src_height - 1);
+        const f32 *r0 = source_row(work, y0, scratch);
+        const f32 *r1 = source_row(work, y1, scratch ? scratch + sw * 4 : NULL);
+
+        f32 *out = work->dst + cast(usize)y * cast(usize)dw * 4;
+        for (int x = 0; x < dw; x++) {
+            int x0 = SDL_min(2 * x, sw - 1) * 4;
+            int x1 = SDL_min(2 * x + 1, sw - 1) * 4;
+            Texel sum = texel_add(texel_add(texel_load(r0 + x0), texel_load(r0 + x1)),
+                                  texel_add(texel_load(r1 + x0), texel_load(r1 + x1)));
+            texel_store(out + x * 4, texel_scale(sum, 0.25f));
+        }
+
+        encode_row(work, out, work->dst_pixels + cast(usize)y * cast(usize)dw * 4, dw);
+    }
+}
+
+// Horizontal pass over source rows into tmp.
+static void kaiser_rows_x(void *data, int begin, int end) {
+    auto work = cast(Mip_Work *)data;
+    f32 *scratch = row_scratch(work);
+    if (!work->src && !scratch) return;
+    defer { SDL_free(scratch); };
+
+    int dw = work->dst_width;
+    for (int y = begin; y < end; y++) {
+        const f32 *row = source_row(work, y, scratch);
+        f32 *out = work->tmp + cast(usize)y * cast(usize)dw * 4;
+
+        for (int x = 0; x < dw; x++) {
+            const s32 *index   = work->x_index + x * KAISER_TAPS;
+            const f32 *weights = work->x_weights + x * KAISER_TAPS;
+
+            Texel sum = texel_zero();
+            for (int k = 0; k < KAISER_TAPS; k++) sum = texel_madd(sum, texel_load(row + index[k] * 4), weights[k]);
+            texel_store(out + x * 4, sum);
+        }
+    }
+}
+
+// Vertical pass over destination rows, from tmp.
+static void kaiser_rows_y(void *data, int begin, int end) {
+    auto work = cast(Mip_Work *)data;
+
+    int dw = work->dst_width;
+    usize stride = cast(usize)dw * 4;
+    for (int y = begin; y < end; y++) {
+        const s32 *index   = work->y_index + y * KAISER_TAPS;
+        const f32 *weights = work->y_weights + y * KAISER_TAPS;
+
+        const f32 *rows[KAISER_TAPS];
+        for (int k = 0; k < KAISER_TAPS; k++) rows[k] = work->tmp + cast(usize)index[k] * stride;
+
+        f32 *out = work->dst + cast(usize)y * stride;
+        for (int x = 0; x < dw * 4; x += 4) {
+            Texel sum = texel_zero();
+            for (int k = 0; k < KAISER_TAPS; k++) sum = texel_madd(sum, texel_load(rows[k] + x), weights[k]);
+            texel_store(out + x, sum);
+        }
+
+        encode_row(work, out, work->dst_pixels + cast(usize)y * stride, dw);
+    }
+}
+
+int gfx_mip_level_count(int width, int height) {
+    int size = SDL_max(width, height);
+    int count = 1;
+    while (size > 1) {
+        size >>= 1;
+        count++;
+    }
+    return count;
+}
+
+bool gfx_mip_chain_build(Gfx_Mip_Chain *chain, const u8 *pixels, int width, int height, Gfx_Mip_Filter filter, bool srgb,
+                         Job_System *jobs) {
+    *chain = {};
+    if (pixels == NULL || width <= 0 || height <= 0 || width > MAX_SIZE || height > MAX_SIZE) return false;
+
+    int level_count = gfx_mip_level_count(width, height);
+    usize size = 0;
+    usize float_count = 0; // Levels 1 and up.
+    for (int i = 0; i < level_count; i++) {
+        Gfx_Mip_Level *level = &chain->levels[i];
+        level->width  = SDL_max(width >> i, 1);
+        level->height = SDL_max(height >> i, 1);
+        level->offset = size;
+        level->size   = cast(usize)level->width * cast(usize)level->height * 4;
+        size += level->size;
+        if (i > 0) float_count += level->size;
+    }
+
+    chain->data = cast(u8 *)SDL_malloc(size);
+    if (!chain->data) return false;
+    chain->size = size;
+    chain->level_count = level_count;
+    SDL_memcpy(chain->data, pixels, chain->levels[0].size);
+    if (level_count == 1) return true;
+
+    // Linear copies of levels 1 and up, then Kaiser scratch sized for level 1,
+    // the largest.
+    int max_width  = chain->levels[1].width;
+    int max_height = chain->levels[1].height;
+    usize tmp_count = filter == GFX_MIP_FILTER_KAISER ? cast(usize)max_width * cast(usize)height * 4 : 0;
+    auto floats = cast(f32 *)SDL_malloc((float_count + tmp_count) * sizeof(f32));
+    auto taps   = filter == GFX_MIP_FILTER_KAISER ? cast(u8 *)SDL_malloc(cast(usize)(max_width + max_height) * KAISER_TAPS * (sizeof(s32) + sizeof(f32))) : NULL;
+    defer {
+        SDL_free(floats);
+        SDL_free(taps);
+    };
+    if (!floats || (filter == GFX_MIP_FILTER_KAISER && !taps)) {
+        gfx_mip_chain_free(chain);
+        return false;
+    }
+
+    Mip_Work work{};
+    work.srgb   = srgb;
+    work.tables = srgb_tables();
+    work.tmp    = floats + float_count;
+    if (taps) {
+        usize x_taps = cast(usize)max_width * KAISER_TAPS;
+        usize y_taps = cast(usize)max_height * KAISER_TAPS;
+        work.x_index   = cast(s32 *)taps;
+        work.y_index   = work.x_index + x_taps;
+        work.x_weights = cast(f32 *)(work.y_index + y_taps);
+        work.y_weights = work.x_weights + x_taps;
+    }
+
+    f32 *level_floats = floats;
+    for (int i = 1; i < level_count; i++) {
+        const Gfx_Mip_Level *src = &chain->levels[i - 1];
+        const Gfx_Mip_Level *dst = &chain->levels[i];
+
+        work.src_pixels = chain->data + src->offset;
+        work.src        = i == 1 ? NULL : level_floats - src->size;
+        work.src_width  = src->width;
+        work.src_height = src->height;
+        work.dst        = level_floats;
+        work.dst_pixels = chain->data + dst->offset;
+        work.dst_width  = dst->width;
+        work.dst_height = dst->height;
+
+        if (filter == GFX_MIP_FILTER_BOX) {
+            job_parallel_for(jobs, dst->height, SDL_max(JOB_TEXELS / src->width, 1), box_rows, &work);
+        } else {
+            kaiser_taps(src->width, dst->width, cast(s32 *)work.x_index, cast(f32 *)work.x_weights);
+            kaiser_taps(src->height, dst->height, cast(s32 *)work.y_index, cast(f32 *)work.y_weights);
+            job_parallel_for(jobs, src->height, SDL_max(JOB_TEXELS / src->width, 1), kaiser_rows_x, &work);
+            job_parallel_for(jobs, dst->height, SDL_max(JOB_TEXELS / dst->width, 1), kaiser_rows_y, &work);
+        }
+
+        if (SDL_GetAtomicInt(&work.failed)) {
+            gfx_mip_chain_free(chain);
+            return false;
+        }
+        level_floats += dst->size;
+    }
+
+    return true;
+}
+
+void gfx_mip_chain_free(Gfx_Mip_Chain *chain) {
+    SDL_free(chain->data);
+    *chain = {};
+}
+
+const char *gfx_mip_filter_name(Gfx_Mip_Filter filter) {
+    switch (filter) {
+        case GFX_MIP_FILTER_BOX:    return "box";
+        case GFX_MIP_FILTER_KAISER: return "kaiser";
+        default:                    return "unknown";
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "defines.h"
+#include "job.h"
+
+//
+// CPU mip chain generation for RGBA8 images.
+//
+// Every level is filtered from the one above it. Color is filtered in linear
+// space: with srgb set, RGB is decoded from sRGB first and encoded again for
+// every level, so dark and bright texels average the way they look. Alpha is
+// always linear. Intermediate levels are kept as floats, so rounding does not
+// add up down the chain.
+//
+// The box filter averages 2x2 blocks and drops an odd last row or column.
+// The Kaiser filter is a windowed sinc over 8 taps per axis, run as two
+// separable passes. It keeps more detail and handles odd sizes, at a few
+// times the cost. Both process one RGBA texel per SSE2 register.
+//
+// Rows of a level are filtered as parallel jobs when jobs is set.
+//
+
+#define GFX_MIP_MAX_LEVELS 16
+
+enum Gfx_Mip_Filter {
+    GFX_MIP_FILTER_BOX,
+    GFX_MIP_FILTER_KAISER,
+
+    GFX_MIP_FILTER_COUNT,
+};
+
+struct Gfx_Mip_Level {
+    int width;
+    int height;
+    usize offset; // Into Gfx_Mip_Chain::data.
+    usize size;
+};
+
+// RGBA8 levels, largest first, in one block.
+struct Gfx_Mip_Chain {
+    int level_count = 0;
+    Gfx_Mip_Level levels[GFX_MIP_MAX_LEVELS];
+    u8 *data   = NULL;
+    usize size = 0;
+};
+
+// Levels down to 1x1, halving and rounding down: 1 + log2(max(width, height)).
+int gfx_mip_level_count(int width, int height);
+
+// Builds the full chain, level 0 is a copy of pixels. Returns false on
+// allocation failure or a size above 32768.
+bool gfx_mip_chain_build(Gfx_Mip_Chain *chain, const u8 *pixels, int width, int height, Gfx_Mip_Filter filter, bool srgb,
+                         Job_System *jobs = NULL);
+void gfx_mip_chain_free(Gfx_Mip_Chain *chain);
+
+const char *gfx_mip_filter_name(Gfx_Mip_Filter filter);
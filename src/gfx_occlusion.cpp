@@ -0,0 +1,796 @@
+#include "gfx_occlusion.h"
+
+#include "gfx.h"
+
+#include <SDL3/SDL.h>
+
+#if SIMD_SSE2
+    #include <emmintrin.h>
+#endif
+
+#if SIMD_AVX2
+    #include <immintrin.h>
+#endif
+
+// Half extent of the clip region in screen sizes. Triangles reaching past it
+// are clipped, which keeps the edge equations of huge triangles precise.
+#define OCCLUSION_GUARD_BAND 2.0f
+
+// Near plane and the four guard band planes.
+#define OCCLUSION_CLIP_PLANES 5
+#define OCCLUSION_MAX_CLIPPED (3 + OCCLUSION_CLIP_PLANES)
+
+// A box is hidden only when it is this much farther than the occluders, in
+// 1/w, so an occluder never hides its own bounds.
+#define OCCLUSION_DEPTH_BIAS (1.0f / 1024.0f)
+
+struct Gfx_Occlusion_Triangle {
+    // Pixel center (x, y) is inside when edge_a[i] * x + (edge_b[i] * y +
+    // edge_c[i]) >= 0 for all three edges.
+    f32 edge_a[3];
+    f32 edge_b[3];
+    f32 edge_c[3];
+
+    // 1/w at (x, y) is depth_a * x + (depth_b * y + depth_c), clamped to
+    // depth_max so rounding never moves it nearer than a vertex.
+    f32 depth_a;
+    f32 depth_b;
+    f32 depth_c;
+    f32 depth_max;
+
+    // Pixels whose centers the bounds cover, inclusive.
+    s16 min_x, min_y;
+    s16 max_x, max_y;
+};
+
+bool gfx_occlusion_init(Gfx_Occlusion_Buffer *buffer, int width, int height) {
+    *buffer = {};
+
+    buffer->tiles_x = (SDL_max(width, 1) + GFX_OCCLUSION_TILE_WIDTH - 1) / GFX_OCCLUSION_TILE_WIDTH;
+    buffer->tiles_y = (SDL_max(height, 1) + GFX_OCCLUSION_TILE_HEIGHT - 1) / GFX_OCCLUSION_TILE_HEIGHT;
+    buffer->width   = buffer->tiles_x * GFX_OCCLUSION_TILE_WIDTH;
+    buffer->height  = buffer->tiles_y * GFX_OCCLUSION_TILE_HEIGHT;
+
+    usize pixels = cast(usize)buffer->width * cast(usize)buffer->height;
+    usize blocks = pixels / (GFX_OCCLUSION_BLOCK * GFX_OCCLUSION_BLOCK);
+    int tile_count = buffer->tiles_x * buffer->tiles_y;
+
+    // Empty until the first render, hiding nothing.
+    buffer->depth       = cast(f32 *)SDL_aligned_alloc(32, pixels * sizeof(f32));
+    buffer->hiz         = cast(f32 *)SDL_calloc(blocks, sizeof(f32));
+    buffer->bin_offsets = cast(u32 *)SDL_calloc(cast(usize)tile_count + 1, sizeof(u32));
+    if (!buffer->depth || !buffer->hiz || !buffer->bin_offsets) {
+        gfx_occlusion_free(buffer);
+        return false;
+    }
+    SDL_memset(buffer->depth, 0, pixels * sizeof(f32));
+    return true;
+}
+
+void gfx_occlusion_free(Gfx_Occlusion_Buffer *buffer) {
+    SDL_aligned_free(buffer->depth);
+    SDL_free(buffer->hiz);
+    SDL_free(buffer->occluders);
+    SDL_free(buffer->clip_vertices);
+    SDL_free(buffer->triangles);
+    SDL_free(buffer->bin_triangles);
+    SDL_free(buffer->bin_offsets);
+    *buffer = {};
+}
+
+void gfx_occlusion_clear(Gfx_Occlusion_Buffer *buffer) {
+    buffer->occluder_count = 0;
+}
+
+bool gfx_occlusion_add(Gfx_Occlusion_Buffer *buffer, const Gfx_Occluder *occluder, const glm::mat4 &transform) {
+    if (buffer->occluder_count == buffer->occluder_capacity) {
+        int capacity = SDL_max(64, buffer->occluder_capacity * 2);
+        auto occluders = cast(Gfx_Occlusion_Instance *)SDL_realloc(buffer->occluders, cast(usize)capacity * sizeof(Gfx_Occlusion_Instance));
+        if (!occluders) return false;
+        buffer->occluders = occluders;
+        buffer->occluder_capacity = capacity;
+    }
+
+    Gfx_Occlusion_Instance *instance = &buffer->occluders[buffer->occluder_count++];
+    instance->occluder  = *occluder;
+    instance->transform = transform;
+    return true;
+}
+
+Gfx_Occluder gfx_occluder_from_mesh(const Gfx_Mesh *mesh, int lod) {
+    Gfx_Occluder occluder;
+    occluder.positions    = mesh->vertices;
+    occluder.vertex_count = mesh->vertex_count;
+    occluder.index_size   = mesh->index_size;
+
+    if (lod > 0 && lod <= mesh->lod_count) {
+        const Gfx_Lod *level = &mesh->lods[lod - 1];
+        occluder.indices     = cast(const u8 *)mesh->lod_indices + cast(usize)level->first_index * mesh->index_size;
+        occluder.index_count = cast(int)level->index_count;
+    } else {
+        occluder.indices     = mesh->indices;
+        occluder.index_count = mesh->triangle_count * 3;
+    }
+    return occluder;
+}
+
+//
+// Setup.
+//
+
+// Signed distance to a clip plane, inside when >= 0.
+static f32 clip_distance(glm::vec4 v, int plane) {
+    switch (plane) {
+        case 0:  return v.z + v.w;
+        case 1:  return OCCLUSION_GUARD_BAND * v.w + v.x;
+        case 2:  return OCCLUSION_GUARD_BAND * v.w - v.x;
+        case 3:  return OCCLUSION_GUARD_BAND * v.w + v.y;
+        default: return OCCLUSION_GUARD_BAND * v.w - v.y;
+    }
+}
+
+// Bit per plane the vertex is outside of.
+static u32 clip_outcode(glm::vec4 v) {
+    u32 code = 0;
+    for (int plane = 0; plane < OCCLUSION_CLIP_PLANES; plane++) {
+        if (clip_distance(v, plane) < 0.0f) code |= 1u << plane;
+    }
+    return code;
+}
+
+// Sutherland-Hodgman against the planes in the mask. polygon has room for
+// OCCLUSION_MAX_CLIPPED vertices, each plane adds at most one. Returns the
+// vertex count left, 0 when less than a triangle.
+static int clip_polygon(glm::vec4 *polygon, int count, u32 planes) {
+    glm::vec4 clipped[OCCLUSION_MAX_CLIPPED];
+
+    for (int plane = 0; plane < OCCLUSION_CLIP_PLANES; plane++) {
+        if ((planes & (1u << plane)) == 0) continue;
+
+        int clipped_count = 0;
+        for (int i = 0; i < count; i++) {
+            glm::vec4 a = polygon[i];
+            glm::vec4 b = polygon[i + 1 < count ? i + 1 : 0];
+            f32 da = clip_distance(a, plane);
+            f32 db = clip_distance(b, plane);
+
+            if (da >= 0.0f) clipped[clipped_count++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f)) clipped[clipped_count++] = a + (b - a) * (da / (da - db));
+        }
+
+        count = clipped_count;
+        if (count < 3) return 0;
+        SDL_memcpy(polygon, clipped, cast(usize)count * sizeof(glm::vec4));
+    }
+    return count;
+}
+
+// Screen-space triangle of three clip-space vertices in front of the near
+// plane. False for triangles without area or pixel centers.
+static bool setup_triangle(const Gfx_Occlusion_Buffer *buffer, glm::vec4 c0, glm::vec4 c1, glm::vec4 c2, Gfx_Occlusion_Triangle *triangle) {
+    f32 half_width  = cast(f32)buffer->width * 0.5f;
+    f32 half_height = cast(f32)buffer->height * 0.5f;
+
+    glm::vec4 clip[3] = { c0, c1, c2 };
+    f32 x[3], y[3], d[3];
+    for (int i = 0; i < 3; i++) {
+        d[i] = 1.0f / clip[i].w;
+        x[i] = (clip[i].x * d[i] + 1.0f) * half_width;
+        y[i] = (1.0f - clip[i].y * d[i]) * half_height;
+    }
+
+    // Both windings are drawn, the negative one is flipped.
+    f32 area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(SDL_fabsf(area) > 0.0f)) return false;
+    if (area < 0.0f) {
+        auto swap = [](f32 *values) { f32 value = values[1]; values[1] = values[2]; values[2] = value; };
+        swap(x);
+        swap(y);
+        swap(d);
+        area = -area;
+    }
+
+    f32 min_x = SDL_min(SDL_min(x[0], x[1]), x[2]);
+    f32 max_x = SDL_max(SDL_max(x[0], x[1]), x[2]);
+    f32 min_y = SDL_min(SDL_min(y[0], y[1]), y[2]);
+    f32 max_y = SDL_max(SDL_max(y[0], y[1]), y[2]);
+
+    int first_x = SDL_max(cast(int)SDL_ceilf(min_x - 0.5f), 0);
+    int last_x  = SDL_min(cast(int)SDL_floorf(max_x - 0.5f), buffer->width - 1);
+    int first_y = SDL_max(cast(int)SDL_ceilf(min_y - 0.5f), 0);
+    int last_y  = SDL_min(cast(int)SDL_floorf(max_y - 0.5f), buffer->height - 1);
+    if (first_x > last_x || first_y > last_y) return false;
+
+    triangle->min_x = cast(s16)first_x;
+    triangle->max_x = cast(s16)last_x;
+    triangle->min_y = cast(s16)first_y;
+    triangle->max_y = cast(s16)last_y;
+
+    // Edge i runs from vertex i to the next one. Shared edges get exactly
+    // negated equations, so pixels on them go to both triangles.
+    for (int i = 0; i < 3; i++) {
+        int j = i < 2 ? i + 1 : 0;
+        triangle->edge_a[i] = y[i] - y[j];
+        triangle->edge_b[i] = x[j] - x[i];
+        triangle->edge_c[i] = x[i] * y[j] - x[j] * y[i];
+    }
+
+    f32 d1 = d[1] - d[0];
+    f32 d2 = d[2] - d[0];
+    triangle->depth_a   = (d1 * (y[2] - y[0]) - d2 * (y[1] - y[0])) / area;
+    triangle->depth_b   = (d2 * (x[1] - x[0]) - d1 * (x[2] - x[0])) / area;
+    triangle->depth_c   = d[0] - triangle->depth_a * x[0] - triangle->depth_b * y[0];
+    triangle->depth_max = SDL_max(SDL_max(d[0], d[1]), d[2]);
+    return true;
+}
+
+static Gfx_Occlusion_Triangle *push_triangle(Gfx_Occlusion_Buffer *buffer) {
+    if (buffer->triangle_count == buffer->triangle_capacity) {
+        int capacity = SDL_max(1024, buffer->triangle_capacity * 2);
+        auto triangles = cast(Gfx_Occlusion_Triangle *)SDL_realloc(buffer->triangles, cast(usize)capacity * sizeof(Gfx_Occlusion_Triangle));
+        if (!triangles) return NULL;
+        buffer->triangles = triangles;
+        buffer->triangle_capacity = capacity;
+    }
+    return &buffer->triangles[buffer->triangle_count++];
+}
+
+static bool setup_occluder(Gfx_Occlusion_Buffer *buffer, const Gfx_Occlusion_Instance *instance) {
+    const Gfx_Occluder *occluder = &instance->occluder;
+    if (occluder->vertex_count <= 0 || occluder->index_count < 3) return true;
+
+    if (buffer->clip_capacity < occluder->vertex_count) {
+        int capacity = SDL_max(occluder->vertex_count, buffer->clip_capacity * 2);
+        auto vertices = cast(glm::vec4 *)SDL_realloc(buffer->clip_vertices, cast(usize)capacity * sizeof(glm::vec4));
+        if (!vertices) return false;
+        buffer->clip_vertices = vertices;
+        buffer->clip_capacity = capacity;
+    }
+
+    // Vertices are shared by several triangles, transformed once.
+    glm::mat4 clip = buffer->view_proj * instance->transform;
+    glm::vec4 *vertices = buffer->clip_vertices;
+    const f32 *p = occluder->positions;
+    for (int v = 0; v < occluder->vertex_count; v++, p += 3) {
+        vertices[v] = clip * glm::vec4(p[0], p[1], p[2], 1.0f);
+    }
+
+    auto index16 = cast(const u16 *)occluder->indices;
+    auto index32 = cast(const u32 *)occluder->indices;
+    int triangle_count = occluder->index_count / 3;
+    buffer->stats.triangles += cast(u64)triangle_count;
+
+    for (int t = 0; t < triangle_count; t++) {
+        glm::vec4 polygon[OCCLUSION_MAX_CLIPPED];
+        u32 inside = ~0u, outside = 0;
+        for (int k = 0; k < 3; k++) {
+            u32 index = occluder->index_size == sizeof(u32) ? index32[t * 3 + k] : index16[t * 3 + k];
+            ASSERT(index < cast(u32)occluder->vertex_count);
+            polygon[k] = vertices[index];
+
+            u32 code = clip_outcode(polygon[k]);
+            inside  &= code;
+            outside |= code;
+        }
+
+        // All three outside the same plane.
+        if (inside != 0) continue;
+
+        int count = outside ? clip_polygon(polygon, 3, outside) : 3;
+        for (int k = 2; k < count; k++) {
+            Gfx_Occlusion_Triangle *triangle = push_triangle(buffer);
+            if (!triangle) return false;
+            if (!setup_triangle(buffer, polygon[0], polygon[k - 1], polygon[k], triangle)) buffer->triangle_count--;
+        }
+    }
+    return true;
+}
+
+// Counts the triangles per tile, then fills the bins in triangle order.
+static bool bin_triangles(Gfx_Occlusion_Buffer *buffer) {
+    int tile_count = buffer->tiles_x * buffer->tiles_y;
+    u32 *offsets = buffer->bin_offsets;
+    SDL_memset(offsets, 0, (cast(usize)tile_count + 1) * sizeof(u32));
+
+    auto for_tiles = [&](const Gfx_Occlusion_Triangle *triangle, auto func) {
+        int first_x = triangle->min_x / GFX_OCCLUSION_TILE_WIDTH;
+        int last_x  = triangle->max_x / GFX_OCCLUSION_TILE_WIDTH;
+        int first_y = triangle->min_y / GFX_OCCLUSION_TILE_HEIGHT;
+        int last_y  = triangle->max_y / GFX_OCCLUSION_TILE_HEIGHT;
+        for (int ty = first_y; ty <= last_y; ty++) {
+            for (int tx = first_x; tx <= last_x; tx++) func(ty * buffer->tiles_x + tx);
+        }
+    };
+
+    for (int t = 0; t < buffer->triangle_count; t++) {
+        for_tiles(&buffer->triangles[t], [&](int tile) { offsets[tile + 1]++; });
+    }
+    for (int tile = 0; tile < tile_count; tile++) offsets[tile + 1] += offsets[tile];
+
+    int binned = cast(int)offsets[tile_count];
+    if (buffer->bin_capacity < binned) {
+        int capacity = SDL_max(binned, buffer->bin_capacity * 2);
+        auto bins = cast(u32 *)SDL_realloc(buffer->bin_triangles, cast(usize)capacity * sizeof(u32));
+        if (!bins) return false;
+        buffer->bin_triangles = bins;
+        buffer->bin_capacity = capacity;
+    }
+
+    // Filling moves every offset to the end of its bin, the start of the
+    // next one, so they are shifted back afterwards.
+    for (int t = 0; t < buffer->triangle_count; t++) {
+        for_tiles(&buffer->triangles[t], [&](int tile) { buffer->bin_triangles[offsets[tile]++] = cast(u32)t; });
+    }
+    for (int tile = tile_count; tile > 0; tile--) offsets[tile] = offsets[tile - 1];
+    offsets[0] = 0;
+
+    buffer->stats.binned = cast(u64)binned;
+    return true;
+}
+
+bool gfx_occlusion_setup(Gfx_Occlusion_Buffer *buffer, const glm::mat4 &view_proj) {
+    buffer->view_proj = view_proj;
+    buffer->triangle_count = 0;
+    buffer->stats = {};
+    buffer->stats.occluders = buffer->occluder_count;
+
+    bool ok = true;
+    for (int i = 0; ok && i < buffer->occluder_count; i++) ok = setup_occluder(buffer, &buffer->occluders[i]);
+    ok = ok && bin_triangles(buffer);
+
+    // Empty bins clear the tiles, so a failed setup hides nothing.
+    if (!ok) {
+        buffer->triangle_count = 0;
+        SDL_memset(buffer->bin_offsets, 0, (cast(usize)(buffer->tiles_x * buffer->tiles_y) + 1) * sizeof(u32));
+        buffer->stats.binned = 0;
+    }
+    buffer->stats.rasterized = cast(u64)buffer->triangle_count;
+    return ok;
+}
+
+//
+// Rasterization.
+//
+// Every kernel evaluates the edge and depth equations in the same order, per
+// row first and then per pixel, so they all write the same depths. Pixels
+// outside the coverage or the bounds take depth 0, which never wins against
+// the stored depth.
+//
+
+struct Occlusion_Rect {
+    int min_x, min_y;
+    int max_x, max_y;
+};
+
+static Occlusion_Rect tile_rect(const Gfx_Occlusion_Buffer *buffer, int tile) {
+    Occlusion_Rect rect;
+    rect.min_x = (tile % buffer->tiles_x) * GFX_OCCLUSION_TILE_WIDTH;
+    rect.min_y = (tile / buffer->tiles_x) * GFX_OCCLUSION_TILE_HEIGHT;
+    rect.max_x = rect.min_x + GFX_OCCLUSION_TILE_WIDTH - 1;
+    rect.max_y = rect.min_y + GFX_OCCLUSION_TILE_HEIGHT - 1;
+    return rect;
+}
+
+// The part of the triangle bounds inside the tile, false when empty.
+static bool clip_bounds(const Gfx_Occlusion_Triangle *triangle, const Occlusion_Rect *tile, Occlusion_Rect *rect) {
+    rect->min_x = SDL_max(cast(int)triangle->min_x, tile->min_x);
+    rect->max_x = SDL_min(cast(int)triangle->max_x, tile->max_x);
+    rect->min_y = SDL_max(cast(int)triangle->min_y, tile->min_y);
+    rect->max_y = SDL_min(cast(int)triangle->max_y, tile->max_y);
+    return rect->min_x <= rect->max_x && rect->min_y <= rect->max_y;
+}
+
+static void clear_tile(Gfx_Occlusion_Buffer *buffer, const Occlusion_Rect *tile) {
+    for (int y = tile->min_y; y <= tile->max_y; y++) {
+        SDL_memset(buffer->depth + y * buffer->width + tile->min_x, 0, GFX_OCCLUSION_TILE_WIDTH * sizeof(f32));
+    }
+}
+
+// Farthest depth of every block of the tile.
+static void update_blocks(Gfx_Occlusion_Buffer *buffer, const Occlusion_Rect *tile) {
+    int blocks_x = buffer->width / GFX_OCCLUSION_BLOCK;
+    for (int by = tile->min_y; by <= tile->max_y; by += GFX_OCCLUSION_BLOCK) {
+        for (int bx = tile->min_x; bx <= tile->max_x; bx += GFX_OCCLUSION_BLOCK) {
+            f32 farthest = buffer->depth[by * buffer->width + bx];
+            for (int y = by; y < by + GFX_OCCLUSION_BLOCK; y++) {
+                const f32 *row = buffer->depth + y * buffer->width;
+                for (int x = bx; x < bx + GFX_OCCLUSION_BLOCK; x++) farthest = SDL_min(farthest, row[x]);
+            }
+            buffer->hiz[(by / GFX_OCCLUSION_BLOCK) * blocks_x + bx / GFX_OCCLUSION_BLOCK] = farthest;
+        }
+    }
+}
+
+void gfx_occlusion_rasterize_tile_scalar(Gfx_Occlusion_Buffer *buffer, int tile) {
+    Occlusion_Rect tile_bounds = tile_rect(buffer, tile);
+    clear_tile(buffer, &tile_bounds);
+
+    for (u32 b = buffer->bin_offsets[tile]; b < buffer->bin_offsets[tile + 1]; b++) {
+        const Gfx_Occlusion_Triangle *triangle = &buffer->triangles[buffer->bin_triangles[b]];
+        Occlusion_Rect rect;
+        if (!clip_bounds(triangle, &tile_bounds, &rect)) continue;
+
+        for (int y = rect.min_y; y <= rect.max_y; y++) {
+            f32 fy = cast(f32)y + 0.5f;
+            f32 row[3];
+            for (int i = 0; i < 3; i++) row[i] = triangle->edge_b[i] * fy + triangle->edge_c[i];
+            f32 depth_row = triangle->depth_b * fy + triangle->depth_c;
+
+            f32 *depth = buffer->depth + y * buffer->width;
+            for (int x = rect.min_x; x <= rect.max_x; x++) {
+                f32 fx = cast(f32)x + 0.5f;
+                bool covered = triangle->edge_a[0] * fx + row[0] >= 0.0f &&
+                               triangle->edge_a[1] * fx + row[1] >= 0.0f &&
+                               triangle->edge_a[2] * fx + row[2] >= 0.0f;
+                f32 z = SDL_min(triangle->depth_a * fx + depth_row, triangle->depth_max);
+                if (covered && z > depth[x]) depth[x] = z;
+            }
+        }
+    }
+
+    update_blocks(buffer, &tile_bounds);
+}
+
+#if SIMD_AVX2
+
+static void rasterize_tile_avx2(Gfx_Occlusion_Buffer *buffer, int tile) {
+    Occlusion_Rect tile_bounds = tile_rect(buffer, tile);
+    clear_tile(buffer, &tile_bounds);
+
+    const __m256 centers = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256i lanes  = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 zero    = _mm256_setzero_ps();
+
+    for (u32 b = buffer->bin_offsets[tile]; b < buffer->bin_offsets[tile + 1]; b++) {
+        const Gfx_Occlusion_Triangle *triangle = &buffer->triangles[buffer->bin_triangles[b]];
+        Occlusion_Rect rect;
+        if (!clip_bounds(triangle, &tile_bounds, &rect)) continue;
+
+        __m256 a0 = _mm256_set1_ps(triangle->edge_a[0]);
+        __m256 a1 = _mm256_set1_ps(triangle->edge_a[1]);
+        __m256 a2 = _mm256_set1_ps(triangle->edge_a[2]);
+        __m256 depth_a   = _mm256_set1_ps(triangle->depth_a);
+        __m256 depth_max = _mm256_set1_ps(triangle->depth_max);
+        __m256i first = _mm256_set1_epi32(rect.min_x - 1);
+        __m256i last  = _mm256_set1_epi32(rect.max_x + 1);
+
+        // Tiles start on multiples of 8, so the groups stay in the tile.
+        int begin_x = rect.min_x & ~7;
+        for (int y = rect.min_y; y <= rect.max_y; y++) {
+            f32 fy = cast(f32)y + 0.5f;
+            __m256 row0 = _mm256_set1_ps(triangle->edge_b[0] * fy + triangle->edge_c[0]);
+            __m256 row1 = _mm256_set1_ps(triangle->edge_b[1] * fy + triangle->edge_c[1]);
+            __m256 row2 = _mm256_set1_ps(triangle->edge_b[2] * fy + triangle->edge_c[2]);
+            __m256 depth_row = _mm256_set1_ps(triangle->depth_b * fy + triangle->depth_c);
+
+            f32 *depth = buffer->depth + y * buffer->width;
+            for (int x = begin_x; x <= rect.max_x; x += 8) {
+                __m256 fx = _mm256_add_ps(_mm256_set1_ps(cast(f32)x), centers);
+                __m256i xs = _mm256_add_epi32(_mm256_set1_epi32(x), lanes);
+                __m256 in_bounds = _mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpgt_epi32(xs, first), _mm256_cmpgt_epi32(last, xs)));
+
+                __m256 covered = _mm256_and_ps(in_bounds, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a0, fx), row0), zero, _CMP_GE_OQ));
+                covered = _mm256_and_ps(covered, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a1, fx), row1), zero, _CMP_GE_OQ));
+                covered = _mm256_and_ps(covered, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a2, fx), row2), zero, _CMP_GE_OQ));
+
+                __m256 z = _mm256_min_ps(_mm256_add_ps(_mm256_mul_ps(depth_a, fx), depth_row), depth_max);
+                __m256 stored = _mm256_load_ps(depth + x);
+                _mm256_store_ps(depth + x, _mm256_max_ps(stored, _mm256_and_ps(z, covered)));
+            }
+        }
+    }
+
+    update_blocks(buffer, &tile_bounds);
+}
+
+#elif SIMD_SSE2
+
+static void rasterize_tile_sse2(Gfx_Occlusion_Buffer *buffer, int tile) {
+    Occlusion_Rect tile_bounds = tile_rect(buffer, tile);
+    clear_tile(buffer, &tile_bounds);
+
+    const __m128 centers = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128i lanes  = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128 zero    = _mm_setzero_ps();
+
+    for (u32 b = buffer->bin_offsets[tile]; b < buffer->bin_offsets[tile + 1]; b++) {
+        const Gfx_Occlusion_Triangle *triangle = &buffer->triangles[buffer->bin_triangles[b]];
+        Occlusion_Rect rect;
+        if (!clip_bounds(triangle, &tile_bounds, &rect)) continue;
+
+        __m128 a0 = _mm_set1_ps(triangle->edge_a[0]);
+        __m128 a1 = _mm_set1_ps(triangle->edge_a[1]);
+        __m128 a2 = _mm_set1_ps(triangle->edge_a[2]);
+        __m128 depth_a   = _mm_set1_ps(triangle->depth_a);
+        __m128 depth_max = _mm_set1_ps(triangle->depth_max);
+        __m128i first = _mm_set1_epi32(rect.min_x - 1);
+        __m128i last  = _mm_set1_epi32(rect.max_x + 1);
+
+        // Tiles start on multiples of 4, so the groups stay in the tile.
+        int begin_x = rect.min_x & ~3;
+        for (int y = rect.min_y; y <= rect.max_y; y++) {
+            f32 fy = cast(f32)y + 0.5f;
+            __m128 row0 = _mm_set1_ps(triangle->edge_b[0] * fy + triangle->edge_c[0]);
+            __m128 row1 = _mm_set1_ps(triangle->edge_b[1] * fy + triangle->edge_c[1]);
+            __m128 row2 = _mm_set1_ps(triangle->edge_b[2] * fy + triangle->edge_c[2]);
+            __m128 depth_row = _mm_set1_ps(triangle->depth_b * fy + triangle->depth_c);
+
+            f32 *depth = buffer->depth + y * buffer->width;
+            for (int x = begin_x; x <= rect.max_x; x += 4) {
+                __m128 fx = _mm_add_ps(_mm_set1_ps(cast(f32)x), centers);
+                __m128i xs = _mm_add_epi32(_mm_set1_epi32(x), lanes);
+                __m128 in_bounds = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(xs, first), _mm_cmplt_epi32(xs, last)));
+
+                __m128 covered = _mm_and_ps(in_bounds, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, fx), row0), zero));
+                covered = _mm_and_ps(covered, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, fx), row1), zero));
+                covered = _mm_and_ps(covered, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, fx), row2), zero));
+
+                __m128 z = _mm_min_ps(_mm_add_ps(_mm_mul_ps(depth_a, fx), depth_row), depth_max);
+                __m128 stored = _mm_load_ps(depth + x);
+                _mm_store_ps(depth + x, _mm_max_ps(stored, _mm_and_ps(z, covered)));
+            }
+        }
+    }
+
+    update_blocks(buffer, &tile_bounds);
+}
+
+#endif
+
+void gfx_occlusion_rasterize_tile(Gfx_Occlusion_Buffer *buffer, int tile) {
+#if SIMD_AVX2
+    rasterize_tile_avx2(buffer, tile);
+#elif SIMD_SSE2
+    rasterize_tile_sse2(buffer, tile);
+#else
+    gfx_occlusion_rasterize_tile_scalar(buffer, tile);
+#endif
+}
+
+static void rasterize_tiles(void *data, int begin, int end) {
+    auto buffer = cast(Gfx_Occlusion_Buffer *)data;
+    for (int tile = begin; tile < end; tile++) gfx_occlusion_rasterize_tile(buffer, tile);
+}
+
+bool gfx_occlusion_render(Gfx_Occlusion_Buffer *buffer, const glm::mat4 &view_proj, Job_System *jobs) {
+    u64 start = SDL_GetPerformanceCounter();
+
+    bool ok = gfx_occlusion_setup(buffer, view_proj);
+
+    // Tiles are independent, each writes only its own pixels and blocks.
+    job_parallel_for(jobs, buffer->tiles_x * buffer->tiles_y, 1, rasterize_tiles, buffer);
+
+    buffer->stats.render_ms = cast(f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / cast(f64)SDL_GetPerformanceFrequency();
+    return ok;
+}
+
+//
+// Tests.
+//
+// Both kernels project the 8 corners with the same operations in the same
+// order, so they find the same rectangles and agree on every box. A corner
+// is center + axis_x * sx + axis_y * sy + axis_z * sz with signs of +-1, in
+// clip space through view_proj * transform built column by column.
+//
+
+enum Occlusion_Box {
+    OCCLUSION_BOX_VISIBLE, // Crosses the near plane.
+    OCCLUSION_BOX_EMPTY,   // Covers no pixel.
+    OCCLUSION_BOX_TEST,
+};
+
+// Pixel rectangle of the projected corners, and the depth a pixel must beat
+// to hide them.
+static Occlusion_Box box_rect(const Gfx_Occlusion_Buffer *buffer, f32 min_x, f32 max_x, f32 min_y, f32 max_y, f32 max_depth,
+                              Occlusion_Rect *rect, f32 *nearest) {
+    // Clamped to the screen first, far off screen boxes would overflow int.
+    min_x = SDL_max(min_x, -1.0f);
+    max_x = SDL_min(max_x, 1.0f);
+    min_y = SDL_max(min_y, -1.0f);
+    max_y = SDL_min(max_y, 1.0f);
+    if (min_x > max_x || min_y > max_y) return OCCLUSION_BOX_EMPTY;
+
+    // Not negative, truncating floors.
+    f32 half_width  = cast(f32)buffer->width * 0.5f;
+    f32 half_height = cast(f32)buffer->height * 0.5f;
+    rect->min_x = cast(int)((min_x + 1.0f) * half_width);
+    rect->max_x = SDL_min(cast(int)((max_x + 1.0f) * half_width), buffer->width - 1);
+    rect->min_y = cast(int)((1.0f - max_y) * half_height);
+    rect->max_y = SDL_min(cast(int)((1.0f - min_y) * half_height), buffer->height - 1);
+
+    *nearest = max_depth * (1.0f + OCCLUSION_DEPTH_BIAS);
+    return OCCLUSION_BOX_TEST;
+}
+
+static Occlusion_Box project_box(const Gfx_Occlusion_Buffer *buffer, const Gfx_Bounds *bounds, const glm::mat4 &transform,
+                                 Occlusion_Rect *rect, f32 *nearest) {
+    if (buffer->width == 0) return OCCLUSION_BOX_VISIBLE;
+
+    const glm::mat4 &view_proj = buffer->view_proj;
+    glm::vec4 clip[4];
+    for (int j = 0; j < 4; j++) {
+        clip[j] = view_proj[0] * transform[j].x + view_proj[1] * transform[j].y + view_proj[2] * transform[j].z + view_proj[3] * transform[j].w;
+    }
+
+    glm::vec3 half = (bounds->max - bounds->min) * 0.5f;
+    glm::vec4 center = clip[0] * bounds->center.x + clip[1] * bounds->center.y + clip[2] * bounds->center.z + clip[3];
+    glm::vec4 axis_x = clip[0] * half.x;
+    glm::vec4 axis_y = clip[1] * half.y;
+    glm::vec4 axis_z = clip[2] * half.z;
+
+    f32 min_x = 1e30f, max_x = -1e30f;
+    f32 min_y = 1e30f, max_y = -1e30f;
+    f32 max_depth = 0.0f;
+    for (int corner = 0; corner < 8; corner++) {
+        f32 sx = (corner & 1) ? 1.0f : -1.0f;
+        f32 sy = (corner & 2) ? 1.0f : -1.0f;
+        f32 sz = (corner & 4) ? 1.0f : -1.0f;
+        glm::vec4 v = center + axis_x * sx + axis_y * sy + axis_z * sz;
+        if (v.z + v.w < 0.0f) return OCCLUSION_BOX_VISIBLE;
+
+        f32 d = 1.0f / v.w;
+        f32 x = v.x * d;
+        f32 y = v.y * d;
+        min_x = SDL_min(min_x, x);
+        max_x = SDL_max(max_x, x);
+        min_y = SDL_min(min_y, y);
+        max_y = SDL_max(max_y, y);
+        max_depth = SDL_max(max_depth, d);
+    }
+
+    return box_rect(buffer, min_x, max_x, min_y, max_y, max_depth, rect, nearest);
+}
+
+// Pixels of rect inside the block at pixel (bx, by).
+static Occlusion_Rect block_part(const Occlusion_Rect *rect, int bx, int by) {
+    Occlusion_Rect part;
+    part.min_x = SDL_max(rect->min_x, bx);
+    part.max_x = SDL_min(rect->max_x, bx + GFX_OCCLUSION_BLOCK - 1);
+    part.min_y = SDL_max(rect->min_y, by);
+    part.max_y = SDL_min(rect->max_y, by + GFX_OCCLUSION_BLOCK - 1);
+    return part;
+}
+
+bool gfx_occlusion_test_box_scalar(const Gfx_Occlusion_Buffer *buffer, const Gfx_Bounds *bounds, const glm::mat4 &transform) {
+    Occlusion_Rect rect;
+    f32 nearest;
+    Occlusion_Box box = project_box(buffer, bounds, transform, &rect, &nearest);
+    if (box != OCCLUSION_BOX_TEST) return box == OCCLUSION_BOX_VISIBLE;
+
+    int blocks_x = buffer->width / GFX_OCCLUSION_BLOCK;
+    for (int by = rect.min_y & ~(GFX_OCCLUSION_BLOCK - 1); by <= rect.max_y; by += GFX_OCCLUSION_BLOCK) {
+        for (int bx = rect.min_x & ~(GFX_OCCLUSION_BLOCK - 1); bx <= rect.max_x; bx += GFX_OCCLUSION_BLOCK) {
+            if (buffer->hiz[(by / GFX_OCCLUSION_BLOCK) * blocks_x + bx / GFX_OCCLUSION_BLOCK] > nearest) continue;
+
+            Occlusion_Rect part = block_part(&rect, bx, by);
+            for (int y = part.min_y; y <= part.max_y; y++) {
+                const f32 *depth = buffer->depth + y * buffer->width;
+                for (int x = part.min_x; x <= part.max_x; x++) {
+                    if (!(depth[x] > nearest)) return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+#if SIMD_SSE2
+
+// Smallest and largest lane.
+static f32 horizontal_min(__m128 v) {
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+static f32 horizontal_max(__m128 v) {
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+// The corners as structure of arrays, 4 of them per vector: the first with
+// sz = -1, the second with sz = +1.
+static Occlusion_Box project_box_sse2(const Gfx_Occlusion_Buffer *buffer, const Gfx_Bounds *bounds, const glm::mat4 &transform,
+                                      Occlusion_Rect *rect, f32 *nearest) {
+    if (buffer->width == 0) return OCCLUSION_BOX_VISIBLE;
+
+    const glm::mat4 &view_proj = buffer->view_proj;
+    __m128 vp0 = _mm_loadu_ps(&view_proj[0][0]);
+    __m128 vp1 = _mm_loadu_ps(&view_proj[1][0]);
+    __m128 vp2 = _mm_loadu_ps(&view_proj[2][0]);
+    __m128 vp3 = _mm_loadu_ps(&view_proj[3][0]);
+
+    __m128 clip[4];
+    for (int j = 0; j < 4; j++) {
+        clip[j] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(vp0, _mm_set1_ps(transform[j].x)), _mm_mul_ps(vp1, _mm_set1_ps(transform[j].y))),
+            _mm_mul_ps(vp2, _mm_set1_ps(transform[j].z))), _mm_mul_ps(vp3, _mm_set1_ps(transform[j].w)));
+    }
+
+    glm::vec3 half = (bounds->max - bounds->min) * 0.5f;
+    __m128 center = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(clip[0], _mm_set1_ps(bounds->center.x)), _mm_mul_ps(clip[1], _mm_set1_ps(bounds->center.y))),
+        _mm_mul_ps(clip[2], _mm_set1_ps(bounds->center.z))), clip[3]);
+    __m128 axis_x = _mm_mul_ps(clip[0], _mm_set1_ps(half.x));
+    __m128 axis_y = _mm_mul_ps(clip[1], _mm_set1_ps(half.y));
+    __m128 axis_z = _mm_mul_ps(clip[2], _mm_set1_ps(half.z));
+
+    alignas(16) f32 c[4], ax[4], ay[4], az[4];
+    _mm_store_ps(c, center);
+    _mm_store_ps(ax, axis_x);
+    _mm_store_ps(ay, axis_y);
+    _mm_store_ps(az, axis_z);
+
+    const __m128 sx = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+    const __m128 sy = _mm_setr_ps(-1.0f, -1.0f, 1.0f, 1.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    // Component i of the 4 corners with the given sz.
+    auto corners = [&](int i, f32 sz) {
+        return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_set1_ps(c[i]), _mm_mul_ps(_mm_set1_ps(ax[i]), sx)),
+                                     _mm_mul_ps(_mm_set1_ps(ay[i]), sy)), _mm_mul_ps(_mm_set1_ps(az[i]), _mm_set1_ps(sz)));
+    };
+
+    __m128 min_x = _mm_set1_ps(1e30f), max_x = _mm_set1_ps(-1e30f);
+    __m128 min_y = _mm_set1_ps(1e30f), max_y = _mm_set1_ps(-1e30f);
+    __m128 max_depth = _mm_setzero_ps();
+    for (int half_index = 0; half_index < 2; half_index++) {
+        f32 sz = half_index ? 1.0f : -1.0f;
+        __m128 x = corners(0, sz);
+        __m128 y = corners(1, sz);
+        __m128 z = corners(2, sz);
+        __m128 w = corners(3, sz);
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(z, w), _mm_setzero_ps())) != 0) return OCCLUSION_BOX_VISIBLE;
+
+        __m128 d = _mm_div_ps(one, w);
+        x = _mm_mul_ps(x, d);
+        y = _mm_mul_ps(y, d);
+        min_x = _mm_min_ps(min_x, x);
+        max_x = _mm_max_ps(max_x, x);
+        min_y = _mm_min_ps(min_y, y);
+        max_y = _mm_max_ps(max_y, y);
+        max_depth = _mm_max_ps(max_depth, d);
+    }
+
+    return box_rect(buffer, horizontal_min(min_x), horizontal_max(max_x), horizontal_min(min_y), horizontal_max(max_y),
+                    horizontal_max(max_depth), rect, nearest);
+}
+
+#endif
+
+bool gfx_occlusion_test_box(const Gfx_Occlusion_Buffer *buffer, const Gfx_Bounds *bounds, const glm::mat4 &transform) {
+#if SIMD_SSE2
+    Occlusion_Rect rect;
+    f32 nearest;
+    Occlusion_Box box = project_box_sse2(buffer, bounds, transform, &rect, &nearest);
+    if (box != OCCLUSION_BOX_TEST) return box == OCCLUSION_BOX_VISIBLE;
+
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    __m128 threshold = _mm_set1_ps(nearest);
+
+    // Blocks are 8 pixels wide, two groups of 4 per row.
+    int blocks_x = buffer->width / GFX_OCCLUSION_BLOCK;
+    for (int by = rect.min_y & ~(GFX_OCCLUSION_BLOCK - 1); by <= rect.max_y; by += GFX_OCCLUSION_BLOCK) {
+        for (int bx = rect.min_x & ~(GFX_OCCLUSION_BLOCK - 1); bx <= rect.max_x; bx += GFX_OCCLUSION_BLOCK) {
+            if (buffer->hiz[(by / GFX_OCCLUSION_BLOCK) * blocks_x + bx / GFX_OCCLUSION_BLOCK] > nearest) continue;
+
+            Occlusion_Rect part = block_part(&rect, bx, by);
+            __m128i first = _mm_set1_epi32(part.min_x - 1);
+            __m128i last  = _mm_set1_epi32(part.max_x + 1);
+            for (int y = part.min_y; y <= part.max_y; y++) {
+                const f32 *depth = buffer->depth + y * buffer->width;
+                for (int x = part.min_x & ~3; x <= part.max_x; x += 4) {
+                    __m128i xs = _mm_add_epi32(_mm_set1_epi32(x), lanes);
+                    __m128 in_bounds = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(xs, first), _mm_cmplt_epi32(xs, last)));
+                    __m128 open = _mm_and_ps(in_bounds, _mm_cmpngt_ps(_mm_load_ps(depth + x), threshold));
+                    if (_mm_movemask_ps(open) != 0) return true;
+                }
+            }
+        }
+    }
+    return false;
+#else
+    return gfx_occlusion_test_box_scalar(buffer, bounds, transform);
+#endif
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "defines.h"
+#include "gfx_cull.h"
+#include "job.h"
+
+#include <glm/glm.hpp>
+
+struct Gfx_Mesh;
+
+//
+// Software occlusion culling.
+//
+// Occluders, a few large meshes or simplified proxies of them, are
+// rasterized on the CPU into a small depth buffer. Instance bounding boxes
+// are then tested against it, and the ones behind the occluders at every
+// pixel they cover are not drawn.
+//
+// The buffer stores 1/w per pixel, which is linear in screen space and
+// larger for nearer surfaces, 0 where nothing was drawn. Rendering runs in
+// two steps:
+//   - Setup, on the calling thread: every occluder triangle is transformed,
+//     clipped against the near plane and a guard band of twice the screen,
+//     turned into edge and depth plane equations and binned into the tiles
+//     its bounds touch. Both sides of a triangle are drawn, so open meshes
+//     such as single walls occlude too.
+//   - Rasterization, one job per tile: the tile is cleared and its
+//     triangles are drawn 4 (SSE2) or 8 (AVX2) pixels at a time, testing
+//     coverage at pixel centers and keeping the nearest depth. The tile then
+//     updates its part of the hierarchy, the farthest depth of every 8 x 8
+//     pixel block.
+//
+// A box is projected to its screen rectangle and its nearest depth. It is
+// hidden when every pixel of the rectangle holds something nearer. Blocks
+// whose farthest depth is already nearer are accepted whole, only the others
+// are tested per pixel. Boxes crossing the near plane are always visible.
+// Coverage is sampled at pixel centers, so a box can still disappear behind
+// an occluder that misses it by less than a pixel. At the default
+// resolution, keep occluders a little inside the geometry they stand for.
+//
+// Clip space follows gfx_cull.h: OpenGL depth, near at z = -w.
+//
+
+#define GFX_OCCLUSION_WIDTH  320 // Default resolution, see gfx_occlusion_init().
+#define GFX_OCCLUSION_HEIGHT 192
+
+#define GFX_OCCLUSION_TILE_WIDTH  32 // Pixels, a multiple of 8.
+#define GFX_OCCLUSION_TILE_HEIGHT 16 // Pixels, a multiple of GFX_OCCLUSION_BLOCK.
+#define GFX_OCCLUSION_BLOCK       8  // Pixels per side of a hierarchy block.
+
+// Triangles to rasterize, borrowed. Indices are u16 or u32.
+struct Gfx_Occluder {
+    const f32 *positions = NULL; // float3 per vertex.
+    int vertex_count = 0;
+    const void *indices = NULL;
+    u32 index_size  = sizeof(u16);
+    int index_count = 0;
+};
+
+// Render fields are set by gfx_occlusion_render(), test fields are counted
+// by the caller.
+struct Gfx_Occlusion_Stats {
+    int occluders = 0;
+    u64 triangles  = 0; // Of the occluders.
+    u64 rasterized = 0; // Left after clipping, each counted once.
+    u64 binned     = 0; // Triangles over all tiles.
+    f64 render_ms  = 0.0;
+
+    int tested = 0;
+    int culled = 0;
+    f64 test_ms = 0.0;
+};
+
+struct Gfx_Occlusion_Instance {
+    Gfx_Occluder occluder;
+    glm::mat4 transform;
+};
+
+// Built by setup, see gfx_occlusion.cpp.
+struct Gfx_Occlusion_Triangle;
+
+struct Gfx_Occlusion_Buffer {
+    int width  = 0; // Multiples of the tile size.
+    int height = 0;
+    int tiles_x = 0;
+    int tiles_y = 0;
+
+    f32 *depth = NULL; // width * height, rows top to bottom.
+    f32 *hiz   = NULL; // Farthest depth per block, (width / 8) * (height / 8).
+
+    // Occluders added since the last gfx_occlusion_clear().
+    Gfx_Occlusion_Instance *occluders = NULL;
+    int occluder_count    = 0;
+    int occluder_capacity = 0;
+
+    // Camera of the last render, the tests use it.
+    glm::mat4 view_proj = glm::mat4(1.0f);
+
+    // Setup scratch: the vertices of one occluder in clip space.
+    glm::vec4 *clip_vertices = NULL;
+    int clip_capacity = 0;
+
+    // Setup output: the triangles, and per tile a range of bin_triangles.
+    Gfx_Occlusion_Triangle *triangles = NULL;
+    int triangle_count    = 0;
+    int triangle_capacity = 0;
+    u32 *bin_triangles = NULL;
+    int bin_capacity   = 0;
+    u32 *bin_offsets   = NULL; // tiles_x * tiles_y + 1.
+
+    Gfx_Occlusion_Stats stats;
+};
+
+// width and height are rounded up to whole tiles. Returns false on
+// allocation failure.
+bool gfx_occlusion_init(Gfx_Occlusion_Buffer *buffer, int width, int height);
+void gfx_occlusion_free(Gfx_Occlusion_Buffer *buffer);
+
+// Drops the occluders, the depth stays until the next render.
+void gfx_occlusion_clear(Gfx_Occlusion_Buffer *buffer);
+
+// Queues an occluder for the next render. It must stay alive until then.
+// Returns false on allocation failure, the occluder is dropped then.
+bool gfx_occlusion_add(Gfx_Occlusion_Buffer *buffer, const Gfx_Occluder *occluder, const glm::mat4 &transform);
+
+// The full mesh, or one of its LOD levels for lod > 0. Simplified levels may
+// stick out of the full mesh a little, see gfx_lod.h.
+Gfx_Occluder gfx_occluder_from_mesh(const Gfx_Mesh *mesh, int lod);
+
+// Sets up and bins the occluders, then rasterizes the tiles as parallel
+// jobs, serially when jobs is NULL. Returns false on allocation failure, the
+// buffer is empty then and hides nothing.
+bool gfx_occlusion_render(Gfx_Occlusion_Buffer *buffer, const glm::mat4 &view_proj, Job_System *jobs);
+
+// The setup of gfx_occlusion_render() alone, for driving the tiles by hand.
+bool gfx_occlusion_setup(Gfx_Occlusion_Buffer *buffer, const glm::mat4 &view_proj);
+
+// Clears and rasterizes one tile after setup, and updates its blocks.
+void gfx_occlusion_rasterize_tile(Gfx_Occlusion_Buffer *buffer, int tile);
+
+// Reference version of gfx_occlusion_rasterize_tile() without SIMD, same
+// result to the bit.
+void gfx_occlusion_rasterize_tile_scalar(Gfx_Occlusion_Buffer *buffer, int tile);
+
+// False when the object-space box, placed by transform, is hidden behind
+// the occluders of the last render or covers no pixel.
+bool gfx_occlusion_test_box(const Gfx_Occlusion_Buffer *buffer, const Gfx_Bounds *bounds, const glm::mat4 &transform);
+
+// Reference version of gfx_occlusion_test_box() without SIMD.
+bool gfx_occlusion_test_box_scalar(const Gfx_Occlusion_Buffer *buffer, const Gfx_Bounds *bounds, const glm::mat4 &transform);
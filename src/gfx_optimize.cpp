@@ -0,0 +1,429 @@
+#include "gfx_optimize.h"
+
+#include "gfx.h"
+
+Gfx_Vertex_Cache_Stats gfx_analyze_vertex_cache(const u32 *indices, int index_count, int vertex_count, int cache_size) {
+    Gfx_Vertex_Cache_Stats stats{};
+    if (index_count < 3 || vertex_count <= 0) return stats;
+
+    // Each vertex remembers when it entered the cache. With a FIFO cache it is
+    // still resident while fewer than cache_size misses happened since.
+    auto entered = cast(u32 *)SDL_calloc(cast(usize)vertex_count, sizeof(u32));
+    auto used    = cast(u8 *)SDL_calloc(cast(usize)vertex_count, sizeof(u8));
+    if (!entered || !used) {
+        SDL_free(entered);
+        SDL_free(used);
+        return stats;
+    }
+    defer {
+        SDL_free(entered);
+        SDL_free(used);
+    };
+
+    u32 misses = 0;
+    int unique = 0;
+    for (int i = 0; i < index_count; i++) {
+        u32 v = indices[i];
+        if (!used[v]) {
+            used[v] = 1;
+            unique++;
+        }
+
+        // Timestamps start at 1 so that 0 means never cached.
+        if (entered[v] == 0 || misses - entered[v] >= cast(u32)cache_size) {
+            misses++;
+            entered[v] = misses;
+        }
+    }
+
+    stats.acmr = cast(f32)misses / cast(f32)(index_count / 3);
+    stats.atvr = cast(f32)misses / cast(f32)SDL_max(unique, 1);
+    return stats;
+}
+
+//
+// Tipsify.
+// Source: Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex
+// Locality and Reduced Overdraw", SIGGRAPH 2007.
+//
+
+int gfx_optimize_vertex_cache(const u32 *indices, u32 *out, int index_count, int vertex_count, int cache_size, u32 *cluster_starts) {
+    int triangle_count = index_count / 3;
+    if (triangle_count == 0 || vertex_count <= 0) return 0;
+
+    // Vertex to triangle adjacency.
+    auto offsets    = cast(u32 *)SDL_calloc(cast(usize)vertex_count + 1, sizeof(u32));
+    auto live       = cast(u32 *)SDL_calloc(cast(usize)vertex_count, sizeof(u32));
+    auto cache_time = cast(u32 *)SDL_calloc(cast(usize)vertex_count, sizeof(u32));
+    auto adjacency  = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    auto dead_end   = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    auto candidates = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    auto emitted    = cast(u8 *)SDL_calloc(cast(usize)triangle_count, sizeof(u8));
+    auto fill       = cast(u32 *)SDL_malloc(cast(usize)vertex_count * sizeof(u32));
+    defer {
+        SDL_free(offsets);
+        SDL_free(live);
+        SDL_free(cache_time);
+        SDL_free(adjacency);
+        SDL_free(dead_end);
+        SDL_free(candidates);
+        SDL_free(emitted);
+        SDL_free(fill);
+    };
+    if (!offsets || !live || !cache_time || !adjacency || !dead_end || !candidates || !emitted || !fill) {
+        SDL_memcpy(out, indices, cast(usize)index_count * sizeof(u32));
+        cluster_starts[0] = 0;
+        return 1;
+    }
+
+    for (int i = 0; i < triangle_count * 3; i++) live[indices[i]]++;
+    for (int v = 0; v < vertex_count; v++) offsets[v + 1] = offsets[v] + live[v];
+    SDL_memcpy(fill, offsets, cast(usize)vertex_count * sizeof(u32));
+    for (int i = 0; i < triangle_count * 3; i++) adjacency[fill[indices[i]]++] = cast(u32)(i / 3);
+
+    u32 timestamp = cast(u32)cache_size + 1;
+    int dead_end_count = 0;
+    int cursor = 0;     // Next vertex to try in input order.
+    int out_count = 0;
+    int cluster_count = 0;
+
+    s64 fanning = indices[0];
+    cluster_starts[cluster_count++] = 0;
+
+    while (fanning >= 0) {
+        int candidate_count = 0;
+
+        // Emit all remaining triangles around the fanning vertex.
+        u32 f = cast(u32)fanning;
+        for (u32 ai = offsets[f]; ai < offsets[f + 1]; ai++) {
+            u32 t = adjacency[ai];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+
+            for (int k = 0; k < 3; k++) {
+                u32 v = indices[t * 3 + k];
+                out[out_count++] = v;
+                dead_end[dead_end_count++] = v;
+                candidates[candidate_count++] = v;
+                live[v]--;
+
+                if (timestamp - cache_time[v] > cast(u32)cache_size) {
+                    cache_time[v] = timestamp++;
+                }
+            }
+        }
+
+        // Prefer the candidate that is still in the cache and has the most
+        // triangles left that fit into it.
+        s64 next = -1;
+        s64 best = -1;
+        for (int ci = 0; ci < candidate_count; ci++) {
+            u32 v = candidates[ci];
+            if (live[v] == 0) continue;
+
+            s64 priority = 0;
+            if (timestamp - cache_time[v] + 2 * live[v] <= cast(u32)cache_size) {
+                priority = timestamp - cache_time[v];
+            }
+            if (priority > best) {
+                best = priority;
+                next = v;
+            }
+        }
+
+        if (next < 0) {
+            // Dead end, go back through recently emitted vertices, then scan
+            // forward. Jumps start a new cluster for the overdraw pass.
+            while (dead_end_count > 0) {
+                u32 v = dead_end[--dead_end_count];
+                if (live[v] > 0) {
+                    next = v;
+                    break;
+                }
+            }
+            while (next < 0 && cursor < vertex_count) {
+                if (live[cursor] > 0) next = cursor;
+                cursor++;
+            }
+
+            if (next >= 0 && out_count < index_count) {
+                cluster_starts[cluster_count++] = cast(u32)(out_count / 3);
+            }
+        }
+
+        fanning = next;
+    }
+
+    return cluster_count;
+}
+
+struct Cluster_Sort {
+    f32 key;
+    u32 start;
+    u32 count;
+    u32 index;
+};
+
+static int compare_clusters(const void *a, const void *b) {
+    auto ca = cast(const Cluster_Sort *)a;
+    auto cb = cast(const Cluster_Sort *)b;
+    if (ca->key > cb->key) return -1;
+    if (ca->key < cb->key) return  1;
+    return (ca->start < cb->start) ? -1 : 1;
+}
+
+// View-independent ordering from the same paper: clusters whose normal points
+// away from the mesh center are likely occluders, draw them first.
+void gfx_optimize_overdraw(u32 *indices, int index_count, const f32 *positions, const u32 *cluster_starts, int cluster_count,
+                           u32 *cluster_order) {
+    // Clusters stay in place unless they are sorted below.
+    for (int ci = 0; cluster_order && ci < cluster_count; ci++) cluster_order[ci] = cast(u32)ci;
+
+    int triangle_count = index_count / 3;
+    if (cluster_count <= 1 || triangle_count == 0) return;
+
+    auto position = [&](u32 v) {
+        return glm::vec3(positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2]);
+    };
+
+    glm::vec3 mesh_center(0.0f);
+    f32 mesh_area = 0.0f;
+
+    auto clusters = cast(Cluster_Sort *)SDL_malloc(cast(usize)cluster_count * sizeof(Cluster_Sort));
+    auto centers  = cast(glm::vec3 *)SDL_malloc(cast(usize)cluster_count * sizeof(glm::vec3));
+    auto normals  = cast(glm::vec3 *)SDL_malloc(cast(usize)cluster_count * sizeof(glm::vec3));
+    auto sorted   = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    defer {
+        SDL_free(clusters);
+        SDL_free(centers);
+        SDL_free(normals);
+        SDL_free(sorted);
+    };
+    if (!clusters || !centers || !normals || !sorted) return;
+
+    for (int ci = 0; ci < cluster_count; ci++) {
+        u32 start = cluster_starts[ci];
+        u32 end   = (ci + 1 < cluster_count) ? cluster_starts[ci + 1] : cast(u32)triangle_count;
+
+        glm::vec3 center(0.0f);
+        glm::vec3 normal(0.0f);
+        f32 area = 0.0f;
+        for (u32 t = start; t < end; t++) {
+            glm::vec3 a = position(indices[t * 3 + 0]);
+            glm::vec3 b = position(indices[t * 3 + 1]);
+            glm::vec3 c = position(indices[t * 3 + 2]);
+            glm::vec3 n = glm::cross(b - a, c - a);
+            f32 double_area = glm::length(n);
+
+            center += (a + b + c) * (double_area / 3.0f);
+            normal += n;
+            area   += double_area;
+        }
+
+        mesh_center += center;
+        mesh_area   += area;
+
+        clusters[ci].start = start;
+        clusters[ci].count = end - start;
+        clusters[ci].index = cast(u32)ci;
+        centers[ci] = area > 0.0f ? center / area : position(indices[start * 3]);
+        normals[ci] = normal;
+    }
+
+    if (mesh_area > 0.0f) mesh_center /= mesh_area;
+
+    for (int ci = 0; ci < cluster_count; ci++) {
+        f32 length = glm::length(normals[ci]);
+        clusters[ci].key = length > 0.0f ? glm::dot(centers[ci] - mesh_center, normals[ci] / length) : 0.0f;
+    }
+
+    SDL_qsort(clusters, cast(usize)cluster_count, sizeof(Cluster_Sort), compare_clusters);
+
+    u32 offset = 0;
+    for (int ci = 0; ci < cluster_count; ci++) {
+        usize size = cast(usize)clusters[ci].count * 3;
+        SDL_memcpy(sorted + offset, indices + clusters[ci].start * 3, size * sizeof(u32));
+        offset += cast(u32)size;
+        if (cluster_order) cluster_order[ci] = clusters[ci].index;
+    }
+    SDL_memcpy(indices, sorted, cast(usize)index_count * sizeof(u32));
+}
+
+static void permute_stream(void *stream, usize vertex_size, const u32 *remap, int vertex_count, u8 *scratch) {
+    if (stream == NULL) return;
+
+    auto bytes = cast(u8 *)stream;
+    SDL_memcpy(scratch, bytes, vertex_size * cast(usize)vertex_count);
+    for (int v = 0; v < vertex_count; v++) {
+        SDL_memcpy(bytes + remap[v] * vertex_size, scratch + cast(usize)v * vertex_size, vertex_size);
+    }
+}
+
+// Renumbers vertices in first-use order so the vertex fetch walks memory
+// forward. Unreferenced vertices go last.
+static void optimize_vertex_fetch(Gfx_Mesh *mesh, u32 *indices, int index_count) {
+    int vertex_count = mesh->vertex_count;
+
+    auto remap   = cast(u32 *)SDL_malloc(cast(usize)vertex_count * sizeof(u32));
+    auto scratch = cast(u8 *)SDL_malloc(cast(usize)vertex_count * 4 * sizeof(f32));
+    defer {
+        SDL_free(remap);
+        SDL_free(scratch);
+    };
+    if (!remap || !scratch) return;
+
+    SDL_memset(remap, 0xff, cast(usize)vertex_count * sizeof(u32));
+
+    u32 next = 0;
+    for (int i = 0; i < index_count; i++) {
+        u32 v = indices[i];
+        if (remap[v] == 0xffffffff) remap[v] = next++;
+        indices[i] = remap[v];
+    }
+    for (int v = 0; v < vertex_count; v++) {
+        if (remap[v] == 0xffffffff) remap[v] = next++;
+    }
+
+    // The LODs index the same vertices.
+    u32 lod_index_count = gfx_mesh_lod_index_count(mesh);
+    for (u32 i = 0; i < lod_index_count; i++) {
+        if (mesh->index_size == sizeof(u32)) {
+            auto lod_indices = cast(u32 *)mesh->lod_indices;
+            lod_indices[i] = remap[lod_indices[i]];
+        } else {
+            auto lod_indices = cast(u16 *)mesh->lod_indices;
+            lod_indices[i] = cast(u16)remap[lod_indices[i]];
+        }
+    }
+
+    permute_stream(mesh->vertices,   3 * sizeof(f32), remap, vertex_count, scratch);
+    permute_stream(mesh->normals,    3 * sizeof(f32), remap, vertex_count, scratch);
+    permute_stream(mesh->tangents,   4 * sizeof(f32), remap, vertex_count, scratch);
+    permute_stream(mesh->texcoords,  2 * sizeof(f32), remap, vertex_count, scratch);
+    permute_stream(mesh->texcoords2, 2 * sizeof(f32), remap, vertex_count, scratch);
+    permute_stream(mesh->colors,     4 * sizeof(u8),  remap, vertex_count, scratch);
+    permute_stream(mesh->joints,     4 * sizeof(u16), remap, vertex_count, scratch);
+    permute_stream(mesh->weights,    4 * sizeof(f32), remap, vertex_count, scratch);
+}
+
+// Runs Tipsify within every meshlet, on the meshlet's own vertices so the
+// tables of each run are sized for them. The meshlets are the clusters of the
+// overdraw pass, their first triangles go to cluster_starts.
+static void optimize_meshlet_vertex_cache(const Gfx_Meshlets *meshlets, const u32 *indices, u32 *out, int index_count,
+                                          int vertex_count, u32 *cluster_starts) {
+    SDL_memcpy(out, indices, cast(usize)index_count * sizeof(u32));
+    for (int mi = 0; mi < meshlets->count; mi++) cluster_starts[mi] = meshlets->meshlets[mi].first_index / 3;
+
+    auto remap        = cast(u32 *)SDL_malloc(cast(usize)vertex_count * sizeof(u32));
+    auto global       = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    auto local        = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    auto local_out    = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    auto local_starts = cast(u32 *)SDL_malloc(cast(usize)(index_count / 3) * sizeof(u32));
+    defer {
+        SDL_free(remap);
+        SDL_free(global);
+        SDL_free(local);
+        SDL_free(local_out);
+        SDL_free(local_starts);
+    };
+    if (!remap || !global || !local || !local_out || !local_starts) return;
+
+    SDL_memset(remap, 0xff, cast(usize)vertex_count * sizeof(u32));
+
+    for (int mi = 0; mi < meshlets->count; mi++) {
+        const Gfx_Meshlet *meshlet = &meshlets->meshlets[mi];
+        const u32 *source = indices + meshlet->first_index;
+        int count = cast(int)meshlet->index_count;
+
+        int local_count = 0;
+        for (int i = 0; i < count; i++) {
+            u32 v = source[i];
+            if (remap[v] == 0xffffffff) {
+                remap[v] = cast(u32)local_count;
+                global[local_count++] = v;
+            }
+            local[i] = remap[v];
+        }
+
+        gfx_optimize_vertex_cache(local, local_out, count, local_count, GFX_VERTEX_CACHE_SIZE, local_starts);
+        for (int i = 0; i < count; i++) out[meshlet->first_index + cast(u32)i] = global[local_out[i]];
+        for (int v = 0; v < local_count; v++) remap[global[v]] = 0xffffffff;
+    }
+}
+
+void gfx_mesh_optimize(Gfx_Mesh *mesh, Gfx_Optimize_Report *report) {
+    Gfx_Optimize_Report result{};
+    defer { if (report) *report = result; };
+
+    int index_count  = mesh->triangle_count * 3;
+    int vertex_count = mesh->vertex_count;
+    if (index_count == 0 || vertex_count == 0 || mesh->indices == NULL || mesh->vertices == NULL) return;
+
+    auto indices        = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    auto optimized      = cast(u32 *)SDL_malloc(cast(usize)index_count * sizeof(u32));
+    auto cluster_starts = cast(u32 *)SDL_malloc(cast(usize)mesh->triangle_count * sizeof(u32));
+
+    // The meshlet table is reordered along with the meshlets.
+    Gfx_Meshlets *meshlets = &mesh->meshlets;
+    u32 *cluster_order = NULL;
+    Gfx_Meshlet *table = NULL;
+    if (meshlets->count > 0) {
+        cluster_order = cast(u32 *)SDL_malloc(cast(usize)meshlets->count * sizeof(u32));
+        table         = cast(Gfx_Meshlet *)SDL_malloc(cast(usize)meshlets->count * sizeof(Gfx_Meshlet));
+    }
+    defer {
+        SDL_free(indices);
+        SDL_free(optimized);
+        SDL_free(cluster_starts);
+        SDL_free(cluster_order);
+        SDL_free(table);
+    };
+    if (!indices || !optimized || !cluster_starts) return;
+    if (meshlets->count > 0 && (!cluster_order || !table)) return;
+
+    for (int i = 0; i < index_count; i++) indices[i] = gfx_mesh_get_index(mesh, i);
+    result.before = gfx_analyze_vertex_cache(indices, index_count, vertex_count, GFX_VERTEX_CACHE_SIZE);
+
+    if (meshlets->count > 0) {
+        result.cluster_count = meshlets->count;
+        optimize_meshlet_vertex_cache(meshlets, indices, optimized, index_count, vertex_count, cluster_starts);
+    } else {
+        result.cluster_count = gfx_optimize_vertex_cache(indices, optimized, index_count, vertex_count, GFX_VERTEX_CACHE_SIZE, cluster_starts);
+    }
+    gfx_optimize_overdraw(optimized, index_count, mesh->vertices, cluster_starts, result.cluster_count, cluster_order);
+
+    // Keep the input order if reordering made the cache behaviour worse.
+    // Renumbering vertices does not change ACMR/ATVR, so this can be decided
+    // before the fetch pass.
+    result.after = gfx_analyze_vertex_cache(optimized, index_count, vertex_count, GFX_VERTEX_CACHE_SIZE);
+    if (result.after.acmr > result.before.acmr) {
+        SDL_memcpy(optimized, indices, cast(usize)index_count * sizeof(u32));
+        result.after = result.before;
+    } else if (meshlets->count > 0) {
+        SDL_memcpy(table, meshlets->meshlets, cast(usize)meshlets->count * sizeof(Gfx_Meshlet));
+        u32 first_index = 0;
+        for (int mi = 0; mi < meshlets->count; mi++) {
+            Gfx_Meshlet *meshlet = &meshlets->meshlets[mi];
+            *meshlet = table[cluster_order[mi]];
+            meshlet->first_index = first_index;
+            first_index += meshlet->index_count;
+        }
+    }
+
+    optimize_vertex_fetch(mesh, optimized, index_count);
+
+    for (int i = 0; i < index_count; i++) gfx_mesh_set_index(mesh, i, optimized[i]);
+}
+
+void gfx_model_optimize(Gfx_Model *model, bool log) {
+    for (int i = 0; i < model->mesh_count; i++) {
+        Gfx_Optimize_Report report;
+        gfx_mesh_optimize(&model->meshes[i], &report);
+
+        if (log) {
+            SDL_Log("mesh %3d: %6d tris, %4d clusters, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+                    i, model->meshes[i].triangle_count, report.cluster_count,
+                    report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "defines.h"
+
+struct Gfx_Mesh;
+struct Gfx_Model;
+
+//
+// Mesh optimization, run at bake time by gfx_cache_bake().
+//
+// Three passes run in order:
+// 1. Post-transform vertex cache reordering of the triangles (Tipsify).
+// 2. Overdraw ordering of the clusters Tipsify produced, outward-facing
+//    clusters far from the mesh center first.
+// 3. Vertex fetch reordering, which renumbers vertices in first-use order and
+//    permutes every attribute stream to match.
+//
+// Meshes with meshlets (see gfx_meshlet.h) keep them: Tipsify runs within
+// each meshlet and the overdraw pass orders whole meshlets, reordering the
+// meshlet table to match.
+//
+// Cache efficiency is measured with a simulated FIFO cache:
+// - ACMR: cache misses per triangle, 0.5 is the ideal for regular grids.
+// - ATVR: cache misses per referenced vertex, 1.0 is ideal.
+//
+
+#define GFX_VERTEX_CACHE_SIZE 16
+
+struct Gfx_Vertex_Cache_Stats {
+    f32 acmr = 0.0f;
+    f32 atvr = 0.0f;
+};
+
+struct Gfx_Optimize_Report {
+    Gfx_Vertex_Cache_Stats before;
+    Gfx_Vertex_Cache_Stats after;
+    int cluster_count = 0;
+};
+
+// Simulates a FIFO post-transform cache of cache_size entries.
+Gfx_Vertex_Cache_Stats gfx_analyze_vertex_cache(const u32 *indices, int index_count, int vertex_count, int cache_size);
+
+// Reorders triangles for the vertex cache. Writes the first triangle of each
+// cluster into cluster_starts (capacity index_count / 3) and returns the
+// cluster count. indices and out must not overlap.
+int gfx_optimize_vertex_cache(const u32 *indices, u32 *out, int index_count, int vertex_count, int cache_size, u32 *cluster_starts);
+
+// Reorders whole clusters to reduce overdraw. positions is float3 per vertex.
+// cluster_order may be NULL, otherwise it receives the old index of every
+// cluster in the new order.
+void gfx_optimize_overdraw(u32 *indices, int index_count, const f32 *positions, const u32 *cluster_starts, int cluster_count,
+                           u32 *cluster_order = NULL);
+
+// Runs all passes on the mesh in place. report may be NULL.
+void gfx_mesh_optimize(Gfx_Mesh *mesh, Gfx_Optimize_Report *report);
+
+// Optimizes every mesh and logs the ACMR/ATVR change of each one.
+void gfx_model_optimize(Gfx_Model *model, bool log);
@@ -0,0 +1,341 @@
+#include "gfx_pipeline.h"
+#include "profile.h"
+
+#if GFX_EMBEDDED_SHADERS
+#include "gfx_shader_spirv.h"
+#define SPIRV(name) gfx_spirv_##name, sizeof(gfx_spirv_##name)
+#elif GFX_GPU_RECORD
+// The recording device never reads shader code, see gfx_gpu_record.h.
+static const u8 placeholder_spirv[4] = {};
+#define SPIRV(name) placeholder_spirv, sizeof(placeholder_spirv)
+#else
+#define SPIRV(name) NULL, 0
+#endif
+
+struct Shader_Source {
+    const char *name; // File name in res/shaders without extension.
+    SDL_GPUShaderStage stage;
+    u32 sampler_count;
+    u32 uniform_buffer_count;
+    const u8 *code; // Embedded SPIR-V, NULL to load the file.
+    usize code_size;
+};
+
+static const Shader_Source shader_sources[GFX_SHADER_COUNT] = {
+    {"basic.vert",                SDL_GPU_SHADERSTAGE_VERTEX,   0, 1, SPIRV(basic_vert)},
+    {"basic.frag",                SDL_GPU_SHADERSTAGE_FRAGMENT, 1, 0, SPIRV(basic_frag)},
+    {"mesh.vert",                 SDL_GPU_SHADERSTAGE_VERTEX,   0, 1, SPIRV(mesh_vert)},
+    {"mesh_compact.vert",         SDL_GPU_SHADERSTAGE_VERTEX,   0, 1, SPIRV(mesh_compact_vert)},
+    {"mesh_compact_tangent.vert", SDL_GPU_SHADERSTAGE_VERTEX,   0, 1, SPIRV(mesh_compact_tangent_vert)},
+};
+
+static SDL_GPUShader *get_shader(Gfx_Pipeline_Cache *cache, u32 shader) {
+    if (shader >= GFX_SHADER_COUNT) return NULL;
+
+    SDL_LockMutex(cache->shader_lock);
+    defer { SDL_UnlockMutex(cache->shader_lock); };
+    if (cache->shaders[shader]) return cache->shaders[shader];
+
+    const Shader_Source *source = &shader_sources[shader];
+    const void *code = source->code;
+    usize code_size  = source->code_size;
+
+    void *loaded = NULL;
+    defer { SDL_free(loaded); };
+    if (!code) {
+        char path[256];
+        SDL_snprintf(path, sizeof(path), "res/shaders/%s.spv", source->name);
+        loaded = SDL_LoadFile(path, &code_size);
+        if (!loaded) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to load shader %s: %s", path, SDL_GetError());
+            return NULL;
+        }
+        code = loaded;
+    }
+
+    SDL_GPUShaderCreateInfo info{};
+    info.code_size    = code_size;
+    info.code         = cast(const u8 *)code;
+    info.entrypoint   = "main";
+    info.format       = SDL_GPU_SHADERFORMAT_SPIRV;
+    info.stage        = source->stage;
+    info.num_samplers = source->sampler_count;
+    info.num_storage_textures = 0;
+    info.num_storage_buffers  = 0;
+    info.num_uniform_buffers  = source->uniform_buffer_count;
+    cache->shaders[shader] = SDL_CreateGPUShader(cache->device, &info);
+    return cache->shaders[shader];
+}
+
+static void quad_vertex_input(Gfx_Vertex_Input *input) {
+    *input = {};
+
+    input->buffers[0].slot  = 0;
+    input->buffers[0].pitch = sizeof(Gfx_Quad_Vertex);
+    input->buffers[0].input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX;
+    input->buffers[0].instance_step_rate = 0;
+
+    input->attributes[0].location    = 0;
+    input->attributes[0].buffer_slot = 0;
+    input->attributes[0].format      = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3;
+    input->attributes[0].offset      = offsetof(Gfx_Quad_Vertex, position);
+
+    input->attributes[1].location    = 1;
+    input->attributes[1].buffer_slot = 0;
+    input->attributes[1].format      = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4;
+    input->attributes[1].offset      = offsetof(Gfx_Quad_Vertex, color);
+
+    input->attributes[2].location    = 2;
+    input->attributes[2].buffer_slot = 0;
+    input->attributes[2].format      = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2;
+    input->attributes[2].offset      = offsetof(Gfx_Quad_Vertex, texcoord);
+
+    input->state.vertex_buffer_descriptions = input->buffers;
+    input->state.num_vertex_buffers    = 1;
+    input->state.vertex_attributes     = input->attributes;
+    input->state.num_vertex_attributes = 3;
+}
+
+static SDL_GPUColorTargetBlendState blend_state(u32 mode) {
+    SDL_GPUColorTargetBlendState state{};
+    if (mode == GFX_BLEND_OPAQUE) return state;
+
+    state.enable_blend          = true;
+    state.color_blend_op        = SDL_GPU_BLENDOP_ADD;
+    state.alpha_blend_op        = SDL_GPU_BLENDOP_ADD;
+    state.src_color_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA;
+    state.src_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE;
+    if (mode == GFX_BLEND_ADDITIVE) {
+        state.dst_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE;
+        state.dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE;
+    } else {
+        state.dst_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA;
+        state.dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA;
+    }
+    return state;
+}
+
+static SDL_GPUGraphicsPipeline *create_pipeline(Gfx_Pipeline_Cache *cache, const Gfx_Pipeline_Key *key) {
+    SDL_GPUShader *vertex_shader   = get_shader(cache, key->vertex_shader);
+    SDL_GPUShader *fragment_shader = get_shader(cache, key->fragment_shader);
+    if (!vertex_shader || !fragment_shader) return NULL;
+
+    Gfx_Vertex_Input input;
+    if (key->vertex_input == GFX_PIPELINE_INPUT_QUAD)     quad_vertex_input(&input);
+    else if (key->vertex_input < GFX_VERTEX_LAYOUT_COUNT) gfx_vertex_input(cast(Gfx_Vertex_Layout)key->vertex_input, &input);
+    else                                                  return NULL;
+
+    SDL_GPUColorTargetDescription color_target_description{};
+    color_target_description.format      = cast(SDL_GPUTextureFormat)key->color_format;
+    color_target_description.blend_state = blend_state(key->blend);
+
+    SDL_GPUGraphicsPipelineTargetInfo target_info{};
+    target_info.color_target_descriptions = &color_target_description;
+    target_info.num_color_targets = 1;
+
+    SDL_GPUDepthStencilState depth_stencil_state{};
+    if (key->depth != GFX_DEPTH_NONE) {
+        target_info.has_depth_stencil_target = true;
+        target_info.depth_stencil_format     = cast(SDL_GPUTextureFormat)key->depth_format;
+        depth_stencil_state.enable_depth_test  = true;
+        depth_stencil_state.enable_depth_write = key->depth == GFX_DEPTH_TEST_WRITE;
+        depth_stencil_state.compare_op         = SDL_GPU_COMPAREOP_LESS_OR_EQUAL;
+    }
+
+    SDL_GPUGraphicsPipelineCreateInfo pipeline_info{};
+    pipeline_info.vertex_shader   = vertex_shader;
+    pipeline_info.fragment_shader = fragment_shader;
+    pipeline_info.primitive_type  = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST;
+    pipeline_info.target_info     = target_info;
+    pipeline_info.vertex_input_state  = input.state;
+    pipeline_info.depth_stencil_state = depth_stencil_state;
+
+    return SDL_CreateGPUGraphicsPipeline(cache->device, &pipeline_info);
+}
+
+// Creates the variant of an entry the caller moved to BUILDING, without the
+// lock held.
+static SDL_GPUGraphicsPipeline *build_entry(Gfx_Pipeline_Cache *cache, Gfx_Pipeline_Entry *entry, bool background) {
+    PROFILE_ZONE("create_pipeline");
+    u64 start = SDL_GetPerformanceCounter();
+    SDL_GPUGraphicsPipeline *pipeline = create_pipeline(cache, &entry->key);
+    f64 ms = cast(f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / cast(f64)SDL_GetPerformanceFrequency();
+
+    if (!pipeline) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to create pipeline %s/%s: %s",
+                     gfx_shader_name(cast(Gfx_Shader)entry->key.vertex_shader),
+                     gfx_shader_name(cast(Gfx_Shader)entry->key.fragment_shader), SDL_GetError());
+    }
+
+    SDL_LockMutex(cache->lock);
+    entry->pipeline = pipeline;
+    entry->state    = pipeline ? GFX_PIPELINE_READY : GFX_PIPELINE_FAILED;
+    if (pipeline) {
+        cache->stats.created++;
+        if (background) cache->stats.background++;
+    }
+    cache->stats.create_ms += ms;
+    SDL_UnlockMutex(cache->lock);
+
+    return pipeline;
+}
+
+static int pipeline_main(void *userdata) {
+    auto cache = cast(Gfx_Pipeline_Cache *)userdata;
+    SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_LOW);
+    profile_set_thread_name("gfx_pipeline");
+
+    for (;;) {
+        SDL_WaitSemaphore(cache->wake);
+        if (SDL_GetAtomicInt(&cache->quit)) break;
+
+        // The main thread may have taken the entry over since it was queued.
+        Gfx_Pipeline_Entry *entry = NULL;
+        SDL_LockMutex(cache->lock);
+        if (cache->queue_count > 0) {
+            entry = &cache->entries[cache->queue[cache->queue_head]];
+            cache->queue_head = (cache->queue_head + 1) % GFX_PIPELINE_QUEUE_CAPACITY;
+            cache->queue_count--;
+            if (entry->state == GFX_PIPELINE_QUEUED) entry->state = GFX_PIPELINE_BUILDING;
+            else                                     entry = NULL;
+        }
+        SDL_UnlockMutex(cache->lock);
+
+        if (entry) build_entry(cache, entry, true);
+    }
+
+    return 0;
+}
+
+bool gfx_pipeline_cache_init(Gfx_Pipeline_Cache *cache, SDL_GPUDevice *device) {
+    *cache = {};
+    cache->device = device;
+
+    cache->lock        = SDL_CreateMutex();
+    cache->shader_lock = SDL_CreateMutex();
+    cache->wake        = SDL_CreateSemaphore(0);
+    if (!cache->lock || !cache->shader_lock || !cache->wake) {
+        gfx_pipeline_cache_free(cache);
+        return false;
+    }
+
+    cache->thread = SDL_CreateThread(pipeline_main, "gfx_pipeline", cache);
+    return true;
+}
+
+void gfx_pipeline_cache_free(Gfx_Pipeline_Cache *cache) {
+    if (cache->thread) {
+        SDL_SetAtomicInt(&cache->quit, 1);
+        SDL_SignalSemaphore(cache->wake);
+        SDL_WaitThread(cache->thread, NULL);
+    }
+
+    for (int i = 0; i < GFX_PIPELINE_CACHE_CAPACITY; i++) {
+        if (cache->entries[i].pipeline) SDL_ReleaseGPUGraphicsPipeline(cache->device, cache->entries[i].pipeline);
+    }
+    for (int i = 0; i < GFX_SHADER_COUNT; i++) {
+        if (cache->shaders[i]) SDL_ReleaseGPUShader(cache->device, cache->shaders[i]);
+    }
+
+    if (cache->lock)        SDL_DestroyMutex(cache->lock);
+    if (cache->shader_lock) SDL_DestroyMutex(cache->shader_lock);
+    if (cache->wake)        SDL_DestroySemaphore(cache->wake);
+    *cache = {};
+}
+
+// The entry of key, or the empty one to take for it. NULL when the cache is
+// full. Called with the lock held.
+static Gfx_Pipeline_Entry *find_entry(Gfx_Pipeline_Cache *cache, const Gfx_Pipeline_Key *key, u64 hash) {
+    u32 mask = GFX_PIPELINE_CACHE_CAPACITY - 1;
+    for (u32 i = 0, slot = cast(u32)hash & mask; i < GFX_PIPELINE_CACHE_CAPACITY; i++, slot = (slot + 1) & mask) {
+        Gfx_Pipeline_Entry *entry = &cache->entries[slot];
+        if (entry->state == GFX_PIPELINE_EMPTY) return entry;
+        if (entry->hash == hash && gfx_pipeline_key_equal(&entry->key, key)) return entry;
+    }
+    return NULL;
+}
+
+static void take_entry(Gfx_Pipeline_Cache *cache, Gfx_Pipeline_Entry *entry, const Gfx_Pipeline_Key *key, u64 hash,
+                       Gfx_Pipeline_State state) {
+    entry->key   = *key;
+    entry->hash  = hash;
+    entry->state = state;
+    cache->count++;
+}
+
+void gfx_pipeline_request(Gfx_Pipeline_Cache *cache, const Gfx_Pipeline_Key *key) {
+    u64 hash = gfx_pipeline_key_hash(key);
+
+    SDL_LockMutex(cache->lock);
+    defer { SDL_UnlockMutex(cache->lock); };
+
+    // Left for the first get without the thread or room in the queue.
+    if (!cache->thread || cache->queue_count == GFX_PIPELINE_QUEUE_CAPACITY) return;
+
+    Gfx_Pipeline_Entry *entry = find_entry(cache, key, hash);
+    if (!entry || entry->state != GFX_PIPELINE_EMPTY) return;
+
+    take_entry(cache, entry, key, hash, GFX_PIPELINE_QUEUED);
+    int tail = (cache->queue_head + cache->queue_count) % GFX_PIPELINE_QUEUE_CAPACITY;
+    cache->queue[tail] = cast(int)(entry - cache->entries);
+    cache->queue_count++;
+    SDL_SignalSemaphore(cache->wake);
+}
+
+SDL_GPUGraphicsPipeline *gfx_pipeline_get(Gfx_Pipeline_Cache *cache, const Gfx_Pipeline_Key *key) {
+    u64 hash = gfx_pipeline_key_hash(key);
+
+    SDL_LockMutex(cache->lock);
+    Gfx_Pipeline_Entry *entry = find_entry(cache, key, hash);
+
+    if (entry && entry->state == GFX_PIPELINE_READY) {
+        cache->stats.hits++;
+        SDL_GPUGraphicsPipeline *pipeline = entry->pipeline;
+        SDL_UnlockMutex(cache->lock);
+        return pipeline;
+    }
+
+    if (!entry || entry->state == GFX_PIPELINE_BUILDING || entry->state == GFX_PIPELINE_FAILED) {
+        cache->stats.missing++;
+        SDL_UnlockMutex(cache->lock);
+        return NULL;
+    }
+
+    // New or still queued, the thread skips a queued entry taken over here.
+    if (entry->state == GFX_PIPELINE_EMPTY) take_entry(cache, entry, key, hash, GFX_PIPELINE_BUILDING);
+    else                                    entry->state = GFX_PIPELINE_BUILDING;
+    cache->stats.stalls++;
+    SDL_UnlockMutex(cache->lock);
+
+    return build_entry(cache, entry, false);
+}
+
+Gfx_Pipeline_Stats gfx_pipeline_stats(Gfx_Pipeline_Cache *cache) {
+    SDL_LockMutex(cache->lock);
+    Gfx_Pipeline_Stats stats = cache->stats;
+    SDL_UnlockMutex(cache->lock);
+    return stats;
+}
+
+const char *gfx_shader_name(Gfx_Shader shader) {
+    if (shader < 0 || shader >= GFX_SHADER_COUNT) return "unknown";
+    return shader_sources[shader].name;
+}
+
+const char *gfx_blend_mode_name(Gfx_Blend_Mode mode) {
+    switch (mode) {
+        case GFX_BLEND_OPAQUE:   return "opaque";
+        case GFX_BLEND_ALPHA:    return "alpha";
+        case GFX_BLEND_ADDITIVE: return "additive";
+        default:                 return "unknown";
+    }
+}
+
+const char *gfx_depth_mode_name(Gfx_Depth_Mode mode) {
+    switch (mode) {
+        case GFX_DEPTH_NONE:       return "none";
+        case GFX_DEPTH_TEST:       return "test";
+        case GFX_DEPTH_TEST_WRITE: return "test_write";
+        default:                   return "unknown";
+    }
+}
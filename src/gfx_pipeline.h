@@ -0,0 +1,155 @@
+#pragma once
+
+#include "defines.h"
+#include "gfx_vertex.h"
+
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+
+//
+// Shaders and graphics pipeline variants.
+//
+// The SPIR-V of every shader in res/shaders is compiled by the build and
+// embedded in the binary (gfx_shader_spirv.h, see cmake/embed_spirv.cmake),
+// so startup reads no shader files. A build without glslangValidator leaves
+// GFX_EMBEDDED_SHADERS at 0 and loads res/shaders/*.spv instead, compiled by
+// res/shaders/compile.bat.
+//
+// A pipeline variant is described by a Gfx_Pipeline_Key: its shaders,
+// vertex input, blend and depth state and target formats. The cache creates
+// each variant once, on first use, and keeps it until it is freed. Variants
+// known ahead of time are requested at init and created by a background
+// thread, SDL allows GPU resources to be created from any thread. A variant
+// asked for while still queued is created on the spot, one the thread is
+// creating right now is not waited for: it is NULL for that frame.
+//
+// Shaders are created once for all the variants that use them.
+//
+
+enum Gfx_Shader {
+    GFX_SHADER_BASIC_VERT,
+    GFX_SHADER_BASIC_FRAG,
+    GFX_SHADER_MESH_VERT,
+    GFX_SHADER_MESH_COMPACT_VERT,
+    GFX_SHADER_MESH_COMPACT_TANGENT_VERT,
+
+    GFX_SHADER_COUNT,
+};
+
+enum Gfx_Blend_Mode {
+    GFX_BLEND_OPAQUE,
+    GFX_BLEND_ALPHA,    // Source over destination by source alpha.
+    GFX_BLEND_ADDITIVE,
+
+    GFX_BLEND_MODE_COUNT,
+};
+
+enum Gfx_Depth_Mode {
+    GFX_DEPTH_NONE,
+    GFX_DEPTH_TEST,       // Less or equal, no write.
+    GFX_DEPTH_TEST_WRITE,
+
+    GFX_DEPTH_MODE_COUNT,
+};
+
+// Vertex input of the textured quad, next to the mesh vertex layouts.
+#define GFX_PIPELINE_INPUT_QUAD GFX_VERTEX_LAYOUT_COUNT
+
+struct Gfx_Quad_Vertex {
+    glm::vec3 position;
+    glm::vec4 color;
+    glm::vec2 texcoord;
+};
+
+// All u32 so there is no padding, the key is hashed as bytes.
+struct Gfx_Pipeline_Key {
+    u32 vertex_shader   = GFX_SHADER_BASIC_VERT;
+    u32 fragment_shader = GFX_SHADER_BASIC_FRAG;
+    u32 vertex_input    = GFX_PIPELINE_INPUT_QUAD; // Gfx_Vertex_Layout or GFX_PIPELINE_INPUT_QUAD.
+    u32 blend = GFX_BLEND_OPAQUE;
+    u32 depth = GFX_DEPTH_NONE;
+    u32 color_format = SDL_GPU_TEXTUREFORMAT_INVALID;
+    u32 depth_format = SDL_GPU_TEXTUREFORMAT_INVALID; // Used with a depth mode.
+};
+
+inline bool gfx_pipeline_key_equal(const Gfx_Pipeline_Key *a, const Gfx_Pipeline_Key *b) {
+    return SDL_memcmp(a, b, sizeof(Gfx_Pipeline_Key)) == 0;
+}
+
+inline u64 gfx_pipeline_key_hash(const Gfx_Pipeline_Key *key) {
+    return hash_fnv1a64(key, sizeof(Gfx_Pipeline_Key));
+}
+
+#define GFX_PIPELINE_CACHE_CAPACITY 256 // Variants, a power of two.
+#define GFX_PIPELINE_QUEUE_CAPACITY 64  // Background requests.
+
+enum Gfx_Pipeline_State {
+    GFX_PIPELINE_EMPTY,
+    GFX_PIPELINE_QUEUED,   // Waiting for the thread.
+    GFX_PIPELINE_BUILDING, // Being created, by the thread or the main thread.
+    GFX_PIPELINE_READY,
+    GFX_PIPELINE_FAILED,
+};
+
+struct Gfx_Pipeline_Entry {
+    Gfx_Pipeline_Key key;
+    u64 hash = 0;
+    Gfx_Pipeline_State state = GFX_PIPELINE_EMPTY;
+    SDL_GPUGraphicsPipeline *pipeline = NULL;
+};
+
+struct Gfx_Pipeline_Stats {
+    int created    = 0; // Variants created, by either thread.
+    int background = 0; // Of those, created by the thread.
+    int stalls     = 0; // Variants the main thread had to create when asked for.
+    int missing    = 0; // Gets that returned NULL: building, failed or full.
+    u64 hits       = 0; // Gets of a ready variant.
+    f64 create_ms  = 0; // Total time spent creating, shaders included.
+};
+
+struct Gfx_Pipeline_Cache {
+    SDL_GPUDevice *device = NULL;
+
+    // Entries never move once taken, the lock covers their state and the
+    // queue. The key of a taken entry does not change.
+    SDL_Mutex *lock = NULL;
+    Gfx_Pipeline_Entry entries[GFX_PIPELINE_CACHE_CAPACITY];
+    int count = 0;
+
+    // Entry indices waiting for the thread, one semaphore count each.
+    int queue[GFX_PIPELINE_QUEUE_CAPACITY];
+    int queue_head  = 0;
+    int queue_count = 0;
+
+    SDL_Thread *thread = NULL;
+    SDL_Semaphore *wake = NULL;
+    SDL_AtomicInt quit;
+
+    SDL_Mutex *shader_lock = NULL;
+    SDL_GPUShader *shaders[GFX_SHADER_COUNT] = {};
+
+    Gfx_Pipeline_Stats stats;
+};
+
+// Starts the background thread. The cache must not move while it runs.
+// Without a thread, requests are created on first use. Returns false on
+// failure.
+bool gfx_pipeline_cache_init(Gfx_Pipeline_Cache *cache, SDL_GPUDevice *device);
+
+// Waits for the variant in progress and releases every pipeline and shader.
+void gfx_pipeline_cache_free(Gfx_Pipeline_Cache *cache);
+
+// Queues a variant for the background thread, nothing if it is known
+// already.
+void gfx_pipeline_request(Gfx_Pipeline_Cache *cache, const Gfx_Pipeline_Key *key);
+
+// The variant of key, created now when it is new or still queued. NULL
+// while the thread creates it, or if creating it failed. Main thread only.
+SDL_GPUGraphicsPipeline *gfx_pipeline_get(Gfx_Pipeline_Cache *cache, const Gfx_Pipeline_Key *key);
+
+// A copy of the stats, taken under the lock.
+Gfx_Pipeline_Stats gfx_pipeline_stats(Gfx_Pipeline_Cache *cache);
+
+const char *gfx_shader_name(Gfx_Shader shader);
+const char *gfx_blend_mode_name(Gfx_Blend_Mode mode);
+const char *gfx_depth_mode_name(Gfx_Depth_Mode mode);
@@ -0,0 +1,115 @@
+#include "gfx_queue.h"
+
+#include <SDL3/SDL.h>
+
+u64 gfx_draw_key(u32 pipeline, u32 material, u32 mesh, f32 depth) {
+    u64 depth_bits = cast(u64)(SDL_clamp(depth, 0.0f, 1.0f) * cast(f32)GFX_KEY_DEPTH_MASK);
+
+    return ((cast(u64)pipeline & GFX_KEY_PIPELINE_MASK) << GFX_KEY_PIPELINE_SHIFT) |
+           ((cast(u64)material & GFX_KEY_MATERIAL_MASK) << GFX_KEY_MATERIAL_SHIFT) |
+           ((cast(u64)mesh     & GFX_KEY_MESH_MASK)     << GFX_KEY_MESH_SHIFT) |
+           (depth_bits & GFX_KEY_DEPTH_MASK);
+}
+
+void gfx_queue_free(Gfx_Render_Queue *queue) {
+    SDL_free(queue->packets);
+    SDL_free(queue->scratch);
+    *queue = {};
+}
+
+void gfx_queue_clear(Gfx_Render_Queue *queue) {
+    queue->count = 0;
+}
+
+bool gfx_queue_push(Gfx_Render_Queue *queue, u64 key, u32 index) {
+    if (queue->count == queue->capacity) {
+        int capacity = SDL_max(1024, queue->capacity * 2);
+        auto packets = cast(Gfx_Draw_Packet *)SDL_realloc(queue->packets, cast(usize)capacity * sizeof(Gfx_Draw_Packet));
+        if (!packets) return false;
+        queue->packets = packets;
+
+        // The scratch content is never kept between sorts. The old one stays
+        // until the new one exists, so a failure leaves a usable queue of the
+        // old capacity.
+        auto scratch = cast(Gfx_Draw_Packet *)SDL_malloc(cast(usize)capacity * sizeof(Gfx_Draw_Packet));
+        if (!scratch) return false;
+        SDL_free(queue->scratch);
+        queue->scratch = scratch;
+
+        queue->capacity = capacity;
+    }
+
+    Gfx_Draw_Packet *packet = &queue->packets[queue->count++];
+    packet->key   = key;
+    packet->index = index;
+    packet->pad   = 0;
+    return true;
+}
+
+void gfx_queue_sort(Gfx_Render_Queue *queue) {
+    int count = queue->count;
+    if (count <= 1) return;
+
+    // Histograms for all eight digits in one pass.
+    u32 histograms[8][256];
+    SDL_memset(histograms, 0, sizeof(histograms));
+    for (int i = 0; i < count; i++) {
+        u64 key = queue->packets[i].key;
+        for (int digit = 0; digit < 8; digit++) {
+            histograms[digit][(key >> (digit * 8)) & 0xff]++;
+        }
+    }
+
+    Gfx_Draw_Packet *src = queue->packets;
+    Gfx_Draw_Packet *dst = queue->scratch;
+
+    for (int digit = 0; digit < 8; digit++) {
+        u32 *histogram = histograms[digit];
+        int shift = digit * 8;
+
+        // Every key has the same digit, the pass would not move anything.
+        if (histogram[(src[0].key >> shift) & 0xff] == cast(u32)count) continue;
+
+        u32 offsets[256];
+        u32 sum = 0;
+        for (int bucket = 0; bucket < 256; bucket++) {
+            offsets[bucket] = sum;
+            sum += histogram[bucket];
+        }
+
+        for (int i = 0; i < count; i++) {
+            u32 bucket = cast(u32)((src[i].key >> shift) & 0xff);
+            dst[offsets[bucket]++] = src[i];
+        }
+
+        Gfx_Draw_Packet *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    // Keep the sorted packets in queue->packets.
+    if (src != queue->packets) {
+        queue->scratch = queue->packets;
+        queue->packets = src;
+    }
+}
+
+Gfx_Queue_Stats gfx_queue_stats(const Gfx_Render_Queue *queue) {
+    Gfx_Queue_Stats stats{};
+    stats.packets = cast(u32)queue->count;
+
+    for (int i = 0; i < queue->count; i++) {
+        u64 key = queue->packets[i].key;
+        u64 last = i > 0 ? queue->packets[i - 1].key : ~key;
+
+        if (i == 0 || gfx_key_pipeline(key) != gfx_key_pipeline(last)) stats.pipeline_binds++;
+        if (i == 0 || gfx_key_material(key) != gfx_key_material(last)) stats.material_binds++;
+        if (i == 0 || gfx_key_mesh(key) != gfx_key_mesh(last) || gfx_key_pipeline(key) != gfx_key_pipeline(last) ||
+            gfx_key_material(key) != gfx_key_material(last)) {
+            stats.mesh_binds++;
+        }
+    }
+
+    stats.redundant_binds = stats.packets * 3 - (stats.pipeline_binds + stats.material_binds + stats.mesh_binds);
+    return stats;
+}
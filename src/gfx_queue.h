@@ -0,0 +1,70 @@
+#pragma once
+
+#include "defines.h"
+
+//
+// Render queue.
+//
+// Draw packets are collected during the frame, sorted by a 64-bit key and
+// then walked in order, so state only has to be bound when it changes.
+//
+// Key layout, most significant first:
+//
+//     63..56  pipeline  (8 bits)
+//     55..40  material  (16 bits, texture + sampler)
+//     39..24  mesh      (16 bits)
+//     23..0   depth     (24 bits, front to back)
+//
+// Packets are sorted with an LSD radix sort over 8-bit digits. The sort is
+// stable, so packets with equal keys keep their submission order.
+//
+
+#define GFX_KEY_PIPELINE_SHIFT 56
+#define GFX_KEY_MATERIAL_SHIFT 40
+#define GFX_KEY_MESH_SHIFT     24
+
+#define GFX_KEY_PIPELINE_MASK 0xffull
+#define GFX_KEY_MATERIAL_MASK 0xffffull
+#define GFX_KEY_MESH_MASK     0xffffull
+#define GFX_KEY_DEPTH_MASK    0xffffffull
+
+struct Gfx_Draw_Packet {
+    u64 key;
+    u32 index; // Into the caller's per-draw data.
+    u32 pad;
+};
+
+struct Gfx_Render_Queue {
+    Gfx_Draw_Packet *packets = NULL;
+    Gfx_Draw_Packet *scratch = NULL;
+    int count    = 0;
+    int capacity = 0;
+};
+
+// Binds a renderer would issue for the sorted queue, compared to binding
+// everything for every packet.
+struct Gfx_Queue_Stats {
+    u32 packets         = 0;
+    u32 pipeline_binds  = 0;
+    u32 material_binds  = 0;
+    u32 mesh_binds      = 0;
+    u32 redundant_binds = 0; // Removed by sorting and state tracking.
+};
+
+// depth is normalized to [0, 1], values outside are clamped.
+u64 gfx_draw_key(u32 pipeline, u32 material, u32 mesh, f32 depth);
+
+inline u32 gfx_key_pipeline(u64 key) { return cast(u32)((key >> GFX_KEY_PIPELINE_SHIFT) & GFX_KEY_PIPELINE_MASK); }
+inline u32 gfx_key_material(u64 key) { return cast(u32)((key >> GFX_KEY_MATERIAL_SHIFT) & GFX_KEY_MATERIAL_MASK); }
+inline u32 gfx_key_mesh(u64 key)     { return cast(u32)((key >> GFX_KEY_MESH_SHIFT) & GFX_KEY_MESH_MASK); }
+
+void gfx_queue_free(Gfx_Render_Queue *queue);
+void gfx_queue_clear(Gfx_Render_Queue *queue);
+
+// Returns false on allocation failure, the packet is dropped then.
+bool gfx_queue_push(Gfx_Render_Queue *queue, u64 key, u32 index);
+
+void gfx_queue_sort(Gfx_Render_Queue *queue);
+
+// Counts the binds for the queue in its current order.
+Gfx_Queue_Stats gfx_queue_stats(const Gfx_Render_Queue *queue);
@@ -0,0 +1,111 @@
+#include "gfx_residency.h"
+
+#include <SDL3/SDL.h>
+
+static void lru_remove(Gfx_Residency *residency, Gfx_Resident *resident) {
+    if (resident->prev) resident->prev->next = resident->next;
+    else                residency->lru_first = resident->next;
+    if (resident->next) resident->next->prev = resident->prev;
+    else                residency->lru_last  = resident->prev;
+    resident->prev = NULL;
+    resident->next = NULL;
+}
+
+static void lru_push(Gfx_Residency *residency, Gfx_Resident *resident) {
+    resident->prev = residency->lru_last;
+    resident->next = NULL;
+    if (residency->lru_last) residency->lru_last->next = resident;
+    else                     residency->lru_first = resident;
+    residency->lru_last = resident;
+}
+
+void gfx_residency_add(Gfx_Residency *residency, Gfx_Resident *resident, Gfx_Resident_Kind kind, u64 size) {
+    ASSERT(!resident->resident);
+
+    Gfx_Residency_Stats *stats = &residency->stats;
+    if (resident->evicted) {
+        stats->restores++;
+        stats->restored_bytes += size;
+    }
+
+    resident->kind      = kind;
+    resident->size      = size;
+    resident->last_used = residency->frame;
+    resident->resident  = true;
+    resident->evicted   = false;
+    if (resident->evict) lru_push(residency, resident);
+
+    stats->bytes[kind] += size;
+    stats->count[kind]++;
+    stats->peak_bytes = SDL_max(stats->peak_bytes, gfx_residency_bytes(stats));
+}
+
+static void forget(Gfx_Residency *residency, Gfx_Resident *resident) {
+    if (resident->evict) lru_remove(residency, resident);
+    resident->resident = false;
+    residency->stats.bytes[resident->kind] -= resident->size;
+    residency->stats.count[resident->kind]--;
+}
+
+void gfx_residency_remove(Gfx_Residency *residency, Gfx_Resident *resident) {
+    if (resident->resident) forget(residency, resident);
+    resident->evicted = false;
+}
+
+void gfx_residency_touch(Gfx_Residency *residency, Gfx_Resident *resident) {
+    if (!resident->resident || resident->last_used == residency->frame) return;
+    resident->last_used = residency->frame;
+    if (resident->evict && resident != residency->lru_last) {
+        lru_remove(residency, resident);
+        lru_push(residency, resident);
+    }
+}
+
+bool gfx_residency_reserve(Gfx_Residency *residency, u64 size) {
+    if (residency->budget_bytes == 0) return true;
+
+    // Whatever the frame in progress uses stays, it may be drawn already.
+    u64 keep_frames = cast(u64)SDL_max(residency->keep_frames, 1);
+
+    Gfx_Residency_Stats *stats = &residency->stats;
+    while (gfx_residency_bytes(stats) + size > residency->budget_bytes) {
+        // Everything behind the first one was used more recently.
+        Gfx_Resident *oldest = residency->lru_first;
+        if (!oldest || residency->frame - oldest->last_used < keep_frames) {
+            stats->over_budget++;
+            return false;
+        }
+
+        forget(residency, oldest);
+        oldest->evicted = true;
+        stats->evictions++;
+        stats->evicted_bytes += oldest->size;
+        oldest->evict(residency->userdata, oldest->owner);
+    }
+    return true;
+}
+
+bool gfx_residency_can_restore(const Gfx_Residency *residency, u64 size) {
+    u64 restored = residency->stats.restored_bytes;
+    return restored == 0 || restored + size <= residency->restore_budget_bytes;
+}
+
+void gfx_residency_next_frame(Gfx_Residency *residency) {
+    Gfx_Residency_Stats *stats = &residency->stats;
+    residency->last_frame = *stats;
+
+    stats->evictions      = 0;
+    stats->evicted_bytes  = 0;
+    stats->restores       = 0;
+    stats->restored_bytes = 0;
+    stats->over_budget    = 0;
+    residency->frame++;
+}
+
+const char *gfx_resident_kind_name(Gfx_Resident_Kind kind) {
+    switch (kind) {
+        case GFX_RESIDENT_BUFFER:  return "buffer";
+        case GFX_RESIDENT_TEXTURE: return "texture";
+        default:                   return "unknown";
+    }
+}
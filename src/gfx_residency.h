@@ -0,0 +1,110 @@
+#pragma once
+
+#include "defines.h"
+
+//
+// GPU memory budget.
+//
+// Every buffer and texture the gfx layer creates is recorded with its size
+// in a Gfx_Resident embedded in its owner. Resources without an evict
+// callback, the context's own buffers, only count. The others, meshes and
+// cached textures, are kept in least recently used order:
+// gfx_residency_touch() moves a resource to the back when a frame uses it,
+// and gfx_residency_reserve() evicts from the front until a new allocation
+// fits the budget. Resources used in the last keep_frames frames are never
+// evicted, so a frame whose working set is larger than the budget still
+// draws, and the budget holds again once the view moves on.
+//
+// The evict callback releases the GPU memory, the owner keeps what it needs
+// to bring the resource back: meshes are packed and uploaded again from
+// their source mesh when submitted, textures stream back in from their file
+// (see gfx_texture_cache.h). Restores share a byte budget per frame.
+//
+// There are no GPU calls in here, the policy runs without a device (see
+// bench_main.cpp). Main thread only.
+//
+
+enum Gfx_Resident_Kind {
+    GFX_RESIDENT_BUFFER,
+    GFX_RESIDENT_TEXTURE,
+
+    GFX_RESIDENT_KIND_COUNT,
+};
+
+struct Gfx_Resident {
+    Gfx_Resident_Kind kind = GFX_RESIDENT_BUFFER;
+    u64 size      = 0;
+    u64 last_used = 0; // Frame of the last touch.
+
+    bool resident = false;
+    bool evicted  = false; // Released by the budget, until added again.
+
+    // Releases the GPU memory of owner. userdata is the one of the
+    // residency. NULL pins the resource.
+    void (*evict)(void *userdata, void *owner) = NULL;
+    void *owner = NULL;
+
+    // Least recently used order, evictable resources only.
+    Gfx_Resident *prev = NULL;
+    Gfx_Resident *next = NULL;
+};
+
+struct Gfx_Residency_Stats {
+    u64 bytes[GFX_RESIDENT_KIND_COUNT] = {};
+    int count[GFX_RESIDENT_KIND_COUNT] = {};
+    u64 peak_bytes = 0;
+
+    // During one frame.
+    int evictions      = 0;
+    u64 evicted_bytes  = 0;
+    int restores       = 0;
+    u64 restored_bytes = 0;
+    int over_budget    = 0; // Reservations that did not fit after evicting.
+};
+
+struct Gfx_Residency {
+    u64 budget_bytes         = 0; // 0 for no budget.
+    u64 restore_budget_bytes = 16 * 1024 * 1024;
+    int keep_frames          = 2; // At least 1, the frame in progress.
+    void *userdata           = NULL; // Passed to the evict callbacks.
+
+    u64 frame = 1;
+    Gfx_Resident *lru_first = NULL;
+    Gfx_Resident *lru_last  = NULL;
+
+    // Totals are current, the frame counters are of the frame in progress.
+    Gfx_Residency_Stats stats;
+
+    // Copied by gfx_residency_next_frame().
+    Gfx_Residency_Stats last_frame;
+};
+
+inline u64 gfx_residency_bytes(const Gfx_Residency_Stats *stats) {
+    u64 bytes = 0;
+    for (int i = 0; i < GFX_RESIDENT_KIND_COUNT; i++) bytes += stats->bytes[i];
+    return bytes;
+}
+
+// Records a resource that was just created, as used this frame. Adding an
+// evicted resource again counts as a restore. evict and owner are set by
+// the caller beforehand.
+void gfx_residency_add(Gfx_Residency *residency, Gfx_Resident *resident, Gfx_Resident_Kind kind, u64 size);
+
+// The owner released the resource, evicted or not.
+void gfx_residency_remove(Gfx_Residency *residency, Gfx_Resident *resident);
+
+void gfx_residency_touch(Gfx_Residency *residency, Gfx_Resident *resident);
+
+// Evicts least recently used resources until size more bytes fit the
+// budget. Returns false if they do not, the caller may allocate anyway.
+bool gfx_residency_reserve(Gfx_Residency *residency, u64 size);
+
+// True if size more bytes of restores fit the restore budget of the frame.
+// The first restore of a frame may go over it.
+bool gfx_residency_can_restore(const Gfx_Residency *residency, u64 size);
+
+// Ends the frame: copies the stats to last_frame and resets the frame
+// counters.
+void gfx_residency_next_frame(Gfx_Residency *residency);
+
+const char *gfx_resident_kind_name(Gfx_Resident_Kind kind);
@@ -0,0 +1,186 @@
+#include "gfx_scene.h"
+
+#include <SDL3/SDL.h>
+
+bool gfx_scene_init(Gfx_Scene *scene, int node_count) {
+    *scene = {};
+    if (node_count <= 0) return true;
+
+    usize n = cast(usize)node_count;
+    scene->parent      = cast(s32 *)SDL_malloc(n * sizeof(s32));
+    scene->subtree_end = cast(s32 *)SDL_malloc(n * sizeof(s32));
+    scene->translation = cast(glm::vec3 *)SDL_malloc(n * sizeof(glm::vec3));
+    scene->rotation    = cast(glm::quat *)SDL_malloc(n * sizeof(glm::quat));
+    scene->scale       = cast(glm::vec3 *)SDL_malloc(n * sizeof(glm::vec3));
+    scene->world       = cast(glm::mat4 *)SDL_malloc(n * sizeof(glm::mat4));
+    scene->dirty       = cast(u8 *)SDL_malloc(n * sizeof(u8));
+    scene->dirty_nodes = cast(s32 *)SDL_malloc(n * sizeof(s32));
+    scene->ranges      = cast(s32 *)SDL_malloc(n * sizeof(s32));
+    scene->node_count  = node_count;
+
+    if (!scene->parent || !scene->subtree_end || !scene->translation || !scene->rotation || !scene->scale ||
+        !scene->world || !scene->dirty || !scene->dirty_nodes || !scene->ranges) {
+        gfx_scene_free(scene);
+        return false;
+    }
+
+    for (int i = 0; i < node_count; i++) {
+        scene->parent[i]      = GFX_SCENE_NO_PARENT;
+        scene->subtree_end[i] = i + 1;
+        scene->translation[i] = glm::vec3(0.0f);
+        scene->rotation[i]    = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+        scene->scale[i]       = glm::vec3(1.0f);
+        scene->world[i]       = glm::mat4(1.0f);
+        scene->dirty[i]       = 1;
+        scene->dirty_nodes[i] = i;
+    }
+    scene->dirty_count = node_count;
+
+    return true;
+}
+
+void gfx_scene_free(Gfx_Scene *scene) {
+    SDL_free(scene->parent);
+    SDL_free(scene->subtree_end);
+    SDL_free(scene->translation);
+    SDL_free(scene->rotation);
+    SDL_free(scene->scale);
+    SDL_free(scene->world);
+    SDL_free(scene->dirty);
+    SDL_free(scene->dirty_nodes);
+    SDL_free(scene->ranges);
+    *scene = {};
+}
+
+bool gfx_scene_link(Gfx_Scene *scene) {
+    // Depth-first order means the parent of every node is on the stack of
+    // open ancestors when the node is reached. ranges is free to use as the
+    // stack here.
+    s32 *stack = scene->ranges;
+    int depth = 0;
+    for (int i = 0; i < scene->node_count; i++) {
+        s32 parent = scene->parent[i];
+        if (parent != GFX_SCENE_NO_PARENT && (parent < 0 || parent >= i)) return false;
+
+        while (depth > 0 && stack[depth - 1] != parent) depth--;
+        if (parent != GFX_SCENE_NO_PARENT && depth == 0) return false;
+        stack[depth++] = i;
+    }
+
+    for (int i = 0; i < scene->node_count; i++) scene->subtree_end[i] = i + 1;
+    for (int i = scene->node_count - 1; i >= 0; i--) {
+        s32 parent = scene->parent[i];
+        if (parent != GFX_SCENE_NO_PARENT) scene->subtree_end[parent] = SDL_max(scene->subtree_end[parent], scene->subtree_end[i]);
+    }
+
+    return true;
+}
+
+glm::mat4 gfx_scene_local_matrix(const Gfx_Scene *scene, int node) {
+    // T * R * S without the full matrix products.
+    glm::mat4 local = glm::mat4_cast(scene->rotation[node]);
+    local[0] *= scene->scale[node].x;
+    local[1] *= scene->scale[node].y;
+    local[2] *= scene->scale[node].z;
+    local[3]  = glm::vec4(scene->translation[node], 1.0f);
+    return local;
+}
+
+void gfx_scene_set_local(Gfx_Scene *scene, int node, glm::vec3 translation, glm::quat rotation, glm::vec3 scale) {
+    scene->translation[node] = translation;
+    scene->rotation[node]    = rotation;
+    scene->scale[node]       = scale;
+    gfx_scene_mark_dirty(scene, node);
+}
+
+void gfx_scene_mark_dirty(Gfx_Scene *scene, int node) {
+    ASSERT(node >= 0 && node < scene->node_count);
+    if (scene->dirty[node]) return;
+    scene->dirty[node] = 1;
+    scene->dirty_nodes[scene->dirty_count++] = node;
+}
+
+static void update_node(Gfx_Scene *scene, int node) {
+    s32 parent = scene->parent[node];
+    glm::mat4 local = gfx_scene_local_matrix(scene, node);
+    scene->world[node] = parent == GFX_SCENE_NO_PARENT ? local : scene->world[parent] * local;
+}
+
+static void update_subtree(Gfx_Scene *scene, int root) {
+    for (int i = root; i < scene->subtree_end[root]; i++) update_node(scene, i);
+}
+
+struct Update_Scene_Work {
+    Gfx_Scene *scene;
+    const s32 *ranges;
+};
+
+static void update_scene_ranges(void *data, int begin, int end) {
+    auto work = cast(Update_Scene_Work *)data;
+    for (int i = begin; i < end; i++) update_subtree(work->scene, work->ranges[i]);
+}
+
+static int compare_nodes(const void *a, const void *b) {
+    s32 na = *cast(const s32 *)a;
+    s32 nb = *cast(const s32 *)b;
+    return (na > nb) - (na < nb);
+}
+
+int gfx_scene_update(Gfx_Scene *scene, Job_System *jobs) {
+    // Below this many nodes per worker, scheduling costs more than the
+    // update. Ranges smaller than MIN_SPLIT are never split.
+    const int MIN_NODES = 4096;
+    const int MIN_SPLIT = 256;
+
+    if (scene->dirty_count == 0) return 0;
+
+    // In node order, a dirty node inside an earlier dirty subtree is covered
+    // by that subtree.
+    SDL_qsort(scene->dirty_nodes, cast(usize)scene->dirty_count, sizeof(s32), compare_nodes);
+
+    s32 *ranges = scene->ranges;
+    int range_count = 0;
+    int covered = 0;
+    int total = 0;
+    for (int i = 0; i < scene->dirty_count; i++) {
+        s32 node = scene->dirty_nodes[i];
+        scene->dirty[node] = 0;
+        if (node < covered) continue;
+
+        ranges[range_count++] = node;
+        covered = scene->subtree_end[node];
+        total  += covered - node;
+    }
+    scene->dirty_count = 0;
+
+    int worker_count = SDL_min(job_worker_count(jobs), SDL_max(total / MIN_NODES, 1));
+    if (worker_count == 1) {
+        for (int i = 0; i < range_count; i++) update_subtree(scene, ranges[i]);
+        return total;
+    }
+
+    // A few ranges per worker balance the load. Split the largest range by
+    // computing its root here and handing out its children's subtrees.
+    while (range_count < worker_count * 4) {
+        int largest = 0;
+        for (int i = 1; i < range_count; i++) {
+            if (scene->subtree_end[ranges[i]] - ranges[i] > scene->subtree_end[ranges[largest]] - ranges[largest]) largest = i;
+        }
+
+        s32 root = ranges[largest];
+        if (scene->subtree_end[root] - root < MIN_SPLIT) break;
+
+        update_node(scene, root);
+        ranges[largest] = ranges[--range_count];
+        for (s32 child = root + 1; child < scene->subtree_end[root]; child = scene->subtree_end[child]) {
+            ranges[range_count++] = child;
+        }
+    }
+
+    Update_Scene_Work work;
+    work.scene  = scene;
+    work.ranges = ranges;
+    job_parallel_for(jobs, range_count, 0, update_scene_ranges, &work);
+
+    return total;
+}
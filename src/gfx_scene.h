@@ -0,0 +1,65 @@
+#pragma once
+
+#include "defines.h"
+#include "job.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+//
+// Transform hierarchy.
+//
+// Nodes are stored flattened in depth-first order, as structure of arrays.
+// Every parent comes before its children and the subtree of node i is the
+// range [i, subtree_end[i]), so world matrices are computed in one forward
+// walk that only reads parents already written.
+//
+// Local transforms are translation, rotation and scale. Changing one marks the
+// node dirty, and gfx_scene_update() recomputes only the subtrees under dirty
+// nodes. Dirty subtrees are disjoint ranges that depend on nothing but the
+// world matrix of their root's parent, so they are updated as parallel jobs
+// when there is enough work. A single large range is split into its
+// children's subtrees first.
+//
+
+#define GFX_SCENE_NO_PARENT -1
+
+struct Gfx_Scene {
+    int node_count = 0;
+
+    s32 *parent      = NULL;
+    s32 *subtree_end = NULL;
+
+    glm::vec3 *translation = NULL;
+    glm::quat *rotation    = NULL;
+    glm::vec3 *scale       = NULL;
+    glm::mat4 *world       = NULL;
+
+    // Nodes whose local transform changed since the last update, each once.
+    u8  *dirty       = NULL;
+    s32 *dirty_nodes = NULL;
+    int dirty_count  = 0;
+
+    // Scratch for gfx_scene_update().
+    s32 *ranges = NULL;
+};
+
+// Allocates node_count nodes with identity transforms and no parents, all of
+// them dirty. Set the parents, then call gfx_scene_link().
+bool gfx_scene_init(Gfx_Scene *scene, int node_count);
+void gfx_scene_free(Gfx_Scene *scene);
+
+// Computes the subtree ranges from the parents. Returns false when the nodes
+// are not in depth-first order.
+bool gfx_scene_link(Gfx_Scene *scene);
+
+glm::mat4 gfx_scene_local_matrix(const Gfx_Scene *scene, int node);
+
+void gfx_scene_set_local(Gfx_Scene *scene, int node, glm::vec3 translation, glm::quat rotation, glm::vec3 scale);
+
+// For code that writes the local transform arrays directly.
+void gfx_scene_mark_dirty(Gfx_Scene *scene, int node);
+
+// Recomputes the world matrices under dirty nodes, serially when jobs is NULL.
+// Returns the number of nodes recomputed.
+int gfx_scene_update(Gfx_Scene *scene, Job_System *jobs);
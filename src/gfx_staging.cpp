@@ -0,0 +1,303 @@
+#include "gfx_staging.h"
+
+// Offsets of the ranges in the transfer buffer. Both divide the capacity.
+#define BUFFER_ALIGNMENT  16
+#define TEXTURE_ALIGNMENT 512
+
+void gfx_staging_ring_init(Gfx_Staging_Ring *ring, u32 capacity) {
+    *ring = {};
+    ring->capacity = capacity;
+}
+
+bool gfx_staging_ring_alloc(Gfx_Staging_Ring *ring, u32 size, u32 alignment, u32 *offset) {
+    ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0 && ring->capacity % alignment == 0);
+    if (size > ring->capacity) return false;
+
+    // An empty ring starts over at the beginning of a lap, so any range fits.
+    if (ring->head == ring->tail) {
+        u64 lap = (ring->head + ring->capacity - 1) / ring->capacity * ring->capacity;
+        ring->head = lap;
+        ring->tail = lap;
+    }
+
+    u64 start = (ring->head + alignment - 1) & ~cast(u64)(alignment - 1);
+    u64 start_offset = start % ring->capacity;
+    if (start_offset + size > ring->capacity) start += ring->capacity - start_offset;
+    if (start + size - ring->tail > ring->capacity) return false;
+
+    *offset = cast(u32)(start % ring->capacity);
+    ring->head = start + size;
+    return true;
+}
+
+bool gfx_staging_ring_close(Gfx_Staging_Ring *ring) {
+    if (ring->batch_count == GFX_STAGING_MAX_BATCHES) return false;
+    ring->batch_ends[(ring->batch_first + ring->batch_count) % GFX_STAGING_MAX_BATCHES] = ring->head;
+    ring->batch_count++;
+    return true;
+}
+
+void gfx_staging_ring_retire(Gfx_Staging_Ring *ring) {
+    ASSERT(ring->batch_count > 0);
+
+    // An empty ring may have moved on to the next lap since the batch closed.
+    u64 end = ring->batch_ends[ring->batch_first];
+    if (end > ring->tail) ring->tail = end;
+
+    ring->batch_first = (ring->batch_first + 1) % GFX_STAGING_MAX_BATCHES;
+    ring->batch_count--;
+}
+
+bool gfx_staging_init(Gfx_Staging *staging, SDL_GPUDevice *device, u32 capacity) {
+    *staging = {};
+    staging->device = device;
+
+    SDL_GPUTransferBufferCreateInfo transfer_info{};
+    transfer_info.size  = capacity;
+    transfer_info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+    staging->transfer_buffer = SDL_CreateGPUTransferBuffer(device, &transfer_info);
+    if (staging->transfer_buffer == NULL) return false;
+
+    gfx_staging_ring_init(&staging->ring, capacity);
+    return true;
+}
+
+static void retire_oldest(Gfx_Staging *staging) {
+    SDL_ReleaseGPUFence(staging->device, staging->fences[staging->ring.batch_first]);
+    gfx_staging_ring_retire(&staging->ring);
+}
+
+static void wait_oldest(Gfx_Staging *staging) {
+    SDL_WaitForGPUFences(staging->device, true, &staging->fences[staging->ring.batch_first], 1);
+    retire_oldest(staging);
+    staging->stats.stalls++;
+}
+
+void gfx_staging_free(Gfx_Staging *staging) {
+    if (staging->device == NULL) return;
+
+    // Pending copies are dropped.
+    if (staging->mapped) SDL_UnmapGPUTransferBuffer(staging->device, staging->transfer_buffer);
+    for (int i = 0; i < staging->copy_count; i++) {
+        Gfx_Staging_Copy *copy = &staging->copies[i];
+        if (!copy->dedicated) continue;
+        SDL_UnmapGPUTransferBuffer(staging->device, copy->source);
+        SDL_ReleaseGPUTransferBuffer(staging->device, copy->source);
+    }
+
+    while (staging->ring.batch_count > 0) {
+        SDL_WaitForGPUFences(staging->device, true, &staging->fences[staging->ring.batch_first], 1);
+        retire_oldest(staging);
+    }
+
+    SDL_ReleaseGPUTransferBuffer(staging->device, staging->transfer_buffer);
+    SDL_free(staging->copies);
+    *staging = {};
+}
+
+// Adds a copy and returns the memory to write its data to.
+static u8 *reserve(Gfx_Staging *staging, u32 size, u32 alignment, const Gfx_Staging_Copy *copy) {
+    if (size == 0 || staging->transfer_buffer == NULL) return NULL;
+
+    if (staging->copy_count == staging->copy_capacity) {
+        int capacity = SDL_max(64, staging->copy_capacity * 2);
+        auto copies = cast(Gfx_Staging_Copy *)SDL_realloc(staging->copies, cast(usize)capacity * sizeof(Gfx_Staging_Copy));
+        if (!copies) return NULL;
+        staging->copies = copies;
+        staging->copy_capacity = capacity;
+    }
+
+    Gfx_Staging_Copy *added = &staging->copies[staging->copy_count];
+    *added = *copy;
+    added->size = size;
+
+    u8 *data = NULL;
+    if (size > staging->ring.capacity) {
+        SDL_GPUTransferBufferCreateInfo transfer_info{};
+        transfer_info.size  = size;
+        transfer_info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+        added->source = SDL_CreateGPUTransferBuffer(staging->device, &transfer_info);
+        if (added->source == NULL) return NULL;
+
+        data = cast(u8 *)SDL_MapGPUTransferBuffer(staging->device, added->source, false);
+        if (data == NULL) {
+            SDL_ReleaseGPUTransferBuffer(staging->device, added->source);
+            return NULL;
+        }
+        added->source_offset = 0;
+        added->dedicated = true;
+        staging->stats.dedicated++;
+    } else {
+        u32 offset = 0;
+        if (!gfx_staging_ring_alloc(&staging->ring, size, alignment, &offset)) {
+            // Submit the open batch so it can be waited on too, then wait
+            // until enough of the ring is free.
+            if (staging->open) {
+                gfx_staging_flush(staging);
+                staging->stats.flushes++;
+            }
+            while (!gfx_staging_ring_alloc(&staging->ring, size, alignment, &offset)) {
+                if (staging->ring.batch_count == 0) return NULL;
+                wait_oldest(staging);
+            }
+            // The flush moved the copies, the slot is the first one again.
+            added = &staging->copies[staging->copy_count];
+            *added = *copy;
+            added->size = size;
+        }
+        staging->open = true;
+
+        if (staging->mapped == NULL) {
+            staging->mapped = cast(u8 *)SDL_MapGPUTransferBuffer(staging->device, staging->transfer_buffer, false);
+            if (staging->mapped == NULL) return NULL;
+        }
+        added->source = staging->transfer_buffer;
+        added->source_offset = offset;
+        added->dedicated = false;
+        data = staging->mapped + offset;
+    }
+
+    staging->copy_count++;
+    staging->stats.bytes += size;
+    return data;
+}
+
+u8 *gfx_staging_reserve_buffer(Gfx_Staging *staging, SDL_GPUBuffer *buffer, u32 offset, u32 size, bool cycle) {
+    if (buffer == NULL) return NULL;
+
+    Gfx_Staging_Copy copy{};
+    copy.type   = GFX_STAGING_COPY_BUFFER;
+    copy.buffer = buffer;
+    copy.offset = offset;
+    copy.cycle  = cycle;
+    return reserve(staging, size, BUFFER_ALIGNMENT, &copy);
+}
+
+u8 *gfx_staging_reserve_texture(Gfx_Staging *staging, SDL_GPUTexture *texture, u32 mip_level, u32 width, u32 height, u32 size) {
+    if (texture == NULL) return NULL;
+
+    Gfx_Staging_Copy copy{};
+    copy.type    = GFX_STAGING_COPY_TEXTURE;
+    copy.texture   = texture;
+    copy.mip_level = mip_level;
+    copy.width     = width;
+    copy.height    = height;
+    return reserve(staging, size, TEXTURE_ALIGNMENT, &copy);
+}
+
+// Removes the pending copies with the destination, keeping the order of the
+// others.
+static void cancel(Gfx_Staging *staging, SDL_GPUBuffer *buffer, SDL_GPUTexture *texture) {
+    int kept = 0;
+    for (int i = 0; i < staging->copy_count; i++) {
+        Gfx_Staging_Copy *copy = &staging->copies[i];
+        bool match = copy->type == GFX_STAGING_COPY_BUFFER ? copy->buffer == buffer : copy->texture == texture;
+        if (!match) {
+            staging->copies[kept++] = *copy;
+            continue;
+        }
+        if (copy->dedicated) {
+            SDL_UnmapGPUTransferBuffer(staging->device, copy->source);
+            SDL_ReleaseGPUTransferBuffer(staging->device, copy->source);
+        }
+        staging->stats.bytes -= copy->size;
+    }
+    staging->copy_count = kept;
+}
+
+void gfx_staging_cancel_buffer(Gfx_Staging *staging, SDL_GPUBuffer *buffer) {
+    if (buffer != NULL) cancel(staging, buffer, NULL);
+}
+
+void gfx_staging_cancel_texture(Gfx_Staging *staging, SDL_GPUTexture *texture) {
+    if (texture != NULL) cancel(staging, NULL, texture);
+}
+
+void gfx_staging_collect(Gfx_Staging *staging) {
+    while (staging->ring.batch_count > 0 && SDL_QueryGPUFence(staging->device, staging->fences[staging->ring.batch_first])) {
+        retire_oldest(staging);
+    }
+}
+
+void gfx_staging_record(Gfx_Staging *staging, SDL_GPUCommandBuffer *command_buffer) {
+    // The transfer buffer must be unmapped before copies from it are recorded.
+    if (staging->mapped) {
+        SDL_UnmapGPUTransferBuffer(staging->device, staging->transfer_buffer);
+        staging->mapped = NULL;
+    }
+    if (staging->copy_count == 0) return;
+
+    auto copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+    for (int i = 0; i < staging->copy_count; i++) {
+        const Gfx_Staging_Copy *copy = &staging->copies[i];
+        if (copy->dedicated) SDL_UnmapGPUTransferBuffer(staging->device, copy->source);
+
+        if (copy->type == GFX_STAGING_COPY_BUFFER) {
+            SDL_GPUTransferBufferLocation copy_src{};
+            copy_src.transfer_buffer = copy->source;
+            copy_src.offset = copy->source_offset;
+
+            SDL_GPUBufferRegion copy_dst{};
+            copy_dst.buffer = copy->buffer;
+            copy_dst.offset = copy->offset;
+            copy_dst.size   = copy->size;
+
+            SDL_UploadToGPUBuffer(copy_pass, &copy_src, &copy_dst, copy->cycle);
+        } else {
+            SDL_GPUTextureTransferInfo copy_src{};
+            copy_src.transfer_buffer = copy->source;
+            copy_src.offset = copy->source_offset;
+
+            SDL_GPUTextureRegion copy_dst{};
+            copy_dst.texture   = copy->texture;
+            copy_dst.mip_level = copy->mip_level;
+            copy_dst.w = copy->width;
+            copy_dst.h = copy->height;
+            copy_dst.d = 1;
+
+            SDL_UploadToGPUTexture(copy_pass, &copy_src, &copy_dst, false);
+        }
+
+        // Released once the copy ran.
+        if (copy->dedicated) SDL_ReleaseGPUTransferBuffer(staging->device, copy->source);
+    }
+    SDL_EndGPUCopyPass(copy_pass);
+
+    staging->stats.copies += staging->copy_count;
+    staging->copy_count = 0;
+}
+
+bool gfx_staging_submit(Gfx_Staging *staging, SDL_GPUCommandBuffer *command_buffer) {
+    if (!staging->open) return SDL_SubmitGPUCommandBuffer(command_buffer);
+
+    if (staging->ring.batch_count == GFX_STAGING_MAX_BATCHES) wait_oldest(staging);
+
+    // Without a fence the open batch stays open, and is fenced by the next
+    // submit instead.
+    SDL_GPUFence *fence = SDL_SubmitGPUCommandBufferAndAcquireFence(command_buffer);
+    if (fence == NULL) return false;
+
+    gfx_staging_ring_close(&staging->ring);
+    int last = (staging->ring.batch_first + staging->ring.batch_count - 1) % GFX_STAGING_MAX_BATCHES;
+    staging->fences[last] = fence;
+    staging->open = false;
+    return true;
+}
+
+void gfx_staging_flush(Gfx_Staging *staging) {
+    if (staging->copy_count == 0 && !staging->open) return;
+
+    auto command_buffer = SDL_AcquireGPUCommandBuffer(staging->device);
+    if (command_buffer == NULL) return;
+
+    gfx_staging_record(staging, command_buffer);
+    if (!gfx_staging_submit(staging, command_buffer)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to submit the staging copies: %s", SDL_GetError());
+    }
+}
+
+Gfx_Staging_Stats gfx_staging_take_stats(Gfx_Staging *staging) {
+    Gfx_Staging_Stats stats = staging->stats;
+    staging->stats = {};
+    return stats;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "defines.h"
+
+#include <SDL3/SDL.h>
+
+//
+// Staging memory for GPU uploads.
+//
+// One transfer buffer is used as a ring. Uploads reserve a range of it,
+// the caller writes the data there, and the copy into the destination buffer
+// or texture is recorded later, together with every other pending copy, in
+// one copy pass. A batch of copies is fenced when its command buffer is
+// submitted, and its range is reused once the fence signals.
+//
+// Gfx_Staging_Ring is only the bookkeeping of the ring, positions and
+// batches, without a device. Gfx_Staging drives it with the transfer buffer,
+// the pending copies and the fences.
+//
+// Ranges larger than the ring get a transfer buffer of their own. When the
+// ring is full, the pending copies are submitted early and the upload waits
+// for the oldest batch.
+//
+
+#define GFX_STAGING_MAX_BATCHES 8
+#define GFX_STAGING_CAPACITY    (32 * 1024 * 1024)
+
+// Positions grow forever, the ring offset is position % capacity. [tail, head)
+// is in use, by the batches in flight and the open batch.
+struct Gfx_Staging_Ring {
+    u32 capacity = 0;
+    u64 head = 0;
+    u64 tail = 0;
+
+    // End position of each batch in flight, oldest first.
+    u64 batch_ends[GFX_STAGING_MAX_BATCHES];
+    int batch_first = 0;
+    int batch_count = 0;
+};
+
+void gfx_staging_ring_init(Gfx_Staging_Ring *ring, u32 capacity);
+
+// Reserves size bytes at a power of two alignment that divides the capacity. A range
+// never wraps, the end of the ring is skipped instead. Returns false when
+// the space is still in use.
+bool gfx_staging_ring_alloc(Gfx_Staging_Ring *ring, u32 size, u32 alignment, u32 *offset);
+
+// Closes the allocations since the last close into a batch. Returns false
+// when GFX_STAGING_MAX_BATCHES are in flight, retire one first.
+bool gfx_staging_ring_close(Gfx_Staging_Ring *ring);
+
+// Frees the oldest batch, once the GPU is done with it.
+void gfx_staging_ring_retire(Gfx_Staging_Ring *ring);
+
+inline u32 gfx_staging_ring_used(const Gfx_Staging_Ring *ring) {
+    return cast(u32)(ring->head - ring->tail);
+}
+
+enum Gfx_Staging_Copy_Type {
+    GFX_STAGING_COPY_BUFFER,
+    GFX_STAGING_COPY_TEXTURE,
+};
+
+struct Gfx_Staging_Copy {
+    Gfx_Staging_Copy_Type type;
+    SDL_GPUTransferBuffer *source; // The ring, or a buffer of its own when dedicated.
+    u32 source_offset;
+    u32 size;
+    bool dedicated;
+
+    SDL_GPUBuffer *buffer;
+    u32 offset;
+    bool cycle;
+
+    SDL_GPUTexture *texture;
+    u32 mip_level;
+    u32 width;
+    u32 height;
+};
+
+// Per frame, see gfx_staging_take_stats().
+struct Gfx_Staging_Stats {
+    u64 bytes     = 0; // Staged for upload.
+    int copies    = 0;
+    int flushes   = 0; // Early submits because the ring was full.
+    int stalls    = 0; // Waits for the GPU to free ring space.
+    int dedicated = 0; // Uploads too large for the ring.
+};
+
+struct Gfx_Staging {
+    SDL_GPUDevice *device = NULL;
+    SDL_GPUTransferBuffer *transfer_buffer = NULL;
+    Gfx_Staging_Ring ring;
+
+    // Mapped from the first reservation of the open batch until it is
+    // recorded.
+    u8 *mapped = NULL;
+
+    // Fence of every batch in flight, in ring order.
+    SDL_GPUFence *fences[GFX_STAGING_MAX_BATCHES];
+
+    // Set when the open batch has ring space, so its submit needs a fence.
+    bool open = false;
+
+    Gfx_Staging_Copy *copies = NULL;
+    int copy_count    = 0;
+    int copy_capacity = 0;
+
+    Gfx_Staging_Stats stats;
+};
+
+bool gfx_staging_init(Gfx_Staging *staging, SDL_GPUDevice *device, u32 capacity);
+
+// Waits for the GPU to finish all batches.
+void gfx_staging_free(Gfx_Staging *staging);
+
+// Reserve staging memory for a copy into buffer at offset, or into a whole
+// level of a texture, width and height being the size of that level and size
+// the bytes of its texels or blocks. Write the data to the returned pointer
+// before the next reservation, which may record the pending copies. Returns
+// NULL on failure.
+u8 *gfx_staging_reserve_buffer(Gfx_Staging *staging, SDL_GPUBuffer *buffer, u32 offset, u32 size, bool cycle);
+u8 *gfx_staging_reserve_texture(Gfx_Staging *staging, SDL_GPUTexture *texture, u32 mip_level, u32 width, u32 height, u32 size);
+
+// Drop the pending copies into buffer or texture, before releasing it. Their
+// ring space is freed with the batch it belongs to.
+void gfx_staging_cancel_buffer(Gfx_Staging *staging, SDL_GPUBuffer *buffer);
+void gfx_staging_cancel_texture(Gfx_Staging *staging, SDL_GPUTexture *texture);
+
+// Retires the batches the GPU finished.
+void gfx_staging_collect(Gfx_Staging *staging);
+
+// Records the pending copies in one copy pass of command_buffer. Submit it
+// with gfx_staging_submit().
+void gfx_staging_record(Gfx_Staging *staging, SDL_GPUCommandBuffer *command_buffer);
+
+// Submits command_buffer and fences what was recorded into it.
+bool gfx_staging_submit(Gfx_Staging *staging, SDL_GPUCommandBuffer *command_buffer);
+
+// Records and submits the pending copies in a command buffer of their own.
+void gfx_staging_flush(Gfx_Staging *staging);
+
+// Returns the stats since the last call and resets them.
+Gfx_Staging_Stats gfx_staging_take_stats(Gfx_Staging *staging);
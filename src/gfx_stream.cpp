@@ -0,0 +1,302 @@
+#include "gfx_stream.h"
+#include "gfx_cache.h"
+#include "profile.h"
+
+#include <stb_image.h>
+
+static void load_model(Gfx_Asset *asset) {
+    gfx_model_load_cached(&asset->model, asset->path, asset->cache_path, NULL);
+    int mesh_count = asset->model.mesh_count;
+    if (mesh_count == 0) return;
+
+    asset->gpu_meshes = cast(Gfx_GPU_Mesh *)SDL_calloc(cast(usize)mesh_count, sizeof(Gfx_GPU_Mesh));
+    if (!asset->gpu_meshes) return;
+
+    // Cached meshes come with their meshlets. Models loaded from the glTF
+    // file get them here, they reorder the triangles so this is before the
+    // upload.
+    bool has_meshlets = true;
+    for (int i = 0; i < mesh_count; i++) {
+        const Gfx_Mesh *mesh = &asset->model.meshes[i];
+        if (mesh->triangle_count > 0 && mesh->meshlets.count == 0) has_meshlets = false;
+    }
+    if (!has_meshlets) gfx_model_build_meshlets(&asset->model, NULL);
+    asset->loaded = true;
+}
+
+static void load_image(Gfx_Stream *stream, Gfx_Asset *asset) {
+    usize size = 0;
+    void *data = SDL_LoadFile(asset->path, &size);
+    if (!data) return;
+
+    asset->content_hash = hash_fnv1a64(data, size);
+    if (stream->claim_image && !stream->claim_image(stream->claim_userdata, asset->content_hash)) {
+        SDL_free(data);
+        asset->shared = true;
+        asset->loaded = true;
+        return;
+    }
+
+    // A baked texture keeps the file.
+    if (gfx_texture_load_memory(&asset->baked, data, size)) {
+        asset->loaded = true;
+        return;
+    }
+    defer { SDL_free(data); };
+    if (size > SDL_MAX_SINT32) return;
+
+    int width  = 0;
+    int height = 0;
+    u8 *pixels = stbi_load_from_memory(cast(const u8 *)data, cast(int)size, &width, &height, NULL, 4);
+    if (!pixels) return;
+    defer { stbi_image_free(pixels); };
+
+    // Off the frame, so the slower and sharper filter is affordable.
+    asset->loaded = gfx_mip_chain_build(&asset->mips, pixels, width, height, GFX_MIP_FILTER_KAISER, true);
+}
+
+// Lock-free push, any thread. The main thread takes the whole list at once,
+// so a node is never popped while another thread looks at it.
+static void push_completed(Gfx_Stream *stream, Gfx_Asset *asset) {
+    void *head;
+    do {
+        head = SDL_GetAtomicPointer(&stream->completed);
+        asset->next = cast(Gfx_Asset *)head;
+    } while (!SDL_CompareAndSwapAtomicPointer(&stream->completed, head, asset));
+}
+
+static int loader_main(void *userdata) {
+    auto stream = cast(Gfx_Stream *)userdata;
+    SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_LOW);
+    profile_set_thread_name("gfx_stream");
+
+    for (;;) {
+        SDL_WaitSemaphore(stream->wake);
+        if (SDL_GetAtomicInt(&stream->quit)) break;
+
+        SDL_LockMutex(stream->lock);
+        Gfx_Asset *asset = stream->request_head;
+        if (asset) {
+            stream->request_head = asset->next;
+            if (!stream->request_head) stream->request_tail = NULL;
+        }
+        SDL_UnlockMutex(stream->lock);
+        if (!asset) continue;
+
+        u64 start = SDL_GetPerformanceCounter();
+        {
+            PROFILE_ZONE(asset->type == GFX_ASSET_MODEL ? "load_model" : "load_image");
+            if (asset->type == GFX_ASSET_MODEL) load_model(asset);
+            else                                load_image(stream, asset);
+        }
+        f64 ms = cast(f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / cast(f64)SDL_GetPerformanceFrequency();
+        SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "Loaded %s in %.1f ms", asset->path, ms);
+
+        push_completed(stream, asset);
+    }
+
+    return 0;
+}
+
+bool gfx_stream_init(Gfx_Stream *stream, int thread_count) {
+    *stream = {};
+
+    if (thread_count <= 0) thread_count = SDL_GetNumLogicalCPUCores() / 2;
+    thread_count = SDL_clamp(thread_count, 1, GFX_STREAM_MAX_THREADS);
+
+    stream->lock = SDL_CreateMutex();
+    stream->wake = SDL_CreateSemaphore(0);
+    if (!stream->lock || !stream->wake) {
+        if (stream->lock) SDL_DestroyMutex(stream->lock);
+        if (stream->wake) SDL_DestroySemaphore(stream->wake);
+        *stream = {};
+        return false;
+    }
+
+    for (int i = 0; i < thread_count; i++) {
+        SDL_Thread *thread = SDL_CreateThread(loader_main, "gfx_stream", stream);
+        if (thread) stream->threads[stream->thread_count++] = thread;
+    }
+
+    if (stream->thread_count == 0) {
+        gfx_stream_shutdown(stream, NULL);
+        return false;
+    }
+
+    return true;
+}
+
+static void free_asset(Gfx_Asset *asset, Gfx_Context *context) {
+    if (asset->type == GFX_ASSET_MODEL) {
+        for (int i = 0; i < asset->model.mesh_count; i++) {
+            if (asset->gpu_meshes && context) gfx_mesh_release(context, &asset->gpu_meshes[i]);
+        }
+        SDL_free(asset->gpu_meshes);
+        gfx_model_cleanup(&asset->model);
+    } else {
+        gfx_texture_free(&asset->baked);
+        gfx_mip_chain_free(&asset->mips);
+        if (asset->texture && context) {
+            gfx_staging_cancel_texture(&context->staging, asset->texture);
+            SDL_ReleaseGPUTexture(context->device, asset->texture);
+        }
+    }
+
+    SDL_free(asset->path);
+    SDL_free(asset->cache_path);
+    SDL_free(asset);
+}
+
+void gfx_stream_shutdown(Gfx_Stream *stream, Gfx_Context *context) {
+    SDL_SetAtomicInt(&stream->quit, 1);
+    for (int i = 0; i < stream->thread_count; i++) SDL_SignalSemaphore(stream->wake);
+    for (int i = 0; i < stream->thread_count; i++) SDL_WaitThread(stream->threads[i], NULL);
+
+    for (Gfx_Asset *asset = stream->assets; asset;) {
+        Gfx_Asset *next = asset->next_owned;
+        free_asset(asset, context);
+        asset = next;
+    }
+
+    if (stream->lock) SDL_DestroyMutex(stream->lock);
+    if (stream->wake) SDL_DestroySemaphore(stream->wake);
+    *stream = {};
+}
+
+static Gfx_Asset *queue_asset(Gfx_Stream *stream, Gfx_Asset_Type type, const char *path, const char *cache_path) {
+    auto asset = cast(Gfx_Asset *)SDL_malloc(sizeof(Gfx_Asset));
+    if (!asset) return NULL;
+    *asset = {};
+
+    asset->type       = type;
+    asset->path       = SDL_strdup(path);
+    asset->cache_path = cache_path ? SDL_strdup(cache_path) : NULL;
+    if (!asset->path || (cache_path && !asset->cache_path)) {
+        SDL_free(asset->path);
+        SDL_free(asset->cache_path);
+        SDL_free(asset);
+        return NULL;
+    }
+
+    asset->next_owned = stream->assets;
+    stream->assets = asset;
+    stream->outstanding++;
+
+    SDL_LockMutex(stream->lock);
+    if (stream->request_tail) stream->request_tail->next = asset;
+    else                      stream->request_head = asset;
+    stream->request_tail = asset;
+    SDL_UnlockMutex(stream->lock);
+    SDL_SignalSemaphore(stream->wake);
+
+    return asset;
+}
+
+Gfx_Asset *gfx_stream_model(Gfx_Stream *stream, const char *source_file, const char *cache_file, Gfx_Vertex_Layout layout) {
+    Gfx_Asset *asset = queue_asset(stream, GFX_ASSET_MODEL, source_file, cache_file);
+    if (asset) asset->layout = layout;
+    return asset;
+}
+
+Gfx_Asset *gfx_stream_image(Gfx_Stream *stream, const char *file) {
+    return queue_asset(stream, GFX_ASSET_IMAGE, file, NULL);
+}
+
+// Moves the completion list, reversed into completion order, behind the
+// assets still waiting for upload.
+static void take_completed(Gfx_Stream *stream) {
+    auto list = cast(Gfx_Asset *)SDL_SetAtomicPointer(&stream->completed, NULL);
+    Gfx_Asset *ordered = NULL;
+    while (list) {
+        Gfx_Asset *next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+    }
+
+    for (Gfx_Asset *asset = ordered; asset;) {
+        Gfx_Asset *next = asset->next;
+        asset->next = NULL;
+
+        if (!asset->loaded) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to load %s", asset->path);
+            asset->state = GFX_ASSET_FAILED;
+            stream->outstanding--;
+        } else if (asset->shared) {
+            // Nothing to upload, the texture comes from the claiming load.
+            asset->state = GFX_ASSET_READY;
+            stream->outstanding--;
+        } else {
+            asset->state = GFX_ASSET_UPLOADING;
+            if (stream->upload_tail) stream->upload_tail->next = asset;
+            else                     stream->upload_head = asset;
+            stream->upload_tail = asset;
+        }
+        asset = next;
+    }
+}
+
+// Uploads the next part of an asset and returns its size. Sets failed when
+// the part did not upload.
+static u64 upload_step(Gfx_Asset *asset, Gfx_Context *context, bool *failed) {
+    if (asset->type == GFX_ASSET_IMAGE) {
+        u64 size = 0;
+        if (asset->baked.data) {
+            asset->texture = gfx_texture_upload_baked(context, &asset->baked);
+            size = asset->baked.size;
+        } else {
+            asset->texture = gfx_texture_upload_mips(context, &asset->mips);
+            size = asset->mips.size;
+        }
+        gfx_texture_free(&asset->baked);
+        gfx_mip_chain_free(&asset->mips);
+        if (asset->texture) asset->texture_size = size;
+        *failed = asset->texture == NULL;
+        return size;
+    }
+
+    int i = asset->uploaded_meshes++;
+    const Gfx_Mesh *mesh = &asset->model.meshes[i];
+    gfx_mesh_upload(context, &asset->gpu_meshes[i], mesh, asset->layout);
+    if (mesh->meshlets.count > 0) asset->gpu_meshes[i].meshlets = &mesh->meshlets;
+
+    // Empty meshes have nothing to upload.
+    bool empty = mesh->vertex_count == 0 || mesh->triangle_count == 0;
+    *failed = !empty && asset->gpu_meshes[i].vertex_buffer == NULL;
+
+    return cast(u64)mesh->vertex_count * gfx_vertex_stride(asset->layout) + cast(u64)mesh->triangle_count * 3 * mesh->index_size;
+}
+
+u64 gfx_stream_update(Gfx_Stream *stream, Gfx_Context *context, u64 budget_bytes) {
+    PROFILE_ZONE("gfx_stream_update");
+    take_completed(stream);
+
+    u64 uploaded = 0;
+    while (stream->upload_head) {
+        if (uploaded > 0 && uploaded >= budget_bytes) break;
+
+        Gfx_Asset *asset = stream->upload_head;
+        bool failed = false;
+        uploaded += upload_step(asset, context, &failed);
+
+        bool done = failed || asset->type == GFX_ASSET_IMAGE || asset->uploaded_meshes == asset->model.mesh_count;
+        if (!done) continue;
+
+        if (failed) {
+            // A model is drawn whole or not at all.
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to upload %s", asset->path);
+            for (int i = 0; asset->type == GFX_ASSET_MODEL && i < asset->uploaded_meshes; i++) {
+                gfx_mesh_release(context, &asset->gpu_meshes[i]);
+            }
+            asset->state = GFX_ASSET_FAILED;
+        } else {
+            asset->state = GFX_ASSET_READY;
+        }
+        stream->outstanding--;
+        stream->upload_head = asset->next;
+        if (!stream->upload_head) stream->upload_tail = NULL;
+        asset->next = NULL;
+    }
+
+    return uploaded;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "defines.h"
+#include "gfx.h"
+
+#include <SDL3/SDL.h>
+
+//
+// Asynchronous asset streaming.
+//
+// Requests go to background loader threads that read and decode the files:
+// models through the mesh cache (see gfx_cache.h), with their meshlets, and
+// images through stb_image. A finished asset is pushed onto a lock-free
+// completion list. The main thread drains that list in gfx_stream_update()
+// and uploads the assets to the GPU, within a byte budget per call, so a
+// large model is uploaded a few meshes per frame. Baked textures (see
+// gfx_texture.h) are uploaded as they are, other images get their full mip
+// chain built on the loader thread (see gfx_mip.h).
+//
+// Loader threads decode serially and stay out of the job system. Frame jobs
+// are also run by the main thread, which must not pick up a load.
+//
+// Image files are hashed when read. With claim_image set, the loader asks it
+// before decoding, and an image it turns down is finished without data, so
+// a cache on top (see gfx_texture_cache.h) decodes each content once.
+//
+// Everything except the loader threads themselves runs on the main thread.
+//
+
+#define GFX_STREAM_MAX_THREADS 8
+
+enum Gfx_Asset_Type {
+    GFX_ASSET_MODEL,
+    GFX_ASSET_IMAGE,
+};
+
+enum Gfx_Asset_State {
+    GFX_ASSET_LOADING,   // Queued or being decoded, the data must not be touched.
+    GFX_ASSET_UPLOADING, // Decoded, model meshes are uploaded as the budget allows.
+    GFX_ASSET_READY,
+    GFX_ASSET_FAILED,    // Not loaded, or an upload failed. Models keep no GPU meshes then.
+};
+
+struct Gfx_Asset {
+    Gfx_Asset_Type type;
+    Gfx_Asset_State state = GFX_ASSET_LOADING;
+
+    char *path       = NULL;
+    char *cache_path = NULL; // Models only.
+
+    // GFX_ASSET_MODEL. gpu_meshes has one entry per mesh, drawable (non-NULL
+    // buffers) once uploaded. Their meshlets are the ones of the model meshes.
+    Gfx_Model model;
+    Gfx_Vertex_Layout layout = GFX_VERTEX_LAYOUT_FLOAT;
+    Gfx_GPU_Mesh *gpu_meshes = NULL;
+    int uploaded_meshes = 0;
+
+    // GFX_ASSET_IMAGE, either baked or RGBA8 mips. Both are freed after the
+    // upload.
+    Gfx_Baked_Texture baked;
+    Gfx_Mip_Chain mips;
+    SDL_GPUTexture *texture = NULL;
+    u64 texture_size = 0; // Bytes uploaded.
+
+    // Set by the loader thread, read after the asset came off the
+    // completion list. content_hash is the hash of the image file, 0 if it
+    // could not be read. A shared image was turned down by claim_image and
+    // never gets a texture.
+    bool loaded = false;
+    bool shared = false;
+    u64 content_hash = 0;
+
+    Gfx_Asset *next       = NULL; // Request queue or completion list.
+    Gfx_Asset *next_owned = NULL; // All assets of the stream.
+};
+
+struct Gfx_Stream {
+    int thread_count = 0;
+    SDL_Thread *threads[GFX_STREAM_MAX_THREADS];
+
+    // Request queue, one semaphore count per request.
+    SDL_Mutex *lock = NULL;
+    SDL_Semaphore *wake = NULL;
+    Gfx_Asset *request_head = NULL;
+    Gfx_Asset *request_tail = NULL;
+    SDL_AtomicInt quit;
+
+    // Pushed by the loader threads, newest first.
+    void *completed = NULL;
+
+    // Taken off the completion list, in completion order, waiting for upload.
+    Gfx_Asset *upload_head = NULL;
+    Gfx_Asset *upload_tail = NULL;
+
+    Gfx_Asset *assets = NULL;
+    int outstanding = 0; // Assets neither ready nor failed.
+
+    // Optional, called on the loader threads with the content hash of an
+    // image before it is decoded. Returning false skips the decode. Set
+    // before the first request.
+    bool (*claim_image)(void *userdata, u64 content_hash) = NULL;
+    void *claim_userdata = NULL;
+};
+
+// Starts thread_count loader threads, 0 picks half the logical cores. The
+// stream must not move while it runs. Returns false on failure.
+bool gfx_stream_init(Gfx_Stream *stream, int thread_count);
+
+// Waits for the loads in progress, drops the queued ones and releases every
+// asset, GPU resources included.
+void gfx_stream_shutdown(Gfx_Stream *stream, Gfx_Context *context);
+
+// Queue a load. The asset is owned by the stream and stays valid until
+// gfx_stream_shutdown(). Returns NULL on allocation failure.
+Gfx_Asset *gfx_stream_model(Gfx_Stream *stream, const char *source_file, const char *cache_file, Gfx_Vertex_Layout layout);
+Gfx_Asset *gfx_stream_image(Gfx_Stream *stream, const char *file);
+
+// Uploads finished assets until budget_bytes of GPU data were written. The
+// last upload may go over the budget, and at least one mesh or image is
+// uploaded per call when one is waiting. Returns the bytes uploaded.
+u64 gfx_stream_update(Gfx_Stream *stream, Gfx_Context *context, u64 budget_bytes);
+
+// True while any asset is loading or uploading.
+inline bool gfx_stream_busy(const Gfx_Stream *stream) {
+    return stream->outstanding > 0;
+}
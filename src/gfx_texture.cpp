@@ -0,0 +1,112 @@
+#include "gfx_texture.h"
+#include "file.h"
+
+#include <SDL3/SDL.h>
+#include <stb_image.h>
+
+static usize align_up(usize value, usize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool gfx_texture_bake(const char *source_file, const char *texture_file, Gfx_BC_Format format, Job_System *jobs) {
+    int width  = 0;
+    int height = 0;
+    u8 *pixels = stbi_load(source_file, &width, &height, NULL, 4);
+    if (!pixels) return false;
+    defer { stbi_image_free(pixels); };
+
+    if (width % 4 != 0 || height % 4 != 0) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "%s is %dx%d, block-compressed textures need multiples of 4", source_file, width, height);
+        return false;
+    }
+
+    Gfx_Mip_Chain chain;
+    defer { gfx_mip_chain_free(&chain); };
+    if (!gfx_mip_chain_build(&chain, pixels, width, height, GFX_MIP_FILTER_KAISER, true, jobs)) return false;
+
+    Gfx_Texture_File_Level levels[GFX_MIP_MAX_LEVELS];
+    usize table_offset = sizeof(Gfx_Texture_Header);
+    usize file_size    = align_up(table_offset + cast(usize)chain.level_count * sizeof(Gfx_Texture_File_Level), GFX_TEXTURE_ALIGNMENT);
+    for (int i = 0; i < chain.level_count; i++) {
+        levels[i].width  = cast(u32)chain.levels[i].width;
+        levels[i].height = cast(u32)chain.levels[i].height;
+        levels[i].offset = file_size;
+        levels[i].size   = gfx_bc_size(format, chain.levels[i].width, chain.levels[i].height);
+        file_size = align_up(file_size + levels[i].size, GFX_TEXTURE_ALIGNMENT);
+    }
+
+    auto bytes = cast(u8 *)SDL_calloc(1, file_size);
+    if (!bytes) return false;
+    defer { SDL_free(bytes); };
+
+    Gfx_Texture_Header header{};
+    header.magic       = GFX_TEXTURE_MAGIC;
+    header.version     = GFX_TEXTURE_VERSION;
+    header.file_size   = file_size;
+    header.format      = cast(u32)format;
+    header.width       = cast(u32)width;
+    header.height      = cast(u32)height;
+    header.level_count = cast(u32)chain.level_count;
+    SDL_memcpy(bytes, &header, sizeof(header));
+    SDL_memcpy(bytes + table_offset, levels, cast(usize)chain.level_count * sizeof(Gfx_Texture_File_Level));
+
+    for (int i = 0; i < chain.level_count; i++) {
+        const Gfx_Mip_Level *level = &chain.levels[i];
+        gfx_bc_encode(format, chain.data + level->offset, level->width, level->height, bytes + levels[i].offset, jobs);
+    }
+
+    return save_file_atomic(texture_file, bytes, file_size);
+}
+
+bool gfx_texture_load_memory(Gfx_Baked_Texture *texture, void *data, usize size) {
+    *texture = {};
+    if (data == NULL || size < sizeof(Gfx_Texture_Header)) return false;
+
+    auto header = cast(const Gfx_Texture_Header *)data;
+    if (header->magic != GFX_TEXTURE_MAGIC)     return false;
+    if (header->version != GFX_TEXTURE_VERSION) return false;
+    if (header->file_size != size)              return false;
+    if (header->format >= GFX_BC_FORMAT_COUNT)  return false;
+    if (header->level_count == 0 || header->level_count > GFX_MIP_MAX_LEVELS) return false;
+    if (sizeof(Gfx_Texture_Header) + header->level_count * sizeof(Gfx_Texture_File_Level) > size) return false;
+
+    auto format = cast(Gfx_BC_Format)header->format;
+    auto levels = cast(const Gfx_Texture_File_Level *)(cast(const u8 *)data + sizeof(Gfx_Texture_Header));
+    for (u32 i = 0; i < header->level_count; i++) {
+        const Gfx_Texture_File_Level *level = &levels[i];
+        if (level->width == 0 || level->height == 0 || level->width > 32768 || level->height > 32768) return false;
+        if (level->size != gfx_bc_size(format, cast(int)level->width, cast(int)level->height)) return false;
+        if (level->offset > size || level->size > size - level->offset) return false;
+
+        Gfx_Mip_Level *out = &texture->levels[i];
+        out->width  = cast(int)level->width;
+        out->height = cast(int)level->height;
+        out->offset = cast(usize)level->offset;
+        out->size   = cast(usize)level->size;
+    }
+
+    texture->format      = format;
+    texture->level_count = cast(int)header->level_count;
+    texture->data        = cast(u8 *)data;
+    texture->size        = size;
+    return true;
+}
+
+bool gfx_texture_load(Gfx_Baked_Texture *texture, const char *texture_file) {
+    *texture = {};
+
+    usize size = 0;
+    void *data = SDL_LoadFile(texture_file, &size);
+    if (!data) return false;
+
+    if (!gfx_texture_load_memory(texture, data, size)) {
+        SDL_free(data);
+        return false;
+    }
+    return true;
+}
+
+void gfx_texture_free(Gfx_Baked_Texture *texture) {
+    SDL_free(texture->data);
+    *texture = {};
+}
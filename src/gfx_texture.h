@@ -0,0 +1,69 @@
+#pragma once
+
+#include "defines.h"
+#include "gfx_bc.h"
+#include "gfx_mip.h"
+
+//
+// Baked texture files.
+//
+// gfx_texture_bake() decodes an image, builds its mip chain (see gfx_mip.h)
+// and block-compresses every level (see gfx_bc.h). gfx_texture_load() reads
+// the file back in one piece, the levels point into it and are uploaded as
+// they are, without decoding.
+//
+// Layout (little-endian):
+//
+//     Gfx_Texture_Header
+//     Gfx_Texture_File_Level[level_count]
+//     level data, largest first, each aligned to GFX_TEXTURE_ALIGNMENT
+//
+// Block-compressed textures need a first level with a width and height that
+// are multiples of 4, smaller levels may end in partial blocks. Bump
+// GFX_TEXTURE_VERSION whenever the layout changes.
+//
+
+#define GFX_TEXTURE_MAGIC     SDL_FOURCC('S', '3', 'D', 'T')
+#define GFX_TEXTURE_VERSION   1
+#define GFX_TEXTURE_ALIGNMENT 16
+
+struct Gfx_Texture_Header {
+    u32 magic;
+    u32 version;
+    u64 file_size;
+    u32 format; // Gfx_BC_Format.
+    u32 width;
+    u32 height;
+    u32 level_count;
+};
+
+struct Gfx_Texture_File_Level {
+    u32 width;
+    u32 height;
+    u64 offset; // From the start of the file.
+    u64 size;
+};
+
+struct Gfx_Baked_Texture {
+    Gfx_BC_Format format = GFX_BC7;
+    int level_count = 0;
+    Gfx_Mip_Level levels[GFX_MIP_MAX_LEVELS]; // Offsets into data.
+
+    // The whole file.
+    u8 *data   = NULL;
+    usize size = 0;
+};
+
+// Bakes source_file (anything stb_image reads) into texture_file. Color is
+// filtered as sRGB. Returns false on failure, or when the image size is not
+// a multiple of 4. jobs may be NULL.
+bool gfx_texture_bake(const char *source_file, const char *texture_file, Gfx_BC_Format format, Job_System *jobs = NULL);
+
+// Reads texture_file. Returns false if it is missing or invalid.
+bool gfx_texture_load(Gfx_Baked_Texture *texture, const char *texture_file);
+
+// Same from a file already in memory, allocated with SDL_malloc(). Takes
+// ownership of data on success only.
+bool gfx_texture_load_memory(Gfx_Baked_Texture *texture, void *data, usize size);
+
+void gfx_texture_free(Gfx_Baked_Texture *texture);
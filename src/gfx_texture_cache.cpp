@@ -0,0 +1,380 @@
+#include "gfx_texture_cache.h"
+#include "profile.h"
+
+static bool table_insert(Gfx_Texture_Table *table, u64 key, void *value);
+
+static bool table_grow(Gfx_Texture_Table *table) {
+    Gfx_Texture_Table old = *table;
+    u32 capacity = old.capacity ? old.capacity * 2 : 64;
+
+    table->keys   = cast(u64 *)SDL_calloc(capacity, sizeof(u64));
+    table->values = cast(void **)SDL_calloc(capacity, sizeof(void *));
+    if (!table->keys || !table->values) {
+        SDL_free(table->keys);
+        SDL_free(table->values);
+        *table = old;
+        return false;
+    }
+    table->capacity = capacity;
+    table->count    = 0;
+
+    for (u32 i = 0; i < old.capacity; i++) {
+        if (old.values[i]) table_insert(table, old.keys[i], old.values[i]);
+    }
+    SDL_free(old.keys);
+    SDL_free(old.values);
+    return true;
+}
+
+// Kept at most half full, so the probe runs stay short.
+static bool table_insert(Gfx_Texture_Table *table, u64 key, void *value) {
+    if ((table->count + 1) * 2 > table->capacity && !table_grow(table)) return false;
+
+    u32 mask = table->capacity - 1;
+    u32 i = cast(u32)key & mask;
+    while (table->values[i]) i = (i + 1) & mask;
+    table->keys[i]   = key;
+    table->values[i] = value;
+    table->count++;
+    return true;
+}
+
+template <typename Match>
+static void *table_find(const Gfx_Texture_Table *table, u64 key, Match match) {
+    if (table->count == 0) return NULL;
+
+    u32 mask = table->capacity - 1;
+    for (u32 i = cast(u32)key & mask; table->values[i]; i = (i + 1) & mask) {
+        if (table->keys[i] == key && match(table->values[i])) return table->values[i];
+    }
+    return NULL;
+}
+
+// Removes the entry and moves the rest of its probe run back into the hole,
+// so lookups never need tombstones.
+static void table_remove(Gfx_Texture_Table *table, u64 key, void *value) {
+    if (table->count == 0) return;
+
+    u32 mask = table->capacity - 1;
+    u32 hole = cast(u32)key & mask;
+    while (table->values[hole] && !(table->keys[hole] == key && table->values[hole] == value)) hole = (hole + 1) & mask;
+    if (!table->values[hole]) return;
+
+    for (u32 i = (hole + 1) & mask; table->values[i]; i = (i + 1) & mask) {
+        // An entry whose home slot lies in (hole, i] cannot move before it.
+        u32 home = cast(u32)table->keys[i] & mask;
+        bool stays = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (stays) continue;
+
+        table->keys[hole]   = table->keys[i];
+        table->values[hole] = table->values[i];
+        hole = i;
+    }
+    table->values[hole] = NULL;
+    table->count--;
+}
+
+static void table_free(Gfx_Texture_Table *table) {
+    SDL_free(table->keys);
+    SDL_free(table->values);
+    *table = {};
+}
+
+static bool any_value(const void *) { return true; }
+
+// Loader threads. A failed insert decodes without the claim, the duplicate
+// is dropped when it resolves.
+static bool claim_image(void *userdata, u64 content_hash) {
+    auto cache = cast(Gfx_Texture_Cache *)userdata;
+    SDL_LockMutex(cache->claim_lock);
+    defer { SDL_UnlockMutex(cache->claim_lock); };
+
+    if (table_find(&cache->claimed, content_hash, any_value)) return false;
+    table_insert(&cache->claimed, content_hash, cache);
+    return true;
+}
+
+static bool is_claimed(Gfx_Texture_Cache *cache, u64 content_hash) {
+    SDL_LockMutex(cache->claim_lock);
+    defer { SDL_UnlockMutex(cache->claim_lock); };
+    return table_find(&cache->claimed, content_hash, any_value) != NULL;
+}
+
+static void unclaim(Gfx_Texture_Cache *cache, u64 content_hash) {
+    SDL_LockMutex(cache->claim_lock);
+    table_remove(&cache->claimed, content_hash, cache);
+    SDL_UnlockMutex(cache->claim_lock);
+}
+
+// Called by the residency. The claim goes with the texture, so loading the
+// content again decodes it.
+static void evict_texture(void *userdata, void *owner) {
+    auto context = cast(Gfx_Context *)userdata;
+    auto cached  = cast(Gfx_Cached_Texture *)owner;
+    Gfx_Texture_Cache *cache = cached->cache;
+
+    gfx_staging_cancel_texture(&context->staging, cached->texture);
+    SDL_ReleaseGPUTexture(context->device, cached->texture);
+    cached->texture = NULL;
+    cache->stats.resident_textures--;
+    cache->stats.resident_bytes -= cached->size;
+    unclaim(cache, cached->content_hash);
+}
+
+bool gfx_texture_cache_init(Gfx_Texture_Cache *cache, Gfx_Stream *stream, Gfx_Context *context) {
+    *cache = {};
+    cache->claim_lock = SDL_CreateMutex();
+    if (!cache->claim_lock) return false;
+
+    cache->stream  = stream;
+    cache->context = context;
+    stream->claim_image    = claim_image;
+    stream->claim_userdata = cache;
+    return true;
+}
+
+static Gfx_Cached_Texture *find_texture(Gfx_Texture_Cache *cache, u64 content_hash) {
+    return cast(Gfx_Cached_Texture *)table_find(&cache->textures, content_hash, any_value);
+}
+
+// Starts out loading, filled in when the claiming load resolves.
+static Gfx_Cached_Texture *add_texture(Gfx_Texture_Cache *cache, u64 content_hash) {
+    auto cached = cast(Gfx_Cached_Texture *)SDL_malloc(sizeof(Gfx_Cached_Texture));
+    if (!cached) return NULL;
+    *cached = {};
+    cached->cache          = cache;
+    cached->content_hash   = content_hash;
+    cached->resident.evict = evict_texture;
+    cached->resident.owner = cached;
+
+    if (!table_insert(&cache->textures, content_hash, cached)) {
+        SDL_free(cached);
+        return NULL;
+    }
+    return cached;
+}
+
+// Releases the texture once unused, and gives up its claim so the content
+// loads again when asked for.
+static void drop_texture_if_unused(Gfx_Texture_Cache *cache, Gfx_Cached_Texture *cached) {
+    if (cached->refs > 0 || cached->loading) return;
+
+    table_remove(&cache->textures, cached->content_hash, cached);
+    unclaim(cache, cached->content_hash);
+    gfx_residency_remove(&cache->context->residency, &cached->resident);
+
+    if (cached->texture) {
+        gfx_staging_cancel_texture(&cache->context->staging, cached->texture);
+        SDL_ReleaseGPUTexture(cache->context->device, cached->texture);
+        cache->stats.resident_textures--;
+        cache->stats.resident_bytes -= cached->size;
+    }
+    SDL_free(cached);
+}
+
+static void free_handle(Gfx_Texture_Cache *cache, Gfx_Texture_Handle *handle) {
+    table_remove(&cache->handles, handle->path_hash, handle);
+    SDL_free(handle->path);
+    SDL_free(handle);
+}
+
+void gfx_texture_cache_free(Gfx_Texture_Cache *cache) {
+    for (u32 i = 0; i < cache->handles.capacity; i++) {
+        auto handle = cast(Gfx_Texture_Handle *)cache->handles.values[i];
+        if (!handle) continue;
+        SDL_free(handle->path);
+        SDL_free(handle);
+    }
+    for (u32 i = 0; i < cache->textures.capacity; i++) {
+        auto cached = cast(Gfx_Cached_Texture *)cache->textures.values[i];
+        if (!cached) continue;
+        gfx_residency_remove(&cache->context->residency, &cached->resident);
+        if (cached->texture) SDL_ReleaseGPUTexture(cache->context->device, cached->texture);
+        SDL_free(cached);
+    }
+
+    table_free(&cache->handles);
+    table_free(&cache->textures);
+    table_free(&cache->claimed);
+    if (cache->claim_lock) SDL_DestroyMutex(cache->claim_lock);
+    *cache = {};
+}
+
+Gfx_Texture_Handle *gfx_texture_cache_acquire(Gfx_Texture_Cache *cache, const char *path) {
+    u64 path_hash = hash_fnv1a64(path, SDL_strlen(path));
+    auto same_path = [&](const void *value) {
+        return SDL_strcmp((cast(const Gfx_Texture_Handle *)value)->path, path) == 0;
+    };
+
+    auto handle = cast(Gfx_Texture_Handle *)table_find(&cache->handles, path_hash, same_path);
+    if (handle) {
+        cache->stats.hits++;
+        handle->refs++;
+        if (handle->cached) handle->cached->refs++;
+        return handle;
+    }
+
+    handle = cast(Gfx_Texture_Handle *)SDL_malloc(sizeof(Gfx_Texture_Handle));
+    if (!handle) return NULL;
+    *handle = {};
+    handle->path      = SDL_strdup(path);
+    handle->path_hash = path_hash;
+    handle->refs      = 1;
+    if (!handle->path || !table_insert(&cache->handles, path_hash, handle)) {
+        SDL_free(handle->path);
+        SDL_free(handle);
+        return NULL;
+    }
+
+    cache->stats.misses++;
+    handle->asset = gfx_stream_image(cache->stream, path);
+    if (handle->asset) {
+        handle->next_pending = cache->pending;
+        cache->pending = handle;
+    } else {
+        handle->failed = true;
+    }
+    return handle;
+}
+
+void gfx_texture_cache_release(Gfx_Texture_Cache *cache, Gfx_Texture_Handle *handle) {
+    ASSERT(handle->refs > 0);
+    handle->refs--;
+    Gfx_Cached_Texture *cached = handle->cached;
+    if (cached) cached->refs--;
+
+    // A handle still loading is dropped when it resolves.
+    if (handle->refs > 0 || handle->asset) return;
+
+    free_handle(cache, handle);
+    if (cached) drop_texture_if_unused(cache, cached);
+}
+
+static void fill_texture(Gfx_Texture_Cache *cache, Gfx_Cached_Texture *cached, Gfx_Asset *asset) {
+    cached->loading = false;
+    cached->texture = asset->texture;
+    cached->size    = asset->texture_size;
+    cached->failed  = asset->texture == NULL;
+    asset->texture  = NULL;
+    cache->stats.decodes++;
+
+    if (cached->texture) {
+        gfx_residency_add(&cache->context->residency, &cached->resident, GFX_RESIDENT_TEXTURE, cached->size);
+        cache->stats.resident_textures++;
+        cache->stats.resident_bytes += cached->size;
+    }
+}
+
+// The file of an evicted texture did not load back.
+static void fail_restore(Gfx_Cached_Texture *cached) {
+    cached->loading = false;
+    cached->failed  = true;
+}
+
+// Returns false while the handle keeps waiting.
+static bool resolve(Gfx_Texture_Cache *cache, Gfx_Texture_Handle *handle) {
+    Gfx_Asset *asset = handle->asset;
+    if (asset->state != GFX_ASSET_READY && asset->state != GFX_ASSET_FAILED) return false;
+    handle->asset = NULL;
+
+    // Set when streaming an evicted texture back in.
+    Gfx_Cached_Texture *restoring = handle->cached;
+
+    // Unreadable, there is no content to share.
+    if (asset->content_hash == 0) {
+        if (restoring) fail_restore(restoring);
+        else           handle->failed = true;
+        return true;
+    }
+
+    u64 content_hash = asset->content_hash;
+    Gfx_Cached_Texture *cached = find_texture(cache, content_hash);
+    if (asset->shared) {
+        if (!cached) {
+            // The claim was given up by a released texture after the loader
+            // saw it, nothing else loads the content.
+            if (!is_claimed(cache, content_hash)) {
+                handle->asset = gfx_stream_image(cache->stream, handle->path);
+                if (handle->asset) return false;
+                if (restoring) fail_restore(restoring);
+                else           handle->failed = true;
+                return true;
+            }
+            // Claimed by a load that has not resolved yet.
+            cached = add_texture(cache, content_hash);
+        }
+        cache->stats.shared++;
+    } else {
+        if (!cached) cached = add_texture(cache, content_hash);
+        if (cached && (cached->loading || cached->resident.evicted)) fill_texture(cache, cached, asset);
+    }
+
+    // Anything left is a duplicate, or lost to a failed allocation.
+    if (asset->texture) {
+        gfx_staging_cancel_texture(&cache->context->staging, asset->texture);
+        SDL_ReleaseGPUTexture(cache->context->device, asset->texture);
+        asset->texture = NULL;
+    }
+
+    if (restoring) {
+        // The file changed since its first load.
+        if (cached != restoring) {
+            fail_restore(restoring);
+            if (cached) drop_texture_if_unused(cache, cached);
+        }
+        return true;
+    }
+
+    if (!cached) {
+        handle->failed = true;
+        return true;
+    }
+    handle->cached = cached;
+    cached->refs += handle->refs;
+    return true;
+}
+
+void gfx_texture_cache_update(Gfx_Texture_Cache *cache) {
+    PROFILE_ZONE("gfx_texture_cache_update");
+    Gfx_Texture_Handle *pending = cache->pending;
+    cache->pending = NULL;
+
+    while (pending) {
+        Gfx_Texture_Handle *handle = pending;
+        pending = handle->next_pending;
+        handle->next_pending = NULL;
+
+        if (!resolve(cache, handle)) {
+            handle->next_pending = cache->pending;
+            cache->pending = handle;
+            continue;
+        }
+
+        // Released while loading.
+        if (handle->refs == 0) {
+            Gfx_Cached_Texture *cached = handle->cached;
+            free_handle(cache, handle);
+            if (cached) drop_texture_if_unused(cache, cached);
+        }
+    }
+}
+
+SDL_GPUTexture *gfx_texture_cache_use(Gfx_Texture_Cache *cache, Gfx_Texture_Handle *handle) {
+    if (!handle || !handle->cached) return NULL;
+
+    Gfx_Cached_Texture *cached = handle->cached;
+    if (cached->texture) {
+        gfx_residency_touch(&cache->context->residency, &cached->resident);
+        return cached->texture;
+    }
+
+    if (cached->resident.evicted && !cached->loading && !cached->failed && !handle->asset) {
+        handle->asset = gfx_stream_image(cache->stream, handle->path);
+        if (handle->asset) {
+            cached->loading = true;
+            handle->next_pending = cache->pending;
+            cache->pending = handle;
+        }
+    }
+    return NULL;
+}
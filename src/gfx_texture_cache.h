@@ -0,0 +1,113 @@
+#pragma once
+
+#include "defines.h"
+#include "gfx.h"
+#include "gfx_stream.h"
+
+#include <SDL3/SDL.h>
+
+//
+// Textures shared by content.
+//
+// gfx_texture_cache_acquire() hands out one reference counted handle per
+// path. The first acquire of a path streams the file (see gfx_stream.h),
+// later ones return the same handle. Loads run in parallel on the loader
+// threads, which hash each file and claim the hash before decoding it. A
+// file whose content is already claimed, loaded under another path or
+// still loading, is neither decoded nor uploaded again: its handle resolves
+// to the same texture.
+//
+// Each unique content is a Gfx_Cached_Texture, reference counted by the
+// handles resolved to it. Its GPU texture is released with the last
+// reference, and the content can be loaded again afterwards.
+//
+// Textures count against the budget of the context (see gfx_residency.h).
+// An evicted texture gives up its claim and is streamed back in from the
+// path of the first handle that uses it again, resolved like a first load.
+//
+// Everything runs on the main thread, except the claim on the loader
+// threads.
+//
+
+struct Gfx_Texture_Cache;
+
+struct Gfx_Cached_Texture {
+    Gfx_Texture_Cache *cache = NULL;
+    u64 content_hash = 0;
+    SDL_GPUTexture *texture = NULL; // NULL while loading, evicted or failed.
+    u64 size = 0;     // GPU bytes.
+    int refs = 0;     // Handles resolved to it, counted by their references.
+    bool loading = true;
+    bool failed  = false;
+    Gfx_Resident resident;
+};
+
+struct Gfx_Texture_Handle {
+    char *path = NULL;
+    u64 path_hash = 0;
+    int refs = 0;
+
+    Gfx_Asset *asset = NULL;           // While loading.
+    Gfx_Cached_Texture *cached = NULL; // Once the content is known.
+    bool failed = false;               // Nothing to resolve to.
+
+    Gfx_Texture_Handle *next_pending = NULL;
+};
+
+// Open addressing with linear probing on keys that are hashes already.
+// Values are never NULL, several values may share a key.
+struct Gfx_Texture_Table {
+    u64 *keys     = NULL;
+    void **values = NULL;
+    u32 capacity  = 0; // Power of two.
+    u32 count     = 0;
+};
+
+struct Gfx_Texture_Cache_Stats {
+    u64 hits    = 0; // Acquires of a path already in the cache.
+    u64 misses  = 0; // Acquires that started a load.
+    u64 shared  = 0; // Loads that found their content loaded or loading.
+    u64 decodes = 0; // Loads that decoded their content, failed ones included.
+
+    int resident_textures = 0;
+    u64 resident_bytes    = 0;
+};
+
+struct Gfx_Texture_Cache {
+    Gfx_Stream *stream   = NULL;
+    Gfx_Context *context = NULL;
+
+    Gfx_Texture_Table handles;  // By path hash.
+    Gfx_Texture_Table textures; // By content hash.
+    Gfx_Texture_Handle *pending = NULL;
+
+    // Content hashes claimed by the loader threads, a texture's until it is
+    // released.
+    SDL_Mutex *claim_lock = NULL;
+    Gfx_Texture_Table claimed;
+
+    Gfx_Texture_Cache_Stats stats;
+};
+
+// Installs the claim on stream, which must not have image requests yet.
+// Returns false on failure.
+bool gfx_texture_cache_init(Gfx_Texture_Cache *cache, Gfx_Stream *stream, Gfx_Context *context);
+
+// Releases every texture and handle. Call after gfx_stream_shutdown(), no
+// loader thread may claim anymore.
+void gfx_texture_cache_free(Gfx_Texture_Cache *cache);
+
+// Returns the handle of path with one more reference, NULL on allocation
+// failure. The texture arrives with gfx_texture_cache_update().
+Gfx_Texture_Handle *gfx_texture_cache_acquire(Gfx_Texture_Cache *cache, const char *path);
+
+// Drops a reference. The handle is invalid once it has none left.
+void gfx_texture_cache_release(Gfx_Texture_Cache *cache, Gfx_Texture_Handle *handle);
+
+// Resolves the handles whose loads finished. Call after gfx_stream_update().
+void gfx_texture_cache_update(Gfx_Texture_Cache *cache);
+
+// The texture of handle for the frame in progress, NULL while loading, after
+// a failure or while coming back from an eviction. Marks it used, so it is
+// not evicted this frame, and starts the load back in when evicted.
+SDL_GPUTexture *gfx_texture_cache_use(Gfx_Texture_Cache *cache, Gfx_Texture_Handle *handle);
@@ -0,0 +1,479 @@
+#include "gfx_vertex.h"
+
+#include "gfx.h"
+#include "profile.h"
+
+#if SIMD_SSE2
+    #include <emmintrin.h>
+#endif
+
+#if SIMD_F16C
+    #include <immintrin.h>
+#endif
+
+#define SNORM16_MAX 32767.0f
+#define HALF_MIN_NORMAL (1.0f / 16384.0f) // 2^-14.
+
+u32 gfx_vertex_stride(Gfx_Vertex_Layout layout) {
+    switch (layout) {
+        case GFX_VERTEX_LAYOUT_FLOAT:           return sizeof(Gfx_Vertex_Float);
+        case GFX_VERTEX_LAYOUT_COMPACT:         return sizeof(Gfx_Vertex_Compact);
+        case GFX_VERTEX_LAYOUT_COMPACT_TANGENT: return sizeof(Gfx_Vertex_Compact_Tangent);
+        default: break;
+    }
+    return 0;
+}
+
+const char *gfx_vertex_layout_name(Gfx_Vertex_Layout layout) {
+    switch (layout) {
+        case GFX_VERTEX_LAYOUT_FLOAT:           return "float";
+        case GFX_VERTEX_LAYOUT_COMPACT:         return "compact";
+        case GFX_VERTEX_LAYOUT_COMPACT_TANGENT: return "compact_tangent";
+        default: break;
+    }
+    return "unknown";
+}
+
+void gfx_vertex_input(Gfx_Vertex_Layout layout, Gfx_Vertex_Input *input) {
+    *input = {};
+
+    input->buffers[0].slot  = 0;
+    input->buffers[0].pitch = gfx_vertex_stride(layout);
+    input->buffers[0].input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX;
+    input->buffers[0].instance_step_rate = 0;
+
+    input->buffers[1].slot  = GFX_INSTANCE_BUFFER_SLOT;
+    input->buffers[1].pitch = sizeof(Gfx_Instance);
+    input->buffers[1].input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE;
+    input->buffers[1].instance_step_rate = 0;
+
+    u32 attribute_count = 0;
+    auto add_attribute = [&](u32 location, SDL_GPUVertexElementFormat format, u32 offset, u32 slot = 0) {
+        SDL_GPUVertexAttribute *attribute = &input->attributes[attribute_count++];
+        attribute->location    = location;
+        attribute->buffer_slot = slot;
+        attribute->format      = format;
+        attribute->offset      = offset;
+    };
+
+    // A mat4 takes one location per column.
+    for (u32 column = 0; column < 4; column++) {
+        add_attribute(4 + column, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4, column * sizeof(glm::vec4), GFX_INSTANCE_BUFFER_SLOT);
+    }
+
+    switch (layout) {
+        case GFX_VERTEX_LAYOUT_FLOAT: {
+            add_attribute(0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3, offsetof(Gfx_Vertex_Float, position));
+            add_attribute(1, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3, offsetof(Gfx_Vertex_Float, normal));
+            add_attribute(2, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2, offsetof(Gfx_Vertex_Float, texcoord));
+            break;
+        }
+        case GFX_VERTEX_LAYOUT_COMPACT: {
+            add_attribute(0, SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM, offsetof(Gfx_Vertex_Compact, position));
+            add_attribute(1, SDL_GPU_VERTEXELEMENTFORMAT_SHORT2_NORM, offsetof(Gfx_Vertex_Compact, normal));
+            add_attribute(2, SDL_GPU_VERTEXELEMENTFORMAT_HALF2,       offsetof(Gfx_Vertex_Compact, texcoord));
+            break;
+        }
+        case GFX_VERTEX_LAYOUT_COMPACT_TANGENT: {
+            add_attribute(0, SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM, offsetof(Gfx_Vertex_Compact_Tangent, position));
+            add_attribute(1, SDL_GPU_VERTEXELEMENTFORMAT_SHORT2_NORM, offsetof(Gfx_Vertex_Compact_Tangent, normal));
+            add_attribute(2, SDL_GPU_VERTEXELEMENTFORMAT_HALF2,       offsetof(Gfx_Vertex_Compact_Tangent, texcoord));
+            add_attribute(3, SDL_GPU_VERTEXELEMENTFORMAT_SHORT2_NORM, offsetof(Gfx_Vertex_Compact_Tangent, tangent));
+            break;
+        }
+        default: break;
+    }
+
+    input->state.vertex_buffer_descriptions = input->buffers;
+    input->state.num_vertex_buffers = ARRAY_COUNT(input->buffers);
+    input->state.vertex_attributes  = input->attributes;
+    input->state.num_vertex_attributes = attribute_count;
+}
+
+//
+// Scalar conversions.
+//
+// Half conversion rounds to nearest even.
+// Source: https://gist.github.com/rygorous/2156668
+//
+
+u16 gfx_f32_to_f16(f32 value) {
+    u32 f;
+    SDL_memcpy(&f, &value, sizeof(f));
+
+    u32 sign = f & 0x80000000u;
+    f ^= sign;
+
+    u32 result;
+    if (f >= ((127 + 16) << 23)) {
+        // Overflow to infinity, keep NaN.
+        result = (f > (255u << 23)) ? 0x7e00 : 0x7c00;
+    } else if (f < (113 << 23)) {
+        // Subnormal or zero, let the FPU do the rounding.
+        const u32 denorm_magic_bits = ((127 - 15) + (23 - 10) + 1) << 23;
+        f32 denorm_magic;
+        SDL_memcpy(&denorm_magic, &denorm_magic_bits, sizeof(denorm_magic));
+
+        f32 temp;
+        SDL_memcpy(&temp, &f, sizeof(temp));
+        temp += denorm_magic;
+        SDL_memcpy(&f, &temp, sizeof(f));
+        result = f - denorm_magic_bits;
+    } else {
+        u32 mantissa_odd = (f >> 13) & 1;
+        f += (cast(u32)(15 - 127) << 23) + 0xfff;
+        f += mantissa_odd;
+        result = f >> 13;
+    }
+
+    return cast(u16)(result | (sign >> 16));
+}
+
+f32 gfx_f16_to_f32(u16 value) {
+    const u32 shifted_exp = 0x7c00 << 13;
+
+    u32 o = cast(u32)(value & 0x7fff) << 13;
+    u32 exp = shifted_exp & o;
+    o += (127 - 15) << 23;
+
+    if (exp == shifted_exp) {
+        o += (128 - 16) << 23; // Infinity or NaN.
+    } else if (exp == 0) {
+        // Subnormal, renormalize.
+        const u32 magic_bits = 113 << 23;
+        f32 magic, temp;
+        SDL_memcpy(&magic, &magic_bits, sizeof(magic));
+        o += 1 << 23;
+        SDL_memcpy(&temp, &o, sizeof(temp));
+        temp -= magic;
+        SDL_memcpy(&o, &temp, sizeof(o));
+    }
+
+    o |= cast(u32)(value & 0x8000) << 16;
+
+    f32 result;
+    SDL_memcpy(&result, &o, sizeof(result));
+    return result;
+}
+
+static s16 to_snorm16(f32 value) {
+    value = SDL_clamp(value, -1.0f, 1.0f) * SNORM16_MAX;
+    return cast(s16)SDL_roundf(value);
+}
+
+static f32 from_snorm16(s16 value) {
+    return SDL_max(cast(f32)value / SNORM16_MAX, -1.0f);
+}
+
+static void oct_encode(const f32 *n, s16 *out) {
+    f32 l1 = SDL_fabsf(n[0]) + SDL_fabsf(n[1]) + SDL_fabsf(n[2]);
+    l1 = SDL_max(l1, 1e-20f);
+
+    f32 x = n[0] / l1;
+    f32 y = n[1] / l1;
+    if (n[2] < 0.0f) {
+        f32 fx = (1.0f - SDL_fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        f32 fy = (1.0f - SDL_fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+
+    out[0] = to_snorm16(x);
+    out[1] = to_snorm16(y);
+}
+
+static glm::vec3 oct_decode(const s16 *in) {
+    glm::vec3 v(from_snorm16(in[0]), from_snorm16(in[1]), 0.0f);
+    v.z = 1.0f - SDL_fabsf(v.x) - SDL_fabsf(v.y);
+
+    f32 t = SDL_max(-v.z, 0.0f);
+    v.x += v.x >= 0.0f ? -t : t;
+    v.y += v.y >= 0.0f ? -t : t;
+    return glm::normalize(v);
+}
+
+//
+// Packing kernels. Each writes one attribute into an interleaved buffer with
+// the given stride.
+//
+
+static void pack_positions(const f32 *positions, u32 count, glm::vec3 offset, glm::vec3 inv_scale, u8 *out, u32 stride) {
+#if SIMD_SSE2
+    const __m128 v_offset = _mm_setr_ps(offset.x, offset.y, offset.z, 0.0f);
+    const __m128 v_scale  = _mm_setr_ps(inv_scale.x * SNORM16_MAX, inv_scale.y * SNORM16_MAX, inv_scale.z * SNORM16_MAX, 0.0f);
+    const __m128 v_max    = _mm_set1_ps(SNORM16_MAX);
+    const __m128 v_min    = _mm_set1_ps(-SNORM16_MAX);
+
+    for (u32 i = 0; i < count; i++) {
+        const f32 *p = &positions[i * 3];
+        __m128 v = _mm_setr_ps(p[0], p[1], p[2], 0.0f);
+        v = _mm_mul_ps(_mm_sub_ps(v, v_offset), v_scale);
+        v = _mm_min_ps(_mm_max_ps(v, v_min), v_max);
+
+        __m128i q = _mm_cvtps_epi32(v);
+        q = _mm_packs_epi32(q, q);
+        _mm_storel_epi64(cast(__m128i *)(out + i * stride), q);
+    }
+#else
+    for (u32 i = 0; i < count; i++) {
+        const f32 *p = &positions[i * 3];
+        auto q = cast(s16 *)(out + i * stride);
+        q[0] = to_snorm16((p[0] - offset.x) * inv_scale.x);
+        q[1] = to_snorm16((p[1] - offset.y) * inv_scale.y);
+        q[2] = to_snorm16((p[2] - offset.z) * inv_scale.z);
+        q[3] = 0;
+    }
+#endif
+}
+
+// Encodes count unit vectors read with the given float stride (3 or 4).
+static void pack_octahedral(const f32 *vectors, u32 vector_stride, u32 count, u8 *out, u32 stride) {
+    u32 i = 0;
+
+#if SIMD_SSE2
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 one       = _mm_set1_ps(1.0f);
+    const __m128 zero      = _mm_setzero_ps();
+    const __m128 tiny      = _mm_set1_ps(1e-20f);
+    const __m128 v_max     = _mm_set1_ps(SNORM16_MAX);
+
+    for (; i + 4 <= count; i += 4) {
+        const f32 *n = &vectors[i * vector_stride];
+        const u32 s = vector_stride;
+        __m128 x = _mm_setr_ps(n[0], n[s + 0], n[2 * s + 0], n[3 * s + 0]);
+        __m128 y = _mm_setr_ps(n[1], n[s + 1], n[2 * s + 1], n[3 * s + 1]);
+        __m128 z = _mm_setr_ps(n[2], n[s + 2], n[2 * s + 2], n[3 * s + 2]);
+
+        __m128 ax = _mm_andnot_ps(sign_mask, x);
+        __m128 ay = _mm_andnot_ps(sign_mask, y);
+        __m128 az = _mm_andnot_ps(sign_mask, z);
+        __m128 l1 = _mm_max_ps(_mm_add_ps(_mm_add_ps(ax, ay), az), tiny);
+
+        __m128 px = _mm_div_ps(x, l1);
+        __m128 py = _mm_div_ps(y, l1);
+
+        // Fold the lower hemisphere: (1 - |p.yx|) * sign(p.xy).
+        __m128 sx = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(px, zero), sign_mask), one);
+        __m128 sy = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(py, zero), sign_mask), one);
+        __m128 fx = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, py)), sx);
+        __m128 fy = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, px)), sy);
+
+        __m128 lower = _mm_cmplt_ps(z, zero);
+        px = _mm_or_ps(_mm_and_ps(lower, fx), _mm_andnot_ps(lower, px));
+        py = _mm_or_ps(_mm_and_ps(lower, fy), _mm_andnot_ps(lower, py));
+
+        __m128i qx = _mm_cvtps_epi32(_mm_mul_ps(px, v_max));
+        __m128i qy = _mm_cvtps_epi32(_mm_mul_ps(py, v_max));
+
+        // Interleave to x0 y0 x1 y1 ... and store one pair per vertex.
+        __m128i xy = _mm_packs_epi32(_mm_unpacklo_epi32(qx, qy), _mm_unpackhi_epi32(qx, qy));
+        alignas(16) u32 pairs[4];
+        _mm_store_si128(cast(__m128i *)pairs, xy);
+        for (u32 k = 0; k < 4; k++) {
+            SDL_memcpy(out + (i + k) * stride, &pairs[k], sizeof(u32));
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        oct_encode(&vectors[i * vector_stride], cast(s16 *)(out + i * stride));
+    }
+}
+
+static void pack_half2(const f32 *values, u32 count, u8 *out, u32 stride) {
+    u32 i = 0;
+
+#if SIMD_F16C
+    for (; i + 2 <= count; i += 2) {
+        __m128 v = _mm_loadu_ps(&values[i * 2]);
+        __m128i h = _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT);
+        alignas(16) u32 pairs[4];
+        _mm_store_si128(cast(__m128i *)pairs, h);
+        SDL_memcpy(out + (i + 0) * stride, &pairs[0], sizeof(u32));
+        SDL_memcpy(out + (i + 1) * stride, &pairs[1], sizeof(u32));
+    }
+#endif
+
+    for (; i < count; i++) {
+        auto h = cast(u16 *)(out + i * stride);
+        h[0] = gfx_f32_to_f16(values[i * 2 + 0]);
+        h[1] = gfx_f32_to_f16(values[i * 2 + 1]);
+    }
+}
+
+static void get_bounds(const Gfx_Mesh *mesh, glm::vec3 *out_min, glm::vec3 *out_max) {
+    glm::vec3 lo( 1e30f);
+    glm::vec3 hi(-1e30f);
+    for (int i = 0; i < mesh->vertex_count; i++) {
+        const f32 *p = &mesh->vertices[i * 3];
+        glm::vec3 v(p[0], p[1], p[2]);
+        lo = glm::min(lo, v);
+        hi = glm::max(hi, v);
+    }
+    if (mesh->vertex_count == 0) lo = hi = glm::vec3(0.0f);
+    *out_min = lo;
+    *out_max = hi;
+}
+
+// Packs the vertices [begin, end) once the dequant transform is set.
+static void pack_range(const Gfx_Mesh *mesh, Gfx_Packed_Vertices *out, u32 begin, u32 end) {
+    u32 count  = end - begin;
+    u32 stride = out->stride;
+    u8 *data   = out->data + begin * stride;
+
+    if (out->layout == GFX_VERTEX_LAYOUT_FLOAT) {
+        for (u32 i = begin; i < end; i++) {
+            auto v = cast(Gfx_Vertex_Float *)(out->data + i * stride);
+            SDL_memcpy(v->position, &mesh->vertices[i * 3], sizeof(v->position));
+            if (mesh->normals)   SDL_memcpy(v->normal,   &mesh->normals[i * 3],   sizeof(v->normal));
+            else                 v->normal[2] = 1.0f;
+            if (mesh->texcoords) SDL_memcpy(v->texcoord, &mesh->texcoords[i * 2], sizeof(v->texcoord));
+        }
+        return;
+    }
+
+    // Offsets are the same for both compact layouts.
+    static_assert(offsetof(Gfx_Vertex_Compact, position) == offsetof(Gfx_Vertex_Compact_Tangent, position), "");
+    static_assert(offsetof(Gfx_Vertex_Compact, normal)   == offsetof(Gfx_Vertex_Compact_Tangent, normal),   "");
+    static_assert(offsetof(Gfx_Vertex_Compact, texcoord) == offsetof(Gfx_Vertex_Compact_Tangent, texcoord), "");
+
+    glm::vec3 scale = out->dequant_scale;
+    glm::vec3 inv_scale(1.0f / scale.x, 1.0f / scale.y, 1.0f / scale.z);
+    pack_positions(mesh->vertices + begin * 3, count, out->dequant_offset, inv_scale, data + offsetof(Gfx_Vertex_Compact, position), stride);
+
+    if (mesh->normals) {
+        pack_octahedral(mesh->normals + begin * 3, 3, count, data + offsetof(Gfx_Vertex_Compact, normal), stride);
+    } else {
+        const f32 up[3] = {0.0f, 0.0f, 1.0f};
+        for (u32 i = 0; i < count; i++) {
+            oct_encode(up, cast(s16 *)(data + i * stride + offsetof(Gfx_Vertex_Compact, normal)));
+        }
+    }
+
+    if (mesh->texcoords) {
+        pack_half2(mesh->texcoords + begin * 2, count, data + offsetof(Gfx_Vertex_Compact, texcoord), stride);
+    }
+
+    // Position w holds the tangent handedness.
+    for (u32 i = begin; i < end; i++) {
+        auto position = cast(s16 *)(out->data + i * stride + offsetof(Gfx_Vertex_Compact, position));
+        position[3] = (mesh->tangents && mesh->tangents[i * 4 + 3] < 0.0f) ? -32767 : 32767;
+    }
+
+    if (out->layout == GFX_VERTEX_LAYOUT_COMPACT_TANGENT && mesh->tangents) {
+        pack_octahedral(mesh->tangents + begin * 4, 4, count, data + offsetof(Gfx_Vertex_Compact_Tangent, tangent), stride);
+    }
+}
+
+struct Pack_Vertices_Work {
+    const Gfx_Mesh *mesh;
+    Gfx_Packed_Vertices *out;
+};
+
+static void pack_vertices(void *data, int begin, int end) {
+    auto work = cast(Pack_Vertices_Work *)data;
+    pack_range(work->mesh, work->out, cast(u32)begin, cast(u32)end);
+}
+
+bool gfx_vertex_pack(const Gfx_Mesh *mesh, Gfx_Vertex_Layout layout, Gfx_Packed_Vertices *out, Job_System *jobs) {
+    PROFILE_ZONE("vertex_pack");
+    // Vertices per job, large enough to hide the scheduling.
+    const int PACK_BATCH = 16384;
+
+    *out = {};
+    out->layout       = layout;
+    out->vertex_count = cast(u32)mesh->vertex_count;
+    out->stride       = gfx_vertex_stride(layout);
+
+    out->data = cast(u8 *)SDL_calloc(SDL_max(out->vertex_count, 1u), out->stride);
+    if (!out->data) return false;
+
+    if (layout != GFX_VERTEX_LAYOUT_FLOAT) {
+        glm::vec3 lo, hi;
+        get_bounds(mesh, &lo, &hi);
+
+        glm::vec3 scale = (hi - lo) * 0.5f;
+        for (int k = 0; k < 3; k++) {
+            if (scale[k] <= 0.0f) scale[k] = 1.0f;
+        }
+        out->dequant_scale  = scale;
+        out->dequant_offset = (hi + lo) * 0.5f;
+    }
+
+    Pack_Vertices_Work work;
+    work.mesh = mesh;
+    work.out  = out;
+    job_parallel_for(jobs, mesh->vertex_count, PACK_BATCH, pack_vertices, &work);
+    return true;
+}
+
+void gfx_vertex_free(Gfx_Packed_Vertices *packed) {
+    SDL_free(packed->data);
+    *packed = {};
+}
+
+// From the sine and the cosine, the arc cosine alone is off by more than
+// the octahedral error near 0.
+static f32 angle_degrees(glm::vec3 a, glm::vec3 b) {
+    return SDL_atan2f(glm::length(glm::cross(a, b)), glm::dot(a, b)) * (180.0f / SDL_PI_F);
+}
+
+Gfx_Vertex_Pack_Error gfx_vertex_pack_error(const Gfx_Mesh *mesh, const Gfx_Packed_Vertices *packed) {
+    Gfx_Vertex_Pack_Error error{};
+    if (packed->layout == GFX_VERTEX_LAYOUT_FLOAT) return error;
+
+    for (u32 i = 0; i < packed->vertex_count; i++) {
+        const u8 *vertex = packed->data + i * packed->stride;
+        auto position = cast(const s16 *)(vertex + offsetof(Gfx_Vertex_Compact, position));
+        auto normal   = cast(const s16 *)(vertex + offsetof(Gfx_Vertex_Compact, normal));
+        auto texcoord = cast(const u16 *)(vertex + offsetof(Gfx_Vertex_Compact, texcoord));
+
+        glm::vec3 q(from_snorm16(position[0]), from_snorm16(position[1]), from_snorm16(position[2]));
+        glm::vec3 p = q * packed->dequant_scale + packed->dequant_offset;
+        glm::vec3 original(mesh->vertices[i * 3 + 0], mesh->vertices[i * 3 + 1], mesh->vertices[i * 3 + 2]);
+        error.position = SDL_max(error.position, glm::length(p - original));
+
+        if (mesh->normals) {
+            glm::vec3 n(mesh->normals[i * 3 + 0], mesh->normals[i * 3 + 1], mesh->normals[i * 3 + 2]);
+            error.normal_degrees = SDL_max(error.normal_degrees, angle_degrees(oct_decode(normal), n));
+        }
+
+        if (mesh->texcoords) {
+            for (int k = 0; k < 2; k++) {
+                f32 value = mesh->texcoords[i * 2 + k];
+                f32 diff  = SDL_fabsf(gfx_f16_to_f32(texcoord[k]) - value);
+                error.texcoord = SDL_max(error.texcoord, diff / SDL_max(SDL_fabsf(value), HALF_MIN_NORMAL));
+            }
+        }
+
+        if (packed->layout == GFX_VERTEX_LAYOUT_COMPACT_TANGENT && mesh->tangents) {
+            auto tangent = cast(const s16 *)(vertex + offsetof(Gfx_Vertex_Compact_Tangent, tangent));
+            glm::vec3 t(mesh->tangents[i * 4 + 0], mesh->tangents[i * 4 + 1], mesh->tangents[i * 4 + 2]);
+            error.tangent_degrees = SDL_max(error.tangent_degrees, angle_degrees(oct_decode(tangent), t));
+        }
+    }
+
+    return error;
+}
+
+Gfx_Vertex_Pack_Error gfx_vertex_pack_bound(const Gfx_Packed_Vertices *packed) {
+    Gfx_Vertex_Pack_Error bound{};
+    if (packed->layout == GFX_VERTEX_LAYOUT_FLOAT) return bound;
+
+    // Rounding to the nearest snorm16 is off by half a step, plus the float
+    // rounding of the dequant transform.
+    glm::vec3 half_step = packed->dequant_scale * (0.5f / SNORM16_MAX);
+    glm::vec3 rounding  = (glm::abs(packed->dequant_scale) + glm::abs(packed->dequant_offset)) * (4.0f * SDL_FLT_EPSILON);
+    bound.position = glm::length(half_step + rounding);
+
+    // Half a step on both octahedral coordinates moves the point on the
+    // octahedron by at most sqrt(6) half steps, and the point is at least
+    // 1 / sqrt(3) from the center: 3 sqrt(2) half steps of angle.
+    f32 octahedral = 3.0f * SDL_sqrtf(2.0f) * (0.5f / SNORM16_MAX) * (180.0f / SDL_PI_F) + 1e-5f;
+    bound.normal_degrees  = octahedral;
+    bound.tangent_degrees = packed->layout == GFX_VERTEX_LAYOUT_COMPACT_TANGENT ? octahedral : 0.0f;
+
+    // Round to nearest even: half an ulp of 2^-10.
+    bound.texcoord = (1.0f / 2048.0f) * 1.0001f;
+    return bound;
+}
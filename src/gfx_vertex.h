@@ -0,0 +1,108 @@
+#pragma once
+
+#include "defines.h"
+#include "job.h"
+
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+
+struct Gfx_Mesh;
+
+//
+// GPU vertex layouts generated from Gfx_Mesh.
+//
+// Attribute locations are shared by all layouts:
+//     0 position, 1 normal, 2 texcoord, 3 tangent (if present).
+//
+// Every layout also reads a Gfx_Instance per instance from buffer slot 1:
+//     4-7 model transform columns.
+//
+// Compact layouts store positions as snorm16 relative to the mesh bounds and
+// undo it with the per-mesh dequant transform: p = q * scale + offset. Normals
+// and tangents are octahedral-encoded snorm16x2, the tangent handedness lives
+// in position.w. Texcoords are half floats.
+//
+
+enum Gfx_Vertex_Layout {
+    GFX_VERTEX_LAYOUT_FLOAT,           // 32 bytes, reference layout.
+    GFX_VERTEX_LAYOUT_COMPACT,         // 16 bytes.
+    GFX_VERTEX_LAYOUT_COMPACT_TANGENT, // 20 bytes.
+
+    GFX_VERTEX_LAYOUT_COUNT,
+};
+
+struct Gfx_Vertex_Float {
+    f32 position[3];
+    f32 normal[3];
+    f32 texcoord[2];
+};
+
+struct Gfx_Vertex_Compact {
+    s16 position[4];
+    s16 normal[2];
+    u16 texcoord[2];
+};
+
+struct Gfx_Vertex_Compact_Tangent {
+    s16 position[4];
+    s16 normal[2];
+    u16 texcoord[2];
+    s16 tangent[2];
+};
+
+struct Gfx_Instance {
+    glm::mat4 transform;
+};
+
+#define GFX_INSTANCE_BUFFER_SLOT 1
+
+struct Gfx_Vertex_Input {
+    SDL_GPUVertexBufferDescription buffers[2];
+    SDL_GPUVertexAttribute attributes[8];
+    SDL_GPUVertexInputState state;
+};
+
+struct Gfx_Packed_Vertices {
+    Gfx_Vertex_Layout layout = GFX_VERTEX_LAYOUT_FLOAT;
+    u32 vertex_count = 0;
+    u32 stride       = 0;
+    u8 *data         = NULL;
+
+    // Dequant transform, identity for GFX_VERTEX_LAYOUT_FLOAT.
+    glm::vec3 dequant_scale  = glm::vec3(1.0f);
+    glm::vec3 dequant_offset = glm::vec3(0.0f);
+};
+
+// Largest round-trip error over all vertices of a packed mesh.
+struct Gfx_Vertex_Pack_Error {
+    f32 position;       // Object-space distance.
+    f32 normal_degrees;
+    f32 tangent_degrees;
+    f32 texcoord;       // Relative to the value, or to 2^-14, the smallest normal half, below it.
+};
+
+u32 gfx_vertex_stride(Gfx_Vertex_Layout layout);
+const char *gfx_vertex_layout_name(Gfx_Vertex_Layout layout);
+
+// Fills the vertex and instance buffer descriptions and attributes for a layout. The input
+// state points into `input`, so keep it alive until the pipeline is created.
+void gfx_vertex_input(Gfx_Vertex_Layout layout, Gfx_Vertex_Input *input);
+
+// Packs the mesh streams into an interleaved buffer. Missing normals default
+// to +Z, missing texcoords and tangents to zero. Large meshes are packed as
+// parallel jobs when jobs is set. Returns false on allocation failure.
+bool gfx_vertex_pack(const Gfx_Mesh *mesh, Gfx_Vertex_Layout layout, Gfx_Packed_Vertices *out, Job_System *jobs = NULL);
+void gfx_vertex_free(Gfx_Packed_Vertices *packed);
+
+// Decodes the packed vertices on the CPU and compares them to the mesh.
+Gfx_Vertex_Pack_Error gfx_vertex_pack_error(const Gfx_Mesh *mesh, const Gfx_Packed_Vertices *packed);
+
+// Largest error gfx_vertex_pack_error() may find for packed, from the
+// encodings alone: half a snorm16 step of the bounds on every axis, the
+// octahedral bound for normals and tangents, and half a half-float ulp,
+// 2^-11 relative, for texcoords. All zero for GFX_VERTEX_LAYOUT_FLOAT.
+Gfx_Vertex_Pack_Error gfx_vertex_pack_bound(const Gfx_Packed_Vertices *packed);
+
+// Scalar conversions used by the packing kernels.
+u16 gfx_f32_to_f16(f32 value);
+f32 gfx_f16_to_f32(u16 value);
@@ -0,0 +1,239 @@
+#include "job.h"
+#include "profile.h"
+
+// Spins before an idle worker goes to sleep.
+#define JOB_IDLE_SPINS 256
+
+// Worker of the current thread, NULL outside of any job system.
+static thread_local Job_Worker *current_worker = NULL;
+static thread_local u32 steal_seed = 1;
+
+static bool push_job(Job_Worker *worker, const Job *job) {
+    SDL_LockSpinlock(&worker->lock);
+    bool pushed = worker->bottom - worker->top < JOB_DEQUE_CAPACITY;
+    if (pushed) {
+        worker->jobs[worker->bottom & (JOB_DEQUE_CAPACITY - 1)] = *job;
+        worker->bottom++;
+    }
+    SDL_UnlockSpinlock(&worker->lock);
+    return pushed;
+}
+
+// Newest job, for the owner.
+static bool pop_job(Job_Worker *worker, Job *job) {
+    SDL_LockSpinlock(&worker->lock);
+    bool popped = worker->bottom != worker->top;
+    if (popped) {
+        worker->bottom--;
+        *job = worker->jobs[worker->bottom & (JOB_DEQUE_CAPACITY - 1)];
+    }
+    SDL_UnlockSpinlock(&worker->lock);
+    return popped;
+}
+
+// Oldest job, for thieves. Old jobs tend to be the large ones.
+static bool steal_job(Job_Worker *worker, Job *job) {
+    SDL_LockSpinlock(&worker->lock);
+    bool stolen = worker->bottom != worker->top;
+    if (stolen) {
+        *job = worker->jobs[worker->top & (JOB_DEQUE_CAPACITY - 1)];
+        worker->top++;
+    }
+    SDL_UnlockSpinlock(&worker->lock);
+    return stolen;
+}
+
+static void execute_job(const Job *job) {
+    PROFILE_ZONE("job");
+    if (job->range_func) job->range_func(job->data, job->begin, job->end);
+    else                 job->func(job->data);
+
+    if (job->counter) SDL_AddAtomicInt(&job->counter->pending, -1);
+}
+
+// The worker of the calling thread in system, NULL for outside threads.
+static Job_Worker *self_in(Job_System *system) {
+    return current_worker != NULL && current_worker->system == system ? current_worker : NULL;
+}
+
+// Own deque first, then every other deque once, starting at a random one.
+static bool find_job(Job_System *system, Job_Worker *self, Job *job) {
+    if (self && pop_job(self, job)) return true;
+
+    steal_seed = steal_seed * 1664525u + 1013904223u;
+    int count = system->worker_count;
+    int start = cast(int)((steal_seed >> 16) % cast(u32)count);
+    for (int i = 0; i < count; i++) {
+        Job_Worker *victim = &system->workers[(start + i) % count];
+        if (victim != self && steal_job(victim, job)) return true;
+    }
+    return false;
+}
+
+static void wake_workers(Job_System *system, int job_count) {
+    // The read-modify-write orders the push before reading the sleeper count,
+    // a sleeper that was missed anyway wakes up on its timeout.
+    int sleeping = SDL_AddAtomicInt(&system->sleeping, 0);
+    for (int i = 0; i < SDL_min(sleeping, job_count); i++) SDL_SignalSemaphore(system->wake);
+}
+
+static int worker_main(void *userdata) {
+    auto worker = cast(Job_Worker *)userdata;
+    Job_System *system = worker->system;
+
+    current_worker = worker;
+    steal_seed = cast(u32)worker->index * 2654435761u + 1;
+    profile_set_thread_name("job_worker");
+
+    int idle = 0;
+    while (!SDL_GetAtomicInt(&system->quit)) {
+        Job job;
+        if (find_job(system, worker, &job)) {
+            execute_job(&job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < JOB_IDLE_SPINS) {
+            SDL_CPUPauseInstruction();
+            continue;
+        }
+
+        // Announce the sleep before the last look, so a push after it wakes
+        // this worker.
+        SDL_AddAtomicInt(&system->sleeping, 1);
+        bool found = find_job(system, worker, &job);
+        if (!found) SDL_WaitSemaphoreTimeout(system->wake, 2);
+        SDL_AddAtomicInt(&system->sleeping, -1);
+
+        if (found) execute_job(&job);
+        idle = 0;
+    }
+
+    current_worker = NULL;
+    return 0;
+}
+
+bool job_system_init(Job_System *system, int worker_count) {
+    *system = {};
+
+    if (worker_count <= 0) worker_count = SDL_GetNumLogicalCPUCores();
+    worker_count = SDL_clamp(worker_count, 1, JOB_MAX_WORKERS);
+
+    auto workers = cast(Job_Worker *)SDL_aligned_alloc(alignof(Job_Worker), cast(usize)worker_count * sizeof(Job_Worker));
+    auto jobs    = cast(Job *)SDL_malloc(cast(usize)worker_count * JOB_DEQUE_CAPACITY * sizeof(Job));
+    SDL_Semaphore *wake = SDL_CreateSemaphore(0);
+    if (!workers || !jobs || !wake) {
+        SDL_aligned_free(workers);
+        SDL_free(jobs);
+        if (wake) SDL_DestroySemaphore(wake);
+        return false;
+    }
+
+    SDL_memset(workers, 0, cast(usize)worker_count * sizeof(Job_Worker));
+    for (int i = 0; i < worker_count; i++) {
+        workers[i].system = system;
+        workers[i].index  = i;
+        workers[i].jobs   = jobs + cast(usize)i * JOB_DEQUE_CAPACITY;
+    }
+
+    system->workers      = workers;
+    system->worker_count = worker_count;
+    system->wake         = wake;
+    current_worker = &workers[0];
+
+    // A worker without a thread only loses its share, its deque stays empty.
+    for (int i = 1; i < worker_count; i++) {
+        system->threads[i] = SDL_CreateThread(worker_main, "job_worker", &workers[i]);
+    }
+
+    return true;
+}
+
+void job_system_shutdown(Job_System *system) {
+    if (system->workers == NULL) return;
+
+    SDL_SetAtomicInt(&system->quit, 1);
+    for (int i = 1; i < system->worker_count; i++) SDL_SignalSemaphore(system->wake);
+    for (int i = 1; i < system->worker_count; i++) {
+        if (system->threads[i]) SDL_WaitThread(system->threads[i], NULL);
+    }
+
+    if (self_in(system)) current_worker = NULL;
+
+    // Worker 0 holds the start of the job block.
+    SDL_free(system->workers[0].jobs);
+    SDL_aligned_free(system->workers);
+    SDL_DestroySemaphore(system->wake);
+    *system = {};
+}
+
+int job_worker_count(const Job_System *system) {
+    return system != NULL && system->worker_count > 1 ? system->worker_count : 1;
+}
+
+void job_run(Job_System *system, Job_Func func, void *data, Job_Counter *counter) {
+    Job job{};
+    job.func    = func;
+    job.data    = data;
+    job.counter = counter;
+    if (counter) SDL_AddAtomicInt(&counter->pending, 1);
+
+    if (job_worker_count(system) == 1) {
+        execute_job(&job);
+        return;
+    }
+
+    // Outside threads queue on worker 0.
+    Job_Worker *self = self_in(system);
+    if (!push_job(self ? self : &system->workers[0], &job)) {
+        execute_job(&job);
+        return;
+    }
+    wake_workers(system, 1);
+}
+
+void job_wait(Job_System *system, Job_Counter *counter) {
+    if (counter == NULL) return;
+
+    Job_Worker *self = system ? self_in(system) : NULL;
+    while (SDL_GetAtomicInt(&counter->pending) > 0) {
+        Job job;
+        if (system && system->workers && find_job(system, self, &job)) execute_job(&job);
+        else SDL_CPUPauseInstruction();
+    }
+}
+
+void job_parallel_for(Job_System *system, int count, int batch, Job_Range_Func func, void *data) {
+    if (count <= 0) return;
+
+    int workers = job_worker_count(system);
+    if (batch <= 0) batch = SDL_max(count / (workers * 4), 1);
+    if (workers == 1 || batch >= count) {
+        func(data, 0, count);
+        return;
+    }
+
+    Job_Worker *self = self_in(system);
+    Job_Worker *queue = self ? self : &system->workers[0];
+
+    // The caller keeps the first range for itself.
+    Job_Counter counter{};
+    int pushed = 0;
+    for (int begin = batch; begin < count; begin += batch) {
+        Job job{};
+        job.range_func = func;
+        job.data       = data;
+        job.begin      = begin;
+        job.end        = begin + SDL_min(batch, count - begin);
+        job.counter    = &counter;
+
+        SDL_AddAtomicInt(&counter.pending, 1);
+        if (push_job(queue, &job)) pushed++;
+        else execute_job(&job);
+    }
+    wake_workers(system, pushed);
+
+    func(data, 0, batch);
+    job_wait(system, &counter);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "defines.h"
+
+#include <SDL3/SDL.h>
+
+//
+// Work-stealing job system.
+//
+// Every worker thread owns a deque of jobs. Workers push and pop at the bottom
+// of their own deque, newest first, and steal from the top of a random other
+// deque when theirs is empty. The thread that calls job_system_init() is
+// worker 0: it has a deque too, and runs jobs while it waits.
+//
+// Completion is tracked with counters. job_run() adds one to the counter
+// before the job is queued and the job subtracts it when done. job_wait()
+// runs queued jobs until the counter drops to zero, so waiting never blocks a
+// worker, and a job may itself spawn and wait for other jobs. A dependency is
+// a wait on the counter of the jobs that must finish first.
+//
+// Deques are guarded by spinlocks, which are held for a few instructions. A
+// job pushed onto a full deque runs right away instead.
+//
+// Everything accepts a NULL system and then runs serially on the calling
+// thread, so callers do not need a second code path.
+//
+
+#define JOB_MAX_WORKERS    64
+#define JOB_DEQUE_CAPACITY 4096 // Power of two.
+
+typedef void (*Job_Func)(void *data);
+
+// Runs the items [begin, end) of a job_parallel_for().
+typedef void (*Job_Range_Func)(void *data, int begin, int end);
+
+struct Job_Counter {
+    SDL_AtomicInt pending;
+};
+
+struct Job {
+    Job_Func func;
+    Job_Range_Func range_func;
+    void *data;
+    int begin;
+    int end;
+    Job_Counter *counter;
+};
+
+struct Job_System;
+
+struct alignas(64) Job_Worker {
+    Job_System *system;
+    int index;
+
+    // Deque of JOB_DEQUE_CAPACITY jobs. Workers sit on their own cache
+    // lines so the locks do not contend.
+    SDL_SpinLock lock;
+    u32 top;    // Next to steal.
+    u32 bottom; // Next free slot.
+    Job *jobs;
+};
+
+struct Job_System {
+    int worker_count = 0; // Including the thread that called job_system_init().
+    SDL_Thread *threads[JOB_MAX_WORKERS];
+    Job_Worker *workers = NULL;
+
+    // Idle workers sleep on this after spinning for a while.
+    SDL_Semaphore *wake = NULL;
+    SDL_AtomicInt sleeping;
+    SDL_AtomicInt quit;
+};
+
+// Starts worker_count - 1 threads, 0 means one worker per logical core. The
+// system must not move while it runs. Returns false on failure, the system
+// is then usable and runs serially.
+bool job_system_init(Job_System *system, int worker_count);
+
+// All counters must have been waited on.
+void job_system_shutdown(Job_System *system);
+
+// 1 when system is NULL.
+int job_worker_count(const Job_System *system);
+
+// counter may be NULL for jobs nobody waits on.
+void job_run(Job_System *system, Job_Func func, void *data, Job_Counter *counter);
+void job_wait(Job_System *system, Job_Counter *counter);
+
+// Splits [0, count) into ranges of batch items, 0 picks a few ranges per
+// worker, and returns when all of them ran. The caller runs ranges too.
+void job_parallel_for(Job_System *system, int count, int batch, Job_Range_Func func, void *data);
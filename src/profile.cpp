@@ -0,0 +1,293 @@
+#include "profile.h"
+#include "file.h"
+
+#if PROFILE_ENABLED
+
+// All rings, newest first. Pushed with a compare and swap, released together.
+static void *profile_threads = NULL;
+static SDL_AtomicInt profile_thread_count;
+static thread_local Profile_Thread *current_thread = NULL;
+
+Profile_Thread *profile_thread() {
+    if (current_thread) return current_thread;
+
+    auto thread = cast(Profile_Thread *)SDL_calloc(1, sizeof(Profile_Thread));
+    if (!thread) return NULL;
+    thread->thread_id = SDL_GetCurrentThreadID();
+    thread->index     = SDL_AddAtomicInt(&profile_thread_count, 1) + 1;
+
+    void *head;
+    do {
+        head = SDL_GetAtomicPointer(&profile_threads);
+        thread->next = cast(Profile_Thread *)head;
+    } while (!SDL_CompareAndSwapAtomicPointer(&profile_threads, head, thread));
+
+    current_thread = thread;
+    return thread;
+}
+
+void profile_set_thread_name(const char *name) {
+    Profile_Thread *thread = profile_thread();
+    if (thread) thread->name = name;
+}
+
+// Frame phases, main thread only. A sample below zero is a frame the phase
+// did not run in.
+struct Profile_Phase {
+    const char *name;
+    f64 frame_ms; // Of the frame in progress, below zero until it runs.
+    f32 samples_ms[PROFILE_WINDOW];
+};
+
+struct Profile_Frames {
+    Profile_Phase phases[PROFILE_MAX_PHASES];
+    int phase_count;
+
+    int window_next;
+    int window_count;
+
+    u32 processed; // Events of the main thread already summed.
+    u64 last_frame_ns;
+};
+
+static Profile_Frames frames;
+
+static Profile_Phase *find_phase(const char *name) {
+    for (int i = 0; i < frames.phase_count; i++) {
+        Profile_Phase *phase = &frames.phases[i];
+        if (phase->name == name || SDL_strcmp(phase->name, name) == 0) return phase;
+    }
+    if (frames.phase_count == PROFILE_MAX_PHASES) return NULL;
+
+    Profile_Phase *phase = &frames.phases[frames.phase_count++];
+    phase->name     = name;
+    phase->frame_ms = -1.0;
+    for (int i = 0; i < PROFILE_WINDOW; i++) phase->samples_ms[i] = -1.0f;
+    return phase;
+}
+
+static void add_time(Profile_Phase *phase, f64 ms) {
+    if (!phase) return;
+    if (phase->frame_ms < 0.0) phase->frame_ms = 0.0;
+    phase->frame_ms += ms;
+}
+
+void profile_frame_end() {
+    Profile_Thread *thread = profile_thread();
+    if (!thread) return;
+
+    u64 now = profile_now();
+    if (frames.phase_count == 0) find_phase("frame");
+    if (frames.last_frame_ns != 0) add_time(&frames.phases[0], cast(f64)(now - frames.last_frame_ns) / 1e6);
+    frames.last_frame_ns = now;
+
+    // Zones that closed since the last frame, the oldest are lost if the
+    // ring wrapped around in between.
+    u32 head  = SDL_GetAtomicU32(&thread->head);
+    u32 first = frames.processed;
+    if (head - first > PROFILE_RING_CAPACITY) first = head - PROFILE_RING_CAPACITY;
+    for (u32 i = first; i != head; i++) {
+        const Profile_Event *event = &thread->events[i & (PROFILE_RING_CAPACITY - 1)];
+        add_time(find_phase(event->name), cast(f64)(event->end_ns - event->begin_ns) / 1e6);
+    }
+    frames.processed = head;
+
+    for (int i = 0; i < frames.phase_count; i++) {
+        Profile_Phase *phase = &frames.phases[i];
+        phase->samples_ms[frames.window_next] = cast(f32)phase->frame_ms;
+        phase->frame_ms = -1.0;
+    }
+    frames.window_next  = (frames.window_next + 1) % PROFILE_WINDOW;
+    frames.window_count = SDL_min(frames.window_count + 1, PROFILE_WINDOW);
+}
+
+static int compare_f32(const void *a, const void *b) {
+    f32 x = *cast(const f32 *)a;
+    f32 y = *cast(const f32 *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank of a sorted window.
+static f64 percentile(const f32 *sorted, int count, f64 p) {
+    int rank = cast(int)SDL_ceil(p * count);
+    return sorted[SDL_clamp(rank - 1, 0, count - 1)];
+}
+
+int profile_phase_stats(Profile_Phase_Stats *stats, int capacity) {
+    f32 sorted[PROFILE_WINDOW];
+
+    int count = 0;
+    for (int i = 0; i < frames.phase_count && count < capacity; i++) {
+        const Profile_Phase *phase = &frames.phases[i];
+
+        int sample_count = 0;
+        f64 sum = 0.0;
+        for (int si = 0; si < frames.window_count; si++) {
+            if (phase->samples_ms[si] < 0.0f) continue;
+            sorted[sample_count++] = phase->samples_ms[si];
+            sum += phase->samples_ms[si];
+        }
+        if (sample_count == 0) continue;
+        SDL_qsort(sorted, cast(usize)sample_count, sizeof(f32), compare_f32);
+
+        Profile_Phase_Stats *phase_stats = &stats[count++];
+        phase_stats->name    = phase->name;
+        phase_stats->frames  = sample_count;
+        phase_stats->p50_ms  = percentile(sorted, sample_count, 0.50);
+        phase_stats->p99_ms  = percentile(sorted, sample_count, 0.99);
+        phase_stats->max_ms  = sorted[sample_count - 1];
+        phase_stats->mean_ms = sum / sample_count;
+    }
+    return count;
+}
+
+void profile_log_stats() {
+    Profile_Phase_Stats stats[PROFILE_MAX_PHASES];
+    int count = profile_phase_stats(stats, PROFILE_MAX_PHASES);
+
+    SDL_Log("Frame phases over the last %d frame(s), in ms:", frames.window_count);
+    SDL_Log("  %-24s %6s %8s %8s %8s %8s", "phase", "frames", "p50", "p99", "max", "mean");
+    for (int i = 0; i < count; i++) {
+        const Profile_Phase_Stats *phase = &stats[i];
+        SDL_Log("  %-24s %6d %8.3f %8.3f %8.3f %8.3f", phase->name, phase->frames, phase->p50_ms, phase->p99_ms,
+                phase->max_ms, phase->mean_ms);
+    }
+}
+
+void profile_reset_stats() {
+    Profile_Thread *thread = profile_thread();
+    if (!thread) return;
+
+    for (int i = 0; i < frames.phase_count; i++) {
+        Profile_Phase *phase = &frames.phases[i];
+        phase->frame_ms = -1.0;
+        for (int si = 0; si < PROFILE_WINDOW; si++) phase->samples_ms[si] = -1.0f;
+    }
+    frames.window_next  = 0;
+    frames.window_count = 0;
+    frames.processed    = SDL_GetAtomicU32(&thread->head);
+    frames.last_frame_ns = profile_now();
+}
+
+// Copies the events of a thread that are still intact. Returns the count.
+static u32 snapshot(Profile_Thread *thread, Profile_Event *events) {
+    u32 head  = SDL_GetAtomicU32(&thread->head);
+    u32 count = SDL_min(head, cast(u32)PROFILE_RING_CAPACITY);
+    u32 first = head - count;
+    for (u32 i = 0; i < count; i++) events[i] = thread->events[(first + i) & (PROFILE_RING_CAPACITY - 1)];
+
+    // The owner may be writing event head by now, over event head -
+    // capacity, so only the events after that one are intact.
+    u32 head_now = SDL_GetAtomicU32(&thread->head);
+    s32 lost = SDL_clamp(cast(s32)(head_now + 1 - PROFILE_RING_CAPACITY - first), 0, cast(s32)count);
+    SDL_memmove(events, events + lost, (count - cast(u32)lost) * sizeof(Profile_Event));
+    return count - cast(u32)lost;
+}
+
+struct Trace_Text {
+    char *data;
+    usize size;
+    usize capacity;
+};
+
+static void append(Trace_Text *text, const char *string) {
+    for (; *string && text->size + 1 < text->capacity; string++) text->data[text->size++] = *string;
+}
+
+// Names are literals, anything that would need escaping is replaced.
+static void append_name(Trace_Text *text, const char *name) {
+    for (; *name && text->size + 1 < text->capacity; name++) {
+        char c = *name;
+        text->data[text->size++] = (c == '"' || c == '\\' || cast(u8)c < 0x20) ? '_' : c;
+    }
+}
+
+static void append_us(Trace_Text *text, u64 ns) {
+    char number[32];
+    SDL_snprintf(number, sizeof(number), "%llu.%03u", cast(unsigned long long)(ns / 1000), cast(u32)(ns % 1000));
+    append(text, number);
+}
+
+bool profile_write_trace(const char *file) {
+    int thread_count = 0;
+    for (auto thread = cast(Profile_Thread *)SDL_GetAtomicPointer(&profile_threads); thread; thread = thread->next) thread_count++;
+    if (thread_count == 0) return false;
+
+    auto events = cast(Profile_Event *)SDL_malloc(cast(usize)thread_count * PROFILE_RING_CAPACITY * sizeof(Profile_Event));
+    auto counts = cast(u32 *)SDL_malloc(cast(usize)thread_count * sizeof(u32));
+    defer { SDL_free(events); SDL_free(counts); };
+    if (!events || !counts) return false;
+
+    // Threads created after the count are left out.
+    usize capacity = 64;
+    u64 start_ns = ~0ull;
+    Profile_Thread *thread = cast(Profile_Thread *)SDL_GetAtomicPointer(&profile_threads);
+    for (int ti = 0; ti < thread_count; ti++, thread = thread->next) {
+        Profile_Event *thread_events = events + cast(usize)ti * PROFILE_RING_CAPACITY;
+        counts[ti] = snapshot(thread, thread_events);
+        capacity += 128 + (thread->name ? SDL_strlen(thread->name) : 0);
+        for (u32 i = 0; i < counts[ti]; i++) {
+            capacity += 128 + SDL_strlen(thread_events[i].name);
+            start_ns = SDL_min(start_ns, thread_events[i].begin_ns);
+        }
+    }
+
+    Trace_Text text = {};
+    text.data = cast(char *)SDL_malloc(capacity);
+    text.capacity = capacity;
+    defer { SDL_free(text.data); };
+    if (!text.data) return false;
+
+    append(&text, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    char number[32];
+
+    thread = cast(Profile_Thread *)SDL_GetAtomicPointer(&profile_threads);
+    for (int ti = 0; ti < thread_count; ti++, thread = thread->next) {
+        SDL_snprintf(number, sizeof(number), "%d", thread->index);
+
+        if (thread->name) {
+            append(&text, first ? "" : ",\n");
+            append(&text, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+            append(&text, number);
+            append(&text, ",\"args\":{\"name\":\"");
+            append_name(&text, thread->name);
+            append(&text, "\"}}");
+            first = false;
+        }
+
+        const Profile_Event *thread_events = events + cast(usize)ti * PROFILE_RING_CAPACITY;
+        for (u32 i = 0; i < counts[ti]; i++) {
+            const Profile_Event *event = &thread_events[i];
+            append(&text, first ? "" : ",\n");
+            append(&text, "{\"name\":\"");
+            append_name(&text, event->name);
+            append(&text, "\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+            append(&text, number);
+            append(&text, ",\"ts\":");
+            append_us(&text, event->begin_ns - start_ns);
+            append(&text, ",\"dur\":");
+            append_us(&text, event->end_ns - event->begin_ns);
+            append(&text, "}");
+            first = false;
+        }
+    }
+    append(&text, "\n]}\n");
+
+    return save_file_atomic(file, text.data, text.size);
+}
+
+void profile_shutdown() {
+    auto thread = cast(Profile_Thread *)SDL_SetAtomicPointer(&profile_threads, NULL);
+    while (thread) {
+        Profile_Thread *next = thread->next;
+        SDL_free(thread);
+        thread = next;
+    }
+
+    SDL_SetAtomicInt(&profile_thread_count, 0);
+    current_thread = NULL;
+    frames = {};
+}
+
+#endif
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "defines.h"
+
+#include <SDL3/SDL.h>
+
+//
+// Frame profiler.
+//
+// PROFILE_ZONE("name") times the rest of the enclosing scope, the same way
+// defer runs at its end. The zone is recorded when the scope closes, as one
+// event with nanosecond begin and end timestamps, into a ring owned by the
+// calling thread. Only the owner writes to its ring, so recording takes no
+// lock: a timestamp, a store and an atomic increment. A full ring overwrites
+// its oldest events. Names must be string literals, only the pointer is
+// kept.
+//
+// profile_frame_end(), called once per frame on the main thread, sums the
+// zones the main thread closed since the last call by name. Each name is a
+// frame phase with a window of its last PROFILE_WINDOW frames, p50 and p99
+// come from that window. The time between two calls is the "frame" phase.
+// Zones of other threads only go to the trace.
+//
+// profile_write_trace() writes the events still in all rings as Chrome
+// trace event JSON, for chrome://tracing or ui.perfetto.dev. Call it while
+// the other threads are quiet. An event a thread overwrites during the copy
+// is dropped, not torn.
+//
+// Builds without PROFILE_ENABLED (the PROFILE CMake option) compile zones to
+// nothing and the functions to empty inlines.
+//
+
+#ifndef PROFILE_ENABLED
+    #define PROFILE_ENABLED 0
+#endif
+
+#define PROFILE_RING_CAPACITY 16384 // Events per thread, a power of two.
+#define PROFILE_MAX_PHASES    64
+
+#ifndef PROFILE_WINDOW
+    #define PROFILE_WINDOW 240 // Frames of the rolling phase stats.
+#endif
+
+struct Profile_Phase_Stats {
+    const char *name = NULL;
+    int frames = 0; // Frames of the window the phase ran in.
+    f64 p50_ms  = 0;
+    f64 p99_ms  = 0;
+    f64 max_ms  = 0;
+    f64 mean_ms = 0;
+};
+
+#if PROFILE_ENABLED
+
+struct Profile_Event {
+    const char *name;
+    u64 begin_ns;
+    u64 end_ns;
+};
+
+struct Profile_Thread {
+    Profile_Event events[PROFILE_RING_CAPACITY];
+    SDL_AtomicU32 head; // Events written, wraps around.
+    SDL_ThreadID thread_id;
+    const char *name;   // Optional, for the trace.
+    int index;          // Trace thread id.
+    Profile_Thread *next;
+};
+
+// The ring of the calling thread, created on first use. NULL if that fails,
+// the zones of the thread are then dropped.
+Profile_Thread *profile_thread();
+
+inline u64 profile_now() {
+    return SDL_GetTicksNS();
+}
+
+inline void profile_record(const char *name, u64 begin_ns, u64 end_ns) {
+    Profile_Thread *thread = profile_thread();
+    if (!thread) return;
+
+    u32 head = SDL_GetAtomicU32(&thread->head);
+    Profile_Event *event = &thread->events[head & (PROFILE_RING_CAPACITY - 1)];
+    event->name     = name;
+    event->begin_ns = begin_ns;
+    event->end_ns   = end_ns;
+    SDL_SetAtomicU32(&thread->head, head + 1);
+}
+
+struct Profile_Zone {
+    const char *name;
+    u64 begin_ns;
+
+    Profile_Zone(const char *name) : name(name), begin_ns(profile_now()) {}
+    ~Profile_Zone() { profile_record(name, begin_ns, profile_now()); }
+
+    Profile_Zone(const Profile_Zone &) = delete;
+    Profile_Zone &operator=(const Profile_Zone &) = delete;
+};
+
+#define PROFILE_ZONE(name) Profile_Zone GLUE(profile_zone__, __LINE__)(name)
+
+// Names the calling thread in the trace, a string literal.
+void profile_set_thread_name(const char *name);
+
+// Closes the frame of the main thread, see above.
+void profile_frame_end();
+
+// Fills stats with up to capacity phases, the frame first, then in order of
+// first appearance. Returns the count.
+int profile_phase_stats(Profile_Phase_Stats *stats, int capacity);
+
+// Logs the phase stats, one line per phase.
+void profile_log_stats();
+
+// Empties the phase windows, for stats that leave out the frames so far.
+// The next frame is timed from this call.
+void profile_reset_stats();
+
+// Writes the trace to file, through a temporary file. Returns false on
+// failure.
+bool profile_write_trace(const char *file);
+
+// Releases every ring. Call once no other thread records anymore.
+void profile_shutdown();
+
+#else
+
+#define PROFILE_ZONE(name)
+
+inline void profile_set_thread_name(const char *) {}
+inline void profile_frame_end() {}
+inline int profile_phase_stats(Profile_Phase_Stats *, int) { return 0; }
+inline void profile_log_stats() {}
+inline void profile_reset_stats() {}
+inline bool profile_write_trace(const char *) { return false; }
+inline void profile_shutdown() {}
+
+#endif